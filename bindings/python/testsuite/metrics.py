@@ -0,0 +1,30 @@
+#!/usr/bin/python3
+
+import unittest
+import storage
+
+
+class TestMetrics(unittest.TestCase):
+
+    def test_metrics(self):
+
+        environment = storage.Environment(True, storage.ProbeMode_NONE, storage.TargetMode_DIRECT)
+        s = storage.Storage(environment)
+
+        devicegraph = storage.Devicegraph(s)
+
+        storage.Disk.create(devicegraph, "/dev/sda")
+
+        self.assertTrue(storage.Disk.find_by_name(devicegraph, "/dev/sda"))
+
+        metrics = s.get_metrics()
+
+        self.assertTrue(metrics.counters['device_lookups_total{function="find_by_name"}'] >= 1)
+        self.assertTrue(metrics.counters["devicegraph_copies_total"] >= 2)
+
+        for name, histogram in metrics.histograms.items():
+            self.assertEqual(len(histogram.bucket_bounds), len(histogram.bucket_counts))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -424,6 +424,8 @@
 %catches(storage::Exception) storage::Storage::get_system();
 %catches(storage::Exception) storage::Storage::get_system() const;
 %catches(storage::Aborted, storage::Exception) storage::Storage::probe(const ProbeCallbacks *probe_callbacks=nullptr);
+%catches(storage::Aborted, storage::Exception) storage::Storage::reprobe(const std::vector< std::string > &changed_devices, const ProbeCallbacks *probe_callbacks=nullptr);
+%catches(storage::Exception) storage::Storage::probe_lazy_details();
 %catches(storage::Exception) storage::Storage::remove_devicegraph(const std::string &name);
 %catches(storage::Exception) storage::Storage::remove_pool(const std::string &name);
 %catches(storage::Exception) storage::Storage::rename_pool(const std::string &old_name, const std::string &new_name);
@@ -431,5 +433,7 @@
 %catches(storage::DeviceNotFound, storage::DeviceHasWrongType) storage::StrayBlkDevice::find_by_name(Devicegraph *devicegraph, const std::string &name);
 %catches(storage::DeviceNotFound, storage::DeviceHasWrongType) storage::StrayBlkDevice::find_by_name(const Devicegraph *devicegraph, const std::string &name);
 %catches(storage::HolderAlreadyExists) storage::Subdevice::create(Devicegraph *devicegraph, const Device *source, const Device *target);
+%catches(storage::Exception) storage::UeventMonitor::UeventMonitor();
+%catches(storage::Exception) storage::UeventMonitor::get_changed_devices();
 %catches(storage::HolderAlreadyExists) storage::User::create(Devicegraph *devicegraph, const Device *source, const Device *target);
 
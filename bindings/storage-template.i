@@ -118,3 +118,7 @@
 %template(VectorConstPoolPtr) std::vector<const Pool*>;
 %template(MapStringConstPoolPtr) std::map<std::string, const Pool*>;
 
+%template(VectorDouble) std::vector<double>;
+%template(VectorUnsignedLongLong) std::vector<unsigned long long>;
+%template(MapStringUnsignedLongLong) std::map<std::string, unsigned long long>;
+%template(MapStringMetricsHistogram) std::map<std::string, MetricsHistogram>;
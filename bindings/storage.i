@@ -35,9 +35,11 @@ use_ostream(storage::PartitionSlot);
 %feature("director") storage::ProbeCallbacksV2;
 %feature("director") storage::ProbeCallbacksV3;
 %feature("director") storage::ProbeCallbacksV4;
+%feature("director") storage::ProbeCallbacksV5;
 %feature("director") storage::CheckCallbacks;
 %feature("director") storage::CommitCallbacks;
 %feature("director") storage::CommitCallbacksV2;
+%feature("director") storage::CommitCallbacksV3;
 %feature("director") storage::RemoteCallbacks;
 %feature("director") storage::DevicegraphStyleCallbacks;
 %feature("director") storage::Logger;
@@ -59,7 +61,9 @@ use_ostream(storage::PartitionSlot);
 #include "storage/Utils/Remote.h"
 #include "storage/Utils/Callbacks.h"
 #include "storage/Utils/LightProbe.h"
+#include "storage/Utils/UeventMonitor.h"
 #include "storage/Utils/Lock.h"
+#include "storage/Utils/Metrics.h"
 #include "storage/FreeInfo.h"
 #include "storage/UsedFeatures.h"
 #include "storage/View.h"
@@ -163,7 +167,9 @@ use_ostream(storage::PartitionSlot);
 %include "../../storage/Utils/Remote.h"
 %include "../../storage/Utils/Callbacks.h"
 %include "../../storage/Utils/LightProbe.h"
+%include "../../storage/Utils/UeventMonitor.h"
 %include "../../storage/Utils/Lock.h"
+%include "../../storage/Utils/Metrics.h"
 %include "../../storage/FreeInfo.h"
 %include "../../storage/UsedFeatures.h"
 %include "../../storage/View.h"
@@ -26,9 +26,15 @@
 #include <boost/graph/transitive_reduction.hpp>
 #include <boost/graph/graph_utility.hpp>
 #include <boost/graph/graphviz.hpp>
+#include <boost/core/demangle.hpp>
+#include <boost/algorithm/string.hpp>
 
 #include "storage/Utils/Stopwatch.h"
+#include "storage/Utils/Trace.h"
+#include "storage/Utils/MetricsImpl.h"
 #include "storage/Utils/CallbacksImpl.h"
+#include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/OperationBudget.h"
 #include "storage/Devices/DeviceImpl.h"
 #include "storage/Devices/BlkDevice.h"
 #include "storage/Devices/PartitionTableImpl.h"
@@ -144,6 +150,8 @@ namespace storage
 
 	Stopwatch stopwatch;
 
+	TraceSpan trace_span("devicegraph", "generate actiongraph");
+
 	set_special_flags();
 	get_device_actions();
 	get_holder_actions();
@@ -773,6 +781,8 @@ namespace storage
     void
     Actiongraph::Impl::commit(const CommitOptions& commit_options, const CommitCallbacks* commit_callbacks) const
     {
+	static MetricsCounterFamily actions_committed("actions_committed_total", "type");
+
 	CallbacksGuard callbacks_guard(commit_callbacks);
 
 	y2mil("commit begin");
@@ -784,6 +794,8 @@ namespace storage
 
 	for (const vertex_descriptor vertex : order)
 	{
+	    LogCorrelation log_correlation("action");
+
 	    const Action::Base* action = graph[vertex].get();
 
 	    ActionCallbacksGuard action_callbacks_guard(commit_callbacks, action);
@@ -797,9 +809,22 @@ namespace storage
 	    if (action->nop)
 		continue;
 
+	    OperationBudget::check();
+
+	    TraceSpan trace_span("action", text.native);
+	    trace_span.add_arg("details", action->details());
+
 	    try
 	    {
 		action->commit(commit_data, commit_options);
+
+		string type = boost::core::demangle(typeid(*action).name());
+		boost::replace_first(type, "storage::Action::", "");
+		actions_committed.counter(type).increment();
+	    }
+	    catch (const CommandCancelledException& exception)
+	    {
+		ST_RETHROW(exception);
 	    }
 	    catch (const Exception& exception)
 	    {
@@ -816,6 +841,8 @@ namespace storage
     void
     Actiongraph::Impl::generate_compound_actions(const Actiongraph* actiongraph)
     {
+	TraceSpan trace_span("devicegraph", "generate compound actions");
+
 	compound_actions = CompoundAction::Generator(actiongraph).generate();
     }
 
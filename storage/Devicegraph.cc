@@ -44,6 +44,7 @@
 #include "storage/Utils/AppUtil.h"
 #include "storage/Utils/Logger.h"
 #include "storage/Utils/Format.h"
+#include "storage/Utils/MetricsImpl.h"
 #include "storage/GraphvizImpl.h"
 #include "storage/EnvironmentImpl.h"
 
@@ -445,6 +446,14 @@ namespace storage
 	boost::copy_graph(get_impl().graph, dest.get_impl().graph,
 			  vertex_index_map(vertex_index_map_generator.get()).
 			  vertex_copy(copier).edge_copy(copier));
+
+	static MetricsCounter& devicegraph_copies = Metrics::counter("devicegraph_copies_total");
+	static MetricsCounter& device_clones = Metrics::counter("device_clones_total");
+	static MetricsCounter& holder_clones = Metrics::counter("holder_clones_total");
+
+	devicegraph_copies.increment();
+	device_clones.increment(num_devices());
+	holder_clones.increment(num_holders());
     }
 
 
@@ -165,6 +165,15 @@ namespace storage
      *     \endparblock
      *
      * Whenever possible use the high-level functions.
+     *
+     * All const functions of a devicegraph and of its devices and holders
+     * can be used from several threads at the same time, e.g. to evaluate
+     * several proposals based on the probed devicegraph. Details detected
+     * on demand, e.g. the resize information of filesystems, are detected
+     * only once. Functions modifying the devicegraph must not run at the
+     * same time as any other function. With lazy probing, see
+     * Environment::set_lazy_probing(), call Storage::probe_lazy_details()
+     * before reading the details of btrfs from several threads.
      */
     class Devicegraph : private boost::noncopyable
     {
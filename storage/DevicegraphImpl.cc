@@ -38,6 +38,8 @@
 #include "storage/StorageImpl.h"
 #include "storage/Utils/Format.h"
 #include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/Trace.h"
+#include "storage/Utils/MetricsImpl.h"
 #include "storage/GraphvizImpl.h"
 #include "storage/Registries.h"
 
@@ -415,6 +417,9 @@ namespace storage
     Devicegraph::Impl::vertex_descriptor
     Devicegraph::Impl::find_vertex(sid_t sid) const
     {
+	static MetricsCounter& find_vertex = Metrics::counter("find_vertex_total");
+	find_vertex.increment();
+
 	for (vertex_descriptor vertex : vertices())
 	{
 	    if (graph[vertex]->get_sid() == sid)
@@ -754,6 +759,9 @@ namespace storage
 	if (&devicegraph->get_impl() != this)
 	    ST_THROW(LogicException("wrong impl-ptr"));
 
+	TraceSpan trace_span("devicegraph", "load devicegraph");
+	trace_span.add_arg("filename", filename);
+
 	clear();
 
 	XmlFile xml(filename);
@@ -811,6 +819,9 @@ namespace storage
     void
     Devicegraph::Impl::save(const string& filename) const
     {
+	TraceSpan trace_span("devicegraph", "save devicegraph");
+	trace_span.add_arg("filename", filename);
+
 	XmlFile xml;
 
 	xmlNode* devicegraph_node = xmlNewNode("Devicegraph");
@@ -30,6 +30,8 @@
 #include "storage/Utils/StorageDefines.h"
 #include "storage/Utils/SystemCmd.h"
 #include "storage/Utils/Mockup.h"
+#include "storage/Utils/Trace.h"
+#include "storage/Utils/MetricsImpl.h"
 #include "storage/Devices/BlkDeviceImpl.h"
 #include "storage/Devices/EncryptionImpl.h"
 #include "storage/Devices/BcacheImpl.h"
@@ -416,6 +418,9 @@ namespace storage
     BlkDevice::Impl::find_by_any_name(Devicegraph* devicegraph, const string& name,
 				      SystemInfo::Impl& system_info)
     {
+	static MetricsCounter& lookups = Metrics::counter("device_lookups_total{function=\"find_by_any_name\"}");
+	lookups.increment();
+
 	if (!devicegraph->get_impl().is_system() && !devicegraph->get_impl().is_probed())
 	    ST_THROW(Exception("function called on wrong devicegraph"));
 
@@ -456,6 +461,9 @@ namespace storage
     BlkDevice::Impl::find_by_any_name(const Devicegraph* devicegraph, const string& name,
 				      SystemInfo::Impl& system_info)
     {
+	static MetricsCounter& lookups = Metrics::counter("device_lookups_total{function=\"find_by_any_name\"}");
+	lookups.increment();
+
 	if (!devicegraph->get_impl().is_system() && !devicegraph->get_impl().is_probed())
 	    ST_THROW(Exception("function called on wrong devicegraph"));
 
@@ -956,6 +964,17 @@ namespace storage
     void
     wait_for_devices(const vector<const BlkDevice*>& blk_devices)
     {
+	TraceSpan trace_span("udev", "wait for devices");
+
+	if (Tracer::is_enabled())
+	{
+	    vector<string> names;
+	    for (const BlkDevice* blk_device : blk_devices)
+		names.push_back(blk_device->get_name());
+
+	    trace_span.add_arg("devices", boost::join(names, " "));
+	}
+
 	SystemCmd(UDEVADM_BIN_SETTLE);
 
 	if (Mockup::get_mode() == Mockup::Mode::PLAYBACK)
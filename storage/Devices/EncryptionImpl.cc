@@ -123,7 +123,7 @@ namespace storage
 	const CmdDmsetupInfo& cmd_dmsetup_info = system_info.getCmdDmsetupInfo();
 	const EtcCrypttab& etc_crypttab = system_info.getEtcCrypttab(storage.prepend_rootprefix(ETC_CRYPTTAB));
 
-	static int nr = 1;
+	static std::atomic<int> nr(1);
 
 	while (true)
 	{
@@ -35,6 +35,9 @@
 #include "storage/Prober.h"
 #include "storage/Utils/Format.h"
 #include "storage/Utils/StorageTmpl.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/ParallelFor.h"
+#include "storage/EnvironmentImpl.h"
 
 
 namespace storage
@@ -400,6 +403,8 @@ namespace storage
 	 * times.
 	 */
 
+	vector<BlkDevice*> blk_devices;
+
 	for (BlkDevice* blk_device : BlkDevice::get_all(prober.get_system()))
 	{
 	    if (blk_device->has_children())
@@ -412,6 +417,36 @@ namespace storage
 	    if (it1 == blkid.end() || !it1->second.is_luks)
 		continue;
 
+	    blk_devices.push_back(blk_device);
+	}
+
+	/*
+	 * Read the LUKS headers of all devices in parallel (if possible). The
+	 * results, including errors, are cached by system_info and used
+	 * below in the original order. With remote callbacks commands must
+	 * not run concurrently.
+	 */
+
+	const unsigned int size = get_remote_callbacks() ? 1 : command_pool_size();
+
+	if (blk_devices.size() > 1 && size > 1)
+	{
+	    parallel_for(blk_devices.size(), size, [&blk_devices, &system_info](size_t i) {
+		try
+		{
+		    system_info.getCmdCryptsetupLuksDump(blk_devices[i]->get_name());
+		}
+		catch (const Exception& exception)
+		{
+		    ST_CAUGHT(exception);
+		}
+	    });
+	}
+
+	for (BlkDevice* blk_device : blk_devices)
+	{
+	    Blkid::const_iterator it1 = blkid.find_by_any_name(blk_device->get_name(), system_info);
+
 	    string uuid = it1->second.luks_uuid;
 	    string label = it1->second.luks_label;
 
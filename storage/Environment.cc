@@ -130,6 +130,62 @@ namespace storage
     }
 
 
+    unsigned int
+    Environment::get_probe_timeout() const
+    {
+	return get_impl().get_probe_timeout();
+    }
+
+
+    void
+    Environment::set_probe_timeout(unsigned int probe_timeout)
+    {
+	get_impl().set_probe_timeout(probe_timeout);
+    }
+
+
+    unsigned int
+    Environment::get_commit_timeout() const
+    {
+	return get_impl().get_commit_timeout();
+    }
+
+
+    void
+    Environment::set_commit_timeout(unsigned int commit_timeout)
+    {
+	get_impl().set_commit_timeout(commit_timeout);
+    }
+
+
+    bool
+    Environment::is_lazy_probing() const
+    {
+	return get_impl().is_lazy_probing();
+    }
+
+
+    void
+    Environment::set_lazy_probing(bool lazy_probing)
+    {
+	get_impl().set_lazy_probing(lazy_probing);
+    }
+
+
+    const string&
+    Environment::get_trace_filename() const
+    {
+	return get_impl().get_trace_filename();
+    }
+
+
+    void
+    Environment::set_trace_filename(const string& trace_filename)
+    {
+	get_impl().set_trace_filename(trace_filename);
+    }
+
+
     std::ostream&
     operator<<(std::ostream& out, const Environment& environment)
     {
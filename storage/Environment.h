@@ -119,6 +119,79 @@ namespace storage
 	const std::string& get_mockup_filename() const;
 	void set_mockup_filename(const std::string& mockup_filename);
 
+	/**
+	 * Query the time budget in seconds for probing. Zero means no limit,
+	 * which is the default.
+	 */
+	unsigned int get_probe_timeout() const;
+
+	/**
+	 * Set the time budget in seconds for probing. When the budget is
+	 * exhausted running commands are terminated and probing fails with an
+	 * exception.
+	 */
+	void set_probe_timeout(unsigned int probe_timeout);
+
+	/**
+	 * Query the time budget in seconds for commit. Zero means no limit,
+	 * which is the default.
+	 */
+	unsigned int get_commit_timeout() const;
+
+	/**
+	 * Set the time budget in seconds for commit. When the budget is
+	 * exhausted running commands are terminated and commit fails with an
+	 * exception.
+	 */
+	void set_commit_timeout(unsigned int commit_timeout);
+
+	/**
+	 * Query whether lazy probing is enabled. The default is false.
+	 */
+	bool is_lazy_probing() const;
+
+	/**
+	 * Enable or disable lazy probing. With lazy probing expensive details
+	 * of btrfs filesystems (subvolumes, qgroups, nocow flags and raid
+	 * levels) are not probed during probe() but on first access via the
+	 * functions of Btrfs, e.g. Btrfs::get_btrfs_subvolumes(), by
+	 * Storage::calculate_actiongraph() or by
+	 * Storage::probe_lazy_details(). Only has an effect for
+	 * ProbeMode::STANDARD and ProbeMode::READ_MOCKUP.
+	 *
+	 * Probing the postponed details adds the subvolumes and qgroups to
+	 * all devicegraphs, also when triggered by a const function. Several
+	 * threads accessing the details at the same time probe them only
+	 * once but other functions reading the devicegraphs must not run at
+	 * the same time. So call Storage::probe_lazy_details() before using
+	 * the devicegraphs from several threads. Functions not accessing
+	 * the details, e.g. Devicegraph::save(), see only the top-level
+	 * subvolume.
+	 *
+	 * Space and content information of filesystems is always detected on
+	 * demand.
+	 */
+	void set_lazy_probing(bool lazy_probing);
+
+	/**
+	 * Query the filename for the trace. Empty means no tracing, which is
+	 * the default unless the environment variable LIBSTORAGE_TRACE_FILE
+	 * is set.
+	 */
+	const std::string& get_trace_filename() const;
+
+	/**
+	 * Set the filename for the trace. If not empty, spans for probing
+	 * passes, system commands, commit actions and devicegraph
+	 * operations are recorded and written in the Chrome trace event
+	 * format after probe(), after commit() and when the Storage object
+	 * is destroyed. The file can be opened in e.g. Perfetto or
+	 * chrome://tracing.
+	 *
+	 * Must be set before the Storage object is constructed.
+	 */
+	void set_trace_filename(const std::string& trace_filename);
+
 	friend std::ostream& operator<<(std::ostream& out, const Environment& environment);
 
     public:
@@ -42,6 +42,10 @@ namespace storage
 	const char* p2 = getenv("LIBSTORAGE_LOCKFILE_ROOT");
 	if (p2)
 	    lockfile_root = p2;
+
+	const char* p3 = getenv("LIBSTORAGE_TRACE_FILE");
+	if (p3)
+	    trace_filename = p3;
     }
 
 
@@ -78,6 +82,18 @@ namespace storage
 	if (!environment.lockfile_root.empty())
 	    out << " lockfile-root:" << environment.lockfile_root;
 
+	if (environment.probe_timeout != 0)
+	    out << " probe-timeout:" << environment.probe_timeout;
+
+	if (environment.commit_timeout != 0)
+	    out << " commit-timeout:" << environment.commit_timeout;
+
+	if (environment.lazy_probing)
+	    out << " lazy-probing";
+
+	if (!environment.trace_filename.empty())
+	    out << " trace-filename:" << environment.trace_filename;
+
 	return out;
     }
 
@@ -143,6 +159,60 @@ namespace storage
     }
 
 
+    bool
+    native_blkid()
+    {
+	return read_env_var("LIBSTORAGE_NATIVE_BLKID", false);
+    }
+
+
+    bool
+    native_partition_table_reader()
+    {
+	return read_env_var("LIBSTORAGE_NATIVE_PARTED", true);
+    }
+
+
+    bool
+    native_btrfs()
+    {
+	return read_env_var("LIBSTORAGE_NATIVE_BTRFS", true);
+    }
+
+
+    bool
+    native_mdadm()
+    {
+	return read_env_var("LIBSTORAGE_NATIVE_MDADM", true);
+    }
+
+
+    bool
+    native_dmsetup()
+    {
+	return read_env_var("LIBSTORAGE_NATIVE_DMSETUP", true);
+    }
+
+
+    bool
+    native_cryptsetup()
+    {
+	return read_env_var("LIBSTORAGE_NATIVE_CRYPTSETUP", true);
+    }
+
+
+    ProbeCacheMode
+    probe_cache_mode()
+    {
+	const char* p = getenv("LIBSTORAGE_PROBE_CACHE");
+
+	if (p && strcmp(p, "validate") == 0)
+	    return ProbeCacheMode::VALIDATE;
+
+	return read_env_var("LIBSTORAGE_PROBE_CACHE", false) ? ProbeCacheMode::USE : ProbeCacheMode::NONE;
+    }
+
+
     int
     mdadm_activate_method()
     {
@@ -151,6 +221,22 @@ namespace storage
     }
 
 
+    unsigned int
+    command_pool_size()
+    {
+	const char* p = getenv("LIBSTORAGE_CMD_POOL_SIZE");
+	return p && atoi(p) > 0 ? atoi(p) : 4;
+    }
+
+
+    double
+    mockup_latency_scale()
+    {
+	const char* p = getenv("LIBSTORAGE_MOCKUP_LATENCY_SCALE");
+	return p && atof(p) > 0.0 ? atof(p) : 0.0;
+    }
+
+
     const vector<string> EnumTraits<OsFlavour>::names({
 	"linux", "suse", "redhat"
     });
@@ -185,15 +271,25 @@ namespace storage
 	    "LD_PRELOAD",
 	    "LIBSTORAGE_BTRFS_QGROUPS",
 	    "LIBSTORAGE_BTRFS_SNAPSHOT_RELATIONS",
+	    "LIBSTORAGE_CMD_POOL_SIZE",
 	    "LIBSTORAGE_CONFDIR",
 	    "LIBSTORAGE_DEVELOPER_MODE",
 	    "LIBSTORAGE_LOCALEDIR",
 	    "LIBSTORAGE_LOCKFILE_ROOT",
 	    "LIBSTORAGE_MDADM_ACTIVATE_METHOD",
+	    "LIBSTORAGE_MOCKUP_LATENCY_SCALE",
 	    "LIBSTORAGE_MULTIPLE_DEVICES_BTRFS",
+	    "LIBSTORAGE_NATIVE_BLKID",
+	    "LIBSTORAGE_NATIVE_BTRFS",
+	    "LIBSTORAGE_NATIVE_CRYPTSETUP",
+	    "LIBSTORAGE_NATIVE_DMSETUP",
+	    "LIBSTORAGE_NATIVE_MDADM",
+	    "LIBSTORAGE_NATIVE_PARTED",
 	    "LIBSTORAGE_OS_FLAVOUR",
 	    "LIBSTORAGE_PFSOEMS",
+	    "LIBSTORAGE_PROBE_CACHE",
 	    "LIBSTORAGE_ROOTPREFIX",
+	    "LIBSTORAGE_TRACE_FILE",
 	};
 
 	for (const char* env_var : env_vars)
@@ -62,6 +62,18 @@ namespace storage
 	const string& get_mockup_filename() const { return mockup_filename; }
 	void set_mockup_filename(const string& mockup_filename) { Impl::mockup_filename = mockup_filename; }
 
+	unsigned int get_probe_timeout() const { return probe_timeout; }
+	void set_probe_timeout(unsigned int probe_timeout) { Impl::probe_timeout = probe_timeout; }
+
+	unsigned int get_commit_timeout() const { return commit_timeout; }
+	void set_commit_timeout(unsigned int commit_timeout) { Impl::commit_timeout = commit_timeout; }
+
+	bool is_lazy_probing() const { return lazy_probing; }
+	void set_lazy_probing(bool lazy_probing) { Impl::lazy_probing = lazy_probing; }
+
+	const string& get_trace_filename() const { return trace_filename; }
+	void set_trace_filename(const string& trace_filename) { Impl::trace_filename = trace_filename; }
+
 	bool is_debug_credentials() const { return false; }
 
 	bool is_do_lock() const;
@@ -81,6 +93,12 @@ namespace storage
 	string devicegraph_filename;
 	string arch_filename;
 	string mockup_filename;
+	string trace_filename;
+
+	unsigned int probe_timeout = 0;
+	unsigned int commit_timeout = 0;
+
+	bool lazy_probing = false;
 
     };
 
@@ -121,11 +139,71 @@ namespace storage
      */
     bool cryptsetup_for_bitlocker();
 
+    /**
+     * Switch to probe block devices with libblkid instead of the blkid
+     * command (during probing). Only has an effect if libstorage-ng was
+     * built with libblkid. Off by default until the results are proven
+     * to match the blkid command for all filesystems, see the
+     * native_vs_command test in testsuite/SystemInfo/blkid-probe.cc.
+     */
+    bool native_blkid();
+
+    /**
+     * Switch to read GPT and MS-DOS partition tables without parted (during
+     * probing).
+     */
+    bool native_partition_table_reader();
+
+    /**
+     * Switch to query btrfs with ioctls instead of the btrfs and lsattr
+     * commands (during probing).
+     */
+    bool native_btrfs();
+
+    /**
+     * Switch to read MD RAID details from sysfs and the udev database
+     * instead of running mdadm --detail (during probing).
+     */
+    bool native_mdadm();
+
+    /**
+     * Switch to query the device mapper with ioctls instead of the
+     * dmsetup command (during probing).
+     */
+    bool native_dmsetup();
+
+    /**
+     * Switch to read LUKS and BitLocker headers directly instead of using
+     * cryptsetup luksDump and bitlkDump (during probing).
+     */
+    bool native_cryptsetup();
+
+    /**
+     * Mode of the persistent probe cache, see ProbeCache.
+     */
+    enum class ProbeCacheMode
+    {
+	NONE, USE, VALIDATE
+    };
+
+    ProbeCacheMode probe_cache_mode();
+
     /**
      * There are several methods to use mdadm for activation.
      */
     int mdadm_activate_method();
 
+    /**
+     * Maximal number of commands run concurrently by the global SystemCmdPool.
+     */
+    unsigned int command_pool_size();
+
+    /**
+     * Scale factor for reproducing the recorded latencies of commands and
+     * files when reading a mockup. Zero, the default, disables it.
+     */
+    double mockup_latency_scale();
+
     /**
      * Operating system flavour.
      */
@@ -299,18 +299,15 @@ namespace storage
 	    return resize_info;
 	}
 
-	if (!resize_info.has_value())
-	{
+	return resize_info.get_or_set_value([this, blk_device]() {
 	    const BlkFilesystem* tmp_blk_filesystem = redirect_to_system(get_non_impl());
 
 	    ResizeInfo tmp_resize_info = tmp_blk_filesystem->get_impl().detect_resize_info_on_disk(blk_device);
 
 	    y2mil("on-disk resize-info:" << tmp_resize_info);
 
-	    resize_info.set_value(tmp_resize_info);
-	}
-
-	return resize_info.get_value();
+	    return tmp_resize_info;
+	});
     }
 
 
@@ -413,12 +410,7 @@ namespace storage
     ContentInfo
     BlkFilesystem::Impl::detect_content_info() const
     {
-	if (!content_info.has_value())
-	{
-	    content_info.set_value(detect_content_info_on_disk());
-	}
-
-	return content_info.get_value();
+	return content_info.get_or_set_value([this]() { return detect_content_info_on_disk(); });
     }
 
 
@@ -88,6 +88,8 @@ namespace storage
     BtrfsRaidLevel
     Btrfs::get_metadata_raid_level() const
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().get_metadata_raid_level();
     }
 
@@ -95,6 +97,8 @@ namespace storage
     void
     Btrfs::set_metadata_raid_level(BtrfsRaidLevel metadata_raid_level)
     {
+	get_impl().probe_lazy_details();
+
 	get_impl().set_metadata_raid_level(metadata_raid_level);
     }
 
@@ -102,6 +106,8 @@ namespace storage
     BtrfsRaidLevel
     Btrfs::get_data_raid_level() const
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().get_data_raid_level();
     }
 
@@ -109,6 +115,8 @@ namespace storage
     void
     Btrfs::set_data_raid_level(BtrfsRaidLevel data_raid_level)
     {
+	get_impl().probe_lazy_details();
+
 	get_impl().set_data_raid_level(data_raid_level);
     }
 
@@ -130,6 +138,8 @@ namespace storage
     bool
     Btrfs::has_quota() const
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().has_quota();
     }
 
@@ -137,6 +147,8 @@ namespace storage
     void
     Btrfs::set_quota(bool quota)
     {
+	get_impl().probe_lazy_details();
+
 	get_impl().set_quota(quota);
     }
 
@@ -158,6 +170,8 @@ namespace storage
     BtrfsSubvolume*
     Btrfs::get_top_level_btrfs_subvolume()
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().get_top_level_btrfs_subvolume();
     }
 
@@ -165,6 +179,8 @@ namespace storage
     const BtrfsSubvolume*
     Btrfs::get_top_level_btrfs_subvolume() const
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().get_top_level_btrfs_subvolume();
     }
 
@@ -172,6 +188,8 @@ namespace storage
     BtrfsSubvolume*
     Btrfs::get_default_btrfs_subvolume()
     {
+        get_impl().probe_lazy_details();
+
         return get_impl().get_default_btrfs_subvolume();
     }
 
@@ -179,6 +197,8 @@ namespace storage
     const BtrfsSubvolume*
     Btrfs::get_default_btrfs_subvolume() const
     {
+        get_impl().probe_lazy_details();
+
         return get_impl().get_default_btrfs_subvolume();
     }
 
@@ -186,6 +206,8 @@ namespace storage
     void
     Btrfs::set_default_btrfs_subvolume(BtrfsSubvolume* btrfs_subvolume) const
     {
+	get_impl().probe_lazy_details();
+
 	get_impl().set_default_btrfs_subvolume(btrfs_subvolume);
     }
 
@@ -193,6 +215,8 @@ namespace storage
     vector<BtrfsSubvolume*>
     Btrfs::get_btrfs_subvolumes()
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().get_btrfs_subvolumes();
     }
 
@@ -200,6 +224,8 @@ namespace storage
     vector<const BtrfsSubvolume*>
     Btrfs::get_btrfs_subvolumes() const
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().get_btrfs_subvolumes();
     }
 
@@ -207,6 +233,8 @@ namespace storage
     BtrfsSubvolume*
     Btrfs::find_btrfs_subvolume_by_path(const std::string& path)
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().find_btrfs_subvolume_by_path(path);
     }
 
@@ -214,6 +242,8 @@ namespace storage
     const BtrfsSubvolume*
     Btrfs::find_btrfs_subvolume_by_path(const std::string& path) const
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().find_btrfs_subvolume_by_path(path);
     }
 
@@ -221,6 +251,8 @@ namespace storage
     BtrfsQgroup*
     Btrfs::create_btrfs_qgroup(const BtrfsQgroup::id_t& id)
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().create_btrfs_qgroup(id);
     }
 
@@ -228,6 +260,8 @@ namespace storage
     vector<BtrfsQgroup*>
     Btrfs::get_btrfs_qgroups()
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().get_btrfs_qgroups();
     }
 
@@ -235,6 +269,8 @@ namespace storage
     vector<const BtrfsQgroup*>
     Btrfs::get_btrfs_qgroups() const
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().get_btrfs_qgroups();
     }
 
@@ -242,6 +278,8 @@ namespace storage
     BtrfsQgroup*
     Btrfs::find_btrfs_qgroup_by_id(const BtrfsQgroup::id_t& id)
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().find_btrfs_qgroup_by_id(id);
     }
 
@@ -249,6 +287,8 @@ namespace storage
     const BtrfsQgroup*
     Btrfs::find_btrfs_qgroup_by_id(const BtrfsQgroup::id_t& id) const
     {
+	get_impl().probe_lazy_details();
+
 	return get_impl().find_btrfs_qgroup_by_id(id);
     }
 
@@ -37,13 +37,17 @@
 #include "storage/FreeInfo.h"
 #include "storage/UsedFeatures.h"
 #include "storage/SystemInfo/SystemInfoImpl.h"
+#include "storage/SystemInfo/BtrfsIoctl.h"
 #include "storage/Holders/Subdevice.h"
 #include "storage/Holders/FilesystemUserImpl.h"
 #include "storage/Holders/Snapshot.h"
 #include "storage/Holders/BtrfsQgroupRelationImpl.h"
 #include "storage/EnvironmentImpl.h"
-#include "storage/Storage.h"
+#include "storage/StorageImpl.h"
 #include "storage/Utils/Mockup.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/ParallelFor.h"
+#include "storage/Utils/FileUtils.h"
 #include "storage/Prober.h"
 #include "storage/Redirect.h"
 #include "storage/Actions/ReallotImpl.h"
@@ -86,6 +90,10 @@ namespace storage
 	    data_raid_level = toValueWithFallback(tmp, BtrfsRaidLevel::UNKNOWN);
 
 	getChildValue(node, "quota", quota);
+
+	bool tmp_lazy_details = false;
+	if (getChildValue(node, "lazy-details", tmp_lazy_details))
+	    lazy_details = tmp_lazy_details;
     }
 
 
@@ -104,6 +112,8 @@ namespace storage
 	setChildValue(node, "data-raid-level", toString(data_raid_level));
 
 	setChildValueIf(node, "quota", quota, quota);
+
+	setChildValueIf(node, "lazy-details", has_lazy_details(), has_lazy_details());
     }
 
 
@@ -349,10 +359,20 @@ namespace storage
     }
 
 
+    long
+    Btrfs::Impl::get_default_btrfs_subvolume_id() const
+    {
+	if (has_lazy_details())
+	    return lazy_default_id;
+
+	return get_default_btrfs_subvolume()->get_id();
+    }
+
+
     bool
     Btrfs::Impl::predicate_proc_mounts(const FstabEntry* fstab_entry) const
     {
-	long default_id = get_default_btrfs_subvolume()->get_id();
+	long default_id = get_default_btrfs_subvolume_id();
 
 	return !fstab_entry->get_mount_opts().has_subvol() || fstab_entry->get_mount_opts().has_subvol(default_id);
     }
@@ -488,7 +508,7 @@ namespace storage
 	    return false;
 
 	return metadata_raid_level == rhs.metadata_raid_level && data_raid_level == rhs.data_raid_level &&
-	    quota == rhs.quota;
+	    quota == rhs.quota && has_lazy_details() == rhs.has_lazy_details();
     }
 
 
@@ -503,6 +523,8 @@ namespace storage
 	storage::log_diff_enum(log, "data-raid-level", data_raid_level, rhs.data_raid_level);
 
 	storage::log_diff(log, "quota", quota, rhs.quota);
+
+	storage::log_diff(log, "lazy-details", has_lazy_details(), rhs.has_lazy_details());
     }
 
 
@@ -516,6 +538,9 @@ namespace storage
 
 	if (quota)
 	    out << " quota";
+
+	if (has_lazy_details())
+	    out << " lazy-details";
     }
 
 
@@ -562,6 +587,56 @@ namespace storage
 
 	const CmdBtrfsFilesystemShow& cmd_btrfs_filesystem_show = system_info.getCmdBtrfsFilesystemShow();
 
+	// First collect the details of all btrfses in parallel (if possible)
+	// and then create and probe the btrfses in the original order,
+	// consuming the cached results. So the devicegraph is only modified
+	// by one thread and the result, including the sids, as well as the
+	// order of error reports does not depend on the scheduling.
+
+	const size_t n = distance(cmd_btrfs_filesystem_show.begin(), cmd_btrfs_filesystem_show.end());
+
+	// Not vector<bool> since the elements are set concurrently.
+	vector<char> prefetched(n, false);
+
+	// The parallel collection only pays off with several btrfses. With
+	// remote callbacks commands must not run concurrently.
+
+	const unsigned int size = get_remote_callbacks() ? 1 : command_pool_size();
+
+	if (!prober.is_lazy() && n > 1 && size > 1)
+	{
+	    vector<vector<const BlkDevice*>> blk_devices(n);
+
+	    size_t i = 0;
+	    for (const CmdBtrfsFilesystemShow::value_type& detected_btrfs : cmd_btrfs_filesystem_show)
+	    {
+		try
+		{
+		    for (const CmdBtrfsFilesystemShow::Device& device : detected_btrfs.devices)
+			blk_devices[i].push_back(BlkDevice::Impl::find_by_any_name(system, device.name,
+										   system_info));
+		}
+		catch (const Exception& exception)
+		{
+		    // Reported when creating the btrfs.
+
+		    ST_CAUGHT(exception);
+
+		    blk_devices[i].clear();
+		}
+
+		++i;
+	    }
+
+	    const Storage* storage = system->get_impl().get_storage();
+
+	    parallel_for(n, size, [&blk_devices, &prefetched, &system_info, storage](size_t j) {
+		if (!blk_devices[j].empty())
+		    prefetched[j] = prefetch_details(system_info, storage, blk_devices[j]);
+	    });
+	}
+
+	size_t i = 0;
 	for (const CmdBtrfsFilesystemShow::value_type& detected_btrfs : cmd_btrfs_filesystem_show)
 	{
 	    try
@@ -598,6 +673,8 @@ namespace storage
 		if (!blk_filesystem)
 		    ST_THROW(Exception("no btrfs created"));
 
+		to_btrfs(blk_filesystem)->get_impl().details_prefetched = prefetched[i];
+
 		blk_filesystem->get_impl().probe_pass_2a(prober);
 		blk_filesystem->get_impl().probe_pass_2b(prober);
 	    }
@@ -607,15 +684,139 @@ namespace storage
 		prober.handle(exception, sformat(_("Probing file system with UUID %s failed"),
 						 detected_btrfs.uuid), UF_BTRFS);
 	    }
+
+	    ++i;
 	}
     }
 
 
+    bool
+    Btrfs::Impl::prefetch_details(SystemInfo::Impl& system_info, const Storage* storage,
+				  const vector<const BlkDevice*>& blk_devices)
+    {
+	bool prefetched = false;
+
+	try
+	{
+	    // Same name as get_blk_device() will return once the btrfs is
+	    // created.
+
+	    const string& name = (*min_element(blk_devices.begin(), blk_devices.end(),
+					       BlkDevice::compare_by_name))->get_name();
+
+	    // Same as EnsureMounted does for the top-level subvolume during
+	    // probing, where the btrfs has no mount points yet.
+
+	    unique_ptr<TmpMount> tmp_mount;
+	    unique_ptr<BtrfsIoctl::Scope> btrfs_ioctl_scope;
+	    string mount_point = "/tmp/does-not-matter";
+	    if (Mockup::get_mode() != Mockup::Mode::PLAYBACK)
+	    {
+		storage::wait_for_devices(blk_devices);
+
+		if (blk_devices.size() >= 2)
+		{
+		    string cmd_line = BTRFS_BIN " device scan";
+
+		    for (const BlkDevice* blk_device : blk_devices)
+			cmd_line += " " + quote(blk_device->get_name());
+
+		    SystemCmd cmd(cmd_line, SystemCmd::NoThrow);
+		}
+
+		tmp_mount = make_unique<TmpMount>(storage->get_impl().get_tmp_dir().get_fullname(),
+						  "tmp-mount-XXXXXX", name, true, vector<string>({ "subvol=/" }));
+		mount_point = tmp_mount->get_fullname();
+
+		btrfs_ioctl_scope = make_unique<BtrfsIoctl::Scope>(mount_point);
+	    }
+
+	    // From here on the results, including exceptions, are cached by
+	    // system_info. So probe_details_pass_2a() needs no mount.
+
+	    prefetched = true;
+
+	    // Same calls in same order as in probe_details_pass_2a().
+
+	    system_info.getCmdBtrfsSubvolumeShow(name, mount_point);
+
+	    const CmdBtrfsSubvolumeList& cmd_btrfs_subvolume_list =
+		system_info.getCmdBtrfsSubvolumeList(name, mount_point);
+
+	    for (const CmdBtrfsSubvolumeList::Entry& subvolume : cmd_btrfs_subvolume_list)
+		system_info.getCmdLsattr(name, mount_point, subvolume.path);
+
+	    if (cmd_btrfs_subvolume_list.begin() != cmd_btrfs_subvolume_list.end())
+		system_info.getCmdBtrfsSubvolumeGetDefault(name, mount_point);
+
+	    system_info.getCmdBtrfsFilesystemDf(name, mount_point);
+
+	    if (support_btrfs_qgroups())
+		system_info.getCmdBtrfsQgroupShow(name, mount_point);
+	}
+	catch (const Exception& exception)
+	{
+	    // Reported by probe_details_pass_2a().
+
+	    ST_CAUGHT(exception);
+	}
+
+	return prefetched;
+    }
+
+
     void
     Btrfs::Impl::probe_pass_2a(Prober& prober)
     {
 	BlkFilesystem::Impl::probe_pass_2a(prober);
 
+	if (prober.is_lazy())
+	{
+	    y2mil("postponing details of btrfs " << get_uuid());
+	    lazy_details = true;
+	    probe_lazy_default_id(prober);
+	    return;
+	}
+
+	probe_details_pass_2a(prober);
+    }
+
+
+    void
+    Btrfs::Impl::probe_lazy_default_id(Prober& prober)
+    {
+	SystemInfo::Impl& system_info = prober.get_system_info();
+
+	const vector<ExtendedFstabEntry> proc_mounts_entries = find_proc_mounts_entries_unfiltered(system_info);
+	if (proc_mounts_entries.empty())
+	    return;
+
+	try
+	{
+	    // Any mount point of the btrfs will do.
+
+	    string mount_point = "/tmp/does-not-matter";
+	    if (Mockup::get_mode() != Mockup::Mode::PLAYBACK)
+		mount_point = proc_mounts_entries.front().fstab_entry->get_mount_point();
+
+	    const CmdBtrfsSubvolumeGetDefault& cmd_btrfs_subvolume_get_default =
+		system_info.getCmdBtrfsSubvolumeGetDefault(get_blk_device()->get_name(), mount_point);
+
+	    lazy_default_id = cmd_btrfs_subvolume_get_default.get_id();
+	}
+	catch (const Exception& exception)
+	{
+	    // Assume the top-level subvolume is the default subvolume like
+	    // it is without other subvolumes.
+
+	    ST_CAUGHT(exception);
+	}
+    }
+
+
+    void
+    Btrfs::Impl::probe_details_pass_2a(Prober& prober)
+    {
 	SystemInfo::Impl& system_info = prober.get_system_info();
 
 	const BlkDevice* blk_device = get_blk_device();
@@ -627,11 +828,18 @@ namespace storage
 	subvolumes_by_id[top_level->get_id()] = top_level;
 
 	unique_ptr<EnsureMounted> ensure_mounted;
+	unique_ptr<BtrfsIoctl::Scope> btrfs_ioctl_scope;
 	string mount_point = "/tmp/does-not-matter";
-	if (Mockup::get_mode() != Mockup::Mode::PLAYBACK)
+	if (details_prefetched)
+	{
+	    details_prefetched = false;
+	}
+	else if (Mockup::get_mode() != Mockup::Mode::PLAYBACK)
 	{
 	    ensure_mounted = make_unique<EnsureMounted>(top_level);
 	    mount_point = ensure_mounted->get_any_mount_point();
+
+	    btrfs_ioctl_scope = make_unique<BtrfsIoctl::Scope>(mount_point);
 	}
 
 	// Unfortunately 'btrfs subvolume list' uses the UUID to show the parent/origin of
@@ -774,25 +982,116 @@ namespace storage
     {
 	BlkFilesystem::Impl::probe_pass_2b(prober);
 
-	BtrfsSubvolume* top_level = get_top_level_btrfs_subvolume();
-
-	unique_ptr<EnsureMounted> ensure_mounted;
-	string mount_point = "/tmp/does-not-matter";
-	if (Mockup::get_mode() != Mockup::Mode::PLAYBACK)
+	if (has_lazy_details())
 	{
-	    ensure_mounted = make_unique<EnsureMounted>(top_level);
-	    mount_point = ensure_mounted->get_any_mount_point();
+	    // Mount points of the top-level subvolume are probed now since
+	    // that needs no mount. The mount points of the other subvolumes
+	    // are probed together with the subvolumes.
+
+	    get_top_level_btrfs_subvolume()->get_impl().probe_pass_2b(prober, "/tmp/does-not-matter");
+	    return;
 	}
 
+	probe_details_pass_2b(prober, false);
+    }
+
+
+    void
+    Btrfs::Impl::probe_details_pass_2b(Prober& prober, bool skip_top_level)
+    {
+	BtrfsSubvolume* top_level = get_top_level_btrfs_subvolume();
+
+	// Probing the mount points of subvolumes does not access the
+	// filesystem so no mount is needed here. Thus the filesystem is
+	// temporarily mounted only once, in probe_details_pass_2a().
+
+	const string mount_point = "/tmp/does-not-matter";
+
 	vector<BtrfsSubvolume*> btrfs_subvolumes = get_btrfs_subvolumes();
 	sort(btrfs_subvolumes.begin(), btrfs_subvolumes.end(), BtrfsSubvolume::compare_by_id);
 	for (BtrfsSubvolume* btrfs_subvolume : btrfs_subvolumes)
 	{
+	    if (skip_top_level && btrfs_subvolume == top_level)
+		continue;
+
 	    btrfs_subvolume->get_impl().probe_pass_2b(prober, mount_point);
 	}
     }
 
 
+    void
+    Btrfs::Impl::probe_lazy_details() const
+    {
+	if (!has_lazy_details())
+	    return;
+
+	// Probing the postponed details is not considered a modification
+	// of the devicegraph, like detecting e.g. the resize information on
+	// demand.
+
+	Devicegraph* devicegraph = const_cast<Devicegraph*>(get_devicegraph());
+
+	devicegraph->get_storage()->get_impl().probe_lazy_details(devicegraph, get_sid());
+    }
+
+
+    void
+    Btrfs::Impl::probe_details(Prober& prober, const Btrfs* reference)
+    {
+	y2mil("probing postponed details of btrfs " << get_uuid());
+
+	// Only reset once all details are probed and have their final sids
+	// since other threads check the flag without lock. Also reset on
+	// failure so that a failure does not lead to probing twice.
+
+	try
+	{
+	    // The top-level subvolume was already probed in probe_pass_2b().
+
+	    probe_details_pass_2a(prober);
+	    probe_details_pass_2b(prober, true);
+
+	    if (reference)
+		take_sids(reference);
+	}
+	catch (...)
+	{
+	    lazy_details = false;
+	    throw;
+	}
+
+	lazy_details = false;
+    }
+
+
+    void
+    Btrfs::Impl::take_sids(const Btrfs* reference)
+    {
+	for (BtrfsSubvolume* btrfs_subvolume : get_btrfs_subvolumes())
+	{
+	    const BtrfsSubvolume* tmp = nullptr;
+
+	    for (const BtrfsSubvolume* reference_subvolume : reference->get_impl().get_btrfs_subvolumes())
+	    {
+		if (reference_subvolume->get_id() == btrfs_subvolume->get_id())
+		{
+		    tmp = reference_subvolume;
+		    break;
+		}
+	    }
+
+	    if (tmp)
+		btrfs_subvolume->get_impl().set_sid(tmp->get_sid());
+	}
+
+	for (BtrfsQgroup* btrfs_qgroup : get_btrfs_qgroups())
+	{
+	    const BtrfsQgroup* tmp = reference->get_impl().find_btrfs_qgroup_by_id(btrfs_qgroup->get_id());
+	    btrfs_qgroup->get_impl().set_sid(tmp->get_sid());
+	}
+    }
+
+
     namespace
     {
 
@@ -872,18 +1171,13 @@ namespace storage
 
 		    resize_info = filesystem->get_impl().detect_resize_info_on_disk(blk_device);
 		}
-		else if (!multi_device_resize_info.has_value())
-		{
-		    // Checking from no specific block device, and the resize info is not cached yet.
-
-		    resize_info = filesystem->get_impl().detect_resize_info_on_disk();
-		    multi_device_resize_info.set_value(resize_info);
-		}
 		else
 		{
-		    // Checking from no specific block device, and the resize info is already cached.
+		    // Checking from no specific block device, the resize info is cached.
 
-		    resize_info = multi_device_resize_info.get_value();
+		    resize_info = multi_device_resize_info.get_or_set_value([filesystem]() {
+			return filesystem->get_impl().detect_resize_info_on_disk();
+		    });
 		}
 
 		y2mil("on-disk resize-info:" << resize_info);
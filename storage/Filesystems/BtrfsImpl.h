@@ -27,9 +27,11 @@
 
 #include "storage/Filesystems/Btrfs.h"
 #include "storage/Filesystems/BtrfsQgroupImpl.h"
+#include "storage/Filesystems/BtrfsSubvolumeImpl.h"
 #include "storage/Filesystems/BlkFilesystemImpl.h"
 #include "storage/Utils/SnapperConfig.h"
 #include "storage/Utils/HumanString.h"
+#include "storage/Utils/CopyableAtomic.h"
 
 
 namespace storage
@@ -92,6 +94,12 @@ namespace storage
 
 	void set_default_btrfs_subvolume(BtrfsSubvolume* btrfs_subvolume) const;
 
+	/**
+	 * Id of the default subvolume. Unlike get_default_btrfs_subvolume()
+	 * also works with postponed details.
+	 */
+	long get_default_btrfs_subvolume_id() const;
+
 	vector<BtrfsSubvolume*> get_btrfs_subvolumes();
 	vector<const BtrfsSubvolume*> get_btrfs_subvolumes() const;
 
@@ -148,6 +156,37 @@ namespace storage
 	virtual void probe_pass_2a(Prober& prober) override;
 	virtual void probe_pass_2b(Prober& prober) override;
 
+	/**
+	 * Whether probing of subvolumes, qgroups and raid levels was postponed
+	 * by lazy probing.
+	 */
+	bool has_lazy_details() const { return lazy_details.load(std::memory_order_acquire); }
+
+	/**
+	 * Probe the details postponed by lazy probing (if any) in all
+	 * devicegraphs of the storage object and in the devicegraph of the
+	 * btrfs. Called by the functions of Btrfs accessing those details,
+	 * also by the const ones. Even if called from several threads at the
+	 * same time the details are only probed once, see
+	 * Storage::Impl::probe_lazy_details().
+	 *
+	 * Throws an exception if probing fails.
+	 */
+	void probe_lazy_details() const;
+
+	/**
+	 * Probe the details postponed by lazy probing. Sids of the created
+	 * subvolumes and qgroups are taken from reference (if not nullptr) so
+	 * that they match in all devicegraphs.
+	 */
+	void probe_details(Prober& prober, const Btrfs* reference);
+
+	/**
+	 * Set the sids of the subvolumes and qgroups to the ones of the
+	 * subvolumes and qgroups with the same ids in reference.
+	 */
+	void take_sids(const Btrfs* reference);
+
 	virtual ResizeInfo detect_resize_info(const BlkDevice* blk_device = nullptr) const override;
 	virtual ResizeInfo detect_resize_info_on_disk(const BlkDevice* blk_device = nullptr) const override;
 
@@ -194,6 +233,46 @@ namespace storage
 
 	bool quota = false;
 
+	/**
+	 * Set if probing of subvolumes, qgroups and raid levels was
+	 * postponed. Saved in the XML so that a saved devicegraph does not
+	 * pretend to have only the top-level subvolume. Atomic since it is
+	 * checked by const functions, possibly from several threads, and
+	 * cleared once the details are probed.
+	 */
+	CopyableAtomic<bool> lazy_details { false };
+
+	/**
+	 * With postponed details the id of the default subvolume as far as
+	 * known without a temporary mount.
+	 */
+	long lazy_default_id = BtrfsSubvolume::Impl::top_level_id;
+
+	/**
+	 * Probe lazy_default_id. Only needed to probe the mount points of a
+	 * mounted btrfs and for that no temporary mount is needed.
+	 */
+	void probe_lazy_default_id(Prober& prober);
+
+	/**
+	 * Set if the details were already collected by prefetch_details()
+	 * so that probe_details_pass_2a() needs no mount.
+	 */
+	bool details_prefetched = false;
+
+	/**
+	 * Collect the information needed by probe_details_pass_2a() for the
+	 * btrfs on blk_devices, which is not yet created, in system_info
+	 * without modifying the devicegraph. Can run concurrently for
+	 * different btrfses. Errors are cached in system_info and reported
+	 * later. Returns whether probe_details_pass_2a() needs no mount.
+	 */
+	static bool prefetch_details(SystemInfo::Impl& system_info, const Storage* storage,
+				     const vector<const BlkDevice*>& blk_devices);
+
+	void probe_details_pass_2a(Prober& prober);
+	void probe_details_pass_2b(Prober& prober, bool skip_top_level);
+
 	/**
 	 * mutable to allow updating cache from const functions. Otherwise
 	 * caching would not be possible when working with the probed
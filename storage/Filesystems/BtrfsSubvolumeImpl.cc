@@ -367,7 +367,7 @@ namespace storage
     {
 	// see doc/btrfs.md for default id handling
 
-	long default_id = get_btrfs()->get_default_btrfs_subvolume()->get_id();
+	long default_id = get_btrfs()->get_impl().get_default_btrfs_subvolume_id();
 
 	return fstab_entry->get_mount_opts().has_subvol(id, path) && id != default_id;
     }
@@ -90,12 +90,7 @@ namespace storage
     SpaceInfo
     Filesystem::Impl::detect_space_info() const
     {
-	if (!space_info.has_value())
-	{
-	    space_info.set_value(detect_space_info_on_disk());
-	}
-
-	return space_info.get_value();
+	return space_info.get_or_set_value([this]() { return detect_space_info_on_disk(); });
     }
 
 
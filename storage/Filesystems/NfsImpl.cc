@@ -20,6 +20,7 @@
  */
 
 
+#include <mutex>
 #include <boost/algorithm/string.hpp>
 
 #include "storage/Utils/XmlFile.h"
@@ -284,8 +285,15 @@ namespace storage
     {
 	// rpcbind might be needed for remote locking
 
+	// The flag is only set once the command has run so that a concurrent
+	// caller waits for it and a throwing command, e.g. when cancelled, is
+	// tried again.
+
+	static std::mutex rpcbind_mutex;
 	static bool rpcbind_started = false;
 
+	std::lock_guard<std::mutex> lock(rpcbind_mutex);
+
 	if (rpcbind_started)
 	    return;
 
@@ -28,6 +28,7 @@
 
 #include "storage/DevicegraphImpl.h"
 #include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/MetricsImpl.h"
 
 
 namespace storage
@@ -39,6 +40,9 @@ namespace storage
     Type*
     find_by_name(Devicegraph* devicegraph, const string& name)
     {
+	static MetricsCounter& lookups = Metrics::counter("device_lookups_total{function=\"find_by_name\"}");
+	lookups.increment();
+
 	for (Devicegraph::Impl::vertex_descriptor vertex : devicegraph->get_impl().vertices())
 	{
 	    Type* device = dynamic_cast<Type*>(devicegraph->get_impl()[vertex]);
@@ -54,6 +58,9 @@ namespace storage
     const Type*
     find_by_name(const Devicegraph* devicegraph, const string& name)
     {
+	static MetricsCounter& lookups = Metrics::counter("device_lookups_total{function=\"find_by_name\"}");
+	lookups.increment();
+
 	for (Devicegraph::Impl::vertex_descriptor vertex : devicegraph->get_impl().vertices())
 	{
 	    const Type* device = dynamic_cast<const Type*>(devicegraph->get_impl()[vertex]);
@@ -69,6 +76,9 @@ namespace storage
     Type*
     find_by_uuid(Devicegraph* devicegraph, const string& uuid)
     {
+	static MetricsCounter& lookups = Metrics::counter("device_lookups_total{function=\"find_by_uuid\"}");
+	lookups.increment();
+
 	for (Devicegraph::Impl::vertex_descriptor vertex : devicegraph->get_impl().vertices())
 	{
 	    Type* device = dynamic_cast<Type*>(devicegraph->get_impl()[vertex]);
@@ -84,6 +94,9 @@ namespace storage
     const Type*
     find_by_uuid(const Devicegraph* devicegraph, const string& uuid)
     {
+	static MetricsCounter& lookups = Metrics::counter("device_lookups_total{function=\"find_by_uuid\"}");
+	lookups.increment();
+
 	for (Devicegraph::Impl::vertex_descriptor vertex : devicegraph->get_impl().vertices())
 	{
 	    const Type* device = dynamic_cast<const Type*>(devicegraph->get_impl()[vertex]);
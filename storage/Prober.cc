@@ -21,6 +21,7 @@
  */
 
 
+#include <optional>
 #include <boost/algorithm/string.hpp>
 
 #include "storage/Prober.h"
@@ -29,6 +30,7 @@
 #include "storage/Utils/StorageDefines.h"
 #include "storage/Utils/CallbacksImpl.h"
 #include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/OperationBudget.h"
 #include "storage/Utils/Format.h"
 #include "storage/StorageImpl.h"
 #include "storage/DevicegraphImpl.h"
@@ -52,6 +54,7 @@
 #include "storage/Filesystems/TmpfsImpl.h"
 #include "storage/UsedFeatures.h"
 #include "storage/Utils/StorageTmpl.h"
+#include "storage/Utils/Trace.h"
 
 
 namespace storage
@@ -160,7 +163,10 @@ namespace storage
 
     Prober::Prober(const Storage& storage, const ProbeCallbacks* probe_callbacks, Devicegraph* system,
 		   SystemInfo::Impl& system_info)
-	: storage(storage), probe_callbacks(probe_callbacks), system(system), system_info(system_info)
+	: storage(storage), probe_callbacks(probe_callbacks), system(system), system_info(system_info),
+	  lazy(storage.get_environment().is_lazy_probing() &&
+	       (storage.get_environment().get_probe_mode() == ProbeMode::STANDARD ||
+		storage.get_environment().get_probe_mode() == ProbeMode::READ_MOCKUP))
     {
 	/**
 	 * Difficulties:
@@ -200,6 +206,10 @@ namespace storage
 	 * Pass 2:  Probe filesystems and mount points.
 	 */
 
+	std::optional<TraceSpan> pass_span;
+
+	pass_span.emplace("prober", "sys block entries");
+
 	try
 	{
 	    sys_block_entries = probe_sys_block_entries(system_info);
@@ -214,6 +224,8 @@ namespace storage
 
 	y2mil("prober pass 1a");
 
+	pass_span.emplace("prober", "pass 1a");
+
 	// TRANSLATORS: progress message
 	message_callback(probe_callbacks, _("Probing disks"));
 
@@ -339,6 +351,8 @@ namespace storage
 
 	y2mil("prober pass 1b");
 
+	pass_span.emplace("prober", "pass 1b");
+
 	// TRANSLATORS: progress message
 	message_callback(probe_callbacks, _("Probing device relationships"));
 
@@ -360,6 +374,8 @@ namespace storage
 
 	y2mil("prober pass 1c");
 
+	pass_span.emplace("prober", "pass 1c");
+
 	// TRANSLATORS: progress message
 	message_callback(probe_callbacks, _("Probing partitions"));
 
@@ -385,6 +401,8 @@ namespace storage
 
 	y2mil("prober pass 1d");
 
+	pass_span.emplace("prober", "pass 1d");
+
 	// TRANSLATORS: progress message
 	message_callback(probe_callbacks, _("Probing plain encryptions"));
 
@@ -433,6 +451,8 @@ namespace storage
 
 	y2mil("prober pass 1e");
 
+	pass_span.emplace("prober", "pass 1e");
+
 	// TRANSLATORS: progress message
 	message_callback(probe_callbacks, _("Probing device relationships"));
 
@@ -450,6 +470,8 @@ namespace storage
 
 	y2mil("prober pass 1f");
 
+	pass_span.emplace("prober", "pass 1f");
+
 	// TRANSLATORS: progress message
 	message_callback(probe_callbacks, _("Probing additional attributes"));
 
@@ -471,6 +493,8 @@ namespace storage
 
 	y2mil("prober pass 2");
 
+	pass_span.emplace("prober", "pass 2");
+
 	// TRANSLATORS: progress message
 	message_callback(probe_callbacks, _("Probing file systems"));
 
@@ -517,10 +541,18 @@ namespace storage
 
 	y2mil("used features (required): " << get_used_features_names(system->used_features(UsedFeaturesDependencyType::REQUIRED)));
 
+	pass_span.reset();
+
 	y2mil("prober done");
     }
 
 
+    Prober::Prober(const Storage& storage, Devicegraph* system, SystemInfo::Impl& system_info)
+	: storage(storage), probe_callbacks(nullptr), system(system), system_info(system_info), lazy(false)
+    {
+    }
+
+
     void
     Prober::add_holder(const string& name, Device* b, add_holder_func_t add_holder_func)
     {
@@ -569,6 +601,11 @@ namespace storage
     void
     Prober::handle(const Exception& exception, const Text& message, uint64_t used_features) const
     {
+	// Probing must not continue after a cancel or when the time budget is
+	// exhausted.
+	if (typeid(exception) == typeid(CommandCancelledException))
+	    ST_RETHROW(exception);
+
 	const ProbeCallbacksV2* probe_callbacks_v2 = dynamic_cast<const ProbeCallbacksV2*>(probe_callbacks);
 
 	if (probe_callbacks_v2 && typeid(exception) == typeid(CommandNotFoundException))
@@ -81,6 +81,12 @@ namespace storage
 	Prober(const Storage& storage, const ProbeCallbacks* probe_callbacks, Devicegraph* system,
 	       SystemInfo::Impl& system_info);
 
+	/**
+	 * The constructor does not probe anything. Used to probe details
+	 * postponed by lazy probing, see Btrfs::Impl::probe_lazy_details().
+	 */
+	Prober(const Storage& storage, Devicegraph* system, SystemInfo::Impl& system_info);
+
 	const Storage& get_storage() const { return storage; }
 
 	const ProbeCallbacks* get_probe_callbacks() const { return probe_callbacks; }
@@ -91,6 +97,12 @@ namespace storage
 
 	SystemInfo::Impl& get_system_info() { return system_info; }
 
+	/**
+	 * Whether probing of expensive details should be postponed, see
+	 * Environment::set_lazy_probing().
+	 */
+	bool is_lazy() const { return lazy; }
+
 	typedef std::function<void(Devicegraph* system, Device* a, Device* b)> add_holder_func_t;
 
 	/**
@@ -122,6 +134,8 @@ namespace storage
 
 	SystemInfo::Impl& system_info;
 
+	const bool lazy;
+
 	SysBlockEntries sys_block_entries;
 
 	struct pending_holder_t
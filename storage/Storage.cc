@@ -411,6 +411,20 @@ namespace storage
     }
 
 
+    void
+    Storage::reprobe(const vector<string>& changed_devices, const ProbeCallbacks* probe_callbacks)
+    {
+	get_impl().reprobe(changed_devices, probe_callbacks);
+    }
+
+
+    void
+    Storage::probe_lazy_details()
+    {
+	get_impl().probe_lazy_details();
+    }
+
+
     void
     Storage::commit(const CommitCallbacks* commit_callbacks)
     {
@@ -495,4 +509,11 @@ namespace storage
 	return get_impl().get_pool(name);
     }
 
+
+    MetricsSnapshot
+    Storage::get_metrics() const
+    {
+	return get_impl().get_metrics();
+    }
+
 }
@@ -35,6 +35,7 @@
 #include "storage/CommitOptions.h"
 #include "storage/Actions/Base.h"
 #include "storage/Utils/Callbacks.h"
+#include "storage/Utils/Metrics.h"
 #include "storage/Utils/Swig.h"
 
 
@@ -389,6 +390,27 @@ namespace storage
     };
 
 
+    class ProbeCallbacksV5 : public ProbeCallbacksV4
+    {
+    public:
+
+	virtual ~ProbeCallbacksV5() {}
+
+	/**
+	 * Called periodically during probing, also while waiting for commands. If
+	 * it returns true running commands are terminated and probing fails with
+	 * an exception.
+	 *
+	 * Only called from the thread that started the operation, never from
+	 * the worker threads of libstorage-ng.
+	 *
+	 * @see Environment::set_probe_timeout()
+	 */
+	virtual bool cancel_requested() const { return false; }
+
+    };
+
+
     class CheckCallbacks
     {
     public:
@@ -438,7 +460,43 @@ namespace storage
     };
 
 
-    //! The main entry point to libstorage.
+    class CommitCallbacksV3 : public CommitCallbacksV2
+    {
+    public:
+
+	virtual ~CommitCallbacksV3() {}
+
+	/**
+	 * Called periodically during commit, also while waiting for commands. If
+	 * it returns true running commands are terminated and commit fails with
+	 * an exception. Actions already committed are not reverted.
+	 *
+	 * Only called from the thread that started the operation, never from
+	 * the worker threads of libstorage-ng.
+	 *
+	 * @see Environment::set_commit_timeout()
+	 */
+	virtual bool cancel_requested() const { return false; }
+
+    };
+
+
+    /**
+     * The main entry point to libstorage.
+     *
+     * Different Storage objects can be used at the same time from
+     * different threads, e.g. to probe several mockups or rootprefixes in
+     * parallel. Every operation uses the state of its own Storage object,
+     * e.g. the mockup, the probe cache and the operation budget. A single
+     * Storage object and its devicegraphs must not be modified from
+     * several threads at the same time.
+     *
+     * Shared by all Storage objects are the logger, see set_logger(),
+     * which must be thread-safe, and the remote callbacks, see
+     * set_remote_callbacks(), which must not be changed while operations
+     * run. The lock, see Environment, is also process-wide, so usually
+     * only read-only Storage objects can be used in parallel.
+     */
     class Storage : private boost::noncopyable
     {
     public:
@@ -641,6 +699,45 @@ namespace storage
 	 */
 	void probe(const ProbeCallbacks* probe_callbacks = nullptr);
 
+	/**
+	 * Probe the system completely again, e.g. after the devices
+	 * reported by a UeventMonitor changed, but reuse the cached
+	 * information of the previous probe for the devices that did not
+	 * change. The information of the changed devices, of their
+	 * partitions and of all devices above them (e.g. LUKS, LVM or MD
+	 * RAID) is queried again, as is the information covering all
+	 * devices (e.g. blkid and the LVM reports). So the cost is still that
+	 * of a full probe minus the cached per-device commands.
+	 *
+	 * The probed and system devicegraphs are rebuilt completely and
+	 * copied into the existing devicegraph objects. So pointers to the
+	 * devicegraphs stay valid but pointers to devices and holders in
+	 * them are invalidated. Devices whose type, name and parents are
+	 * unchanged keep their sid, so they can be looked up again with
+	 * Devicegraph::find_device(). The staging devicegraph is not
+	 * modified.
+	 *
+	 * If the system was not probed before or the probe mode does not
+	 * allow to query the system again a full probe without cache is
+	 * done.
+	 *
+	 * If an error reported via probe_callbacks is not ignored the
+	 * function throws Aborted.
+	 *
+	 * @throw Aborted, Exception
+	 */
+	void reprobe(const std::vector<std::string>& changed_devices,
+		     const ProbeCallbacks* probe_callbacks = nullptr);
+
+	/**
+	 * Probe the details postponed by lazy probing (if any) of all btrfs
+	 * in all devicegraphs, see Environment::set_lazy_probing(). Call
+	 * this before sharing the devicegraphs between several threads.
+	 *
+	 * @throw Exception
+	 */
+	void probe_lazy_details();
+
 	/**
 	 * The actiongraph must be valid.
 	 *
@@ -723,6 +820,15 @@ namespace storage
 	 */
 	const Pool* get_pool(const std::string& name) const;
 
+	/**
+	 * Return a snapshot of the runtime metrics, e.g. the number of
+	 * commands run. The metrics are global for the process, not per
+	 * Storage object.
+	 *
+	 * @see MetricsSnapshot
+	 */
+	MetricsSnapshot get_metrics() const;
+
     public:
 
 	class Impl;
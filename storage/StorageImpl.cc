@@ -21,6 +21,9 @@
  */
 
 
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
 #include "config.h"
 #include "storage/Utils/AppUtil.h"
 #include "storage/Utils/Mockup.h"
@@ -33,24 +36,47 @@
 #include "storage/Devices/LvmLvImpl.h"
 #include "storage/Devices/LuksImpl.h"
 #include "storage/Devices/BitlockerV2Impl.h"
+#include "storage/Filesystems/BtrfsImpl.h"
 #include "storage/Pool.h"
 #include "storage/SystemInfo/SystemInfoImpl.h"
+#include "storage/SystemInfo/BlkidProbe.h"
 #include "storage/Actiongraph.h"
 #include "storage/Prober.h"
 #include "storage/EnvironmentImpl.h"
 #include "storage/Utils/Format.h"
 #include "storage/Utils/CallbacksImpl.h"
+#include "storage/Utils/OperationBudget.h"
+#include "storage/Utils/ProbeCache.h"
+#include "storage/Utils/Remote.h"
 #include "storage/Utils/StorageTmpl.h"
+#include "storage/Utils/Trace.h"
+#include "storage/Utils/MetricsImpl.h"
 
 
 namespace storage
 {
 
-    sid_t Storage::Impl::global_sid = initial_global_sid;
+    std::atomic<sid_t> Storage::Impl::global_sid(initial_global_sid);
+
+
+    namespace
+    {
+
+	bool
+	uses_mockup(ProbeMode probe_mode)
+	{
+	    return probe_mode == ProbeMode::READ_MOCKUP || probe_mode == ProbeMode::STANDARD_WRITE_MOCKUP;
+	}
+
+    }
 
 
     Storage::Impl::Impl(Storage& storage, const Environment& environment)
-	: storage(storage), environment(environment), arch(false),
+	: storage(storage), environment(environment),
+	  tracer(environment.get_trace_filename().empty() ? nullptr :
+		 make_unique<Tracer>(environment.get_trace_filename())),
+	  mockup_state(uses_mockup(environment.get_probe_mode()) ? make_shared<Mockup::State>() : nullptr),
+	  arch(false),
 	  lock(environment.is_read_only(), !environment.get_impl().is_do_lock(),
 	       environment.get_impl().get_lockfile_root()),
 	  default_mount_by(MountByType::UUID), rootprefix(environment.get_rootprefix()),
@@ -75,11 +101,23 @@ namespace storage
     }
 
 
+    void
+    Storage::Impl::raise_global_sid(sid_t sid)
+    {
+	sid_t current = global_sid.load();
+
+	while (current <= sid && !global_sid.compare_exchange_weak(current, sid + 1))
+	    ;
+    }
+
+
     void
     Storage::Impl::activate(const ActivateCallbacks* activate_callbacks) const
     {
 	ST_CHECK_PTR(activate_callbacks);
 
+	Mockup::Guard mockup_guard(mockup_state);
+
 	CallbacksGuard callbacks_guard(activate_callbacks);
 
 	/**
@@ -134,6 +172,8 @@ namespace storage
     DeactivateStatusV2
     Storage::Impl::deactivate() const
     {
+	Mockup::Guard mockup_guard(mockup_state);
+
 	y2mil("deactivate begin");
 
 	/**
@@ -177,15 +217,165 @@ namespace storage
     }
 
 
+    namespace
+    {
+
+	/**
+	 * Identify a device by its classname and displayname together with
+	 * the identities of its parents. Used to find the same device in
+	 * two devicegraphs although the sids differ.
+	 */
+	const string&
+	identity(const Device* device, map<sid_t, string>& cache)
+	{
+	    map<sid_t, string>::const_iterator it = cache.find(device->get_sid());
+	    if (it != cache.end())
+		return it->second;
+
+	    vector<string> parents;
+	    for (const Device* parent : device->get_parents())
+		parents.push_back(identity(parent, cache));
+
+	    sort(parents.begin(), parents.end());
+
+	    string ret = string(device->get_impl().get_classname()) + ":" + device->get_displayname();
+	    for (const string& parent : parents)
+		ret += "|" + parent;
+
+	    return cache[device->get_sid()] = ret;
+	}
+
+
+	map<string, Device*>
+	unique_identities(const vector<Device*>& devices)
+	{
+	    map<sid_t, string> cache;
+	    map<string, Device*> ret;
+	    set<string> duplicates;
+
+	    for (Device* device : devices)
+	    {
+		const string& tmp = identity(device, cache);
+		if (!ret.emplace(tmp, device).second)
+		    duplicates.insert(tmp);
+	    }
+
+	    for (const string& duplicate : duplicates)
+		ret.erase(duplicate);
+
+	    return ret;
+	}
+
+
+	/**
+	 * Give devices in the new devicegraph that also exist in the old
+	 * devicegraph the sid from the old devicegraph.
+	 */
+	void
+	keep_sids(const Devicegraph* old_devicegraph, Devicegraph* new_devicegraph)
+	{
+	    map<string, Device*> old_identities =
+		unique_identities(old_devicegraph->get_impl().get_devices_of_type<Device>());
+	    map<string, Device*> new_identities =
+		unique_identities(new_devicegraph->get_impl().get_devices_of_type<Device>());
+
+	    unsigned int kept = 0;
+
+	    for (const map<string, Device*>::value_type& value : new_identities)
+	    {
+		map<string, Device*>::const_iterator it = old_identities.find(value.first);
+		if (it == old_identities.end())
+		    continue;
+
+		value.second->get_impl().set_sid(it->second->get_sid());
+		++kept;
+	    }
+
+	    y2mil("kept sids of " << kept << " of " << new_devicegraph->num_devices() << " devices");
+	}
+
+
+	/**
+	 * Extends the changed devices by all block devices holding them,
+	 * directly or indirectly, according to the devicegraph of the
+	 * previous probe, e.g. the LUKS on a partition of a changed disk.
+	 * Their system information can be stale too, e.g. their sysfs path.
+	 * Partitions are included since their names start with the name of
+	 * the changed device.
+	 */
+	vector<string>
+	affected_devices(const Devicegraph* system, const vector<string>& changed_devices)
+	{
+	    set<string> ret(changed_devices.begin(), changed_devices.end());
+
+	    for (const BlkDevice* blk_device : BlkDevice::get_all(system))
+	    {
+		const string& name = blk_device->get_name();
+
+		bool changed = any_of(changed_devices.begin(), changed_devices.end(), [&name](const string& tmp) {
+		    return boost::starts_with(name, tmp);
+		});
+
+		if (!changed)
+		    continue;
+
+		ret.insert(name);
+
+		for (const Device* descendant : blk_device->get_descendants(false, View::ALL))
+		{
+		    if (is_blk_device(descendant))
+			ret.insert(to_blk_device(descendant)->get_name());
+		}
+	    }
+
+	    y2mil("affected devices " << ret);
+
+	    return vector<string>(ret.begin(), ret.end());
+	}
+
+    }
+
+
     void
     Storage::Impl::probe(const ProbeCallbacks* probe_callbacks)
     {
+	LogCorrelation log_correlation("probe");
+
+	// The mockup state stays current after probing, see
+	// Mockup::State.
+
+	if (mockup_state)
+	    Mockup::set_current_state(mockup_state);
+
+	try
+	{
+	    probe_traced(probe_callbacks);
+	}
+	catch (...)
+	{
+	    write_trace();
+	    throw;
+	}
+
+	write_trace();
+    }
+
+
+    void
+    Storage::Impl::probe_traced(const ProbeCallbacks* probe_callbacks)
+    {
+	TraceSpan trace_span("storage", "probe");
+	trace_span.add_arg("probe-mode", toString(environment.get_probe_mode()));
+
 	y2mil("probe begin");
 
 	y2mil("rootprefix: " << get_rootprefix());
 
 	CallbacksGuard callbacks_guard(probe_callbacks);
 
+	OperationBudget operation_budget(std::chrono::seconds(environment.get_impl().get_probe_timeout()),
+					 cancel_requested_function(probe_callbacks));
+
 	if (exist_devicegraph("probed"))
 	    remove_devicegraph("probed");
 
@@ -200,20 +390,55 @@ namespace storage
 
 	Devicegraph* probed = create_devicegraph("system");
 
+	system_info.reset();
+
 	switch (environment.get_probe_mode())
 	{
 	    case ProbeMode::STANDARD: {
-		probe_helper(probe_callbacks, probed);
+		unique_ptr<ProbeCache> probe_cache;
+		switch (probe_cache_mode())
+		{
+		    case ProbeCacheMode::NONE:
+			break;
+
+		    case ProbeCacheMode::USE:
+			probe_cache = make_unique<ProbeCache>(ProbeCache::Mode::USE, PROBE_CACHE_FILE);
+			break;
+
+		    case ProbeCacheMode::VALIDATE:
+			probe_cache = make_unique<ProbeCache>(ProbeCache::Mode::VALIDATE, PROBE_CACHE_FILE);
+			break;
+		}
+
+		unique_ptr<SystemInfo::Impl> tmp = make_unique<SystemInfo::Impl>();
+		probe_helper(probe_callbacks, probed, *tmp);
+		system_info = std::move(tmp);
+
+		if (probe_cache && !get_remote_callbacks())
+		{
+		    try
+		    {
+			probe_cache->save();
+		    }
+		    catch (const Exception& exception)
+		    {
+			ST_CAUGHT(exception);
+
+			y2war("failed to save probe cache");
+		    }
+		}
 	    } break;
 
 	    case ProbeMode::STANDARD_WRITE_DEVICEGRAPH: {
-		probe_helper(probe_callbacks, probed);
+		SystemInfo::Impl tmp;
+		probe_helper(probe_callbacks, probed, tmp);
 		probed->save(environment.get_devicegraph_filename());
 	    } break;
 
 	    case ProbeMode::STANDARD_WRITE_MOCKUP: {
+		SystemInfo::Impl tmp;
 		Mockup::set_mode(Mockup::Mode::RECORD);
-		probe_helper(probe_callbacks, probed);
+		probe_helper(probe_callbacks, probed, tmp);
 		Mockup::save(environment.get_mockup_filename());
 	    } break;
 
@@ -225,10 +450,14 @@ namespace storage
 	    } break;
 
 	    case ProbeMode::READ_MOCKUP: {
+		unique_ptr<SystemInfo::Impl> tmp = make_unique<SystemInfo::Impl>();
 		Mockup::set_mode(Mockup::Mode::PLAYBACK);
+		Mockup::set_latency_scale(mockup_latency_scale());
 		Mockup::load(environment.get_mockup_filename());
-		probe_helper(probe_callbacks, probed);
-		Mockup::occams_razor();
+		probe_helper(probe_callbacks, probed, *tmp);
+		if (!environment.is_lazy_probing())
+		    Mockup::occams_razor();
+		system_info = std::move(tmp);
 	    } break;
 	}
 
@@ -244,10 +473,211 @@ namespace storage
 
 
     void
-    Storage::Impl::probe_helper(const ProbeCallbacks* probe_callbacks, Devicegraph* probed)
+    Storage::Impl::reprobe(const vector<string>& changed_devices, const ProbeCallbacks* probe_callbacks)
+    {
+	if (!system_info || !exist_devicegraph("system"))
+	{
+	    y2mil("no previous probe, doing full probe");
+	    probe(probe_callbacks);
+	    return;
+	}
+
+	LogCorrelation log_correlation("reprobe");
+
+	// The mockup state stays current after probing, see
+	// Mockup::State.
+
+	if (mockup_state)
+	    Mockup::set_current_state(mockup_state);
+
+	try
+	{
+	    reprobe_traced(changed_devices, probe_callbacks);
+	}
+	catch (...)
+	{
+	    write_trace();
+	    throw;
+	}
+
+	write_trace();
+    }
+
+
+    void
+    Storage::Impl::reprobe_traced(const vector<string>& changed_devices, const ProbeCallbacks* probe_callbacks)
     {
-	SystemInfo::Impl system_info;
+	TraceSpan trace_span("storage", "reprobe");
+	trace_span.add_arg("changed-devices", boost::join(changed_devices, " "));
+
+	y2mil("reprobe begin");
+
+	CallbacksGuard callbacks_guard(probe_callbacks);
+
+	OperationBudget operation_budget(std::chrono::seconds(environment.get_impl().get_probe_timeout()),
+					 cancel_requested_function(probe_callbacks));
+
+	Devicegraph* system = get_system();
+
+	system_info->invalidate(affected_devices(system, changed_devices));
+
+	// As in probe() the system devicegraph is used for probing since
+	// it is needed e.g. in EnsureMounted. The commands for the affected
+	// devices and the commands covering all devices are run again,
+	// everything else comes from the cache. On failure the old
+	// devicegraph is restored and the system information is not
+	// trusted anymore.
 
+	Devicegraph old(&storage);
+	system->copy(old);
+
+	system->clear();
+
+	try
+	{
+	    probe_helper(probe_callbacks, system, *system_info);
+	}
+	catch (...)
+	{
+	    old.copy(*system);
+	    system_info.reset();
+	    throw;
+	}
+
+	y2mil("reprobe end");
+
+	keep_sids(&old, system);
+
+	y2mil("probed devicegraph begin");
+	y2mil(*system);
+	y2mil("probed devicegraph end");
+
+	// Copy into the existing probed devicegraph so that pointers to it
+	// stay valid.
+
+	system->copy(devicegraphs.find("probed")->second);
+    }
+
+
+    void
+    Storage::Impl::probe_lazy_details(Devicegraph* devicegraph, sid_t sid)
+    {
+	// While probing the details functions of Btrfs may be called on this
+	// thread, e.g. by the prober, which must not probe again.
+
+	static thread_local bool probing = false;
+
+	if (probing)
+	    return;
+
+	std::lock_guard<std::mutex> lock(lazy_details_mutex);
+
+	probing = true;
+
+	try
+	{
+	    probe_lazy_details_locked(devicegraph, sid);
+	}
+	catch (...)
+	{
+	    probing = false;
+	    throw;
+	}
+
+	probing = false;
+    }
+
+
+    void
+    Storage::Impl::probe_lazy_details_locked(Devicegraph* devicegraph, sid_t sid)
+    {
+	Mockup::Guard mockup_guard(mockup_state);
+
+	y2mil("probe lazy details begin");
+
+	TraceSpan trace_span("storage", "probe lazy details");
+	trace_span.add_arg("sid", to_string(sid));
+
+	// Only possible if the system can be queried again, e.g. not for a
+	// devicegraph loaded from XML with postponed details.
+
+	if (environment.get_probe_mode() != ProbeMode::STANDARD &&
+	    environment.get_probe_mode() != ProbeMode::READ_MOCKUP)
+	    ST_THROW(Exception("postponed details of btrfs cannot be probed in probe mode " +
+			       toString(environment.get_probe_mode())));
+
+	if (!system_info)
+	    system_info = make_unique<SystemInfo::Impl>();
+
+	// All devicegraphs must be updated so that e.g. the actiongraph does
+	// not see different subvolumes in probed and staging. The system
+	// devicegraph comes first to provide the sids for the others.
+
+	vector<Devicegraph*> todo;
+
+	if (exist_devicegraph("system"))
+	    todo.push_back(get_system());
+
+	for (devicegraphs_t::value_type& key_value : devicegraphs)
+	{
+	    if (!contains(todo, &key_value.second))
+		todo.push_back(&key_value.second);
+	}
+
+	if (devicegraph && !contains(todo, devicegraph))
+	    todo.push_back(devicegraph);
+
+	const Btrfs* reference = nullptr;
+
+	for (Devicegraph* tmp : todo)
+	{
+	    if (!tmp->device_exists(sid))
+		continue;
+
+	    Btrfs* btrfs = dynamic_cast<Btrfs*>(tmp->find_device(sid));
+	    if (!btrfs)
+		continue;
+
+	    // The details may already be probed in some devicegraphs, e.g.
+	    // when probing for a devicegraph not owned by the storage object.
+
+	    if (btrfs->get_impl().has_lazy_details())
+	    {
+		Prober prober(storage, tmp, *system_info);
+		btrfs->get_impl().probe_details(prober, reference);
+	    }
+
+	    if (!reference)
+		reference = btrfs;
+	}
+
+	y2mil("probe lazy details end");
+    }
+
+
+    void
+    Storage::Impl::probe_lazy_details()
+    {
+	set<sid_t> sids;
+
+	for (const devicegraphs_t::value_type& key_value : devicegraphs)
+	{
+	    for (const Btrfs* btrfs : Btrfs::get_all(&key_value.second))
+	    {
+		if (btrfs->get_impl().has_lazy_details())
+		    sids.insert(btrfs->get_sid());
+	    }
+	}
+
+	for (sid_t sid : sids)
+	    probe_lazy_details(nullptr, sid);
+    }
+
+
+    void
+    Storage::Impl::probe_helper(const ProbeCallbacks* probe_callbacks, Devicegraph* probed,
+				SystemInfo::Impl& system_info)
+    {
 	arch = system_info.getArch();
 
 	Prober prober(storage, probe_callbacks, probed, system_info);
@@ -366,6 +796,10 @@ namespace storage
     Devicegraph*
     Storage::Impl::copy_devicegraph(const string& source_name, const string& dest_name)
     {
+	TraceSpan trace_span("devicegraph", "copy devicegraph");
+	trace_span.add_arg("source", source_name);
+	trace_span.add_arg("destination", dest_name);
+
 	const Devicegraph* tmp1 = static_cast<const Impl*>(this)->get_devicegraph(source_name);
 
 	Devicegraph* tmp2 = create_devicegraph(dest_name);
@@ -413,6 +847,10 @@ namespace storage
     bool
     Storage::Impl::equal_devicegraph(const string& lhs, const string& rhs) const
     {
+	TraceSpan trace_span("devicegraph", "equal devicegraph");
+	trace_span.add_arg("lhs", lhs);
+	trace_span.add_arg("rhs", rhs);
+
 	return *get_devicegraph(lhs) == *get_devicegraph(rhs);
     }
 
@@ -464,8 +902,14 @@ namespace storage
     const Actiongraph*
     Storage::Impl::calculate_actiongraph()
     {
+	TraceSpan trace_span("storage", "calculate actiongraph");
+
 	actiongraph = nullptr;	// free old actiongraph before generating new to avoid memory peak
 
+	// The actions for subvolumes and qgroups need the complete details.
+
+	probe_lazy_details();
+
 	unique_ptr<Actiongraph> tmp = make_unique<Actiongraph>(storage, get_system(), get_staging());
 	tmp->generate_compound_actions();
 
@@ -480,12 +924,57 @@ namespace storage
     {
 	ST_CHECK_PTR(actiongraph.get());
 
+	LogCorrelation log_correlation("commit");
+
+	Mockup::Guard mockup_guard(mockup_state);
+
+	try
+	{
+	    commit_traced(commit_options, commit_callbacks);
+	}
+	catch (...)
+	{
+	    write_trace();
+	    throw;
+	}
+
+	write_trace();
+    }
+
+
+    void
+    Storage::Impl::commit_traced(const CommitOptions& commit_options, const CommitCallbacks* commit_callbacks)
+    {
+	TraceSpan trace_span("storage", "commit");
+
+	OperationBudget operation_budget(std::chrono::seconds(environment.get_impl().get_commit_timeout()),
+					 cancel_requested_function(commit_callbacks));
+
+	// Cached probe results are not trusted after own modifications.
+	BlkidProbe::flush_cache();
+	system_info.reset();
+
 	actiongraph->get_impl().commit(commit_options, commit_callbacks);
 
 	// TODO somehow update probed
     }
 
 
+    MetricsSnapshot
+    Storage::Impl::get_metrics() const
+    {
+	return Metrics::snapshot();
+    }
+
+
+    void
+    Storage::Impl::write_trace() const
+    {
+	if (tracer)
+	    tracer->write();
+    }
+
+
     void
     Storage::Impl::generate_pools(const Devicegraph* devicegraph)
     {
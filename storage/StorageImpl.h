@@ -25,12 +25,18 @@
 #define STORAGE_STORAGE_IMPL_H
 
 
+#include <atomic>
+#include <mutex>
+
 #include "storage/Devices/Device.h"
 #include "storage/Utils/FileUtils.h"
+#include "storage/Utils/Mockup.h"
 #include "storage/Utils/LockImpl.h"
+#include "storage/Utils/Trace.h"
 #include "storage/Storage.h"
 #include "storage/Environment.h"
 #include "storage/SystemInfo/Arch.h"
+#include "storage/SystemInfo/SystemInfo.h"
 #include "storage/CommitOptions.h"
 
 
@@ -136,6 +142,28 @@ namespace storage
 
 	void probe(const ProbeCallbacks* probe_callbacks);
 
+	void reprobe(const vector<string>& changed_devices, const ProbeCallbacks* probe_callbacks);
+
+	/**
+	 * Probe the details of the btrfs with sid postponed by lazy probing
+	 * in all devicegraphs and in devicegraph (which may be a devicegraph
+	 * not owned by the storage object or nullptr).
+	 *
+	 * Also called on demand by const functions of Btrfs, possibly from
+	 * several threads at the same time. The details are probed only
+	 * once. Calls from the thread probing the details return
+	 * immediately.
+	 *
+	 * @throw Exception
+	 */
+	void probe_lazy_details(Devicegraph* devicegraph, sid_t sid);
+
+	/**
+	 * Probe the details of all btrfs postponed by lazy probing in all
+	 * devicegraphs.
+	 */
+	void probe_lazy_details();
+
 	void commit(const CommitOptions& commit_options, const CommitCallbacks* commit_callbacks);
 
 	void generate_pools(const Devicegraph* devicegraph);
@@ -156,6 +184,8 @@ namespace storage
 	Pool* get_pool(const string& name);
 	const Pool* get_pool(const string& name) const;
 
+	MetricsSnapshot get_metrics() const;
+
 	const TmpDir& get_tmp_dir() const { return tmp_dir; }
 
 	/**
@@ -166,7 +196,7 @@ namespace storage
 	/**
 	 * Raises the global sid to avoid potential conflicts with sid.
 	 */
-	static void raise_global_sid(sid_t sid) { global_sid = max(global_sid, sid + 1); }
+	static void raise_global_sid(sid_t sid);
 
 	/**
 	 * Resets the global sid. Only for testsuites.
@@ -180,16 +210,59 @@ namespace storage
 
 	static const sid_t initial_global_sid = 42;	// just a random number ;)
 
-	static sid_t global_sid;
+	/**
+	 * Shared by all Storage objects so that sids are unique in the
+	 * process. Atomic since Storage objects may be used in different
+	 * threads.
+	 */
+	static std::atomic<sid_t> global_sid;
+
+	void probe_traced(const ProbeCallbacks* probe_callbacks);
+
+	void probe_lazy_details_locked(Devicegraph* devicegraph, sid_t sid);
+
+	void reprobe_traced(const vector<string>& changed_devices, const ProbeCallbacks* probe_callbacks);
+
+	void probe_helper(const ProbeCallbacks* probe_callbacks, Devicegraph* system,
+			  SystemInfo::Impl& system_info);
 
-	void probe_helper(const ProbeCallbacks* probe_callbacks, Devicegraph* system);
+	void commit_traced(const CommitOptions& commit_options, const CommitCallbacks* commit_callbacks);
+
+	/**
+	 * Write the trace file if tracing is enabled.
+	 */
+	void write_trace() const;
 
 	Storage& storage;
 
 	const Environment environment;
 
+	/**
+	 * Only set if tracing is enabled in the environment. Declared early
+	 * so that it is destroyed, and thus the trace written, last.
+	 */
+	std::unique_ptr<Tracer> tracer;
+
+	/**
+	 * Only set if the probe mode reads or writes a mockup. Set as the
+	 * current mockup state of the thread during operations, see
+	 * Mockup::State.
+	 */
+	const std::shared_ptr<Mockup::State> mockup_state;
+
 	Arch arch;
 
+	/**
+	 * The system information of the last probe. Kept for reprobe()
+	 * and lazy probing if the probe mode allows to query the system again.
+	 */
+	std::unique_ptr<SystemInfo::Impl> system_info;
+
+	/**
+	 * Serializes probing the details postponed by lazy probing.
+	 */
+	std::mutex lazy_details_mutex;
+
 	Lock lock;
 
 	using devicegraphs_t = map<string, Devicegraph>;
@@ -177,11 +177,11 @@ namespace storage
     {
 	// TODO move efibootmgr to Arch class - but breaks ABI
 
-	static bool did_check = false;
-	static bool efibootmgr;
+	// The initialization of the static variable is thread-safe. If the
+	// command throws it is tried again on the next call.
+
+	static const bool efibootmgr = []() {
 
-	if (!did_check)
-	{
 	    // Check that efivars directory is writeable and nonempty (bsc #1185610).
 
 	    SystemCmd::Options options(TEST_BIN " -w '" EFIVARS_DIR "' -a "
@@ -190,10 +190,9 @@ namespace storage
 
 	    SystemCmd cmd(options);
 
-	    efibootmgr = cmd.retcode() == 0;
+	    return cmd.retcode() == 0;
 
-	    did_check = true;
-	}
+	}();
 
 	return efibootmgr;
     }
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include "config.h"
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fstream>
+#include <mutex>
+#include <boost/algorithm/string.hpp>
+
+#ifdef HAVE_LIBBLKID
+#include <blkid/blkid.h>
+#endif
+
+#include "storage/SystemInfo/BlkidProbe.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/Format.h"
+#include "storage/EnvironmentImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	string
+	read_line(const string& path)
+	{
+	    ifstream s(path);
+
+	    string line;
+	    getline(s, line);
+
+	    return line;
+	}
+
+    }
+
+
+    bool
+    BlkidProbe::Key::operator==(const Key& rhs) const
+    {
+	return majorminor == rhs.majorminor && diskseq == rhs.diskseq &&
+	    udev_mtime.tv_sec == rhs.udev_mtime.tv_sec && udev_mtime.tv_nsec == rhs.udev_mtime.tv_nsec;
+    }
+
+
+    bool
+    BlkidProbe::get_key(dev_t majorminor, Key& key, const string& udev_data_dir, const string& sysfs_dir)
+    {
+	key.majorminor = majorminor;
+
+	const string id = sformat("%d:%d", major(majorminor), minor(majorminor));
+
+	// Without a udev watch writes to the device, e.g. by mkfs, do not
+	// trigger a change event.
+
+	if (access((udev_data_dir + "/../watch/b" + id).c_str(), F_OK) != 0)
+	    return false;
+
+	struct stat st;
+	if (stat((udev_data_dir + "/b" + id).c_str(), &st) != 0)
+	    return false;
+
+	key.udev_mtime = st.st_mtim;
+
+	// For partitions the disk sequence number is only available for the
+	// disk.
+
+	const string path = sysfs_dir + "/dev/block/" + id;
+
+	key.diskseq = read_line(path + (access((path + "/partition").c_str(), F_OK) == 0 ?
+					"/../diskseq" : "/diskseq"));
+
+	return true;
+    }
+
+
+#ifdef HAVE_LIBBLKID
+
+    namespace
+    {
+
+	struct CacheEntry
+	{
+	    BlkidProbe::Key key;
+	    map<string, string> tags;
+	};
+
+
+	std::mutex cache_mutex;
+
+	map<string, CacheEntry> cache;
+
+
+	/**
+	 * Get the key of the device. Returns false if the result for the
+	 * device must not be cached.
+	 */
+	bool
+	get_device_key(const string& device, BlkidProbe::Key& key)
+	{
+	    struct stat st;
+	    if (stat(device.c_str(), &st) != 0 || !S_ISBLK(st.st_mode))
+		return false;
+
+	    return BlkidProbe::get_key(st.st_rdev, key);
+	}
+
+
+	map<string, string>
+	probe_uncached(const string& device)
+	{
+	    map<string, string> tags;
+
+	    blkid_probe pr = blkid_new_probe_from_filename(device.c_str());
+	    if (!pr)
+	    {
+		y2war("blkid failed to open " << device);
+		return tags;
+	    }
+
+	    // Same settings as blkid uses for the cache.
+
+	    blkid_probe_enable_superblocks(pr, 1);
+	    blkid_probe_set_superblocks_flags(pr, BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID |
+					      BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE);
+	    blkid_probe_enable_partitions(pr, 1);
+	    blkid_probe_set_partitions_flags(pr, BLKID_PARTS_ENTRY_DETAILS);
+
+	    int r = blkid_do_safeprobe(pr);
+	    if (r == 0)
+	    {
+		int n = blkid_probe_numof_values(pr);
+		for (int i = 0; i < n; ++i)
+		{
+		    const char* name = nullptr;
+		    const char* data = nullptr;
+
+		    if (blkid_probe_get_value(pr, i, &name, &data, nullptr) == 0 && name && data)
+			tags[name] = data;
+		}
+	    }
+	    else if (r == -2)
+	    {
+		y2war("blkid found ambiguous signatures on " << device);
+	    }
+	    else if (r < 0)
+	    {
+		y2war("blkid failed to probe " << device);
+	    }
+
+	    blkid_free_probe(pr);
+
+	    return tags;
+	}
+
+    }
+
+#endif
+
+
+    bool
+    BlkidProbe::is_usable()
+    {
+#ifdef HAVE_LIBBLKID
+	return Mockup::get_mode() == Mockup::Mode::NONE && !get_remote_callbacks() && native_blkid();
+#else
+	return false;
+#endif
+    }
+
+
+    vector<string>
+    BlkidProbe::get_devices()
+    {
+	vector<string> lines;
+
+	ifstream s(PROC_DIR "/partitions");
+
+	string line;
+	while (getline(s, line))
+	    lines.push_back(line);
+
+	return parse_partitions(lines);
+    }
+
+
+    vector<string>
+    BlkidProbe::parse_partitions(const vector<string>& lines, const string& sysfs_dir)
+    {
+	vector<string> devices;
+
+	for (const string& line : lines)
+	{
+	    vector<string> columns;
+	    boost::split(columns, line, boost::is_any_of(" \t"), boost::token_compress_on);
+	    if (!columns.empty() && columns.front().empty())
+		columns.erase(columns.begin());
+
+	    if (columns.size() != 4 || columns[0] == "major")
+		continue;
+
+	    // Skip extended partitions (size 1 KiB) like blkid does.
+	    if (columns[2] == "1")
+		continue;
+
+	    const string& name = columns[3];
+
+	    if (boost::starts_with(name, "dm-"))
+	    {
+		string dm_name = read_line(sysfs_dir + "/block/" + name + "/dm/name");
+		if (!dm_name.empty())
+		{
+		    devices.push_back(DEV_MAPPER_DIR "/" + dm_name);
+		    continue;
+		}
+	    }
+
+	    devices.push_back(DEV_DIR "/" + name);
+	}
+
+	return devices;
+    }
+
+
+    map<string, string>
+    BlkidProbe::probe(const string& device)
+    {
+#ifdef HAVE_LIBBLKID
+	Key key;
+	bool cacheable = get_device_key(device, key);
+
+	if (cacheable)
+	{
+	    std::lock_guard<std::mutex> lock(cache_mutex);
+
+	    map<string, CacheEntry>::const_iterator it = cache.find(device);
+	    if (it != cache.end() && it->second.key == key)
+		return it->second.tags;
+	}
+
+	map<string, string> tags = probe_uncached(device);
+
+	{
+	    std::lock_guard<std::mutex> lock(cache_mutex);
+
+	    if (cacheable)
+		cache[device] = { key, tags };
+	    else
+		cache.erase(device);
+	}
+
+	return tags;
+#else
+	ST_THROW(LogicException("libblkid not available"));
+#endif
+    }
+
+
+    void
+    BlkidProbe::flush_cache()
+    {
+#ifdef HAVE_LIBBLKID
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	cache.clear();
+#endif
+    }
+
+}
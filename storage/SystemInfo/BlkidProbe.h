@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_BLKID_PROBE_H
+#define STORAGE_BLKID_PROBE_H
+
+
+#include <sys/types.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "storage/Utils/StorageDefines.h"
+
+
+namespace storage
+{
+    using std::string;
+    using std::vector;
+    using std::map;
+
+
+    /**
+     * Probe block devices in-process using libblkid instead of running the
+     * blkid command.
+     *
+     * The results are cached per device. A cached result is only used if
+     * the device is watched by udev (so any write to the device triggers
+     * a change event and thus an update of the udev database) and neither
+     * the device number, the disk sequence number nor the modification
+     * time of the udev database entry of the device have changed.
+     */
+    class BlkidProbe
+    {
+    public:
+
+	/**
+	 * Check whether libblkid should be used for probing. Not the case
+	 * when libstorage-ng was built without libblkid or when using
+	 * mockup or remote callbacks since the blkid output is needed
+	 * there.
+	 */
+	static bool is_usable();
+
+	/**
+	 * Get the devices the blkid command would probe when run without a
+	 * device, i.e. the devices from /proc/partitions with device mapper
+	 * devices named /dev/mapper/<name>.
+	 */
+	static vector<string> get_devices();
+
+	/**
+	 * Get the devices from the lines of /proc/partitions. Extended
+	 * partitions are skipped like blkid does. The sysfs directory can
+	 * only be changed for testsuites.
+	 */
+	static vector<string> parse_partitions(const vector<string>& lines,
+					       const string& sysfs_dir = SYSFS_DIR);
+
+	/**
+	 * Probe the device and return the tags, e.g. TYPE, UUID and
+	 * LABEL. Empty if nothing was found.
+	 */
+	static map<string, string> probe(const string& device);
+
+	/**
+	 * Drop all cached results.
+	 */
+	static void flush_cache();
+
+	/**
+	 * Everything that must be unchanged for a cached result to be
+	 * valid.
+	 */
+	struct Key
+	{
+	    dev_t majorminor = 0;
+	    string diskseq;
+	    struct timespec udev_mtime = { 0, 0 };
+
+	    bool operator==(const Key& rhs) const;
+	    bool operator!=(const Key& rhs) const { return !(*this == rhs); }
+	};
+
+	/**
+	 * Get the key of the device with the given device number. Returns
+	 * false if the result for the device must not be cached. The
+	 * directories can only be changed for testsuites, the udev watch
+	 * directory is next to the udev data directory.
+	 */
+	static bool get_key(dev_t majorminor, Key& key, const string& udev_data_dir = UDEV_DATA_DIR,
+			    const string& sysfs_dir = SYSFS_DIR);
+
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,610 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <endian.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/btrfs.h>
+#include <linux/btrfs_tree.h>
+#include <functional>
+
+#include "storage/SystemInfo/BtrfsIoctl.h"
+#include "storage/SystemInfo/CmdBtrfs.h"
+#include "storage/SystemInfo/CmdLsattr.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/Format.h"
+#include "storage/Utils/Uuid.h"
+#include "storage/EnvironmentImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	/**
+	 * Read a little-endian value from an unaligned item.
+	 */
+	template <typename Type>
+	Type
+	get(const char* data, size_t offset)
+	{
+	    Type value;
+	    memcpy(&value, data + offset, sizeof(value));
+	    return value;
+	}
+
+
+	unsigned long long
+	get_le64(const char* data, size_t offset)
+	{
+	    return le64toh(get<uint64_t>(data, offset));
+	}
+
+
+	unsigned int
+	get_le16(const char* data, size_t offset)
+	{
+	    return le16toh(get<uint16_t>(data, offset));
+	}
+
+
+	using search_func_t = std::function<void(const btrfs_ioctl_search_header& header, const char* data)>;
+
+
+	/**
+	 * Search the tree for items with key types between min_type and
+	 * max_type. Returns false if the tree does not exist (e.g. the quota
+	 * tree if quota is disabled).
+	 */
+	bool
+	search(int fd, const string& mount_point, unsigned long long tree_id, unsigned long long min_objectid,
+	       unsigned long long max_objectid, unsigned int min_type, unsigned int max_type,
+	       const search_func_t& func)
+	{
+	    const size_t buf_size = 256 * 1024;
+
+	    vector<uint64_t> buffer((sizeof(btrfs_ioctl_search_args_v2) + buf_size) / sizeof(uint64_t));
+	    btrfs_ioctl_search_args_v2* args = reinterpret_cast<btrfs_ioctl_search_args_v2*>(buffer.data());
+
+	    btrfs_ioctl_search_key& key = args->key;
+	    key.tree_id = tree_id;
+	    key.min_objectid = min_objectid;
+	    key.max_objectid = max_objectid;
+	    key.min_type = min_type;
+	    key.max_type = max_type;
+	    key.min_offset = 0;
+	    key.max_offset = (uint64_t)(-1);
+	    key.min_transid = 0;
+	    key.max_transid = (uint64_t)(-1);
+
+	    while (true)
+	    {
+		key.nr_items = (uint32_t)(-1);
+		args->buf_size = buf_size;
+
+		if (ioctl(fd, BTRFS_IOC_TREE_SEARCH_V2, args) != 0)
+		{
+		    if (errno == ENOENT)
+			return false;
+
+		    ST_THROW(IOException(sformat("tree search on '%s' failed, %s", mount_point,
+						 strerror(errno))));
+		}
+
+		if (key.nr_items == 0)
+		    return true;
+
+		const char* data = reinterpret_cast<const char*>(args->buf);
+
+		btrfs_ioctl_search_header header;
+
+		for (size_t pos = 0, i = 0; i < key.nr_items; ++i)
+		{
+		    memcpy(&header, data + pos, sizeof(header));
+		    pos += sizeof(header);
+
+		    // The key range is compound so other types can show up.
+		    if (header.type >= min_type && header.type <= max_type)
+			func(header, data + pos);
+
+		    pos += header.len;
+		}
+
+		// Continue after the last key.
+
+		key.min_objectid = header.objectid;
+		key.min_type = header.type;
+		key.min_offset = header.offset + 1;
+
+		if (key.min_offset == 0)
+		{
+		    if (key.min_type == 255)
+		    {
+			if (key.min_objectid == max_objectid)
+			    return true;
+
+			key.min_type = 0;
+			++key.min_objectid;
+		    }
+		    else
+		    {
+			++key.min_type;
+		    }
+		}
+	    }
+	}
+
+
+	BtrfsQgroup::id_t
+	make_qgroup_id(unsigned long long id)
+	{
+	    return BtrfsQgroup::id_t(id >> 48, id & ((1ULL << 48) - 1));
+	}
+
+    }
+
+
+    BtrfsIoctl::BtrfsIoctl(const string& mount_point)
+	: mount_point(mount_point)
+    {
+	fd = open(mount_point.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+	    ST_THROW(IOException(sformat("open of '%s' failed, %s", mount_point, strerror(errno))));
+    }
+
+
+    BtrfsIoctl::~BtrfsIoctl()
+    {
+	if (fd >= 0)
+	    close(fd);
+    }
+
+
+    bool
+    BtrfsIoctl::is_usable()
+    {
+	return Mockup::get_mode() == Mockup::Mode::NONE && !get_remote_callbacks() && native_btrfs();
+    }
+
+
+    // Thread-local since the details of several btrfs are probed in
+    // parallel.
+    static thread_local const BtrfsIoctl::Scope* current_scope = nullptr;
+
+
+    BtrfsIoctl::Scope::Scope(const string& mount_point)
+	: previous(current_scope)
+    {
+	if (is_usable())
+	{
+	    try
+	    {
+		btrfs_ioctl = make_unique<const BtrfsIoctl>(mount_point);
+	    }
+	    catch (const Exception& exception)
+	    {
+		ST_CAUGHT(exception);
+	    }
+	}
+
+	current_scope = this;
+    }
+
+
+    BtrfsIoctl::Scope::~Scope()
+    {
+	current_scope = previous;
+    }
+
+
+    bool
+    BtrfsIoctl::try_read(const string& mount_point, const std::function<void(const BtrfsIoctl&)>& func)
+    {
+	if (!is_usable())
+	    return false;
+
+	try
+	{
+	    if (current_scope && current_scope->btrfs_ioctl &&
+		current_scope->btrfs_ioctl->mount_point == mount_point)
+	    {
+		func(*current_scope->btrfs_ioctl);
+	    }
+	    else
+	    {
+		func(BtrfsIoctl(mount_point));
+	    }
+
+	    return true;
+	}
+	catch (const Exception& exception)
+	{
+	    ST_CAUGHT(exception);
+
+	    return false;
+	}
+    }
+
+
+    bool
+    BtrfsIoctl::is_listed(unsigned long long id, const map<unsigned long long, unsigned long long>& parent_ids)
+    {
+	// The number of steps is limited to be safe against loops.
+
+	for (size_t i = 0; i <= parent_ids.size(); ++i)
+	{
+	    if (id == BTRFS_FS_TREE_OBJECTID)
+		return true;
+
+	    map<unsigned long long, unsigned long long>::const_iterator it = parent_ids.find(id);
+	    if (it == parent_ids.end() || it->second == 0)
+		return false;
+
+	    id = it->second;
+	}
+
+	return false;
+    }
+
+
+    BtrfsRaidLevel
+    BtrfsIoctl::raid_level(unsigned long long flags)
+    {
+	if (flags & BTRFS_BLOCK_GROUP_RAID0)
+	    return BtrfsRaidLevel::RAID0;
+	if (flags & BTRFS_BLOCK_GROUP_RAID1)
+	    return BtrfsRaidLevel::RAID1;
+	if (flags & BTRFS_BLOCK_GROUP_DUP)
+	    return BtrfsRaidLevel::DUP;
+	if (flags & BTRFS_BLOCK_GROUP_RAID10)
+	    return BtrfsRaidLevel::RAID10;
+	if (flags & BTRFS_BLOCK_GROUP_RAID5)
+	    return BtrfsRaidLevel::RAID5;
+	if (flags & BTRFS_BLOCK_GROUP_RAID6)
+	    return BtrfsRaidLevel::RAID6;
+	if (flags & BTRFS_BLOCK_GROUP_RAID1C3)
+	    return BtrfsRaidLevel::RAID1C3;
+	if (flags & BTRFS_BLOCK_GROUP_RAID1C4)
+	    return BtrfsRaidLevel::RAID1C4;
+
+	return BtrfsRaidLevel::SINGLE;
+    }
+
+
+    string
+    BtrfsIoctl::format_uuid(const unsigned char uuid[16])
+    {
+	if (all_of(uuid, uuid + 16, [](unsigned char c) { return c == 0; }))
+	    return "-";
+
+	return storage::format_uuid(uuid);
+    }
+
+
+    void
+    BtrfsIoctl::read(CmdBtrfsSubvolumeList& cmd_btrfs_subvolume_list) const
+    {
+	struct Subvolume
+	{
+	    string uuid = "-";
+	    string parent_uuid = "-";
+	    unsigned long long parent_id = 0;
+	    unsigned long long dir_id = 0;
+	    string name;
+	};
+
+	// Root items and root backrefs of all subvolumes in one search. With
+	// snapper there can be tens of thousands of them.
+
+	map<unsigned long long, Subvolume> subvolumes;
+
+	search(fd, mount_point, BTRFS_ROOT_TREE_OBJECTID, BTRFS_FIRST_FREE_OBJECTID, BTRFS_LAST_FREE_OBJECTID,
+	       BTRFS_ROOT_ITEM_KEY, BTRFS_ROOT_BACKREF_KEY,
+	       [&subvolumes](const btrfs_ioctl_search_header& header, const char* data) {
+
+		   if (header.type == BTRFS_ROOT_ITEM_KEY)
+		   {
+		       Subvolume& subvolume = subvolumes[header.objectid];
+
+		       // Old root items do not have UUIDs.
+
+		       if (header.len >= offsetof(btrfs_root_item, parent_uuid) + BTRFS_UUID_SIZE)
+		       {
+			   subvolume.uuid = format_uuid(reinterpret_cast<const unsigned char*>(
+			       data + offsetof(btrfs_root_item, uuid)));
+			   subvolume.parent_uuid = format_uuid(reinterpret_cast<const unsigned char*>(
+			       data + offsetof(btrfs_root_item, parent_uuid)));
+		       }
+		   }
+		   else if (header.type == BTRFS_ROOT_BACKREF_KEY)
+		   {
+		       Subvolume& subvolume = subvolumes[header.objectid];
+
+		       unsigned int name_len = get_le16(data, offsetof(btrfs_root_ref, name_len));
+
+		       subvolume.parent_id = header.offset;
+		       subvolume.dir_id = get_le64(data, offsetof(btrfs_root_ref, dirid));
+		       subvolume.name = string(data + sizeof(btrfs_root_ref), name_len);
+		   }
+	       });
+
+	// The path of a subvolume is the path of the parent subvolume, the
+	// path of the directory within the parent subvolume and the name.
+
+	map<unsigned long long, string> paths;
+
+	std::function<string(unsigned long long)> get_path = [&](unsigned long long id) -> string {
+
+	    if (id == BTRFS_FS_TREE_OBJECTID)
+		return "";
+
+	    map<unsigned long long, string>::const_iterator it = paths.find(id);
+	    if (it != paths.end())
+		return it->second;
+
+	    map<unsigned long long, Subvolume>::const_iterator it2 = subvolumes.find(id);
+	    if (it2 == subvolumes.end())
+		ST_THROW(Exception(sformat("subvolume %llu on '%s' not found", id, mount_point)));
+
+	    const Subvolume& subvolume = it2->second;
+
+	    btrfs_ioctl_ino_lookup_args args;
+	    memset(&args, 0, sizeof(args));
+	    args.treeid = subvolume.parent_id;
+	    args.objectid = subvolume.dir_id;
+
+	    if (ioctl(fd, BTRFS_IOC_INO_LOOKUP, &args) != 0)
+		ST_THROW(IOException(sformat("ino lookup on '%s' failed, %s", mount_point, strerror(errno))));
+
+	    string parent_path = get_path(subvolume.parent_id);
+	    if (!parent_path.empty())
+		parent_path += "/";
+
+	    string path = parent_path + args.name + subvolume.name;
+
+	    paths[id] = path;
+
+	    return path;
+	};
+
+	map<unsigned long long, unsigned long long> parent_ids;
+
+	for (const map<unsigned long long, Subvolume>::value_type& value : subvolumes)
+	    parent_ids[value.first] = value.second.parent_id;
+
+	vector<CmdBtrfsSubvolumeList::Entry> entries;
+
+	for (const map<unsigned long long, Subvolume>::value_type& value : subvolumes)
+	{
+	    const Subvolume& subvolume = value.second;
+
+	    // Like 'btrfs subvolume list' skip subvolumes already deleted
+	    // (and thus without backref), also if that is the case for any
+	    // ancestor.
+
+	    if (!is_listed(value.first, parent_ids))
+		continue;
+
+	    CmdBtrfsSubvolumeList::Entry entry;
+
+	    entry.id = value.first;
+	    entry.parent_id = subvolume.parent_id;
+	    entry.path = get_path(value.first);
+	    entry.uuid = subvolume.uuid;
+	    entry.parent_uuid = subvolume.parent_uuid == "-" ? "" : subvolume.parent_uuid;
+
+	    entries.push_back(entry);
+	}
+
+	cmd_btrfs_subvolume_list.data = std::move(entries);
+    }
+
+
+    void
+    BtrfsIoctl::read(CmdBtrfsSubvolumeShow& cmd_btrfs_subvolume_show) const
+    {
+	string uuid = "-";
+
+	search(fd, mount_point, BTRFS_ROOT_TREE_OBJECTID, BTRFS_FS_TREE_OBJECTID, BTRFS_FS_TREE_OBJECTID,
+	       BTRFS_ROOT_ITEM_KEY, BTRFS_ROOT_ITEM_KEY,
+	       [&uuid](const btrfs_ioctl_search_header& header, const char* data) {
+
+		   if (header.len >= offsetof(btrfs_root_item, uuid) + BTRFS_UUID_SIZE)
+		       uuid = format_uuid(reinterpret_cast<const unsigned char*>(
+			   data + offsetof(btrfs_root_item, uuid)));
+	       });
+
+	// See CmdBtrfsSubvolumeShow::parse().
+
+	cmd_btrfs_subvolume_show.uuid = uuid == "-" ? "" : uuid;
+    }
+
+
+    void
+    BtrfsIoctl::read(CmdBtrfsSubvolumeGetDefault& cmd_btrfs_subvolume_get_default) const
+    {
+	// The default subvolume is the location of the "default" entry in
+	// the root tree directory. Without that entry it is the top-level
+	// subvolume.
+
+	long id = BTRFS_FS_TREE_OBJECTID;
+
+	search(fd, mount_point, BTRFS_ROOT_TREE_OBJECTID, BTRFS_ROOT_TREE_DIR_OBJECTID,
+	       BTRFS_ROOT_TREE_DIR_OBJECTID, BTRFS_DIR_ITEM_KEY, BTRFS_DIR_ITEM_KEY,
+	       [&id](const btrfs_ioctl_search_header& header, const char* data) {
+
+		   // Several names can have the same hash.
+
+		   for (size_t pos = 0; pos + sizeof(btrfs_dir_item) <= header.len; )
+		   {
+		       const char* dir_item = data + pos;
+
+		       unsigned int name_len = get_le16(dir_item, offsetof(btrfs_dir_item, name_len));
+		       unsigned int data_len = get_le16(dir_item, offsetof(btrfs_dir_item, data_len));
+
+		       if (string(dir_item + sizeof(btrfs_dir_item), name_len) == "default")
+			   id = get_le64(dir_item, offsetof(btrfs_dir_item, location) +
+					 offsetof(btrfs_disk_key, objectid));
+
+		       pos += sizeof(btrfs_dir_item) + name_len + data_len;
+		   }
+	       });
+
+	cmd_btrfs_subvolume_get_default.id = id;
+    }
+
+
+    void
+    BtrfsIoctl::read(CmdBtrfsFilesystemDf& cmd_btrfs_filesystem_df) const
+    {
+	btrfs_ioctl_space_args args;
+	memset(&args, 0, sizeof(args));
+
+	if (ioctl(fd, BTRFS_IOC_SPACE_INFO, &args) != 0)
+	    ST_THROW(IOException(sformat("space info on '%s' failed, %s", mount_point, strerror(errno))));
+
+	const size_t size = sizeof(btrfs_ioctl_space_args) + args.total_spaces * sizeof(btrfs_ioctl_space_info);
+
+	vector<uint64_t> buffer((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+	btrfs_ioctl_space_args* spaces = reinterpret_cast<btrfs_ioctl_space_args*>(buffer.data());
+	spaces->space_slots = args.total_spaces;
+
+	if (ioctl(fd, BTRFS_IOC_SPACE_INFO, spaces) != 0)
+	    ST_THROW(IOException(sformat("space info on '%s' failed, %s", mount_point, strerror(errno))));
+
+	BtrfsRaidLevel metadata_raid_level = BtrfsRaidLevel::UNKNOWN;
+	BtrfsRaidLevel data_raid_level = BtrfsRaidLevel::UNKNOWN;
+
+	// Same order and precedence as 'btrfs filesystem df'.
+
+	for (unsigned int i = 0; i < spaces->total_spaces && i < spaces->space_slots; ++i)
+	{
+	    unsigned long long flags = spaces->spaces[i].flags;
+
+	    if (flags & BTRFS_SPACE_INFO_GLOBAL_RSV)
+		continue;
+
+	    BtrfsRaidLevel btrfs_raid_level = raid_level(flags);
+
+	    if ((flags & BTRFS_BLOCK_GROUP_DATA) && (flags & BTRFS_BLOCK_GROUP_METADATA))
+		metadata_raid_level = data_raid_level = btrfs_raid_level;
+	    else if (flags & BTRFS_BLOCK_GROUP_METADATA)
+		metadata_raid_level = btrfs_raid_level;
+	    else if (flags & BTRFS_BLOCK_GROUP_DATA)
+		data_raid_level = btrfs_raid_level;
+	}
+
+	cmd_btrfs_filesystem_df.metadata_raid_level = metadata_raid_level;
+	cmd_btrfs_filesystem_df.data_raid_level = data_raid_level;
+    }
+
+
+    void
+    BtrfsIoctl::read(CmdBtrfsQgroupShow& cmd_btrfs_qgroup_show) const
+    {
+	map<unsigned long long, CmdBtrfsQgroupShow::Entry> entries;
+
+	bool status = false;
+
+	bool exists = search(fd, mount_point, BTRFS_QUOTA_TREE_OBJECTID, 0, (uint64_t)(-1),
+			     BTRFS_QGROUP_STATUS_KEY, BTRFS_QGROUP_RELATION_KEY,
+			     [&entries, &status](const btrfs_ioctl_search_header& header, const char* data) {
+
+		switch (header.type)
+		{
+		    case BTRFS_QGROUP_STATUS_KEY:
+			status = true;
+			break;
+
+		    case BTRFS_QGROUP_INFO_KEY: {
+			CmdBtrfsQgroupShow::Entry& entry = entries[header.offset];
+			entry.referenced = get_le64(data, offsetof(btrfs_qgroup_info_item, rfer));
+			entry.exclusive = get_le64(data, offsetof(btrfs_qgroup_info_item, excl));
+		    } break;
+
+		    case BTRFS_QGROUP_LIMIT_KEY: {
+			CmdBtrfsQgroupShow::Entry& entry = entries[header.offset];
+			unsigned long long flags = get_le64(data, offsetof(btrfs_qgroup_limit_item, flags));
+			if (flags & BTRFS_QGROUP_LIMIT_MAX_RFER)
+			    entry.referenced_limit = get_le64(data, offsetof(btrfs_qgroup_limit_item, max_rfer));
+			if (flags & BTRFS_QGROUP_LIMIT_MAX_EXCL)
+			    entry.exclusive_limit = get_le64(data, offsetof(btrfs_qgroup_limit_item, max_excl));
+		    } break;
+
+		    case BTRFS_QGROUP_RELATION_KEY: {
+			// Relations are stored in both directions. Only use
+			// the child to parent direction.
+			if (header.objectid < header.offset)
+			    entries[header.objectid].parents_id.push_back(make_qgroup_id(header.offset));
+		    } break;
+		}
+	    });
+
+	// Like 'btrfs qgroup show' quota is disabled if there is no quota
+	// tree or no status item.
+
+	if (!exists || !status)
+	    return;
+
+	cmd_btrfs_qgroup_show.quota = true;
+
+	for (map<unsigned long long, CmdBtrfsQgroupShow::Entry>::value_type& value : entries)
+	{
+	    CmdBtrfsQgroupShow::Entry& entry = value.second;
+	    entry.id = make_qgroup_id(value.first);
+
+	    cmd_btrfs_qgroup_show.data.push_back(entry);
+	}
+    }
+
+
+    void
+    BtrfsIoctl::read(CmdLsattr& cmd_lsattr, const string& path) const
+    {
+	int subvolume_fd = openat(fd, path.empty() ? "." : path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (subvolume_fd < 0)
+	    ST_THROW(IOException(sformat("open of '%s' failed, %s", path, strerror(errno))));
+
+	int flags = 0;
+	int r = ioctl(subvolume_fd, FS_IOC_GETFLAGS, &flags);
+	int errno_saved = errno;
+
+	close(subvolume_fd);
+
+	if (r != 0)
+	    ST_THROW(IOException(sformat("getflags of '%s' failed, %s", path, strerror(errno_saved))));
+
+	cmd_lsattr.nocow = flags & FS_NOCOW_FL;
+    }
+
+}
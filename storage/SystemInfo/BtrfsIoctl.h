@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_BTRFS_IOCTL_H
+#define STORAGE_BTRFS_IOCTL_H
+
+
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include <boost/noncopyable.hpp>
+
+#include "storage/Filesystems/Btrfs.h"
+
+
+namespace storage
+{
+    using std::string;
+    using std::map;
+
+
+    class CmdBtrfsSubvolumeList;
+    class CmdBtrfsSubvolumeShow;
+    class CmdBtrfsSubvolumeGetDefault;
+    class CmdBtrfsFilesystemDf;
+    class CmdBtrfsQgroupShow;
+    class CmdLsattr;
+
+
+    /**
+     * In-process collector for btrfs information using ioctls on a mounted
+     * btrfs. Fills the CmdBtrfs* objects (and CmdLsattr) with the same data
+     * the btrfs (and lsattr) commands report, but without forking a
+     * command per filesystem and query.
+     *
+     * Subvolumes, the default subvolume and qgroups are read with
+     * BTRFS_IOC_TREE_SEARCH_V2, RAID levels with BTRFS_IOC_SPACE_INFO and
+     * the nocow flag with FS_IOC_GETFLAGS.
+     *
+     * The CmdBtrfs* classes use try_read() and only run the command if
+     * that fails. While a Scope exists all queries for its mount point
+     * use the same open mount point.
+     */
+    class BtrfsIoctl : private boost::noncopyable
+    {
+    public:
+
+	/**
+	 * Opens the mount point. Throws an IOException if that fails.
+	 */
+	BtrfsIoctl(const string& mount_point);
+
+	~BtrfsIoctl();
+
+	/**
+	 * The read functions throw an IOException if an ioctl fails.
+	 */
+	void read(CmdBtrfsSubvolumeList& cmd_btrfs_subvolume_list) const;
+	void read(CmdBtrfsSubvolumeShow& cmd_btrfs_subvolume_show) const;
+	void read(CmdBtrfsSubvolumeGetDefault& cmd_btrfs_subvolume_get_default) const;
+	void read(CmdBtrfsFilesystemDf& cmd_btrfs_filesystem_df) const;
+	void read(CmdBtrfsQgroupShow& cmd_btrfs_qgroup_show) const;
+	void read(CmdLsattr& cmd_lsattr, const string& path) const;
+
+	/**
+	 * Check whether the BtrfsIoctl should be tried for probing. Not the
+	 * case when using mockup or remote callbacks since the command
+	 * output is needed there.
+	 */
+	static bool is_usable();
+
+	/**
+	 * Keeps the mount point open while the object exists and makes it
+	 * the current one of the thread for try_read(). Does nothing if
+	 * BtrfsIoctl is not usable or opening fails.
+	 */
+	class Scope : private boost::noncopyable
+	{
+	public:
+
+	    Scope(const string& mount_point);
+	    ~Scope();
+
+	private:
+
+	    std::unique_ptr<const BtrfsIoctl> btrfs_ioctl;
+
+	    const Scope* previous;
+
+	    friend class BtrfsIoctl;
+
+	};
+
+	/**
+	 * Fill the object using ioctls on the mount point if BtrfsIoctl is
+	 * usable. Uses the open mount point of the current Scope if it
+	 * matches. Returns false if the object was not filled, in which
+	 * case the caller runs the command instead. Errors are only
+	 * logged.
+	 */
+	template <typename Type, typename... Args>
+	static bool try_read(Type& object, const string& mount_point, const Args&... args)
+	{
+	    return try_read(mount_point, [&object, &args...](const BtrfsIoctl& btrfs_ioctl) {
+		btrfs_ioctl.read(object, args...);
+	    });
+	}
+
+	/**
+	 * Check whether the subvolume and all its ancestors have a backref,
+	 * i.e. a parent id other than zero in parent_ids. Only these
+	 * subvolumes are listed by 'btrfs subvolume list'.
+	 */
+	static bool is_listed(unsigned long long id, const map<unsigned long long, unsigned long long>& parent_ids);
+
+	/**
+	 * Get the RAID level from the profile bits of the block group flags
+	 * as reported by BTRFS_IOC_SPACE_INFO.
+	 */
+	static BtrfsRaidLevel raid_level(unsigned long long flags);
+
+	/**
+	 * Format a UUID like the btrfs command. Returns "-" for a null UUID.
+	 */
+	static string format_uuid(const unsigned char uuid[16]);
+
+    private:
+
+	static bool try_read(const string& mount_point, const std::function<void(const BtrfsIoctl&)>& func);
+
+	const string mount_point;
+
+	int fd = -1;
+
+    };
+
+}
+
+
+#endif
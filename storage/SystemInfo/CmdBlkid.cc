@@ -26,6 +26,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include "storage/SystemInfo/CmdBlkid.h"
+#include "storage/SystemInfo/BlkidProbe.h"
 #include "storage/Utils/AppUtil.h"
 #include "storage/Utils/SystemCmd.h"
 #include "storage/Utils/StorageDefines.h"
@@ -41,6 +42,20 @@ namespace storage
 
     Blkid::Blkid()
     {
+	if (BlkidProbe::is_usable())
+	{
+	    // The cache of BlkidProbe relies on an up-to-date udev
+	    // database. No extra udev settle is done since the prober
+	    // already did one when querying udevadm info.
+
+	    for (const string& device : BlkidProbe::get_devices())
+		add(device, BlkidProbe::probe(device));
+
+	    y2mil(*this);
+
+	    return;
+	}
+
 	SystemCmd::Options options(BLKID_BIN " -c '" DEV_NULL_FILE "'", SystemCmd::DoThrow);
 
 	// If blkid does not find anything it returns 2 (see bsc #1203285).
@@ -54,6 +69,15 @@ namespace storage
 
     Blkid::Blkid(const string& device)
     {
+	if (BlkidProbe::is_usable())
+	{
+	    add(device, BlkidProbe::probe(device));
+
+	    y2mil(*this);
+
+	    return;
+	}
+
 	SystemCmd::Options options(BLKID_BIN " -c '" DEV_NULL_FILE "' " + quote(device), SystemCmd::DoThrow);
 	options.verify = [](int exit_code) { return exit_code == 0 || exit_code == 2; };
 
@@ -77,98 +101,103 @@ namespace storage
 	    string device = string(line, 0, pos);
 	    list<string> l = split_line(string(line, pos + 1));
 
-	    Entry entry;
+	    add(device, makeMap(l, "=", "\""));
+	}
+
+	y2mil(*this);
+    }
 
-	    const map<string, string> m = makeMap(l, "=", "\"");
 
-	    map<string, string>::const_iterator it1 = m.find("TYPE");
-	    if (it1 != m.end())
+    void
+    Blkid::add(const string& device, const map<string, string>& m)
+    {
+	Entry entry;
+
+	map<string, string>::const_iterator it1 = m.find("TYPE");
+	if (it1 != m.end())
+	{
+	    if (it1->second == "BitLocker" && cryptsetup_for_bitlocker())
 	    {
-		if (it1->second == "BitLocker" && cryptsetup_for_bitlocker())
-		{
-		    entry.is_bitlocker = true;
-		}
-		else if (toValue(it1->second, entry.fs_type, false))
-		{
-		    entry.is_fs = true;
-		}
-		else if (it1->second == "jbd" || it1->second == "xfs_external_log")
-		{
-		    entry.is_journal = true;
-		}
-		else if (boost::ends_with(it1->second, "_raid_member"))
-		{
-		    entry.is_md = true;
-		}
-		else if (it1->second == "LVM2_member")
-		{
-		    entry.is_lvm = true;
-		}
-		else if (it1->second == "crypto_LUKS")
-		{
-		    entry.is_luks = true;
-		}
-		else if (it1->second == "bcache")
-		{
-		    entry.is_bcache = true;
-		}
+		entry.is_bitlocker = true;
 	    }
-
-	    if (entry.is_fs)
+	    else if (toValue(it1->second, entry.fs_type, false))
 	    {
-		it1 = m.find("UUID");
-		if (it1 != m.end())
-		    entry.fs_uuid = it1->second;
-
-		it1 = m.find("LABEL");
-		if (it1 != m.end())
-		    entry.fs_label = it1->second;
-
-		it1 = m.find("EXT_JOURNAL");
-		if (it1 != m.end())
-		    entry.fs_journal_uuid = it1->second;
-
-		it1 = m.find("UUID_SUB");
-		if (it1 != m.end())
-		    entry.fs_sub_uuid = it1->second;
+		entry.is_fs = true;
 	    }
-
-	    if (entry.is_journal)
+	    else if (it1->second == "jbd" || it1->second == "xfs_external_log")
 	    {
-		it1 = m.find("LOGUUID");
-		if (it1 != m.end())
-		    entry.journal_uuid = it1->second;
+		entry.is_journal = true;
 	    }
-
-	    if (entry.is_luks)
+	    else if (boost::ends_with(it1->second, "_raid_member"))
 	    {
-		it1 = m.find("UUID");
-		if (it1 != m.end())
-		    entry.luks_uuid = it1->second;
-
-		it1 = m.find("LABEL");
-		if (it1 != m.end())
-		    entry.luks_label = it1->second;
+		entry.is_md = true;
 	    }
-
-	    if (entry.is_bitlocker)
+	    else if (it1->second == "LVM2_member")
 	    {
-		// Unfortunately no UUID although BitLocker has one.
+		entry.is_lvm = true;
 	    }
-
-	    if (entry.is_bcache)
+	    else if (it1->second == "crypto_LUKS")
+	    {
+		entry.is_luks = true;
+	    }
+	    else if (it1->second == "bcache")
 	    {
-		it1 = m.find("UUID");
-		if (it1 != m.end())
-		    entry.bcache_uuid = it1->second;
+		entry.is_bcache = true;
 	    }
+	}
 
-	    if (entry.is_fs || entry.is_journal || entry.is_md || entry.is_lvm || entry.is_luks ||
-		entry.is_bitlocker || entry.is_bcache)
-		data[device] = entry;
+	if (entry.is_fs)
+	{
+	    it1 = m.find("UUID");
+	    if (it1 != m.end())
+		entry.fs_uuid = it1->second;
+
+	    it1 = m.find("LABEL");
+	    if (it1 != m.end())
+		entry.fs_label = it1->second;
+
+	    it1 = m.find("EXT_JOURNAL");
+	    if (it1 != m.end())
+		entry.fs_journal_uuid = it1->second;
+
+	    it1 = m.find("UUID_SUB");
+	    if (it1 != m.end())
+		entry.fs_sub_uuid = it1->second;
 	}
 
-	y2mil(*this);
+	if (entry.is_journal)
+	{
+	    it1 = m.find("LOGUUID");
+	    if (it1 != m.end())
+		entry.journal_uuid = it1->second;
+	}
+
+	if (entry.is_luks)
+	{
+	    it1 = m.find("UUID");
+	    if (it1 != m.end())
+		entry.luks_uuid = it1->second;
+
+	    it1 = m.find("LABEL");
+	    if (it1 != m.end())
+		entry.luks_label = it1->second;
+	}
+
+	if (entry.is_bitlocker)
+	{
+	    // Unfortunately no UUID although BitLocker has one.
+	}
+
+	if (entry.is_bcache)
+	{
+	    it1 = m.find("UUID");
+	    if (it1 != m.end())
+		entry.bcache_uuid = it1->second;
+	}
+
+	if (entry.is_fs || entry.is_journal || entry.is_md || entry.is_lvm || entry.is_luks ||
+	    entry.is_bitlocker || entry.is_bcache)
+	    data[device] = entry;
     }
 
 
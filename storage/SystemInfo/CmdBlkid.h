@@ -43,7 +43,8 @@ namespace storage
 
 
     /**
-     * Run and parse the "blkid" command.
+     * Run and parse the "blkid" command. If possible the devices are probed
+     * in-process using libblkid instead, see BlkidProbe.
      */
     class Blkid
     {
@@ -115,6 +116,13 @@ namespace storage
 
 	void parse(const vector<string>& lines);
 
+	/**
+	 * Add an entry for the device given the tags as reported by blkid,
+	 * e.g. TYPE, UUID and LABEL. Devices without relevant type are
+	 * ignored.
+	 */
+	void add(const string& device, const map<string, string>& tags);
+
 	map<string, Entry> data;
 
     };
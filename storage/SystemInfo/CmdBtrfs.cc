@@ -31,6 +31,7 @@
 #include "storage/Utils/ExceptionImpl.h"
 #include "storage/Utils/JsonFile.h"
 #include "storage/SystemInfo/CmdBtrfs.h"
+#include "storage/SystemInfo/BtrfsIoctl.h"
 #include "storage/Filesystems/BtrfsImpl.h"
 
 
@@ -160,53 +161,82 @@ namespace storage
 
     CmdBtrfsSubvolumeList::CmdBtrfsSubvolumeList(const key_t& key, const string& mount_point)
     {
+	if (BtrfsIoctl::try_read(*this, mount_point))
+	{
+	    y2mil(*this);
+	    return;
+	}
+
 	const string tmp = BTRFS_BIN " subvolume list -a -puq ";
 	SystemCmd::Options cmd_options(tmp + quote(mount_point), SystemCmd::DoThrow);
 	cmd_options.mockup_key = tmp + "(device:" + key + ")";
+	cmd_options.capture_buffer = true;
 
 	SystemCmd cmd(cmd_options);
-	parse(cmd.stdout());
+	parse(cmd.stdout_lines());
+    }
+
+
+    /**
+     * Return the word following the token in the line. The word is terminated
+     * by whitespace. Like reading a string with operator>>.
+     */
+    static string_view
+    word_after(string_view line, string_view::size_type pos)
+    {
+	string_view::size_type pos1 = line.find_first_not_of(" \t", pos);
+	if (pos1 == string_view::npos)
+	    return string_view();
+
+	string_view::size_type pos2 = line.find_first_of(" \t", pos1);
+	if (pos2 == string_view::npos)
+	    pos2 = line.size();
+
+	return line.substr(pos1, pos2 - pos1);
     }
 
 
     void
-    CmdBtrfsSubvolumeList::parse(const vector<string>& lines)
+    CmdBtrfsSubvolumeList::parse(const LinesView& lines)
     {
-	for (const string& line : lines)
+	for (string_view line : lines)
 	{
 	    Entry entry;
 
-	    string::size_type pos1 = line.find("ID ");
-	    if (pos1 == string::npos)
+	    string_view::size_type pos1 = line.find("ID ");
+	    if (pos1 == string_view::npos)
 		ST_THROW(Exception("could not find 'id' in 'btrfs subvolume list' output"));
-	    line.substr(pos1 + strlen("ID ")) >> entry.id;
+	    if (!parse_integer(line.substr(pos1 + strlen("ID ")), entry.id))
+		ST_THROW(Exception("could not parse 'id' in 'btrfs subvolume list' output"));
 
-	    string::size_type pos2 = line.find(" parent ");
-	    if (pos2 == string::npos)
+	    string_view::size_type pos2 = line.find(" parent ");
+	    if (pos2 == string_view::npos)
 		ST_THROW(Exception("could not find 'parent' in 'btrfs subvolume list' output"));
-	    line.substr(pos2 + strlen(" parent ")) >> entry.parent_id;
+	    if (!parse_integer(line.substr(pos2 + strlen(" parent ")), entry.parent_id))
+		ST_THROW(Exception("could not parse 'parent' in 'btrfs subvolume list' output"));
 
 	    // Subvolume can already be deleted, in which case parent is "0"
 	    // (and path "DELETED"). That is a temporary state.
 	    if (entry.parent_id == 0)
 		continue;
 
-	    string::size_type pos3 = line.find(" path ");
-	    if (pos3 == string::npos)
+	    string_view::size_type pos3 = line.find(" path ");
+	    if (pos3 == string_view::npos)
 		ST_THROW(Exception("could not find 'path' in 'btrfs subvolume list' output"));
-	    entry.path = line.substr(pos3 + strlen(" path "));
-	    if (boost::starts_with(entry.path, "<FS_TREE>/"))
-		entry.path.erase(0, strlen("<FS_TREE>/"));
+	    string_view path = line.substr(pos3 + strlen(" path "));
+	    if (boost::starts_with(path, "<FS_TREE>/"))
+		path.remove_prefix(strlen("<FS_TREE>/"));
+	    entry.path = path;
 
-	    string::size_type pos4 = line.find(" uuid ");
-	    if (pos4 == string::npos)
+	    string_view::size_type pos4 = line.find(" uuid ");
+	    if (pos4 == string_view::npos)
 		ST_THROW(Exception("could not find 'uuid' in 'btrfs subvolume list' output"));
-	    line.substr(pos4 + strlen(" uuid ")) >> entry.uuid;
+	    entry.uuid = word_after(line, pos4 + strlen(" uuid "));
 
-	    string::size_type pos5 = line.find(" parent_uuid ");
-	    if (pos5 == string::npos)
+	    string_view::size_type pos5 = line.find(" parent_uuid ");
+	    if (pos5 == string_view::npos)
 		ST_THROW(Exception("could not find 'parent_uuid' in 'btrfs subvolume list' output"));
-	    line.substr(pos5 + strlen(" parent_uuid ")) >> entry.parent_uuid;
+	    entry.parent_uuid = word_after(line, pos5 + strlen(" parent_uuid "));
 	    if (entry.parent_uuid == "-")
 		entry.parent_uuid = "";
 
@@ -257,6 +287,12 @@ namespace storage
 
     CmdBtrfsSubvolumeShow::CmdBtrfsSubvolumeShow(const key_t& key, const string& mount_point)
     {
+	if (BtrfsIoctl::try_read(*this, mount_point))
+	{
+	    y2mil(*this);
+	    return;
+	}
+
 	const string tmp = BTRFS_BIN " subvolume show ";
 	SystemCmd::Options cmd_options(tmp + quote(mount_point), SystemCmd::DoThrow);
 	cmd_options.mockup_key = tmp + "(device:" + key + ")";
@@ -312,6 +348,12 @@ namespace storage
 
     CmdBtrfsSubvolumeGetDefault::CmdBtrfsSubvolumeGetDefault(const key_t& key, const string& mount_point)
     {
+	if (BtrfsIoctl::try_read(*this, mount_point))
+	{
+	    y2mil(*this);
+	    return;
+	}
+
 	const string tmp = BTRFS_BIN " subvolume get-default ";
 	SystemCmd::Options cmd_options(tmp + quote(mount_point), SystemCmd::DoThrow);
 	cmd_options.mockup_key = tmp + "(device:" + key + ")";
@@ -349,6 +391,12 @@ namespace storage
 
     CmdBtrfsFilesystemDf::CmdBtrfsFilesystemDf(const key_t& key, const string& mount_point)
     {
+	if (BtrfsIoctl::try_read(*this, mount_point))
+	{
+	    y2mil(*this);
+	    return;
+	}
+
 	const bool json = BtrfsVersion::supports_json_option_for_filesystem_df();
 
 	const string tmp = BTRFS_BIN " " + string(json ? "--format json " : "") + "filesystem df ";
@@ -442,6 +490,12 @@ namespace storage
 
     CmdBtrfsQgroupShow::CmdBtrfsQgroupShow(const key_t& key, const string& mount_point)
     {
+	if (BtrfsIoctl::try_read(*this, mount_point))
+	{
+	    y2mil(*this);
+	    return;
+	}
+
 	// There is no btrfs command line way to just query if quota is enabled. So we
 	// assume it is enabled if 'btrfs qgroup show' does not report an error.
 
@@ -612,6 +666,8 @@ namespace storage
     void
     BtrfsVersion::query_version()
     {
+	std::lock_guard<std::mutex> lock(version_mutex);
+
 	if (did_set_version)
 	    return;
 
@@ -663,6 +719,8 @@ namespace storage
     }
 
 
+    std::mutex BtrfsVersion::version_mutex;
+
     bool BtrfsVersion::did_set_version = false;
 
     int BtrfsVersion::major = 0;
@@ -28,10 +28,12 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
 
 #include "storage/Filesystems/BtrfsSubvolumeImpl.h"
 #include "storage/Filesystems/Btrfs.h"
 #include "storage/Filesystems/BtrfsQgroupImpl.h"
+#include "storage/Utils/LinesIterator.h"
 
 
 namespace storage
@@ -145,7 +147,13 @@ namespace storage
 
     private:
 
-	void parse(const vector<string>& lines);
+	friend class BtrfsIoctl;
+
+	/**
+	 * The output can have several ten thousand lines (with snapper) so the
+	 * lines are parsed from the output buffer without copying them.
+	 */
+	void parse(const LinesView& lines);
 
 	vector<Entry> data;
 
@@ -171,6 +179,8 @@ namespace storage
 
     private:
 
+	friend class BtrfsIoctl;
+
 	void parse(const vector<string>& lines);
 
 	string uuid;
@@ -197,6 +207,8 @@ namespace storage
 
     private:
 
+	friend class BtrfsIoctl;
+
 	void parse(const vector<string>& lines);
 
 	long id = BtrfsSubvolume::Impl::unknown_id;
@@ -224,6 +236,8 @@ namespace storage
 
     private:
 
+	friend class BtrfsIoctl;
+
 	void parse(const vector<string>& lines);
 	void parse_json(const vector<string>& lines);
 
@@ -270,6 +284,8 @@ namespace storage
 
     private:
 
+	friend class BtrfsIoctl;
+
 	void parse(const vector<string>& lines);
 	void parse_json(const vector<string>& lines);
 
@@ -292,6 +308,12 @@ namespace storage
 
     private:
 
+	/**
+	 * Protects querying the version since it can happen in several
+	 * threads at the same time.
+	 */
+	static std::mutex version_mutex;
+
 	static bool did_set_version;
 
 	static int major;
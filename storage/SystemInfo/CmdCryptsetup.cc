@@ -27,7 +27,10 @@
 #include "storage/Utils/AppUtil.h"
 #include "storage/Utils/StorageDefines.h"
 #include "storage/Utils/StorageTmpl.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
 #include "storage/SystemInfo/CmdCryptsetup.h"
+#include "storage/SystemInfo/CryptHeader.h"
 #include "storage/Devices/EncryptionImpl.h"
 
 
@@ -99,6 +102,27 @@ namespace storage
     CmdCryptsetupLuksDump::CmdCryptsetupLuksDump(const string& name)
 	: name(name)
     {
+	if (CryptHeader::is_usable())
+	{
+	    try
+	    {
+		CryptHeader(name).read(*this);
+		y2mil(*this);
+		return;
+	    }
+	    catch (const Exception& exception)
+	    {
+		ST_CAUGHT(exception);
+
+		uuid.clear();
+		encryption_type = EncryptionType::UNKNOWN;
+		cipher.clear();
+		key_size = 0;
+		pbkdf.clear();
+		integrity.clear();
+	    }
+	}
+
 	SystemCmd cmd(CRYPTSETUP_BIN " luksDump " + quote(name), SystemCmd::DoThrow);
 
 	parse(cmd.stdout());
@@ -292,6 +316,24 @@ namespace storage
     CmdCryptsetupBitlkDump::CmdCryptsetupBitlkDump(const string& name)
 	: name(name)
     {
+	if (CryptHeader::is_usable())
+	{
+	    try
+	    {
+		CryptHeader(name).read(*this);
+		y2mil(*this);
+		return;
+	    }
+	    catch (const Exception& exception)
+	    {
+		ST_CAUGHT(exception);
+
+		uuid.clear();
+		cipher.clear();
+		key_size = 0;
+	    }
+	}
+
 	SystemCmd cmd(CRYPTSETUP_BIN " bitlkDump " + quote(name), SystemCmd::DoThrow);
 
 	parse(cmd.stdout());
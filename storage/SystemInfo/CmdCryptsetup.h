@@ -78,6 +78,8 @@ namespace storage
 
     private:
 
+	friend class CryptHeader;
+
 	void parse(const vector<string>& lines);
 
 	void parse_version1(const vector<string>& lines);
@@ -132,6 +134,8 @@ namespace storage
 
     private:
 
+	friend class CryptHeader;
+
 	void parse(const vector<string>& lines);
 
 	string name;
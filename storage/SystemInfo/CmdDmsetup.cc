@@ -22,11 +22,13 @@
 
 
 #include <sys/sysmacros.h>
-#include <regex>
+#include <charconv>
 
 #include "storage/Utils/SystemCmd.h"
 #include "storage/SystemInfo/CmdDmsetup.h"
+#include "storage/SystemInfo/DmIoctl.h"
 #include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
 #include "storage/Utils/StorageDefines.h"
 #include "storage/Utils/StorageTmpl.h"
 
@@ -38,6 +40,21 @@ namespace storage
 
     CmdDmsetupInfo::CmdDmsetupInfo()
     {
+	if (DmIoctl::is_usable())
+	{
+	    try
+	    {
+		DmIoctl().read(*this);
+		y2mil(*this);
+		return;
+	    }
+	    catch (const Exception& exception)
+	    {
+		ST_CAUGHT(exception);
+		data.clear();
+	    }
+	}
+
 	SystemCmd cmd(DMSETUP_BIN " --columns --separator '/' --noheadings -o name,major,minor,"
 		      "segments,subsystem,uuid info", SystemCmd::DoThrow);
 
@@ -105,65 +122,123 @@ namespace storage
 
     CmdDmsetupTable::CmdDmsetupTable()
     {
-	SystemCmd c(DMSETUP_BIN " table", SystemCmd::DoThrow);
+	if (DmIoctl::is_usable())
+	{
+	    try
+	    {
+		DmIoctl().read(*this);
+		y2mil(*this);
+		return;
+	    }
+	    catch (const Exception& exception)
+	    {
+		ST_CAUGHT(exception);
+		data.clear();
+	    }
+	}
+
+	SystemCmd::Options cmd_options(DMSETUP_BIN " table", SystemCmd::DoThrow);
+	cmd_options.capture_buffer = true;
+
+	SystemCmd cmd(cmd_options);
 
-	parse(c.stdout());
+	parse(cmd.stdout_lines());
     }
 
 
-    void
-    CmdDmsetupTable::parse(const vector<string>& lines)
+    /**
+     * Parse a device specification of the form major:minor.
+     */
+    static bool
+    parse_devspec(string_view param, dev_t& majorminor)
     {
-	static const regex devspec("([0-9]+):([0-9]+)", regex::extended);
+	string_view::size_type pos = param.find(':');
+	if (pos == string_view::npos || pos == 0 || pos == param.size() - 1)
+	    return false;
 
-	if (lines.size() == 1 && lines[0] == "No devices found")
-	    return;
+	unsigned int major, minor;
+
+	const char* end1 = param.data() + pos;
+	from_chars_result r1 = from_chars(param.data(), end1, major);
+	if (r1.ec != errc() || r1.ptr != end1)
+	    return false;
+
+	const char* end2 = param.data() + param.size();
+	from_chars_result r2 = from_chars(end1 + 1, end2, minor);
+	if (r2.ec != errc() || r2.ptr != end2)
+	    return false;
+
+	majorminor = makedev(major, minor);
+
+	return true;
+    }
 
-	for (const string& line : lines)
-	{
-	    string::size_type pos = line.find(": ");
-	    if (pos == string::npos)
-		ST_THROW(Exception("failed to parse dmsetup table output"));
 
-	    string name = line.substr(0, pos);
+    void
+    CmdDmsetupTable::parse(const LinesView& lines)
+    {
+	LinesView::const_iterator first = lines.begin();
+	if (first != lines.end() && *first == "No devices found" && next(first) == lines.end())
+	    return;
 
-	    list<string> tmp = splitString(line.substr(pos + 1));
-	    vector<string> params = vector<string>(tmp.begin(), tmp.end());
+	vector<string_view> params;
 
-	    if (params.size() < 3)
+	for (string_view line : lines)
+	{
+	    string_view::size_type pos = line.find(": ");
+	    if (pos == string_view::npos)
 		ST_THROW(Exception("failed to parse dmsetup table output"));
 
-	    Table table(params[2]);
+	    string name(line.substr(0, pos));
 
-	    if (table.target == "striped")
-	    {
-		params[3] >> table.stripes;
-		params[4] >> table.stripe_size;
-		table.stripe_size *= 512;
-	    }
+	    params.clear();
 
-	    for (const string& param : params)
+	    string_view::size_type pos1 = line.find_first_not_of(" \t", pos + 1);
+	    while (pos1 != string_view::npos)
 	    {
-		smatch match;
+		string_view::size_type pos2 = line.find_first_of(" \t", pos1);
+		if (pos2 == string_view::npos)
+		    pos2 = line.size();
 
-		if (regex_match(param, match, devspec) && match.size() == 3)
-		{
-		    unsigned int major, minor;
-		    match[1] >> major;
-		    match[2] >> minor;
-		    dev_t majorminor = makedev(major, minor);
+		params.push_back(line.substr(pos1, pos2 - pos1));
 
-		    table.majorminors.push_back(majorminor);
-		}
+		pos1 = line.find_first_not_of(" \t", pos2);
 	    }
 
-	    data[name].push_back(table);
+	    add(name, params);
 	}
 
 	y2mil(*this);
     }
 
 
+    void
+    CmdDmsetupTable::add(const string& name, const vector<string_view>& params)
+    {
+	if (params.size() < 3)
+	    ST_THROW(Exception("failed to parse dmsetup table output"));
+
+	Table table{string(params[2])};
+
+	if (table.target == "striped" && params.size() >= 5)
+	{
+	    if (!parse_integer(params[3], table.stripes) || !parse_integer(params[4], table.stripe_size))
+		ST_THROW(Exception("failed to parse dmsetup table output"));
+	    table.stripe_size *= 512;
+	}
+
+	for (string_view param : params)
+	{
+	    dev_t majorminor;
+
+	    if (parse_devspec(param, majorminor))
+		table.majorminors.push_back(majorminor);
+	}
+
+	data[name].push_back(table);
+    }
+
+
     vector<CmdDmsetupTable::Table>
     CmdDmsetupTable::get_tables(const string& name) const
     {
@@ -26,13 +26,17 @@
 
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 
+#include "storage/Utils/LinesIterator.h"
+
 
 namespace storage
 {
     using std::string;
+    using std::string_view;
     using std::vector;
     using std::map;
 
@@ -65,6 +69,8 @@ namespace storage
 
     private:
 
+	friend class DmIoctl;
+
 	void parse(const vector<string>& lines);
 
 	map<string, Entry> data;
@@ -113,7 +119,19 @@ namespace storage
 
     private:
 
-	void parse(const vector<string>& lines);
+	friend class DmIoctl;
+
+	/**
+	 * The output can be large (on hosts with thousands of dm devices) so the
+	 * lines are parsed from the output buffer without copying them.
+	 */
+	void parse(const LinesView& lines);
+
+	/**
+	 * Add a table of the device. The params are the fields of a line
+	 * after the name, starting with the start sector.
+	 */
+	void add(const string& name, const vector<string_view>& params);
 
 	map<string, vector<Table>> data;
 
@@ -27,6 +27,7 @@
 #include "storage/Utils/StorageDefines.h"
 #include "storage/Utils/StorageTmpl.h"
 #include "storage/SystemInfo/CmdLsattr.h"
+#include "storage/SystemInfo/BtrfsIoctl.h"
 #include "storage/Utils/Enum.h"
 #include "storage/Utils/Exception.h"
 
@@ -39,6 +40,12 @@ namespace storage
     CmdLsattr::CmdLsattr(const key_t& key, const string& mount_point, const string& path)
 	: mount_point(mount_point), path(path)
     {
+	if (BtrfsIoctl::try_read(*this, mount_point, path))
+	{
+	    y2mil(*this);
+	    return;
+	}
+
 	SystemCmd::Options cmd_options(LSATTR_BIN " -d " + quote(mount_point + "/" + path),
 				       SystemCmd::DoThrow);
 	cmd_options.mockup_key = LSATTR_BIN " -d (device:" + get<0>(key) + " path:" + get<1>(key) + ")";
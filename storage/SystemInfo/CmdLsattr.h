@@ -51,6 +51,8 @@ namespace storage
 
     private:
 
+	friend class BtrfsIoctl;
+
 	string mount_point;
 	string path;
 
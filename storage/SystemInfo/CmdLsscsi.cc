@@ -133,6 +133,8 @@ namespace storage
     void
     LsscsiVersion::query_version()
     {
+	std::lock_guard<std::mutex> lock(version_mutex);
+
 	if (did_set_version)
 	    return;
 
@@ -172,6 +174,8 @@ namespace storage
     }
 
 
+    std::mutex LsscsiVersion::version_mutex;
+
     bool LsscsiVersion::did_set_version = false;
 
     int LsscsiVersion::major = 0;
@@ -28,6 +28,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <mutex>
 
 #include "storage/Devices/Disk.h"
 
@@ -77,6 +78,12 @@ namespace storage
 
     private:
 
+	/**
+	 * Protects querying the version since it can happen in several
+	 * threads at the same time.
+	 */
+	static std::mutex version_mutex;
+
 	static bool did_set_version;
 
 	static int major;
@@ -26,6 +26,7 @@
 #include "storage/SystemInfo/CmdLvm.h"
 #include "storage/Devices/LvmLvImpl.h"
 #include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/Mockup.h"
 #include "storage/Utils/LoggerImpl.h"
 #include "storage/Utils/StorageDefines.h"
 #include "storage/Utils/StorageTmpl.h"
@@ -36,6 +37,15 @@
 
 #define COMMON_LVM_OPTIONS "--reportformat json " CONFIG_OVERRIDE " --units b --nosuffix"
 
+#define PVS_OPTIONS "pv_name,pv_uuid,vg_name,vg_uuid,pv_attr,pe_start"
+
+#define VGS_OPTIONS "vg_name,vg_uuid,vg_attr,vg_extent_size,vg_extent_count,vg_free_count"
+
+#define LVS_OPTIONS "lv_name,lv_uuid,vg_name,vg_uuid,lv_role,lv_attr,lv_size,origin_size,pool_lv," \
+    "pool_lv_uuid,origin,origin_uuid,data_lv,data_lv_uuid,metadata_lv,metadata_lv_uuid"
+
+#define SEGS_OPTIONS "segtype,stripes,stripe_size,chunk_size"
+
 
 namespace storage
 {
@@ -43,12 +53,19 @@ namespace storage
 
 
     void
-    CmdLvm::parse(const vector<string>& lines, const char* tag)
+    CmdLvm::parse(const LinesView& lines, const char* tag)
     {
 	JsonFile json_file(lines);
 
+	parse(json_file.get_root(), tag);
+    }
+
+
+    void
+    CmdLvm::parse(json_object* root, const char* tag)
+    {
 	vector<json_object*> tmp1;
-	if (get_child_nodes(json_file.get_root(), "report", tmp1))
+	if (get_child_nodes(root, "report", tmp1))
 	{
 	    for (json_object* tmp2 : tmp1)
 	    {
@@ -65,15 +82,28 @@ namespace storage
 
     CmdPvs::CmdPvs()
     {
-	SystemCmd cmd(PVS_BIN " " COMMON_LVM_OPTIONS " --all --options pv_name,pv_uuid,"
-		      "vg_name,vg_uuid,pv_attr,pe_start", SystemCmd::DoThrow);
+	SystemCmd::Options cmd_options(PVS_BIN " " COMMON_LVM_OPTIONS " --all --options " PVS_OPTIONS,
+				       SystemCmd::DoThrow);
+	cmd_options.capture_buffer = true;
 
-	parse(cmd.stdout());
+	SystemCmd cmd(cmd_options);
+
+	parse(cmd.stdout_lines());
+    }
+
+
+    CmdPvs::CmdPvs(JsonFile& fullreport)
+    {
+	CmdLvm::parse(fullreport.get_root(), "pv");
+
+	sort(pvs.begin(), pvs.end(), [](const Pv& lhs, const Pv& rhs) { return lhs.pv_name < rhs.pv_name; });
+
+	y2mil(*this);
     }
 
 
     void
-    CmdPvs::parse(const vector<string>& lines)
+    CmdPvs::parse(const LinesView& lines)
     {
 	pvs.clear();
 
@@ -157,17 +187,33 @@ namespace storage
 	// Note: Querying segtype, origin, origin_uuid and origin_size is rather new and
 	// not available in all testsuite data.
 
-	SystemCmd cmd(LVS_BIN " " COMMON_LVM_OPTIONS " --all --options lv_name,lv_uuid,vg_name,"
-		      "vg_uuid,lv_role,lv_attr,lv_size,origin_size,segtype,stripes,stripe_size,"
-		      "chunk_size,pool_lv,pool_lv_uuid,origin,origin_uuid,data_lv,data_lv_uuid,"
-		      "metadata_lv,metadata_lv_uuid", SystemCmd::DoThrow);
+	SystemCmd::Options cmd_options(LVS_BIN " " COMMON_LVM_OPTIONS " --all --options " LVS_OPTIONS ","
+				       SEGS_OPTIONS, SystemCmd::DoThrow);
+	cmd_options.capture_buffer = true;
 
-	parse(cmd.stdout());
+	SystemCmd cmd(cmd_options);
+
+	parse(cmd.stdout_lines());
+    }
+
+
+    CmdLvs::CmdLvs(JsonFile& fullreport)
+    {
+	vector<json_object*> reports;
+	if (get_child_nodes(fullreport.get_root(), "report", reports))
+	{
+	    for (json_object* report : reports)
+		parse_fullreport(report);
+	}
+
+	sort(lvs.begin(), lvs.end(), [](const Lv& lhs, const Lv& rhs) { return lhs.lv_name < rhs.lv_name; });
+
+	y2mil(*this);
     }
 
 
     void
-    CmdLvs::parse(const vector<string>& lines)
+    CmdLvs::parse(const LinesView& lines)
     {
 	lvs.clear();
 
@@ -181,9 +227,81 @@ namespace storage
 
     void
     CmdLvs::parse(json_object* object)
+    {
+	string segtype;
+	get_child_value(object, "segtype", segtype);
+
+	Lv lv = parse_lv(object, segtype);
+	Segment segment = parse_segment(object);
+
+	// The stripes and chunksize options makes lvs print every segment of
+	// a LV. Depending on whether the LV is already in lvs, either add the
+	// complete LV or only the segment to the already existing LV.
+
+	vector<Lv>::iterator it = find_if(lvs.begin(), lvs.end(), [lv](const Lv& tmp) {
+	    return lv.lv_uuid == tmp.lv_uuid;
+	});
+
+	if (it == lvs.end())
+	{
+	    lv.segments.push_back(segment);
+	    lvs.push_back(lv);
+	}
+	else
+	{
+	    it->segments.push_back(segment);
+	}
+    }
+
+
+    void
+    CmdLvs::parse_fullreport(json_object* report)
+    {
+	// In the fullreport the segments are reported separately from the
+	// LVs. The segment type is needed to get the LV type.
+
+	map<string, vector<json_object*>> segs_by_lv_uuid;
+
+	vector<json_object*> segs;
+	if (get_child_nodes(report, "seg", segs))
+	{
+	    for (json_object* seg : segs)
+	    {
+		string lv_uuid;
+		get_child_value(seg, "lv_uuid", lv_uuid);
+		segs_by_lv_uuid[lv_uuid].push_back(seg);
+	    }
+	}
+
+	vector<json_object*> objects;
+	if (get_child_nodes(report, "lv", objects))
+	{
+	    for (json_object* object : objects)
+	    {
+		string lv_uuid;
+		get_child_value(object, "lv_uuid", lv_uuid);
+
+		const vector<json_object*>& lv_segs = segs_by_lv_uuid[lv_uuid];
+
+		string segtype;
+		if (!lv_segs.empty())
+		    get_child_value(lv_segs.front(), "segtype", segtype);
+
+		Lv lv = parse_lv(object, segtype);
+
+		for (json_object* seg : lv_segs)
+		    lv.segments.push_back(parse_segment(seg));
+
+		lvs.push_back(lv);
+	    }
+	}
+    }
+
+
+    CmdLvs::Lv
+    CmdLvs::parse_lv(json_object* object, const string& segtype) const
     {
 	Lv lv;
-	Segment segment;
 
 	get_child_value(object, "lv_name", lv.lv_name);
 	get_child_value(object, "lv_uuid", lv.lv_uuid);
@@ -217,8 +335,6 @@ namespace storage
 	    case 'o':
 	    case 'C':
 	    {
-		string segtype;
-		get_child_value(object, "segtype", segtype);
 		if (segtype.empty())
 		    ST_THROW(ParseException("bad segtype", segtype, "linear"));
 
@@ -250,28 +366,21 @@ namespace storage
 	get_child_value(object, "metadata_lv", lv.metadata_name);
 	get_child_value(object, "metadata_lv_uuid", lv.metadata_uuid);
 
+	return lv;
+    }
+
+
+    CmdLvs::Segment
+    CmdLvs::parse_segment(json_object* object) const
+    {
+	Segment segment;
+
 	get_child_value(object, "stripes", segment.stripes);
 	get_child_value(object, "stripe_size", segment.stripe_size);
 
 	get_child_value(object, "chunk_size", segment.chunk_size);
 
-	// The stripes and chunksize options makes lvs print every segment of
-	// a LV. Depending on whether the LV is already in lvs, either add the
-	// complete LV or only the segment to the already existing LV.
-
-	vector<Lv>::iterator it = find_if(lvs.begin(), lvs.end(), [lv](const Lv& tmp) {
-	    return lv.lv_uuid == tmp.lv_uuid;
-	});
-
-	if (it == lvs.end())
-	{
-	    lv.segments.push_back(segment);
-	    lvs.push_back(lv);
-	}
-	else
-	{
-	    it->segments.push_back(segment);
-	}
+	return segment;
     }
 
 
@@ -374,15 +483,28 @@ namespace storage
 
     CmdVgs::CmdVgs()
     {
-	SystemCmd cmd(VGS_BIN " " COMMON_LVM_OPTIONS " --options vg_name,vg_uuid,vg_attr,"
-		      "vg_extent_size,vg_extent_count,vg_free_count", SystemCmd::DoThrow);
+	SystemCmd::Options cmd_options(VGS_BIN " " COMMON_LVM_OPTIONS " --options " VGS_OPTIONS,
+				       SystemCmd::DoThrow);
+	cmd_options.capture_buffer = true;
+
+	SystemCmd cmd(cmd_options);
 
-	parse(cmd.stdout());
+	parse(cmd.stdout_lines());
+    }
+
+
+    CmdVgs::CmdVgs(JsonFile& fullreport)
+    {
+	CmdLvm::parse(fullreport.get_root(), "vg");
+
+	sort(vgs.begin(), vgs.end(), [](const Vg& lhs, const Vg& rhs) { return lhs.vg_name < rhs.vg_name; });
+
+	y2mil(*this);
     }
 
 
     void
-    CmdVgs::parse(const vector<string>& lines)
+    CmdVgs::parse(const LinesView& lines)
     {
 	vgs.clear();
 
@@ -402,6 +524,10 @@ namespace storage
 	get_child_value(object, "vg_name", vg.vg_name);
 	get_child_value(object, "vg_uuid", vg.vg_uuid);
 
+	// The fullreport includes the orphan PVs in a report without VG.
+	if (vg.vg_uuid.empty())
+	    return;
+
 	string vg_attr;
 	get_child_value(object, "vg_attr", vg_attr);
 	if (vg_attr.size() < 6)
@@ -448,4 +574,74 @@ namespace storage
 	return s;
     }
 
+
+
+    CmdLvmFullreport::CmdLvmFullreport()
+    {
+	// Each subreport has its own options. The pvseg subreport is not
+	// needed but cannot be omitted.
+
+	SystemCmd::Options cmd_options(LVM_BIN " fullreport " COMMON_LVM_OPTIONS " --all "
+				       "--configreport pv --options " PVS_OPTIONS " "
+				       "--configreport vg --options " VGS_OPTIONS " "
+				       "--configreport lv --options " LVS_OPTIONS " "
+				       "--configreport seg --options lv_uuid," SEGS_OPTIONS " "
+				       "--configreport pvseg --options pv_uuid", SystemCmd::NoThrow);
+	cmd_options.capture_buffer = true;
+
+	// Mockups without fullreport were recorded with pvs, vgs and lvs.
+	if (Mockup::get_mode() == Mockup::Mode::PLAYBACK && !Mockup::has_command(cmd_options.command))
+	{
+	    y2deb("lvm fullreport not in mockup, using pvs, vgs and lvs");
+	    return;
+	}
+
+	// A timeout or cancellation throws from SystemCmd even with NoThrow
+	// and is passed on.
+
+	SystemCmd cmd(cmd_options);
+
+	if (cmd.retcode() != 0)
+	{
+	    if (!is_unsupported(cmd))
+		ST_THROW(SystemCmdException(&cmd, "lvm fullreport failed"));
+
+	    y2deb("lvm fullreport not supported, using pvs, vgs and lvs");
+	    return;
+	}
+
+	parse(cmd.stdout_lines());
+    }
+
+
+    bool
+    CmdLvmFullreport::is_unsupported(const SystemCmd& cmd)
+    {
+	// The shell exits with 127 if lvm is not found. LVM exits with
+	// ENO_SUCH_CMD (2) for an unknown command and with EINVALID_CMD_LINE
+	// (3) for unknown options, e.g. --configreport.
+
+	if (cmd.retcode() == 127 || cmd.retcode() == 2 || cmd.retcode() == 3)
+	    return true;
+
+	for (const string& line : cmd.stderr())
+	{
+	    if (boost::contains(line, "No such command") || boost::contains(line, "Unknown command"))
+		return true;
+	}
+
+	return false;
+    }
+
+
+    void
+    CmdLvmFullreport::parse(const LinesView& lines)
+    {
+	JsonFile json_file(lines);
+
+	cmd_pvs.reset(new CmdPvs(json_file));
+	cmd_vgs.reset(new CmdVgs(json_file));
+	cmd_lvs.reset(new CmdLvs(json_file));
+    }
+
 }
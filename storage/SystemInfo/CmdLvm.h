@@ -27,9 +27,11 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include "storage/Devices/LvmLv.h"
 #include "storage/Utils/JsonFile.h"
+#include "storage/Utils/LinesIterator.h"
 
 
 namespace storage
@@ -38,13 +40,17 @@ namespace storage
     using std::vector;
 
 
+    class SystemCmd;
+
+
     class CmdLvm
     {
     protected:
 
 	virtual ~CmdLvm() = default;
 
-	void parse(const vector<string>& lines, const char* tag);
+	void parse(const LinesView& lines, const char* tag);
+	void parse(json_object* root, const char* tag);
 	virtual void parse(json_object* object) = 0;
 
     };
@@ -77,7 +83,11 @@ namespace storage
 
     private:
 
-	void parse(const vector<string>& lines);
+	friend class CmdLvmFullreport;
+
+	explicit CmdPvs(JsonFile& fullreport);
+
+	void parse(const LinesView& lines);
 	virtual void parse(json_object* object) override;
 
 	vector<Pv> pvs;
@@ -139,8 +149,16 @@ namespace storage
 
     private:
 
-	void parse(const vector<string>& lines);
+	friend class CmdLvmFullreport;
+
+	explicit CmdLvs(JsonFile& fullreport);
+
+	void parse(const LinesView& lines);
 	virtual void parse(json_object* object) override;
+	void parse_fullreport(json_object* report);
+
+	Lv parse_lv(json_object* object, const string& segtype) const;
+	Segment parse_segment(json_object* object) const;
 	Role parse_role(const string& role) const;
 
 	vector<Lv> lvs;
@@ -172,13 +190,51 @@ namespace storage
 
     private:
 
-	void parse(const vector<string>& lines);
+	friend class CmdLvmFullreport;
+
+	explicit CmdVgs(JsonFile& fullreport);
+
+	void parse(const LinesView& lines);
 	virtual void parse(json_object* object) override;
 
 	vector<Vg> vgs;
 
     };
 
+
+    /**
+     * Runs "lvm fullreport" once and provides the data of CmdPvs, CmdVgs and
+     * CmdLvs. Each of the separate commands scans all devices and takes the
+     * LVM locks.
+     *
+     * If LVM does not know fullreport or its options, e.g. since it is too
+     * old, is_available() returns false and the separate commands have to be
+     * used. Other failures throw.
+     */
+    class CmdLvmFullreport
+    {
+    public:
+
+	CmdLvmFullreport();
+
+	bool is_available() const { return cmd_pvs && cmd_vgs && cmd_lvs; }
+
+	const CmdPvs& get_cmd_pvs() const { return *cmd_pvs; }
+	const CmdVgs& get_cmd_vgs() const { return *cmd_vgs; }
+	const CmdLvs& get_cmd_lvs() const { return *cmd_lvs; }
+
+    private:
+
+	void parse(const LinesView& lines);
+
+	static bool is_unsupported(const SystemCmd& cmd);
+
+	std::unique_ptr<CmdPvs> cmd_pvs;
+	std::unique_ptr<CmdVgs> cmd_vgs;
+	std::unique_ptr<CmdLvs> cmd_lvs;
+
+    };
+
 }
 
 #endif
@@ -35,6 +35,7 @@
 #include "storage/Devices/PartitionTable.h"
 #include "storage/Utils/Format.h"
 #include "storage/EnvironmentImpl.h"
+#include "storage/SystemInfo/PartitionTableReader.h"
 
 
 namespace storage
@@ -45,11 +46,34 @@ namespace storage
     Parted::Parted(const string& device)
 	: device(device)
     {
+	// Avoid forking parted, which also rereads the partition table and
+	// might trigger udev.
+
+	if (PartitionTableReader::is_usable())
+	{
+	    try
+	    {
+		PartitionTableReader partition_table_reader(device);
+		if (partition_table_reader.read(*this))
+		{
+		    y2mil(*this);
+		    return;
+		}
+
+		y2mil("partition table of " << device << " not handled natively, using parted");
+	    }
+	    catch (const Exception& exception)
+	    {
+		ST_CAUGHT(exception);
+	    }
+	}
+
 	const bool json = PartedVersion::supports_json_option();
 
 	SystemCmd::Options options(PARTED_BIN " --script " + string(json ? "--json " : "--machine ") + quote(device) +
 				   " unit s print", SystemCmd::DoThrow);
 	options.verify = [](int) { return true; };
+	options.capture_buffer = true;
 	if (!json)
 	    options.env.push_back("PARTED_PRINT_NUMBER_OF_PARTITION_SLOTS=1");
 
@@ -80,7 +104,7 @@ namespace storage
 	    }
 	}
 
-	parse(cmd.stdout(), cmd.stderr());
+	parse(cmd.stdout_lines(), cmd.stderr());
 
 	if (PartedVersion::print_triggers_udev())
 	    SystemCmd(UDEVADM_BIN_SETTLE);
@@ -88,7 +112,7 @@ namespace storage
 
 
     void
-    Parted::parse(const vector<string>& stdout, const vector<string>& stderr)
+    Parted::parse(const LinesView& stdout, const vector<string>& stderr)
     {
 	primary_slots = -1;
 	implicit = false;
@@ -119,18 +143,19 @@ namespace storage
 	}
 	else
 	{
-	    if (stdout.size() < 2)
+	    LinesView::const_iterator it = stdout.begin();
+	    if (it == stdout.end() || std::next(it) == stdout.end())
 		ST_THROW(Exception("wrong number of lines"));
 
-	    if (stdout[0] != "BYT;")
-		ST_THROW(ParseException("Bad first line", stdout[0], "BYT;"));
+	    if (*it != "BYT;")
+		ST_THROW(ParseException("Bad first line", string(*it), "BYT;"));
 
-	    scan_device_line(stdout[1]);
+	    scan_device_line(string(*++it));
 
 	    if (label != PtType::UNKNOWN && label != PtType::LOOP)
 	    {
-		for (size_t i = 2; i < stdout.size(); ++i)
-		    scan_entry_line(stdout[i]);
+		for (++it; it != stdout.end(); ++it)
+		    scan_entry_line(string(*it));
 	    }
 	}
 
@@ -666,6 +691,8 @@ namespace storage
     void
     PartedVersion::query_version()
     {
+	std::lock_guard<std::mutex> lock(version_mutex);
+
 	if (did_set_version)
 	    return;
 
@@ -756,6 +783,8 @@ namespace storage
     }
 
 
+    std::mutex PartedVersion::version_mutex;
+
     bool PartedVersion::did_set_version = false;
 
     int PartedVersion::major = 0;
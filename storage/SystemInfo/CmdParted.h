@@ -25,8 +25,11 @@
 #define STORAGE_CMD_PARTED_H
 
 
+#include <mutex>
+
 #include "storage/Utils/Region.h"
 #include "storage/Utils/JsonFile.h"
+#include "storage/Utils/LinesIterator.h"
 #include "storage/Devices/PartitionTable.h"
 
 
@@ -46,8 +49,9 @@ namespace storage
     public:
 
 	/**
-	 * Constructor: Probe the specified device
-	 * with the 'parted' command and parse its output.
+	 * Constructor: Probe the specified device. GPT and MS-DOS partition
+	 * tables are read by the PartitionTableReader if possible. Otherwise
+	 * the 'parted' command is used and its output is parsed.
 	 * This may throw a SystemCmdException or a ParseException.
 	 */
 	Parted(const string& device);
@@ -146,6 +150,8 @@ namespace storage
 
     private:
 
+	friend class PartitionTableReader;
+
 	typedef vector<Entry>::const_iterator const_iterator;
 
 	const string device;
@@ -167,7 +173,7 @@ namespace storage
 	 * Parse the output of the 'parted' command in 'lines'.
 	 * This may throw a ParseException.
 	 */
-	void parse(const vector<string>& stdout, const vector<string>& stderr);
+	void parse(const LinesView& stdout, const vector<string>& stderr);
 
 	/**
 	 * parted reports wrong sector sizes on DASDs, see
@@ -230,6 +236,12 @@ namespace storage
 
     private:
 
+	/**
+	 * Protects querying the version since it can happen in several
+	 * threads at the same time.
+	 */
+	static std::mutex version_mutex;
+
 	static bool did_set_version;
 
 	static int major;
@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <endian.h>
+#include <algorithm>
+
+#include "storage/SystemInfo/CryptHeader.h"
+#include "storage/SystemInfo/CmdCryptsetup.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/Format.h"
+#include "storage/Utils/JsonFile.h"
+#include "storage/Utils/Uuid.h"
+#include "storage/EnvironmentImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	const char luks_magic[] = { 'L', 'U', 'K', 'S', '\xba', '\xbe' };
+
+
+	template <typename Type>
+	Type
+	get(const string& data, size_t offset)
+	{
+	    if (offset + sizeof(Type) > data.size())
+		ST_THROW(Exception("header too short"));
+
+	    Type value;
+	    memcpy(&value, data.data() + offset, sizeof(value));
+	    return value;
+	}
+
+
+	/**
+	 * Get a NUL-terminated string from a field with a maximal length.
+	 */
+	string
+	get_string(const string& data, size_t offset, size_t size)
+	{
+	    if (offset + size > data.size())
+		ST_THROW(Exception("header too short"));
+
+	    const char* p = data.data() + offset;
+	    return string(p, find(p, p + size, '\0'));
+	}
+
+
+	struct BitlkMethod
+	{
+	    unsigned int encryption;
+	    const char* cipher;
+	    unsigned int key_bits;
+	};
+
+
+	const vector<BitlkMethod> bitlk_methods = {
+	    { 0x8000, "aes-cbc-elephant", 256 },
+	    { 0x8001, "aes-cbc-elephant", 512 },
+	    { 0x8002, "aes-cbc-eboiv", 128 },
+	    { 0x8003, "aes-cbc-eboiv", 256 },
+	    { 0x8004, "aes-xts-plain64", 256 },
+	    { 0x8005, "aes-xts-plain64", 512 }
+	};
+
+
+	/**
+	 * Get the children of a JSON object with numeric names (like
+	 * keyslots and segments in LUKS2) sorted by number.
+	 */
+	vector<json_object*>
+	get_numbered_children(json_object* parent, const char* name)
+	{
+	    vector<pair<unsigned long, json_object*>> tmp;
+
+	    json_object* object;
+	    if (get_child_node(parent, name, object) && json_object_is_type(object, json_type_object))
+	    {
+		json_object_iterator it = json_object_iter_begin(object);
+		json_object_iterator end = json_object_iter_end(object);
+
+		for (; !json_object_iter_equal(&it, &end); json_object_iter_next(&it))
+		    tmp.emplace_back(strtoul(json_object_iter_peek_name(&it), nullptr, 10),
+				     json_object_iter_peek_value(&it));
+	    }
+
+	    sort(tmp.begin(), tmp.end(), [](const pair<unsigned long, json_object*>& lhs,
+					    const pair<unsigned long, json_object*>& rhs) {
+		return lhs.first < rhs.first;
+	    });
+
+	    vector<json_object*> ret;
+	    for (const pair<unsigned long, json_object*>& value : tmp)
+		ret.push_back(value.second);
+
+	    return ret;
+	}
+
+    }
+
+
+    CryptHeader::CryptHeader(const string& device)
+	: device(device)
+    {
+	fd = open(device.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	    ST_THROW(IOException(sformat("open of '%s' failed, %s", device, strerror(errno))));
+    }
+
+
+    CryptHeader::~CryptHeader()
+    {
+	if (fd >= 0)
+	    close(fd);
+    }
+
+
+    string
+    CryptHeader::pread(unsigned long long offset, size_t size) const
+    {
+	string data(size, '\0');
+
+	size_t done = 0;
+	while (done < size)
+	{
+	    ssize_t r = ::pread(fd, &data[done], size - done, offset + done);
+	    if (r < 0)
+	    {
+		if (errno == EINTR)
+		    continue;
+
+		ST_THROW(IOException(sformat("read of '%s' failed, %s", device, strerror(errno))));
+	    }
+
+	    if (r == 0)
+		break;
+
+	    done += r;
+	}
+
+	data.resize(done);
+
+	return data;
+    }
+
+
+    void
+    CryptHeader::read(CmdCryptsetupLuksDump& cmd_cryptsetup_luks_dump) const
+    {
+	// The default size of the LUKS2 header incl. the JSON area is 16 KiB.
+	// Only bigger headers need a second read.
+
+	string data = pread(0, 64 * 1024);
+
+	if (data.size() >= 16 && memcmp(data.data(), luks_magic, sizeof(luks_magic)) == 0 &&
+	    be16toh(get<uint16_t>(data, 6)) == 2)
+	{
+	    unsigned long long hdr_size = be64toh(get<uint64_t>(data, 8));
+	    if (hdr_size > data.size() && hdr_size <= 4 * 1024 * 1024)
+		data += pread(data.size(), hdr_size - data.size());
+	}
+
+	parse_luks(cmd_cryptsetup_luks_dump, data);
+    }
+
+
+    void
+    CryptHeader::parse_luks(CmdCryptsetupLuksDump& cmd_cryptsetup_luks_dump, const string& data)
+    {
+	if (data.size() < sizeof(luks_magic) || memcmp(data.data(), luks_magic, sizeof(luks_magic)) != 0)
+	    ST_THROW(Exception("no LUKS header found"));
+
+	const unsigned int version = be16toh(get<uint16_t>(data, 6));
+
+	switch (version)
+	{
+	    case 1:
+	    {
+		cmd_cryptsetup_luks_dump.encryption_type = EncryptionType::LUKS1;
+		cmd_cryptsetup_luks_dump.cipher = get_string(data, 8, 32) + "-" + get_string(data, 40, 32);
+		cmd_cryptsetup_luks_dump.key_size = be32toh(get<uint32_t>(data, 108));
+		cmd_cryptsetup_luks_dump.uuid = get_string(data, 168, 40);
+	    }
+	    break;
+
+	    case 2:
+	    {
+		const unsigned long long hdr_size = be64toh(get<uint64_t>(data, 8));
+		if (hdr_size <= 4096 || hdr_size > data.size())
+		    ST_THROW(Exception("invalid LUKS2 header size"));
+
+		cmd_cryptsetup_luks_dump.encryption_type = EncryptionType::LUKS2;
+		cmd_cryptsetup_luks_dump.uuid = get_string(data, 168, 40);
+
+		JsonFile json_file(vector<string>{ get_string(data, 4096, hdr_size - 4096) });
+		json_object* root = json_file.get_root();
+
+		// Like for luksDump the last segment determines the cipher
+		// and integrity and the first keyslot the key size and
+		// PBKDF.
+
+		for (json_object* segment : get_numbered_children(root, "segments"))
+		{
+		    get_child_value(segment, "encryption", cmd_cryptsetup_luks_dump.cipher);
+
+		    json_object* integrity;
+		    if (get_child_node(segment, "integrity", integrity))
+			get_child_value(integrity, "type", cmd_cryptsetup_luks_dump.integrity);
+		}
+
+		vector<json_object*> keyslots = get_numbered_children(root, "keyslots");
+		if (!keyslots.empty())
+		{
+		    get_child_value(keyslots.front(), "key_size", cmd_cryptsetup_luks_dump.key_size);
+
+		    json_object* kdf;
+		    if (get_child_node(keyslots.front(), "kdf", kdf))
+			get_child_value(kdf, "type", cmd_cryptsetup_luks_dump.pbkdf);
+		}
+
+		if (cmd_cryptsetup_luks_dump.cipher.empty())
+		    ST_THROW(Exception("no cipher in LUKS2 header"));
+	    }
+	    break;
+
+	    default:
+		ST_THROW(Exception(sformat("unknown LUKS version %d", version)));
+	}
+    }
+
+
+    void
+    CryptHeader::read(CmdCryptsetupBitlkDump& cmd_cryptsetup_bitlk_dump) const
+    {
+	const string boot_sector = pread(0, 512);
+
+	// The offset of the first FVE metadata block depends on whether it
+	// is a normal BitLocker or BitLocker To Go.
+
+	size_t pos;
+	if (get_string(boot_sector, 3, 8) == "-FVE-FS-")
+	    pos = 176;
+	else if (get_string(boot_sector, 3, 8) == "MSWIN4.1")
+	    pos = 424;
+	else
+	    ST_THROW(Exception("no BitLocker header found"));
+
+	const unsigned long long offset = le64toh(get<uint64_t>(boot_sector, pos));
+
+	parse_bitlk(cmd_cryptsetup_bitlk_dump, pread(offset, 64 + 48));
+    }
+
+
+    void
+    CryptHeader::parse_bitlk(CmdCryptsetupBitlkDump& cmd_cryptsetup_bitlk_dump, const string& metadata)
+    {
+	if (metadata.size() < 64 + 48)
+	    ST_THROW(Exception("BitLocker FVE metadata too short"));
+
+	if (get_string(metadata, 0, 8) != "-FVE-FS-" || le16toh(get<uint16_t>(metadata, 10)) != 2)
+	    ST_THROW(Exception("no BitLocker FVE metadata found"));
+
+	// The FVE metadata header follows the 64 bytes of the block
+	// header.
+
+	const size_t header = 64;
+
+	cmd_cryptsetup_bitlk_dump.uuid = format_mixed_endian_guid(
+	    reinterpret_cast<const unsigned char*>(metadata.data() + header + 16));
+
+	// Same mapping of the encryption method as in cryptsetup. Like the
+	// parser of the bitlkDump output the key size is in bytes.
+
+	const unsigned int encryption = le16toh(get<uint16_t>(metadata, header + 36));
+
+	vector<BitlkMethod>::const_iterator it = find_if(bitlk_methods.begin(), bitlk_methods.end(),
+		[encryption](const BitlkMethod& method) { return method.encryption == encryption; });
+
+	if (it == bitlk_methods.end())
+	    ST_THROW(Exception(sformat("unknown BitLocker encryption 0x%x", encryption)));
+
+	cmd_cryptsetup_bitlk_dump.cipher = it->cipher;
+	cmd_cryptsetup_bitlk_dump.key_size = it->key_bits / 8;
+    }
+
+
+    bool
+    CryptHeader::is_usable()
+    {
+	return Mockup::get_mode() == Mockup::Mode::NONE && !get_remote_callbacks() && native_cryptsetup();
+    }
+
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_CRYPT_HEADER_H
+#define STORAGE_CRYPT_HEADER_H
+
+
+#include <string>
+#include <boost/noncopyable.hpp>
+
+
+namespace storage
+{
+    using std::string;
+
+
+    class CmdCryptsetupLuksDump;
+    class CmdCryptsetupBitlkDump;
+
+
+    /**
+     * In-process reader for LUKS1, LUKS2 and BitLocker headers. Fills
+     * CmdCryptsetupLuksDump and CmdCryptsetupBitlkDump with the same data
+     * 'cryptsetup luksDump' and 'cryptsetup bitlkDump' report, but without
+     * running cryptsetup (which loads its crypto backend on every run).
+     *
+     * The LUKS header, including the JSON area of LUKS2 with the default
+     * size, is read with a single pread. Objects for different devices
+     * can be used concurrently.
+     */
+    class CryptHeader : private boost::noncopyable
+    {
+    public:
+
+	/**
+	 * Opens the device. Throws an IOException if that fails.
+	 */
+	CryptHeader(const string& device);
+
+	~CryptHeader();
+
+	/**
+	 * The read functions throw an exception if reading fails or no
+	 * valid header is found.
+	 */
+	void read(CmdCryptsetupLuksDump& cmd_cryptsetup_luks_dump) const;
+	void read(CmdCryptsetupBitlkDump& cmd_cryptsetup_bitlk_dump) const;
+
+	/**
+	 * Check whether the CryptHeader should be tried for probing. Not the
+	 * case when using mockup or remote callbacks since the command
+	 * output is needed there.
+	 */
+	static bool is_usable();
+
+	/**
+	 * Parse a LUKS header from data. Used by read() and the testsuite.
+	 */
+	static void parse_luks(CmdCryptsetupLuksDump& cmd_cryptsetup_luks_dump, const string& data);
+
+	/**
+	 * Parse the FVE metadata of a BitLocker. Used by read() and the
+	 * testsuite.
+	 */
+	static void parse_bitlk(CmdCryptsetupBitlkDump& cmd_cryptsetup_bitlk_dump, const string& metadata);
+
+    private:
+
+	string pread(unsigned long long offset, size_t size) const;
+
+	const string device;
+
+	int fd = -1;
+
+    };
+
+}
+
+
+#endif
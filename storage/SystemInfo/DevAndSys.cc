@@ -27,6 +27,7 @@
 #include "storage/Utils/StorageTmpl.h"
 #include "storage/Utils/SystemCmd.h"
 #include "storage/Utils/Mockup.h"
+#include "storage/Utils/Stopwatch.h"
 #include "storage/Utils/StorageDefines.h"
 #include "storage/SystemInfo/DevAndSys.h"
 
@@ -68,12 +69,15 @@ namespace storage
     {
 	if (Mockup::get_mode() == Mockup::Mode::PLAYBACK)
 	{
-	    const Mockup::File& mockup_file = Mockup::get_file(path);
-	    content = mockup_file.content;
+	    const Mockup::FileView mockup_file = Mockup::get_file_view(path);
+	    content = mockup_file.content.to_vector();
+	    Mockup::replay_latency(mockup_file.latency);
 
 	    y2mil(*this);
 	}
 
+	const Stopwatch stopwatch;
+
 	if (get_remote_callbacks())
 	{
 	    const RemoteFile mockup_file = get_remote_callbacks()->get_file(path);
@@ -98,7 +102,7 @@ namespace storage
 
 	if (Mockup::get_mode() == Mockup::Mode::RECORD)
 	{
-	    Mockup::set_file(path, content);
+	    Mockup::set_file(path, content, stopwatch.read());
 	}
 
 	y2mil(*this);
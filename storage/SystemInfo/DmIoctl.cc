@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/dm-ioctl.h>
+#include <functional>
+
+#include "storage/SystemInfo/DmIoctl.h"
+#include "storage/SystemInfo/CmdDmsetup.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/Format.h"
+#include "storage/EnvironmentImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	/**
+	 * Buffer for the ioctls. Zeroed on destruction since tables can
+	 * contain keys (e.g. for dm-crypt).
+	 */
+	class Buffer : private boost::noncopyable
+	{
+	public:
+
+	    ~Buffer() { clear(); }
+
+	    dm_ioctl* reset(size_t size)
+	    {
+		clear();
+		data.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+		return get();
+	    }
+
+	    dm_ioctl* get() { return reinterpret_cast<dm_ioctl*>(data.data()); }
+
+	private:
+
+	    void clear()
+	    {
+		if (!data.empty())
+		    explicit_bzero(data.data(), data.size() * sizeof(uint64_t));
+	    }
+
+	    vector<uint64_t> data;
+
+	};
+
+
+	/**
+	 * Run the ioctl. The buffer is enlarged as long as the kernel
+	 * reports it to be too small. Returns false if the device does not
+	 * exist (anymore).
+	 */
+	bool
+	run(int fd, unsigned long request, const string& name, uint32_t flags, Buffer& buffer)
+	{
+	    for (size_t size = 16 * 1024; ; size *= 2)
+	    {
+		dm_ioctl* io = buffer.reset(size);
+
+		// Version 4.0.0 is supported by every kernel with dm ioctl
+		// version 4.
+		io->version[0] = DM_VERSION_MAJOR;
+		io->data_size = size;
+		io->data_start = sizeof(dm_ioctl);
+		io->flags = flags;
+		strncpy(io->name, name.c_str(), DM_NAME_LEN - 1);
+
+		if (ioctl(fd, request, io) != 0)
+		{
+		    if (errno == ENXIO)
+			return false;
+
+		    ST_THROW(IOException(sformat("dm ioctl failed for '%s', %s", name, strerror(errno))));
+		}
+
+		if (!(io->flags & DM_BUFFER_FULL_FLAG))
+		    return true;
+	    }
+	}
+
+
+	vector<string>
+	list_devices(int fd)
+	{
+	    vector<string> names;
+
+	    Buffer buffer;
+	    run(fd, DM_LIST_DEVICES, "", 0, buffer);
+
+	    const dm_ioctl* io = buffer.get();
+	    const char* data = reinterpret_cast<const char*>(io) + io->data_start;
+
+	    const dm_name_list* name_list = reinterpret_cast<const dm_name_list*>(data);
+	    if (name_list->dev == 0)
+		return names;
+
+	    while (true)
+	    {
+		names.push_back(name_list->name);
+
+		if (name_list->next == 0)
+		    break;
+
+		name_list = reinterpret_cast<const dm_name_list*>(reinterpret_cast<const char*>(name_list) +
+								  name_list->next);
+	    }
+
+	    return names;
+	}
+
+    }
+
+
+    DmIoctl::DmIoctl()
+    {
+	fd = open(DEV_MAPPER_DIR "/control", O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+	    ST_THROW(IOException(sformat("open of '%s' failed, %s", DEV_MAPPER_DIR "/control",
+					 strerror(errno))));
+    }
+
+
+    DmIoctl::~DmIoctl()
+    {
+	if (fd >= 0)
+	    close(fd);
+    }
+
+
+    void
+    DmIoctl::read(CmdDmsetupInfo& cmd_dmsetup_info) const
+    {
+	Buffer buffer;
+
+	for (const string& name : list_devices(fd))
+	{
+	    if (!run(fd, DM_DEV_STATUS, name, 0, buffer))
+		continue;
+
+	    const dm_ioctl* io = buffer.get();
+
+	    CmdDmsetupInfo::Entry entry;
+	    entry.majorminor = io->dev;
+	    entry.segments = io->target_count;
+	    entry.uuid = io->uuid;
+	    entry.subsystem = subsystem(entry.uuid);
+
+	    cmd_dmsetup_info.data[name] = entry;
+	}
+    }
+
+
+    void
+    DmIoctl::read(CmdDmsetupTable& cmd_dmsetup_table) const
+    {
+	Buffer buffer;
+
+	vector<string> fields;
+	vector<string_view> params;
+
+	for (const string& name : list_devices(fd))
+	{
+	    if (!run(fd, DM_TABLE_STATUS, name, DM_STATUS_TABLE_FLAG, buffer))
+		continue;
+
+	    const dm_ioctl* io = buffer.get();
+	    const char* data = reinterpret_cast<const char*>(io) + io->data_start;
+
+	    const char* pos = data;
+
+	    for (uint32_t i = 0; i < io->target_count; ++i)
+	    {
+		const dm_target_spec* spec = reinterpret_cast<const dm_target_spec*>(pos);
+
+		// The same fields as in a line of 'dmsetup table' after the
+		// name.
+
+		fields = { to_string(spec->sector_start), to_string(spec->length), spec->target_type };
+
+		params.assign(fields.begin(), fields.end());
+
+		string_view tmp(reinterpret_cast<const char*>(spec + 1));
+
+		string_view::size_type pos1 = tmp.find_first_not_of(" \t");
+		while (pos1 != string_view::npos)
+		{
+		    string_view::size_type pos2 = tmp.find_first_of(" \t", pos1);
+		    if (pos2 == string_view::npos)
+			pos2 = tmp.size();
+
+		    params.push_back(tmp.substr(pos1, pos2 - pos1));
+
+		    pos1 = tmp.find_first_not_of(" \t", pos2);
+		}
+
+		cmd_dmsetup_table.add(name, params);
+
+		pos = data + spec->next;
+	    }
+	}
+    }
+
+
+    bool
+    DmIoctl::is_usable()
+    {
+	return Mockup::get_mode() == Mockup::Mode::NONE && !get_remote_callbacks() && native_dmsetup();
+    }
+
+
+    string
+    DmIoctl::subsystem(const string& uuid)
+    {
+	string::size_type pos = uuid.find('-');
+	if (pos == string::npos)
+	    return "";
+
+	return uuid.substr(0, pos);
+    }
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_DM_IOCTL_H
+#define STORAGE_DM_IOCTL_H
+
+
+#include <string>
+#include <boost/noncopyable.hpp>
+
+
+namespace storage
+{
+    using std::string;
+
+
+    class CmdDmsetupInfo;
+    class CmdDmsetupTable;
+
+
+    /**
+     * In-process collector for device mapper information using ioctls on
+     * /dev/mapper/control. Fills CmdDmsetupInfo and CmdDmsetupTable with
+     * the same data 'dmsetup info' and 'dmsetup table' report, but
+     * without forking dmsetup and parsing its output.
+     *
+     * The devices are listed with DM_LIST_DEVICES. For each device the
+     * info is read with DM_DEV_STATUS and the table with
+     * DM_TABLE_STATUS.
+     */
+    class DmIoctl : private boost::noncopyable
+    {
+    public:
+
+	/**
+	 * Opens the device mapper control device. Throws an IOException if
+	 * that fails.
+	 */
+	DmIoctl();
+
+	~DmIoctl();
+
+	/**
+	 * The read functions throw an IOException if an ioctl fails.
+	 * Devices removed concurrently are skipped.
+	 */
+	void read(CmdDmsetupInfo& cmd_dmsetup_info) const;
+	void read(CmdDmsetupTable& cmd_dmsetup_table) const;
+
+	/**
+	 * Check whether the DmIoctl should be tried for probing. Not the
+	 * case when using mockup or remote callbacks since the command
+	 * output is needed there.
+	 */
+	static bool is_usable();
+
+	/**
+	 * Get the subsystem like dmsetup from the UUID, e.g. "CRYPT" for
+	 * "CRYPT-LUKS2-...". Empty if the UUID has no subsystem prefix.
+	 */
+	static string subsystem(const string& uuid);
+
+    private:
+
+	int fd = -1;
+
+    };
+
+}
+
+
+#endif
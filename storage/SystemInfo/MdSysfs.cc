@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#include <dirent.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <endian.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
+#include <fstream>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/SystemInfo/MdSysfs.h"
+#include "storage/SystemInfo/ProcMdstat.h"
+#include "storage/Devices/MdImpl.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/Format.h"
+#include "storage/Utils/Uuid.h"
+#include "storage/EnvironmentImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	string
+	read_attribute(const string& path)
+	{
+	    ifstream s(path);
+	    if (!s)
+		ST_THROW(IOException(sformat("open of '%s' failed", path)));
+
+	    string line;
+	    getline(s, line);
+
+	    return boost::trim_copy(line, locale::classic());
+	}
+
+
+	/**
+	 * Read the properties (E: lines) of an entry of the udev database. The
+	 * entry may be missing, e.g. for inactive MD RAIDs.
+	 */
+	map<string, string>
+	read_udev_properties(const string& path)
+	{
+	    map<string, string> properties;
+
+	    ifstream s(path);
+	    if (!s)
+		return properties;
+
+	    string line;
+	    while (getline(s, line))
+	    {
+		if (!boost::starts_with(line, "E:"))
+		    continue;
+
+		string::size_type pos = line.find('=');
+		if (pos == string::npos)
+		    continue;
+
+		properties[line.substr(2, pos - 2)] = line.substr(pos + 1);
+	    }
+
+	    return properties;
+	}
+
+
+	/**
+	 * Convert a UUID in the usual form to the form used by mdadm, e.g.
+	 * "7d0f0b1c:6b0ba4e8:..." for "7d0f0b1c-6b0b-a4e8-...".
+	 */
+	string
+	mdadm_uuid(const string& uuid)
+	{
+	    const string tmp = boost::erase_all_copy(uuid, "-");
+	    if (tmp.size() != 32)
+		ST_THROW(Exception(sformat("bad uuid '%s'", uuid)));
+
+	    return tmp.substr(0, 8) + ":" + tmp.substr(8, 8) + ":" + tmp.substr(16, 8) + ":" +
+		tmp.substr(24, 8);
+	}
+
+
+	// Magic number of MD superblocks of version 1.x.
+	const uint32_t md_sb_magic = 0xa92b4efc;
+
+    }
+
+
+    MdSysfs::MdSysfs(const string& device, const string& sysfs_path, const string& udev_data_path)
+	: device(device), sysfs_path(sysfs_path), udev_data_path(udev_data_path)
+    {
+    }
+
+
+    MdSysfs::MdSysfs(const string& device)
+	: device(device)
+    {
+	struct stat st;
+	if (stat(device.c_str(), &st) != 0)
+	    ST_THROW(IOException(sformat("stat of '%s' failed, %s", device, strerror(errno))));
+
+	if (!S_ISBLK(st.st_mode))
+	    ST_THROW(Exception(sformat("'%s' is no block device", device)));
+
+	const string id = sformat("%d:%d", major(st.st_rdev), minor(st.st_rdev));
+
+	sysfs_path = SYSFS_DIR "/dev/block/" + id + "/md";
+	udev_data_path = UDEV_DATA_DIR "/b" + id;
+
+	if (access(sysfs_path.c_str(), F_OK) != 0)
+	    ST_THROW(Exception(sformat("'%s' is no MD RAID", device)));
+    }
+
+
+    void
+    MdSysfs::read(MdadmDetail& mdadm_detail) const
+    {
+	const string metadata_version = read_attribute(sysfs_path + "/metadata_version");
+
+	const MdLevel tmp_level = level(read_attribute(sysfs_path + "/level"), metadata_version);
+	if (tmp_level == MdLevel::UNKNOWN)
+	    ST_THROW(Exception(sformat("unknown level of '%s'", device)));
+
+	// The devices are the dev-* entries. The name of the device in /dev
+	// uses '/' instead of '!', e.g. cciss!c0d0.
+
+	map<string, string> roles;
+
+	DIR* dir = opendir(sysfs_path.c_str());
+	if (!dir)
+	    ST_THROW(IOException(sformat("opendir of '%s' failed, %s", sysfs_path, strerror(errno))));
+
+	try
+	{
+	    while (const struct dirent* entry = readdir(dir))
+	    {
+		const string name = entry->d_name;
+		if (!boost::starts_with(name, "dev-"))
+		    continue;
+
+		const string slot = read_attribute(sysfs_path + "/" + name + "/slot");
+		const string state = read_attribute(sysfs_path + "/" + name + "/state");
+
+		roles[DEV_DIR "/" + boost::replace_all_copy(name.substr(4), "!", "/")] = role(slot, state);
+	    }
+	}
+	catch (...)
+	{
+	    closedir(dir);
+	    throw;
+	}
+
+	closedir(dir);
+
+	// udev only runs mdadm for active MD RAIDs, so MD_UUID and MD_DEVNAME
+	// are missing for containers and inactive MD RAIDs. The kernel knows
+	// the UUID unless the metadata is external and the superblock of a
+	// device has it for native metadata 1.x.
+
+	string uuid;
+
+	if (access((sysfs_path + "/uuid").c_str(), R_OK) == 0)
+	    uuid = uuid_from_sysfs(read_attribute(sysfs_path + "/uuid"));
+
+	if (uuid.empty() && boost::starts_with(metadata_version, "1.") && !roles.empty())
+	    uuid = uuid_from_superblock(roles.begin()->first, metadata_version);
+
+	const map<string, string> properties = read_udev_properties(udev_data_path);
+
+	map<string, string>::const_iterator it = properties.find("MD_UUID");
+	if (uuid.empty() && it != properties.end())
+	    uuid = it->second;
+
+	if (uuid.empty())
+	    ST_THROW(Exception(sformat("no uuid found for '%s'", device)));
+
+	it = properties.find("MD_DEVNAME");
+	const string devname = it != properties.end() ? it->second : "";
+
+	mdadm_detail.uuid = uuid;
+	mdadm_detail.devname = devname;
+	mdadm_detail.metadata = metadata(metadata_version);
+	mdadm_detail.level = tmp_level;
+	mdadm_detail.roles = roles;
+    }
+
+
+    bool
+    MdSysfs::is_usable()
+    {
+	return Mockup::get_mode() == Mockup::Mode::NONE && !get_remote_callbacks() && native_mdadm();
+    }
+
+
+    string
+    MdSysfs::uuid_from_sysfs(const string& uuid)
+    {
+	if (boost::erase_all_copy(boost::erase_all_copy(uuid, "-"), "0").empty())
+	    return "";
+
+	return mdadm_uuid(uuid);
+    }
+
+
+    string
+    MdSysfs::uuid_from_superblock(const string& device, const string& metadata_version)
+    {
+	int fd = open(device.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	    ST_THROW(IOException(sformat("open of '%s' failed, %s", device, strerror(errno))));
+
+	// The superblock is at the start for 1.1, at 4 KiB for 1.2 and near
+	// the end for 1.0.
+
+	unsigned long long offset = 0;
+
+	if (metadata_version == "1.2")
+	{
+	    offset = 4096;
+	}
+	else if (metadata_version == "1.0")
+	{
+	    // Regular files are images used for testing.
+
+	    struct stat st;
+	    if (fstat(fd, &st) != 0)
+	    {
+		close(fd);
+		ST_THROW(IOException(sformat("fstat for '%s' failed", device)));
+	    }
+
+	    unsigned long long size = st.st_size;
+	    if (S_ISBLK(st.st_mode) && ioctl(fd, BLKGETSIZE64, &size) != 0)
+	    {
+		close(fd);
+		ST_THROW(IOException(sformat("ioctl for '%s' failed", device)));
+	    }
+
+	    offset = ((size / 512 - 16) & ~7ULL) * 512;
+	}
+	else if (metadata_version != "1.1")
+	{
+	    close(fd);
+	    ST_THROW(Exception(sformat("unsupported metadata version '%s'", metadata_version)));
+	}
+
+	unsigned char data[32];
+	const ssize_t ret = pread(fd, data, sizeof(data), offset);
+
+	close(fd);
+
+	if (ret != sizeof(data))
+	    ST_THROW(IOException(sformat("read of '%s' failed", device)));
+
+	uint32_t magic, major_version;
+	memcpy(&magic, data, 4);
+	memcpy(&major_version, data + 4, 4);
+
+	if (le32toh(magic) != md_sb_magic || le32toh(major_version) != 1)
+	    ST_THROW(Exception(sformat("no MD superblock on '%s'", device)));
+
+	return mdadm_uuid(format_uuid(data + 16));
+    }
+
+
+    string
+    MdSysfs::metadata(const string& metadata_version)
+    {
+	if (boost::starts_with(metadata_version, "external:/"))
+	    return "";
+
+	if (boost::starts_with(metadata_version, "external:"))
+	    return metadata_version.substr(strlen("external:"));
+
+	if (metadata_version == "none")
+	    return "";
+
+	return metadata_version;
+    }
+
+
+    MdLevel
+    MdSysfs::level(const string& level, const string& metadata_version)
+    {
+	if (level.empty())
+	{
+	    if (boost::starts_with(metadata_version, "external:") &&
+		!boost::starts_with(metadata_version, "external:/"))
+		return MdLevel::CONTAINER;
+
+	    return MdLevel::UNKNOWN;
+	}
+
+	return toValueWithFallback(boost::to_upper_copy(level, locale::classic()), MdLevel::UNKNOWN);
+    }
+
+
+    string
+    MdSysfs::role(const string& slot, const string& state)
+    {
+	// Like mdadm faulty and journal devices are also marked as spare
+	// (see MdadmDetail).
+
+	vector<string> flags;
+	boost::split(flags, state, boost::is_any_of(","));
+
+	if (std::find(flags.begin(), flags.end(), "faulty") != flags.end())
+	    return "spare";
+
+	if (slot.empty() || !all_of(slot.begin(), slot.end(), ::isdigit))
+	    return "spare";
+
+	return slot;
+    }
+
+}
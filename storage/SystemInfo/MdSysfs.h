@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_MD_SYSFS_H
+#define STORAGE_MD_SYSFS_H
+
+
+#include <string>
+
+#include "storage/Devices/Md.h"
+
+
+namespace storage
+{
+    using std::string;
+
+
+    class MdadmDetail;
+
+
+    /**
+     * In-process collector for the information of 'mdadm --detail
+     * --export'. The level, the metadata version and the roles of the
+     * devices are read from /sys/block/mdX/md/. The UUID is read from there
+     * as well, or from the superblock of a device for native metadata.
+     * Otherwise, e.g. for external metadata, the UUID is taken from the
+     * udev database where udev stores the output of 'mdadm --detail
+     * --export' run by its rules. The device name is only available there.
+     *
+     * Covers native MD RAIDs as well as containers and arrays in
+     * containers (IMSM and DDF).
+     */
+    class MdSysfs
+    {
+    public:
+
+	/**
+	 * Looks up the MD RAID in sysfs. Throws an exception if the device
+	 * is no MD RAID.
+	 */
+	MdSysfs(const string& device);
+
+	/**
+	 * Uses the given paths instead of the ones for device. Only for
+	 * testing.
+	 */
+	MdSysfs(const string& device, const string& sysfs_path, const string& udev_data_path);
+
+	/**
+	 * Throws an exception if some information is not available, e.g.
+	 * the UUID of a container, which is only in the udev database for
+	 * active containers.
+	 */
+	void read(MdadmDetail& mdadm_detail) const;
+
+	/**
+	 * Check whether the MdSysfs should be tried for probing. Not the
+	 * case when using mockup or remote callbacks since the command
+	 * output is needed there.
+	 */
+	static bool is_usable();
+
+	/**
+	 * Get the UUID like mdadm from the content of uuid, e.g.
+	 * "7d0f0b1c:6b0ba4e8:1a2b3c4d:5e6f7a8b" for
+	 * "7d0f0b1c-6b0b-a4e8-1a2b-3c4d5e6f7a8b". Returns an empty string for
+	 * the null UUID the kernel reports for external metadata.
+	 */
+	static string uuid_from_sysfs(const string& uuid);
+
+	/**
+	 * Read the UUID like mdadm from the MD superblock of version 1.x on
+	 * device.
+	 */
+	static string uuid_from_superblock(const string& device, const string& metadata_version);
+
+	/**
+	 * Get the metadata like mdadm from the content of metadata_version,
+	 * e.g. "1.0" for "1.0", "imsm" for "external:imsm" and "" for
+	 * "external:/md127/0" (an array in a container).
+	 */
+	static string metadata(const string& metadata_version);
+
+	/**
+	 * Get the level like mdadm from the content of level and
+	 * metadata_version. Containers have an empty level.
+	 */
+	static MdLevel level(const string& level, const string& metadata_version);
+
+	/**
+	 * Get the role like mdadm (a number or "spare") from the content of
+	 * slot and state of a device.
+	 */
+	static string role(const string& slot, const string& state);
+
+    private:
+
+	const string device;
+
+	string sysfs_path;
+	string udev_data_path;
+
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,576 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <memory>
+#include <set>
+#include <boost/crc.hpp>
+
+#include "storage/SystemInfo/PartitionTableReader.h"
+#include "storage/Devices/PartitionImpl.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/Format.h"
+#include "storage/Utils/Uuid.h"
+#include "storage/EnvironmentImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	const unsigned long long max_gpt_entries = 16384;
+
+	const unsigned int max_logicals = 256;
+
+
+	unsigned int
+	le16(const unsigned char* p)
+	{
+	    return p[0] | p[1] << 8;
+	}
+
+
+	unsigned int
+	le32(const unsigned char* p)
+	{
+	    return le16(p) | (unsigned int)(le16(p + 2)) << 16;
+	}
+
+
+	unsigned long long
+	le64(const unsigned char* p)
+	{
+	    return le32(p) | (unsigned long long)(le32(p + 4)) << 32;
+	}
+
+
+	unsigned int
+	crc32(const unsigned char* p, size_t size)
+	{
+	    boost::crc_32_type crc;
+	    crc.process_bytes(p, size);
+	    return crc.checksum();
+	}
+
+
+	/**
+	 * Convert the zero terminated UTF-16LE partition name to UTF-8.
+	 */
+	string
+	utf16le_to_utf8(const unsigned char* p, size_t size)
+	{
+	    string ret;
+
+	    for (size_t i = 0; i + 1 < size; i += 2)
+	    {
+		unsigned int c = le16(p + i);
+		if (c == 0)
+		    break;
+
+		if (c >= 0xd800 && c < 0xdc00 && i + 3 < size)
+		{
+		    unsigned int d = le16(p + i + 2);
+		    if (d >= 0xdc00 && d < 0xe000)
+		    {
+			c = 0x10000 + ((c - 0xd800) << 10) + (d - 0xdc00);
+			i += 2;
+		    }
+		}
+
+		if (c < 0x80)
+		{
+		    ret += (char)(c);
+		}
+		else if (c < 0x800)
+		{
+		    ret += (char)(0xc0 | c >> 6);
+		    ret += (char)(0x80 | (c & 0x3f));
+		}
+		else if (c < 0x10000)
+		{
+		    ret += (char)(0xe0 | c >> 12);
+		    ret += (char)(0x80 | (c >> 6 & 0x3f));
+		    ret += (char)(0x80 | (c & 0x3f));
+		}
+		else
+		{
+		    ret += (char)(0xf0 | c >> 18);
+		    ret += (char)(0x80 | (c >> 12 & 0x3f));
+		    ret += (char)(0x80 | (c >> 6 & 0x3f));
+		    ret += (char)(0x80 | (c & 0x3f));
+		}
+	    }
+
+	    return ret;
+	}
+
+
+	/**
+	 * Mapping from GPT partition type UUIDs to partition ids for the types
+	 * parted reports as flags.
+	 */
+	const map<string, unsigned int> uuid_to_flag_id = {
+	    { "21686148-6449-6e6f-744e-656564454649", ID_BIOS_BOOT },
+	    { "de94bba4-06d1-4d40-a16a-bfd50179d6ac", ID_DIAG },
+	    { "c12a7328-f81f-11d2-ba4b-00a0c93ec93b", ID_ESP },
+	    { "d3bfe2de-3daf-11df-ba40-e3a556d89593", ID_IRST },
+	    { "933ac7e1-2eb4-4f13-b844-0e14e2aef915", ID_LINUX_HOME },
+	    { "e6d6d379-f507-44c2-a23c-238f2a3df928", ID_LVM },
+	    { "e3c9e316-0b5c-4db8-817d-f92df00215ae", ID_MICROSOFT_RESERVED },
+	    { "9e1a2d38-c612-4316-aa26-8b49521e5a8b", ID_PREP },
+	    { "a19d880f-05fc-4d3b-a006-743f0f84911e", ID_RAID },
+	    { "0657fd6d-a4ab-43c4-84e5-0933c84b4f4f", ID_SWAP },
+	    { "ebd0a0a2-b9e5-4433-87c0-68b6b72699c7", ID_WINDOWS_BASIC_DATA },
+	};
+
+
+	unsigned int
+	uuid_to_id(const string& uuid)
+	{
+	    map<string, unsigned int>::const_iterator it1 = uuid_to_flag_id.find(uuid);
+	    if (it1 != uuid_to_flag_id.end())
+		return it1->second;
+
+	    map<unsigned int, const char*>::const_iterator it2 =
+		find_if(Parted::id_to_uuid.begin(), Parted::id_to_uuid.end(),
+			[&uuid](const auto& v) { return v.second == uuid; });
+
+	    return it2 != Parted::id_to_uuid.end() ? it2->first : ID_UNKNOWN;
+	}
+
+
+	bool
+	is_extended_id(unsigned int id)
+	{
+	    // see https://github.com/torvalds/linux/blob/master/include/linux/genhd.h#L32
+	    return id == 0x05 || id == 0x0f || id == 0x85;
+	}
+
+
+	/**
+	 * Check whether the sector is a FAT boot sector, e.g. of a
+	 * superfloppy, which has the same signature as an MS-DOS partition
+	 * table: The filesystem type "FAT" at offset 0x36 (FAT12 and FAT16)
+	 * or 0x52 (FAT32) and a plausible BIOS parameter block.
+	 */
+	bool
+	is_fat_boot_sector(const vector<unsigned char>& sector)
+	{
+	    if (memcmp(sector.data() + 0x36, "FAT", 3) != 0 && memcmp(sector.data() + 0x52, "FAT", 3) != 0)
+		return false;
+
+	    auto is_power_of_two = [](unsigned int x) { return x != 0 && (x & (x - 1)) == 0; };
+
+	    const unsigned int bytes_per_sector = le16(sector.data() + 0x0b);
+	    const unsigned int sectors_per_cluster = sector[0x0d];
+	    const unsigned int reserved_sectors = le16(sector.data() + 0x0e);
+	    const unsigned int num_fats = sector[0x10];
+
+	    return bytes_per_sector >= 512 && bytes_per_sector <= 4096 && is_power_of_two(bytes_per_sector) &&
+		is_power_of_two(sectors_per_cluster) && reserved_sectors > 0 && (num_fats == 1 || num_fats == 2);
+	}
+
+    }
+
+
+    PartitionTableReader::PartitionTableReader(const string& device)
+	: device(device)
+    {
+	fd = open(device.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+	if (fd < 0 && errno == EINVAL)
+	    fd = open(device.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	    ST_THROW(IOException(sformat("open for '%s' failed, errno:%d (%s)", device, errno,
+					 strerror(errno))));
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+	    close(fd);
+	    ST_THROW(IOException(sformat("fstat for '%s' failed", device)));
+	}
+
+	if (S_ISBLK(st.st_mode))
+	{
+	    unsigned long long size = 0;
+	    int logical = 0;
+	    unsigned int physical = 0;
+
+	    if (ioctl(fd, BLKGETSIZE64, &size) != 0 || ioctl(fd, BLKSSZGET, &logical) != 0 ||
+		ioctl(fd, BLKPBSZGET, &physical) != 0)
+	    {
+		close(fd);
+		ST_THROW(IOException(sformat("ioctl for '%s' failed", device)));
+	    }
+
+	    logical_sector_size = logical;
+	    physical_sector_size = physical;
+	    num_sectors = size / logical_sector_size;
+	}
+	else if (S_ISREG(st.st_mode))
+	{
+	    // Images used for testing.
+
+	    num_sectors = st.st_size / logical_sector_size;
+	}
+	else
+	{
+	    close(fd);
+	    ST_THROW(IOException(sformat("'%s' is neither a block device nor a file", device)));
+	}
+    }
+
+
+    PartitionTableReader::~PartitionTableReader()
+    {
+	close(fd);
+    }
+
+
+    bool
+    PartitionTableReader::is_usable()
+    {
+	return Mockup::get_mode() == Mockup::Mode::NONE && !get_remote_callbacks() &&
+	    native_partition_table_reader();
+    }
+
+
+    vector<unsigned char>
+    PartitionTableReader::read_sectors(unsigned long long sector, unsigned long long count) const
+    {
+	if (count == 0 || sector + count > num_sectors)
+	    ST_THROW(IOException(sformat("read beyond end of '%s'", device)));
+
+	// O_DIRECT needs an aligned buffer.
+
+	const size_t size = count * logical_sector_size;
+
+	void* tmp = nullptr;
+	if (posix_memalign(&tmp, max(logical_sector_size, 4096U), size) != 0)
+	    ST_THROW(IOException("posix_memalign failed"));
+
+	unique_ptr<unsigned char, decltype(&free)> buffer((unsigned char*)(tmp), &free);
+
+	size_t done = 0;
+	while (done < size)
+	{
+	    ssize_t ret = pread(fd, buffer.get() + done, size - done, sector * logical_sector_size + done);
+	    if (ret < 0 && errno == EINTR)
+		continue;
+	    if (ret <= 0)
+		ST_THROW(IOException(sformat("read of '%s' failed", device)));
+
+	    done += ret;
+	}
+
+	return vector<unsigned char>(buffer.get(), buffer.get() + size);
+    }
+
+
+    bool
+    PartitionTableReader::read(Parted& parted) const
+    {
+	if (num_sectors < 2)
+	    return false;
+
+	const vector<unsigned char> mbr = read_sectors(0, 1);
+
+	if (mbr[510] != 0x55 || mbr[511] != 0xaa)
+	    return false;
+
+	parted.label = PtType::UNKNOWN;
+	parted.region = Region(0, num_sectors, logical_sector_size);
+	parted.logical_sector_size = (int)(logical_sector_size);
+	parted.physical_sector_size = (int)(physical_sector_size);
+	parted.primary_slots = -1;
+	parted.implicit = false;
+	parted.gpt_undersized = false;
+	parted.gpt_backup_broken = false;
+	parted.gpt_pmbr_boot = false;
+	parted.entries.clear();
+
+	bool protective = false;
+	for (int i = 0; i < 4; ++i)
+	{
+	    if (mbr[446 + 16 * i + 4] == 0xee)
+		protective = true;
+	}
+
+	bool ret = protective ? read_gpt(parted, mbr) : read_msdos(parted, mbr);
+
+	sort(parted.entries.begin(), parted.entries.end(), [](const Parted::Entry& lhs, const Parted::Entry& rhs)
+	    { return lhs.number < rhs.number; }
+	);
+
+	return ret;
+    }
+
+
+    bool
+    PartitionTableReader::is_valid_gpt_header(const vector<unsigned char>& header, unsigned long long sector,
+					      vector<unsigned char>& entries) const
+    {
+	const unsigned char* p = header.data();
+
+	if (memcmp(p, "EFI PART", 8) != 0)
+	    return false;
+
+	unsigned int header_size = le32(p + 12);
+	if (header_size < 92 || header_size > logical_sector_size)
+	    return false;
+
+	vector<unsigned char> tmp(p, p + header_size);
+	memset(tmp.data() + 16, 0, 4);
+	if (crc32(tmp.data(), header_size) != le32(p + 16))
+	    return false;
+
+	if (le64(p + 24) != sector)
+	    return false;
+
+	unsigned long long entries_lba = le64(p + 72);
+	unsigned long long num_entries = le32(p + 80);
+	unsigned long long entry_size = le32(p + 84);
+
+	if (num_entries == 0 || num_entries > max_gpt_entries || entry_size < 128 || entry_size % 8 != 0)
+	    return false;
+
+	unsigned long long bytes = num_entries * entry_size;
+	unsigned long long count = (bytes + logical_sector_size - 1) / logical_sector_size;
+
+	if (entries_lba == 0 || entries_lba + count > num_sectors)
+	    return false;
+
+	entries = read_sectors(entries_lba, count);
+
+	return crc32(entries.data(), bytes) == le32(p + 88);
+    }
+
+
+    bool
+    PartitionTableReader::read_gpt(Parted& parted, const vector<unsigned char>& mbr) const
+    {
+	const vector<unsigned char> header = read_sectors(1, 1);
+
+	// With a broken primary GPT parted might use the backup GPT.
+
+	vector<unsigned char> entries;
+	if (!is_valid_gpt_header(header, 1, entries))
+	    return false;
+
+	const unsigned char* p = header.data();
+
+	unsigned long long alternate_lba = le64(p + 32);
+	unsigned long long first_usable_lba = le64(p + 40);
+	unsigned long long last_usable_lba = le64(p + 48);
+	unsigned int num_entries = le32(p + 80);
+	unsigned int entry_size = le32(p + 84);
+
+	// A GPT beyond the end of the device (after shrinking it) is an error
+	// for parted.
+
+	if (alternate_lba >= num_sectors || last_usable_lba >= alternate_lba)
+	    return false;
+
+	parted.label = PtType::GPT;
+	parted.primary_slots = num_entries;
+
+	parted.gpt_undersized = alternate_lba < num_sectors - 1;
+
+	vector<unsigned char> backup_entries;
+	parted.gpt_backup_broken = !is_valid_gpt_header(read_sectors(alternate_lba, 1), alternate_lba,
+							backup_entries);
+
+	for (int i = 0; i < 4; ++i)
+	{
+	    if (mbr[446 + 16 * i + 4] == 0xee && mbr[446 + 16 * i] == 0x80)
+		parted.gpt_pmbr_boot = true;
+	}
+
+	for (unsigned int i = 0; i < num_entries; ++i)
+	{
+	    const unsigned char* q = entries.data() + i * entry_size;
+
+	    if (all_of(q, q + 16, [](unsigned char c) { return c == 0; }))
+		continue;
+
+	    unsigned long long first_lba = le64(q + 32);
+	    unsigned long long last_lba = le64(q + 40);
+
+	    if (first_lba < first_usable_lba || last_lba > last_usable_lba || last_lba < first_lba)
+		return false;
+
+	    Parted::Entry entry;
+
+	    entry.number = i + 1;
+	    entry.region = Region(first_lba, last_lba - first_lba + 1, logical_sector_size);
+	    entry.type = PartitionType::PRIMARY;
+	    entry.id = uuid_to_id(format_mixed_endian_guid(q));
+	    entry.legacy_boot = le64(q + 48) & (1ULL << 2);
+	    entry.name = utf16le_to_utf8(q + 56, min(entry_size - 56, 72U));
+
+	    parted.entries.push_back(entry);
+	}
+
+	return true;
+    }
+
+
+    bool
+    PartitionTableReader::read_msdos(Parted& parted, const vector<unsigned char>& mbr) const
+    {
+	// A GPT without protective MBR is not reported as GPT by parted.
+
+	if (memcmp(read_sectors(1, 1).data(), "EFI PART", 8) == 0)
+	    return false;
+
+	// Like the kernel and parted, do not consider the sector an MS-DOS
+	// partition table if the boot indicators are invalid. An MS-DOS
+	// partition table without partitions is indistinguishable from some
+	// boot sectors.
+
+	for (int i = 0; i < 4; ++i)
+	{
+	    unsigned char boot_ind = mbr[446 + 16 * i];
+	    if (boot_ind != 0x00 && boot_ind != 0x80)
+		return false;
+	}
+
+	// Like parted, do not consider a FAT boot sector an MS-DOS
+	// partition table. Left to parted.
+
+	if (is_fat_boot_sector(mbr))
+	    return false;
+
+	parted.label = PtType::MSDOS;
+	parted.primary_slots = 4;
+
+	bool has_extended = false;
+
+	for (int i = 0; i < 4; ++i)
+	{
+	    const unsigned char* p = mbr.data() + 446 + 16 * i;
+
+	    unsigned int id = p[4];
+	    if (id == 0x00)
+		continue;
+
+	    unsigned long long start = le32(p + 8);
+	    unsigned long long size = le32(p + 12);
+
+	    if (start == 0 || size == 0 || start + size > num_sectors)
+		return false;
+
+	    Parted::Entry entry;
+
+	    entry.number = i + 1;
+	    entry.region = Region(start, size, logical_sector_size);
+	    entry.id = id;
+	    entry.boot = p[0] == 0x80;
+
+	    if (is_extended_id(id))
+	    {
+		if (has_extended)
+		    return false;
+
+		has_extended = true;
+
+		entry.type = PartitionType::EXTENDED;
+
+		if (!read_logicals(parted, start))
+		    return false;
+	    }
+
+	    parted.entries.push_back(entry);
+	}
+
+	return !parted.entries.empty();
+    }
+
+
+    bool
+    PartitionTableReader::read_logicals(Parted& parted, unsigned long long extended_start) const
+    {
+	unsigned int number = 5;
+
+	set<unsigned long long> seen;
+
+	unsigned long long ebr_lba = extended_start;
+
+	while (true)
+	{
+	    if (!seen.insert(ebr_lba).second || seen.size() > max_logicals)
+		return false;
+
+	    const vector<unsigned char> ebr = read_sectors(ebr_lba, 1);
+
+	    if (ebr[510] != 0x55 || ebr[511] != 0xaa)
+		return false;
+
+	    const unsigned char* p = ebr.data() + 446;
+
+	    unsigned int id = p[4];
+	    if (id != 0x00)
+	    {
+		unsigned long long start = ebr_lba + le32(p + 8);
+		unsigned long long size = le32(p + 12);
+
+		if (size == 0 || start + size > num_sectors)
+		    return false;
+
+		Parted::Entry entry;
+
+		entry.number = number++;
+		entry.region = Region(start, size, logical_sector_size);
+		entry.type = PartitionType::LOGICAL;
+		entry.id = id;
+		entry.boot = p[0] == 0x80;
+
+		parted.entries.push_back(entry);
+	    }
+
+	    const unsigned char* q = ebr.data() + 446 + 16;
+
+	    if (q[4] == 0x00)
+		break;
+
+	    if (!is_extended_id(q[4]))
+		return false;
+
+	    ebr_lba = extended_start + le32(q + 8);
+	}
+
+	return true;
+    }
+
+}
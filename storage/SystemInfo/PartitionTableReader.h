@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_PARTITION_TABLE_READER_H
+#define STORAGE_PARTITION_TABLE_READER_H
+
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+#include "storage/SystemInfo/CmdParted.h"
+
+
+namespace storage
+{
+    using std::string;
+    using std::vector;
+
+
+    /**
+     * In-process reader for GPT and MS-DOS partition tables. Fills a Parted
+     * object with the same data the parted command reports, but without
+     * forking parted.
+     *
+     * Only tables that parted would report without any doubt are
+     * handled. For everything else, e.g. other labels, a broken primary
+     * GPT, a GPT without protective MBR or an MS-DOS table without
+     * partitions (which might also be a FAT boot sector), read() returns
+     * false and parted has to be used.
+     *
+     * The device (or an image file) is read with O_DIRECT if possible.
+     */
+    class PartitionTableReader : private boost::noncopyable
+    {
+    public:
+
+	/**
+	 * Opens the device. Throws an IOException if that fails.
+	 */
+	PartitionTableReader(const string& device);
+
+	~PartitionTableReader();
+
+	/**
+	 * Read the partition table into parted. Returns false if the
+	 * partition table is not handled. Throws an IOException on read
+	 * errors.
+	 */
+	bool read(Parted& parted) const;
+
+	/**
+	 * Check whether the PartitionTableReader should be tried for
+	 * probing. Not the case when using mockup or remote callbacks since
+	 * the parted output is needed there.
+	 */
+	static bool is_usable();
+
+    private:
+
+	const string device;
+
+	int fd = -1;
+
+	unsigned long long num_sectors = 0;
+	unsigned int logical_sector_size = 512;
+	unsigned int physical_sector_size = 512;
+
+	vector<unsigned char> read_sectors(unsigned long long sector, unsigned long long count) const;
+
+	bool read_gpt(Parted& parted, const vector<unsigned char>& mbr) const;
+	bool read_msdos(Parted& parted, const vector<unsigned char>& mbr) const;
+
+	bool read_logicals(Parted& parted, unsigned long long extended_start) const;
+
+	bool is_valid_gpt_header(const vector<unsigned char>& header, unsigned long long sector,
+				 vector<unsigned char>& entries) const;
+
+    };
+
+}
+
+
+#endif
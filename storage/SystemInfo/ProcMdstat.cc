@@ -27,6 +27,7 @@
 #include "storage/Utils/HumanString.h"
 #include "storage/Utils/AsciiFile.h"
 #include "storage/SystemInfo/ProcMdstat.h"
+#include "storage/SystemInfo/MdSysfs.h"
 #include "storage/Devices/MdImpl.h"
 #include "storage/Utils/StorageDefines.h"
 #include "storage/Utils/SystemCmd.h"
@@ -340,6 +341,24 @@ namespace storage
     MdadmDetail::MdadmDetail(const string& device)
 	: uuid(), devname(), metadata(), level(MdLevel::UNKNOWN), device(device)
     {
+	if (MdSysfs::is_usable())
+	{
+	    try
+	    {
+		MdSysfs(device).read(*this);
+
+		y2mil(*this);
+
+		return;
+	    }
+	    catch (const Exception& exception)
+	    {
+		ST_CAUGHT(exception);
+
+		y2war("reading MD RAID details from sysfs failed, falling back to mdadm");
+	    }
+	}
+
 	SystemCmd cmd(MDADM_BIN " --detail " + quote(device) + " --export", SystemCmd::DoThrow);
 
 	parse(cmd.stdout());
@@ -21,7 +21,10 @@
  */
 
 
+#include <boost/algorithm/string.hpp>
+
 #include "storage/SystemInfo/SystemInfoImpl.h"
+#include "storage/Utils/StorageTmpl.h"
 
 
 namespace storage
@@ -42,18 +45,128 @@ namespace storage
     const CmdUdevadmInfo&
     SystemInfo::Impl::getCmdUdevadmInfo(const string& file)
     {
+	// Objects not constructed, e.g. since the constructor throwed, are
+	// skipped.
+
+	const CmdUdevadmInfo* cmd_udevadm_info = cmd_udevadm_infos.find_if(
+	    [&file](const CmdUdevadmInfo& tmp) { return tmp.is_alias_of(file); }
+	);
+
+	if (cmd_udevadm_info)
+	    return *cmd_udevadm_info;
+
+	return cmd_udevadm_infos.get(file);
+    }
+
+
+
+    const CmdPvs&
+    SystemInfo::Impl::getCmdPvs()
+    {
+	const CmdLvmFullreport& fullreport = cmd_lvm_fullreport.get();
+	if (fullreport.is_available())
+	    return fullreport.get_cmd_pvs();
+
+	return cmd_pvs.get();
+    }
+
+
+    const CmdVgs&
+    SystemInfo::Impl::getCmdVgs()
+    {
+	const CmdLvmFullreport& fullreport = cmd_lvm_fullreport.get();
+	if (fullreport.is_available())
+	    return fullreport.get_cmd_vgs();
+
+	return cmd_vgs.get();
+    }
+
+
+    const CmdLvs&
+    SystemInfo::Impl::getCmdLvs()
+    {
+	const CmdLvmFullreport& fullreport = cmd_lvm_fullreport.get();
+	if (fullreport.is_available())
+	    return fullreport.get_cmd_lvs();
+
+	return cmd_lvs.get();
+    }
+
+
+
+    void
+    SystemInfo::Impl::invalidate(const vector<string>& devices)
+    {
+	y2mil("invalidate " << devices);
+
+	// Matching by prefix also covers partitions, e.g. /dev/sda1 for
+	// /dev/sda. It may drop slightly too much, e.g. /dev/sdaa, which is
+	// harmless.
+
+	auto affected = [&devices](const string& key) {
+	    return std::any_of(devices.begin(), devices.end(), [&key](const string& device) {
+		return boost::starts_with(key, device);
+	    });
+	};
+
+	// The udevadm info is also cached under aliases, e.g. links in
+	// /dev/disk, so compare the device numbers.
+
+	set<dev_t> majorminors;
+
 	for (const auto& tmp : cmd_udevadm_infos.get_data())
 	{
-	    // does not have an object iff the constructor throwed
-	    if (!tmp.second.has_object())
-		continue;
-
-	    const CmdUdevadmInfo& cmd_udevadm_info = tmp.second.get_object();
-	    if (cmd_udevadm_info.is_alias_of(file))
-		return cmd_udevadm_info;
+	    if (tmp.second.has_object() && affected(tmp.first))
+		majorminors.insert(tmp.second.get_object().get_majorminor());
 	}
 
-	return cmd_udevadm_infos.get(file);
+	cmd_udevadm_infos.erase_if([&affected, &majorminors](const string& key, const auto& helper) {
+	    return affected(key) || !helper.has_object() ||
+		majorminors.count(helper.get_object().get_majorminor()) > 0;
+	});
+
+	auto affected_key = [&affected](const string& key, const auto&) { return affected(key); };
+
+	cmd_stats.erase_if(affected_key);
+	cmd_blockdev.erase_if(affected_key);
+	mdadm_details.erase_if(affected_key);
+	parteds.erase_if(affected_key);
+	dasdviews.erase_if(affected_key);
+	cmd_cryptsetup_luks_dumps.erase_if(affected_key);
+	cmd_cryptsetup_bitlk_dumps.erase_if(affected_key);
+
+	cmd_btrfs_subvolume_lists.erase_if(affected);
+	cmd_btrfs_subvolume_shows.erase_if(affected);
+	cmd_btrfs_subvolume_get_defaults.erase_if(affected);
+	cmd_btrfs_filesystem_df.erase_if(affected);
+	cmd_btrfs_qgroup_show.erase_if(affected);
+	cmd_lsattr.erase_if([&affected](const CmdLsattr::key_t& key) { return affected(std::get<0>(key)); });
+
+	// Reading files is cheap so simply drop all.
+
+	etc_fstab.clear();
+	etc_crypttab.clear();
+	etc_mdadm.clear();
+	dirs.clear();
+	files.clear();
+	cmd_dfs.clear();
+
+	md_links.reset();
+	proc_mounts.reset();
+	proc_mdstat.reset();
+	blkid.reset();
+	lsscsi.reset();
+	cmd_nvme_list.reset();
+	cmd_nvme_list_subsys.reset();
+	cmd_dmsetup_info.reset();
+	cmd_dmsetup_table.reset();
+	cmd_dmraid.reset();
+	cmd_multipath.reset();
+	cmd_btrfs_filesystem_show.reset();
+	cmd_lvm_fullreport.reset();
+	cmd_pvs.reset();
+	cmd_vgs.reset();
+	cmd_lvs.reset();
     }
 
 }
@@ -25,6 +25,9 @@
 #define STORAGE_SYSTEM_INFO_IMPL_H
 
 
+#include <mutex>
+#include <boost/core/demangle.hpp>
+
 #include "storage/EtcFstab.h"
 #include "storage/EtcCrypttab.h"
 #include "storage/EtcMdadm.h"
@@ -50,6 +53,7 @@
 #include "storage/SystemInfo/CmdLvm.h"
 #include "storage/SystemInfo/CmdUdevadm.h"
 #include "storage/SystemInfo/DevAndSys.h"
+#include "storage/Utils/Trace.h"
 
 
 namespace storage
@@ -126,9 +130,10 @@ namespace storage
 	const CmdBtrfsQgroupShow& getCmdBtrfsQgroupShow(const string& device, const string& mount_point)
 	    { return cmd_btrfs_qgroup_show.get(CmdBtrfsQgroupShow::key_t(device), mount_point); }
 
-	const CmdPvs& getCmdPvs() { return cmd_pvs.get(); }
-	const CmdVgs& getCmdVgs() { return cmd_vgs.get(); }
-	const CmdLvs& getCmdLvs() { return cmd_lvs.get(); }
+	// Uses lvm fullreport if available, otherwise pvs, vgs and lvs.
+	const CmdPvs& getCmdPvs();
+	const CmdVgs& getCmdVgs();
+	const CmdLvs& getCmdLvs();
 
 	/**
 	 * This function is special in that it checks for some aliases.
@@ -141,11 +146,25 @@ namespace storage
 	const CmdLsattr& getCmdLsattr(const string& device, const string& mount_point, const string& path)
 	    { return cmd_lsattr.get(CmdLsattr::key_t(device, path), mount_point, path); }
 
+	/**
+	 * Drop the cached information related to the devices, e.g. after
+	 * uevents for the devices were seen. Information for e.g. partitions
+	 * of the devices is also dropped. Information covering all devices,
+	 * e.g. the blkid or dmsetup output, is always dropped.
+	 */
+	void invalidate(const vector<string>& devices);
+
     private:
 
 	/* LazyObject, LazyObjects and LazyObjectsWithKey cache the object and
 	   a potential exception during object construction. HelperBase does
-	   the common part. */
+	   the common part.
+
+	   The getters can be called from several threads, e.g. during pass
+	   2 of probing. Objects with different keys are constructed
+	   concurrently, for the same key only once. Dropping cached objects
+	   (reset, erase_if and clear) must not run concurrently with
+	   getters. */
 
 	template <class Object, typename... Args>
 	class HelperBase
@@ -154,11 +173,16 @@ namespace storage
 
 	    const Object& get(Args... args)
 	    {
+		std::lock_guard<std::mutex> lock(mutex);
+
 		if (ep)
 		    std::rethrow_exception(ep);
 
 		if (!object)
 		{
+		    TraceSpan trace_span("systeminfo", Tracer::is_enabled() ?
+					 boost::core::demangle(typeid(Object).name()) : string());
+
 		    try
 		    {
 			object = make_shared<Object>(args...);
@@ -173,11 +197,25 @@ namespace storage
 		return *object;
 	    }
 
+	    /**
+	     * Get the object if already constructed. Does not wait for a
+	     * construction running in another thread.
+	     */
+	    const Object* get_if_constructed()
+	    {
+		std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+		return lock.owns_lock() ? object.get() : nullptr;
+	    }
+
 	    bool has_object() const { return (bool)(object); }
 	    const Object& get_object() const { return *object; }
 
+	    void reset() { object.reset(); ep = nullptr; }
+
 	private:
 
+	    std::mutex mutex;
+
 	    std::shared_ptr<Object> object;
 	    std::exception_ptr ep;
 
@@ -199,16 +237,50 @@ namespace storage
 
 	    const Object& get(const Arg& arg)
 	    {
-		typename map<Arg, Helper>::iterator pos = data.lower_bound(arg);
-		if (pos == data.end() || typename map<Arg, Helper>::key_compare()(arg, pos->first))
-		    pos = data.insert(pos, typename map<Arg, Helper>::value_type(arg, Helper()));
-		return pos->second.get(arg);
+		return find_or_insert(arg).get(arg);
 	    }
 
 	    const map<Arg, Helper>& get_data() const { return data; }
 
+	    template <typename Pred>
+	    const Object* find_if(Pred pred)
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (typename map<Arg, Helper>::value_type& value : data)
+		{
+		    const Object* object = value.second.get_if_constructed();
+		    if (object && pred(*object))
+			return object;
+		}
+
+		return nullptr;
+	    }
+
+	    template <typename Pred>
+	    void erase_if(Pred pred)
+	    {
+		for (typename map<Arg, Helper>::iterator it = data.begin(); it != data.end();)
+		    it = pred(it->first, it->second) ? data.erase(it) : std::next(it);
+	    }
+
+	    void clear() { data.clear(); }
+
 	private:
 
+	    Helper& find_or_insert(const Arg& arg)
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+
+		typename map<Arg, Helper>::iterator pos = data.lower_bound(arg);
+		if (pos == data.end() || typename map<Arg, Helper>::key_compare()(arg, pos->first))
+		    pos = data.emplace_hint(pos, std::piecewise_construct, std::forward_as_tuple(arg),
+					    std::forward_as_tuple());
+		return pos->second;
+	    }
+
+	    std::mutex mutex;
+
 	    map<Arg, Helper> data;
 
 	};
@@ -225,19 +297,38 @@ namespace storage
 
 	    bool includes(const Key& key) const
 	    {
+		std::lock_guard<std::mutex> lock(mutex);
+
 		typename map<Key, Helper>::const_iterator pos = data.lower_bound(key);
 		return pos != data.end() && !typename map<Key, Helper>::key_compare()(key, pos->first);
 	    }
 
 	    const Object& get(const Key& key, Args... args)
 	    {
+		return find_or_insert(key).get(key, args...);
+	    }
+
+	    template <typename Pred>
+	    void erase_if(Pred pred)
+	    {
+		for (typename map<Key, Helper>::iterator it = data.begin(); it != data.end();)
+		    it = pred(it->first) ? data.erase(it) : std::next(it);
+	    }
+
+	private:
+
+	    Helper& find_or_insert(const Key& key)
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+
 		typename map<Key, Helper>::iterator pos = data.lower_bound(key);
 		if (pos == data.end() || typename map<Key, Helper>::key_compare()(key, pos->first))
-		    pos = data.insert(pos, typename map<Key, Helper>::value_type(key, Helper()));
-		return pos->second.get(key, args...);
+		    pos = data.emplace_hint(pos, std::piecewise_construct, std::forward_as_tuple(key),
+					    std::forward_as_tuple());
+		return pos->second;
 	    }
 
-	private:
+	    mutable std::mutex mutex;
 
 	    map<Key, Helper> data;
 
@@ -277,6 +368,7 @@ namespace storage
 	LazyObjectsWithKey<CmdBtrfsFilesystemDf, string> cmd_btrfs_filesystem_df;
 	LazyObjectsWithKey<CmdBtrfsQgroupShow, string> cmd_btrfs_qgroup_show;
 
+	LazyObject<CmdLvmFullreport> cmd_lvm_fullreport;
 	LazyObject<CmdPvs> cmd_pvs;
 	LazyObject<CmdVgs> cmd_vgs;
 	LazyObject<CmdLvs> cmd_lvs;
@@ -35,6 +35,7 @@
 #include "storage/Utils/Format.h"
 #include "storage/Utils/ExceptionImpl.h"
 #include "storage/Utils/AppUtil.h"
+#include "storage/Utils/Stopwatch.h"
 
 
 namespace storage
@@ -54,11 +55,14 @@ namespace storage
     {
 	if (Mockup::get_mode() == Mockup::Mode::PLAYBACK)
 	{
-	    const Mockup::File& mockup_file = Mockup::get_file(name);
-	    lines = mockup_file.content;
+	    const Mockup::FileView mockup_file = Mockup::get_file_view(name);
+	    lines = mockup_file.content.to_vector();
+	    Mockup::replay_latency(mockup_file.latency);
 	    return true;
 	}
 
+	const Stopwatch stopwatch;
+
 	bool ret;
 
 	if (get_remote_callbacks())
@@ -88,7 +92,7 @@ namespace storage
 
 	if (Mockup::get_mode() == Mockup::Mode::RECORD)
 	{
-	    Mockup::set_file(name, lines);
+	    Mockup::set_file(name, lines, stopwatch.read());
 	}
 
 	return ret;
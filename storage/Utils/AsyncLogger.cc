@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/syscall.h>
+
+#include <json-c/json.h>
+
+#include "storage/Utils/AsyncLogger.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/AppUtil.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	size_t
+	round_up_to_power_of_two(size_t n)
+	{
+	    size_t ret = 1;
+	    while (ret < n)
+		ret <<= 1;
+	    return ret;
+	}
+
+
+	pid_t
+	get_tid()
+	{
+	    static thread_local const pid_t tid = syscall(SYS_gettid);
+
+	    return tid;
+	}
+
+    }
+
+
+    AsyncLogger::AsyncLogger(const string& filename, Formatter formatter, size_t capacity)
+	: filename(filename), formatter(formatter), mask(round_up_to_power_of_two(max(capacity, (size_t) 2)) - 1),
+	  slots(new Slot[mask + 1])
+    {
+	for (size_t i = 0; i <= mask; ++i)
+	    slots[i].sequence = i;
+
+	thread = std::thread(&AsyncLogger::run, this);
+    }
+
+
+    AsyncLogger::~AsyncLogger()
+    {
+	if (get_logger() == this)
+	    set_logger(nullptr);
+
+	{
+	    std::lock_guard<std::mutex> lock(mutex);
+	    stopping = true;
+	}
+
+	wakeup.notify_one();
+
+	thread.join();
+    }
+
+
+    bool
+    AsyncLogger::try_push(Record& record)
+    {
+	// Bounded queue from Dmitry Vyukov. Every slot has a sequence number
+	// telling whether it is free for the producer at position pos
+	// (sequence == pos) or filled for the consumer at position pos
+	// (sequence == pos + 1).
+
+	size_t pos = enqueue_pos.load(memory_order_relaxed);
+
+	while (true)
+	{
+	    Slot& slot = slots[pos & mask];
+	    size_t sequence = slot.sequence.load(memory_order_acquire);
+	    ptrdiff_t diff = (ptrdiff_t)(sequence) - (ptrdiff_t)(pos);
+
+	    if (diff == 0)
+	    {
+		if (enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+		{
+		    slot.record = std::move(record);
+		    slot.sequence.store(pos + 1, memory_order_release);
+
+		    // Wake up the background thread early when the ring
+		    // buffer is half full.
+
+		    if (pos + 1 - dequeue_pos.load(memory_order_relaxed) == (mask + 1) / 2)
+			wakeup.notify_one();
+
+		    return true;
+		}
+	    }
+	    else if (diff < 0)
+	    {
+		return false;
+	    }
+	    else
+	    {
+		pos = enqueue_pos.load(memory_order_relaxed);
+	    }
+	}
+    }
+
+
+    bool
+    AsyncLogger::try_pop(Record& record)
+    {
+	// Only called from the background thread.
+
+	size_t pos = dequeue_pos.load(memory_order_relaxed);
+
+	Slot& slot = slots[pos & mask];
+	size_t sequence = slot.sequence.load(memory_order_acquire);
+
+	if (sequence != pos + 1)
+	    return false;
+
+	record = std::move(slot.record);
+	slot.sequence.store(pos + mask + 1, memory_order_release);
+
+	dequeue_pos.store(pos + 1, memory_order_relaxed);
+
+	return true;
+    }
+
+
+    AsyncLogger::Record
+    AsyncLogger::make_record(LogLevel log_level, const char* component, const char* file,
+			     int line, const char* function, string&& content)
+    {
+	Record record;
+
+	record.log_level = log_level;
+	record.component = component;
+	record.file = file;
+	record.line = line;
+	record.function = function;
+	record.content = std::move(content);
+	record.time = chrono::system_clock::now();
+	record.tid = get_tid();
+	record.correlation_id = LogCorrelation::get_current();
+
+	return record;
+    }
+
+
+    void
+    AsyncLogger::write(LogLevel log_level, const string& component, const string& file,
+		       int line, const string& function, const string& content)
+    {
+	Record record = make_record(log_level, intern_log_string(component), intern_log_string(file), line,
+				    intern_log_string(function), string(content));
+
+	push(record);
+    }
+
+
+    void
+    AsyncLogger::write_message(LogLevel log_level, const char* component, const char* file, int line,
+			       const char* function, string&& content)
+    {
+	Record record = make_record(log_level, component, file, line, function, std::move(content));
+
+	push(record);
+    }
+
+
+    void
+    AsyncLogger::push(Record& record)
+    {
+	while (!try_push(record))
+	{
+	    wakeup.notify_one();
+	    this_thread::yield();
+	}
+    }
+
+
+    void
+    AsyncLogger::flush()
+    {
+	const size_t target = enqueue_pos.load(memory_order_relaxed);
+
+	wakeup.notify_one();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	flushed.wait(lock, [this, target]() { return written.load(memory_order_relaxed) >= target; });
+    }
+
+
+    void
+    AsyncLogger::run()
+    {
+	string buffer;
+	Record record;
+
+	while (true)
+	{
+	    buffer.clear();
+
+	    size_t n = 0;
+	    while (n <= mask && try_pop(record))
+	    {
+		formatter(record, buffer);
+		++n;
+	    }
+
+	    if (n > 0)
+	    {
+		write_batch(buffer);
+
+		{
+		    std::lock_guard<std::mutex> lock(mutex);
+		    written.fetch_add(n, memory_order_relaxed);
+		}
+
+		flushed.notify_all();
+
+		continue;
+	    }
+
+	    std::unique_lock<std::mutex> lock(mutex);
+
+	    auto pending = [this]() {
+		return dequeue_pos.load(memory_order_relaxed) != enqueue_pos.load(memory_order_relaxed);
+	    };
+
+	    if (stopping && !pending())
+		break;
+
+	    wakeup.wait_for(lock, chrono::milliseconds(100), [this, &pending]() { return stopping || pending(); });
+	}
+    }
+
+
+    void
+    AsyncLogger::write_batch(const string& buffer) const
+    {
+	// log file should not be world-readable
+	int fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0640);
+	if (fd < 0)
+	    return;
+
+	const char* p = buffer.data();
+	size_t left = buffer.size();
+
+	while (left > 0)
+	{
+	    ssize_t r = ::write(fd, p, left);
+	    if (r < 0)
+	    {
+		if (errno == EINTR)
+		    continue;
+		break;
+	    }
+
+	    p += r;
+	    left -= r;
+	}
+
+	close(fd);
+    }
+
+
+    void
+    AsyncLogger::format_text(const Record& record, string& buffer)
+    {
+	typedef typename std::underlying_type<LogLevel>::type log_level_underlying_type;
+
+	// Only called from background threads, so caching the formatted
+	// time of the last second per thread is safe.
+
+	static thread_local time_t last_time = 0;
+	static thread_local string last_datetime;
+
+	time_t time = chrono::system_clock::to_time_t(record.time);
+	if (time != last_time || last_datetime.empty())
+	{
+	    last_time = time;
+	    last_datetime = datetime(time);
+	}
+
+	const string::size_type start = buffer.size();
+
+	buffer += last_datetime;
+	buffer += " <";
+	buffer += to_string(static_cast<log_level_underlying_type>(record.log_level));
+	buffer += "> [";
+	buffer += record.component;
+	buffer += "] ";
+	buffer += record.file;
+	buffer += "(";
+	buffer += record.function;
+	buffer += "):";
+	buffer += to_string(record.line);
+	buffer += " ";
+
+	// Every line of the content gets the same prefix.
+
+	const string::size_type prefix_size = buffer.size() - start;
+
+	bool first = true;
+
+	for (string_view line : LinesView(record.content))
+	{
+	    if (!first)
+		buffer.append(buffer, start, prefix_size);
+
+	    buffer += line;
+	    buffer += "\n";
+
+	    first = false;
+	}
+
+	if (first)
+	    buffer.resize(start);
+    }
+
+
+
+    JsonLogger::JsonLogger(const string& filename, size_t capacity)
+	: AsyncLogger(filename, format_json, capacity)
+    {
+    }
+
+
+    void
+    JsonLogger::write_command(LogLevel log_level, const char* component, const char* file,
+			      int line, const char* function, LogCommand&& log_command)
+    {
+	Record record = make_record(log_level, component, file, line, function, "command");
+	record.command = make_shared<const LogCommand>(std::move(log_command));
+
+	push(record);
+    }
+
+
+    namespace
+    {
+
+	const char*
+	log_level_name(LogLevel log_level)
+	{
+	    switch (log_level)
+	    {
+		case LogLevel::DEBUG: return "debug";
+		case LogLevel::MILESTONE: return "milestone";
+		case LogLevel::WARNING: return "warning";
+		case LogLevel::ERROR: return "error";
+	    }
+
+	    return "unknown";
+	}
+
+
+	string
+	format_time(chrono::system_clock::time_point time)
+	{
+	    const chrono::system_clock::duration since_epoch = time.time_since_epoch();
+	    const time_t seconds = chrono::duration_cast<chrono::seconds>(since_epoch).count();
+	    const long microseconds = chrono::duration_cast<chrono::microseconds>(since_epoch).count() % 1000000;
+
+	    struct tm tm;
+	    gmtime_r(&seconds, &tm);
+
+	    char buffer[64];
+	    size_t n = strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+	    snprintf(buffer + n, sizeof(buffer) - n, ".%06ldZ", microseconds);
+
+	    return buffer;
+	}
+
+
+	json_object*
+	new_string_array(const vector<string>& lines)
+	{
+	    json_object* json_array = json_object_new_array();
+
+	    for (const string& line : lines)
+		json_object_array_add(json_array, json_object_new_string(line.c_str()));
+
+	    return json_array;
+	}
+
+    }
+
+
+    void
+    JsonLogger::format_json(const Record& record, string& buffer)
+    {
+	// Records of commands have a one-line message. Otherwise every line of
+	// the content is written as an object.
+
+	if (record.command)
+	{
+	    format_json_object(record, record.content, buffer);
+	    return;
+	}
+
+	for (string_view line : LinesView(record.content))
+	    format_json_object(record, line, buffer);
+    }
+
+
+    void
+    JsonLogger::format_json_object(const Record& record, string_view message, string& buffer)
+    {
+	json_object* json_root = json_object_new_object();
+
+	json_object_object_add(json_root, "time", json_object_new_string(format_time(record.time).c_str()));
+	json_object_object_add(json_root, "level", json_object_new_string(log_level_name(record.log_level)));
+	json_object_object_add(json_root, "component", json_object_new_string(record.component));
+	json_object_object_add(json_root, "file", json_object_new_string(record.file));
+	json_object_object_add(json_root, "line", json_object_new_int64(record.line));
+	json_object_object_add(json_root, "function", json_object_new_string(record.function));
+	json_object_object_add(json_root, "pid", json_object_new_int64(getpid()));
+	json_object_object_add(json_root, "tid", json_object_new_int64(record.tid));
+
+	if (!record.correlation_id.empty())
+	    json_object_object_add(json_root, "correlation_id", json_object_new_string(record.correlation_id.c_str()));
+
+	json_object_object_add(json_root, "message", json_object_new_string_len(message.data(), message.size()));
+
+	if (record.command)
+	{
+	    const LogCommand& command = *record.command;
+
+	    json_object_object_add(json_root, "command", json_object_new_string(command.command.c_str()));
+	    json_object_object_add(json_root, "exit_code", json_object_new_int64(command.exit_code));
+	    json_object_object_add(json_root, "stdout", new_string_array(command.stdout_lines));
+	    json_object_object_add(json_root, "stderr", new_string_array(command.stderr_lines));
+
+	    if (command.omitted_stdout_lines > 0)
+		json_object_object_add(json_root, "omitted_stdout_lines", json_object_new_int64(command.omitted_stdout_lines));
+
+	    if (command.omitted_stderr_lines > 0)
+		json_object_object_add(json_root, "omitted_stderr_lines", json_object_new_int64(command.omitted_stderr_lines));
+	}
+
+	buffer += json_object_to_json_string_ext(json_root, JSON_C_TO_STRING_PLAIN |
+						 JSON_C_TO_STRING_NOSLASHESCAPE);
+	buffer += "\n";
+
+	json_object_put(json_root);
+    }
+
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_ASYNC_LOGGER_H
+#define STORAGE_ASYNC_LOGGER_H
+
+
+#include <sys/types.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "storage/Utils/Logger.h"
+#include "storage/Utils/LinesIterator.h"
+
+
+namespace storage
+{
+    using std::string;
+    using std::vector;
+
+
+    /**
+     * Structured record of an executed command, see log_command().
+     */
+    struct LogCommand
+    {
+	string command;
+	int exit_code = 0;
+	vector<string> stdout_lines;
+	vector<string> stderr_lines;
+	unsigned int omitted_stdout_lines = 0;
+	unsigned int omitted_stderr_lines = 0;
+    };
+
+
+    /**
+     * A Logger that appends to a file from a background thread.
+     *
+     * write() only moves the log message into a bounded lock-free ring
+     * buffer. The background thread takes all queued messages, splits them
+     * into lines, formats them and appends them to the file with a single
+     * write. The file is opened for
+     * every batch so that log rotation works like for the synchronous
+     * logfile logger.
+     *
+     * If the ring buffer is full write() waits for the background thread.
+     * Log lines are never dropped.
+     */
+    class AsyncLogger : public Logger
+    {
+    public:
+
+	/**
+	 * The strings component, file and function must be valid for the
+	 * lifetime of the process, e.g. literals. The content can have
+	 * several lines.
+	 */
+	struct Record
+	{
+	    LogLevel log_level;
+	    const char* component;
+	    const char* file;
+	    int line;
+	    const char* function;
+	    string content;
+	    std::chrono::system_clock::time_point time;
+	    pid_t tid;
+	    string correlation_id;
+
+	    /** Only set for records of executed commands. */
+	    std::shared_ptr<const LogCommand> command;
+	};
+
+	/**
+	 * Function to append a formatted record to the buffer. Called from
+	 * the background thread.
+	 */
+	typedef std::function<void(const Record& record, string& buffer)> Formatter;
+
+	/**
+	 * The capacity of the ring buffer is rounded up to a power of two.
+	 */
+	AsyncLogger(const string& filename, Formatter formatter = format_text, size_t capacity = 16384);
+
+	/**
+	 * Writes all queued log lines and stops the background thread.
+	 */
+	virtual ~AsyncLogger();
+
+	virtual void write(LogLevel log_level, const string& component, const string& file,
+			   int line, const string& function, const string& content) override;
+
+	/**
+	 * Queue a log message without copying component, file and function,
+	 * see Record. The message is split into lines by the background
+	 * thread.
+	 */
+	void write_message(LogLevel log_level, const char* component, const char* file, int line,
+			   const char* function, string&& content);
+
+	/**
+	 * Wait until all log lines queued so far are written.
+	 */
+	void flush();
+
+	/**
+	 * Same format as the synchronous logfile logger.
+	 */
+	static void format_text(const Record& record, string& buffer);
+
+    protected:
+
+	/**
+	 * Create a record with the current time, thread and correlation id.
+	 */
+	static Record make_record(LogLevel log_level, const char* component, const char* file,
+				  int line, const char* function, string&& content);
+
+	/**
+	 * Queue the record. Waits if the ring buffer is full.
+	 */
+	void push(Record& record);
+
+    private:
+
+	struct Slot
+	{
+	    std::atomic<size_t> sequence;
+	    Record record;
+	};
+
+	bool try_push(Record& record);
+	bool try_pop(Record& record);
+
+	void run();
+
+	void write_batch(const string& buffer) const;
+
+	const string filename;
+	const Formatter formatter;
+
+	const size_t mask;
+	const std::unique_ptr<Slot[]> slots;
+
+	std::atomic<size_t> enqueue_pos { 0 };
+	std::atomic<size_t> dequeue_pos { 0 };
+
+	/** Number of records written to the file. */
+	std::atomic<size_t> written { 0 };
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::condition_variable flushed;
+
+	bool stopping = false;
+
+	std::thread thread;
+
+    };
+
+
+    /**
+     * An AsyncLogger writing one JSON object per line including time,
+     * level, file, line, function, thread id and correlation id. Commands
+     * are written as one record including the output, see log_command().
+     */
+    class JsonLogger : public AsyncLogger
+    {
+    public:
+
+	JsonLogger(const string& filename, size_t capacity = 16384);
+
+	void write_command(LogLevel log_level, const char* component, const char* file,
+			   int line, const char* function, LogCommand&& log_command);
+
+	static void format_json(const Record& record, string& buffer);
+
+    private:
+
+	static void format_json_object(const Record& record, std::string_view message, string& buffer);
+
+    };
+
+}
+
+#endif
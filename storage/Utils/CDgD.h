@@ -26,6 +26,8 @@
 
 #include <memory>
 #include <optional>
+#include <mutex>
+#include <atomic>
 
 
 namespace storage
@@ -49,31 +51,65 @@ namespace storage
     public:
 
 	CDgD()
-	    : ptr(make_shared<std::optional<Type>>())
+	    : data(make_shared<Data>())
 	{
 	}
 
 	bool has_value() const
 	{
-	    std::optional<Type>& tmp = *ptr;
-	    return (bool)(tmp);
+	    return data->valid.load(std::memory_order_acquire);
 	}
 
 	const Type& get_value() const
 	{
-	    std::optional<Type>& tmp = *ptr;
-	    return *tmp;
+	    return *data->value;
 	}
 
 	void set_value(const Type& value)
 	{
-	    std::optional<Type>& tmp = *ptr;
-	    tmp = value;
+	    std::lock_guard<std::mutex> lock(data->mutex);
+
+	    data->value = value;
+	    data->valid.store(true, std::memory_order_release);
+	}
+
+	/**
+	 * Get the value. If no value is set yet func is called to set it.
+	 * Even if called from several threads at the same time func is
+	 * only called once. If func throws the value stays unset.
+	 */
+	template<typename Func>
+	const Type& get_or_set_value(Func func) const
+	{
+	    if (!data->valid.load(std::memory_order_acquire))
+	    {
+		std::lock_guard<std::mutex> lock(data->mutex);
+
+		if (!data->valid.load(std::memory_order_relaxed))
+		{
+		    data->value = func();
+		    data->valid.store(true, std::memory_order_release);
+		}
+	    }
+
+	    return *data->value;
 	}
 
     private:
 
-	std::shared_ptr<std::optional<Type>> ptr;
+	/**
+	 * The value can be set lazily from const functions, possibly from
+	 * several threads querying the same or copied devicegraphs at the
+	 * same time.
+	 */
+	struct Data
+	{
+	    std::mutex mutex;
+	    std::atomic<bool> valid { false };
+	    std::optional<Type> value;
+	};
+
+	std::shared_ptr<Data> data;
 
     };
 
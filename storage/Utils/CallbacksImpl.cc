@@ -80,6 +80,21 @@ namespace storage
     }
 
 
+    std::function<bool()>
+    cancel_requested_function(const Callbacks* callbacks)
+    {
+	const ProbeCallbacksV5* probe_callbacks_v5 = dynamic_cast<const ProbeCallbacksV5*>(callbacks);
+	if (probe_callbacks_v5)
+	    return [probe_callbacks_v5]() { return probe_callbacks_v5->cancel_requested(); };
+
+	const CommitCallbacksV3* commit_callbacks_v3 = dynamic_cast<const CommitCallbacksV3*>(callbacks);
+	if (commit_callbacks_v3)
+	    return [commit_callbacks_v3]() { return commit_callbacks_v3->cancel_requested(); };
+
+	return nullptr;
+    }
+
+
     void
     message_callback(const Callbacks* callbacks, const Text& message)
     {
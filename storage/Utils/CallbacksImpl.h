@@ -25,6 +25,7 @@
 
 
 #include <stdint.h>
+#include <functional>
 
 #include "storage/Utils/Callbacks.h"
 #include "storage/Actions/Base.h"
@@ -80,6 +81,15 @@ namespace storage
     };
 
 
+    /**
+     * Return a function calling the cancel_requested() function of the callbacks
+     * (if available). Used for the OperationBudget which only calls it on the
+     * thread that started the operation.
+     */
+    std::function<bool()>
+    cancel_requested_function(const Callbacks* callbacks);
+
+
     /**
      * Call the message callback of callbacks.
      */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_COPYABLE_ATOMIC_H
+#define STORAGE_COPYABLE_ATOMIC_H
+
+
+#include <atomic>
+
+
+namespace storage
+{
+
+    /**
+     * An atomic value that can be copied, e.g. as a member of the Impl
+     * classes of devices which are copied when a devicegraph is copied.
+     * Copying itself is not atomic as a whole, so copy only while no
+     * other thread modifies the source.
+     */
+    template<typename Type>
+    class CopyableAtomic
+    {
+
+    public:
+
+	CopyableAtomic(Type value)
+	    : value(value)
+	{
+	}
+
+	CopyableAtomic(const CopyableAtomic& other)
+	    : value(other.load())
+	{
+	}
+
+	CopyableAtomic& operator=(const CopyableAtomic& other)
+	{
+	    store(other.load());
+	    return *this;
+	}
+
+	CopyableAtomic& operator=(Type tmp)
+	{
+	    store(tmp);
+	    return *this;
+	}
+
+	Type load(std::memory_order order = std::memory_order_seq_cst) const
+	{
+	    return value.load(order);
+	}
+
+	void store(Type tmp, std::memory_order order = std::memory_order_seq_cst)
+	{
+	    value.store(tmp, order);
+	}
+
+    private:
+
+	std::atomic<Type> value;
+
+    };
+
+}
+
+
+#endif
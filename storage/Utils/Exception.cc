@@ -125,9 +125,9 @@ namespace storage
 		    const char * const 	 prefix )
     {
 	y2log_op( exception.log_level(),
-		  location.file().c_str(),
+		  intern_log_string(location.file()),
 		  location.line(),
-		  location.func().c_str(),
+		  intern_log_string(location.func()),
 		  prefix << " " << exception.asString() );
     }
 
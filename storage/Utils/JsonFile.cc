@@ -59,13 +59,19 @@ namespace storage
     };
 
 
-    JsonFile::JsonFile(const vector<string>& lines)
+    /**
+     * Feed the lines one after another to the tokener and return the root
+     * object. Works for a vector of strings and for a LinesView.
+     */
+    template <typename Lines>
+    static json_object*
+    parse_lines(const Lines& lines)
     {
 	JsonTokener tokener;
 
-	for (const string& line : lines)
+	for (const auto& line : lines)
 	{
-	    root = json_tokener_parse_ex(tokener.get(), line.c_str(), line.size());
+	    json_object* root = json_tokener_parse_ex(tokener.get(), line.data(), line.size());
 
 	    switch (json_tokener_get_error(tokener.get()))
 	    {
@@ -73,7 +79,7 @@ namespace storage
 		    continue;
 
 		case json_tokener_success:
-		    return;
+		    return root;
 
 		default:
 		    break;
@@ -84,6 +90,18 @@ namespace storage
     }
 
 
+    JsonFile::JsonFile(const vector<string>& lines)
+	: root(parse_lines(lines))
+    {
+    }
+
+
+    JsonFile::JsonFile(const LinesView& lines)
+	: root(parse_lines(lines))
+    {
+    }
+
+
     JsonFile::JsonFile(const string& filename)
     {
 	FILE* fp = fopen(filename.c_str(), "r");
@@ -29,6 +29,8 @@
 #include <vector>
 #include <boost/noncopyable.hpp>
 
+#include "storage/Utils/LinesIterator.h"
+
 
 namespace storage
 {
@@ -49,6 +51,8 @@ namespace storage
 
 	JsonFile(const vector<string>& lines);
 
+	JsonFile(const LinesView& lines);
+
 	JsonFile(const string& filename);
 
 	~JsonFile();
@@ -20,17 +20,106 @@
  */
 
 
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <memory>
+#include <boost/algorithm/string.hpp>
+
 #include "storage/Utils/LightProbe.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Remote.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/Format.h"
+#include "storage/Utils/StorageDefines.h"
 #include "storage/SystemInfo/SystemInfoImpl.h"
+#include "storage/Devices/MdImpl.h"
+#include "storage/Devices/BcacheImpl.h"
 #include "storage/Prober.h"
 
 
 namespace storage
 {
 
+    using namespace std;
+
+
+    namespace
+    {
+
+	int
+	read_ext_range(const string& short_name)
+	{
+	    ifstream s(SYSFS_DIR "/block/" + short_name + "/ext_range");
+
+	    int ext_range = 0;
+	    s >> ext_range;
+
+	    return ext_range;
+	}
+
+
+	/**
+	 * Same decisions as probe_sys_block_entries() but only using
+	 * readdir, stat and reads of sysfs attributes, so no process is
+	 * started and no udev settle is done. Returns as soon as the first
+	 * disk or DASD is found.
+	 */
+	bool
+	light_probe_sysfs()
+	{
+	    unique_ptr<DIR, int (*)(DIR*)> dir(opendir(SYSFS_DIR "/block"), closedir);
+	    if (!dir)
+		ST_THROW(IOException(sformat("opendir of '%s' failed, %s", SYSFS_DIR "/block",
+					     strerror(errno))));
+
+	    while (const struct dirent* entry = readdir(dir.get()))
+	    {
+		const string short_name = entry->d_name;
+
+		if (short_name == "." || short_name == "..")
+		    continue;
+
+		if (boost::starts_with(short_name, "loop") || boost::starts_with(short_name, "dm-"))
+		    continue;
+
+		const string name = DEV_DIR "/" + short_name;
+
+		if (Md::Impl::is_valid_sysfs_name(name) || Bcache::Impl::is_valid_name(name))
+		    continue;
+
+		// skip devices without node in /dev (bsc #1076971)
+		struct stat st;
+		if (stat(name.c_str(), &st) != 0 || !S_ISBLK(st.st_mode))
+		    continue;
+
+		// Disks, DASDs and xvd* devices all need an ext_range
+		// greater than one. S/390 virtio-blk devices with a DASD
+		// partition table are not special cased since that needs
+		// parted and they are found as disks anyway.
+
+		if (read_ext_range(short_name) > 1)
+		{
+		    y2mil("light probe found " << name);
+		    return true;
+		}
+	    }
+
+	    return false;
+	}
+
+    }
+
+
     bool
     light_probe()
     {
+	if (Mockup::get_mode() == Mockup::Mode::NONE && !get_remote_callbacks())
+	    return light_probe_sysfs();
+
 	SystemInfo::Impl system_info;
 
 	SysBlockEntries sys_block_entries = probe_sys_block_entries(system_info);
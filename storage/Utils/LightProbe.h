@@ -32,6 +32,9 @@ namespace storage
      * disks or DASDs were found in the system. No devicegraph is generated.
      * The exact type of devices probed may change.
      *
+     * Unless mockup or remote callbacks are used only sysfs is read, so
+     * no programs are run and no udev settle is done.
+     *
      * @throw Exception
      */
     bool light_probe();
@@ -20,6 +20,8 @@
  */
 
 
+#include <algorithm>
+
 #include "storage/Utils/LinesIterator.h"
 #include "storage/Utils/ExceptionImpl.h"
 
@@ -46,4 +48,49 @@ namespace storage
 	return *it++;
     }
 
+
+    void
+    LinesView::const_iterator::update()
+    {
+	if (pos >= buffer.size())
+	{
+	    line = std::string_view();
+	    return;
+	}
+
+	std::string_view::size_type eol = buffer.find('\n', pos);
+	if (eol == std::string_view::npos)
+	    eol = buffer.size();
+
+	line = buffer.substr(pos, eol - pos);
+    }
+
+
+    LinesView::const_iterator&
+    LinesView::const_iterator::operator++()
+    {
+	pos = std::min(pos + line.size() + 1, buffer.size());
+	update();
+	return *this;
+    }
+
+
+    size_t
+    LinesView::size() const
+    {
+	return std::distance(begin(), end());
+    }
+
+
+    vector<string>
+    LinesView::to_vector() const
+    {
+	vector<string> ret;
+
+	for (std::string_view line : *this)
+	    ret.emplace_back(line);
+
+	return ret;
+    }
+
 }
@@ -25,7 +25,9 @@
 
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <iterator>
 
 
 namespace storage
@@ -56,6 +58,73 @@ namespace storage
 
     };
 
+
+    /**
+     * Lazy view of the lines in a buffer, e.g. the output of a command. Iterating
+     * yields string_views of the lines (without the newline) into the buffer, so
+     * no line is copied. The buffer must outlive the view. As with the line
+     * splitting in SystemCmd a final newline does not start an empty line.
+     */
+    class LinesView
+    {
+
+    public:
+
+	LinesView(std::string_view buffer) : buffer(buffer) {}
+
+	class const_iterator
+	{
+
+	public:
+
+	    typedef std::forward_iterator_tag iterator_category;
+	    typedef std::string_view value_type;
+	    typedef std::ptrdiff_t difference_type;
+	    typedef const std::string_view* pointer;
+	    typedef const std::string_view& reference;
+
+	    const_iterator(std::string_view buffer, std::string_view::size_type pos)
+		: buffer(buffer), pos(pos) { update(); }
+
+	    reference operator*() const { return line; }
+	    pointer operator->() const { return &line; }
+
+	    const_iterator& operator++();
+
+	    bool operator==(const const_iterator& rhs) const { return pos == rhs.pos; }
+	    bool operator!=(const const_iterator& rhs) const { return pos != rhs.pos; }
+
+	private:
+
+	    void update();
+
+	    std::string_view buffer;
+	    std::string_view::size_type pos;
+	    std::string_view line;
+
+	};
+
+	const_iterator begin() const { return const_iterator(buffer, 0); }
+	const_iterator end() const { return const_iterator(buffer, buffer.size()); }
+
+	bool empty() const { return buffer.empty(); }
+
+	/**
+	 * Count the lines. Needs a pass over the buffer.
+	 */
+	size_t size() const;
+
+	/**
+	 * Copy the lines into a vector.
+	 */
+	vector<string> to_vector() const;
+
+    private:
+
+	std::string_view buffer;
+
+    };
+
 }
 
 
@@ -29,6 +29,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdlib.h>
+#include <mutex>
 
 #include "storage/Utils/LoggerImpl.h"
 #include "storage/Utils/LockImpl.h"
@@ -45,6 +46,9 @@ namespace storage
 
     int Lock::fd = -1;
 
+    // Storage objects may be created and destroyed in several threads.
+    static std::mutex locks_mutex;
+
 
     Lock::Lock(bool read_only, bool disable, const string& lockfile_root)
 	: read_only(read_only), disabled(disable)
@@ -54,6 +58,8 @@ namespace storage
 
 	y2mil("getting " << (read_only ? "read-only" : "read-write") << " lock");
 
+	std::lock_guard<std::mutex> lock_guard(locks_mutex);
+
 	if (locks.empty())
 	{
 	    // If there are no locks within the same process try to take the
@@ -139,6 +145,8 @@ namespace storage
 	if (disabled)
 	    return;
 
+	std::lock_guard<std::mutex> lock_guard(locks_mutex);
+
 	// Remove this lock from the list of locks in the same process.
 
 	erase(locks, this);
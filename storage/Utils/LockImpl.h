@@ -41,8 +41,8 @@ namespace storage
      * Implement a system-wide read-only or read-write lock.
      *
      * Implemented using traditional ("process-associated") locks (for locks
-     * across processes) and a global list (for locks within a single
-     * process).
+     * across processes) and a global list protected by a mutex (for locks
+     * within a single process).
      *
      * An implementation using only open file descriptor (OFD) locks would be
      * simpler but does not provide the pid of the process holding a lock.
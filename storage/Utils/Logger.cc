@@ -28,8 +28,10 @@
 #include <sys/stat.h>
 
 #include <iostream>
+#include <atomic>
 
 #include "storage/Utils/Logger.h"
+#include "storage/Utils/AsyncLogger.h"
 #include "storage/Utils/AppUtil.h"
 
 
@@ -39,7 +41,8 @@ namespace storage
     typedef typename std::underlying_type<LogLevel>::type log_level_underlying_type;
 
 
-    static Logger* current_logger = nullptr;
+    // Atomic since the logger may be used from several threads.
+    static std::atomic<Logger*> current_logger(nullptr);
 
 
     Logger*
@@ -152,6 +155,33 @@ namespace storage
     }
 
 
+    Logger*
+    get_async_logfile_logger(const string& filename)
+    {
+	static AsyncLogger async_logfile_logger(filename);
+
+	return &async_logfile_logger;
+    }
+
+
+    Logger*
+    get_json_logfile_logger(const string& filename)
+    {
+	static JsonLogger json_logfile_logger(filename);
+
+	return &json_logfile_logger;
+    }
+
+
+    void
+    flush_logger()
+    {
+	AsyncLogger* async_logger = dynamic_cast<AsyncLogger*>(current_logger.load());
+	if (async_logger)
+	    async_logger->flush();
+    }
+
+
     Silencer::Silencer()
 	: active(false)
     {
@@ -187,6 +217,13 @@ namespace storage
     }
 
 
-    int Silencer::count = 0;
+    bool
+    Silencer::is_any_active()
+    {
+	return count > 0;
+    }
+
+
+    thread_local int Silencer::count = 0;
 
 }
@@ -70,7 +70,8 @@ namespace storage
 
     /**
      * Set the current logger object. The logger object must be valid until
-     * replaced by another logger object.
+     * replaced by another logger object. The logger is shared by all
+     * threads and must be thread-safe if several threads use libstorage.
      */
     void set_logger(Logger* logger);
 
@@ -93,8 +94,46 @@ namespace storage
     Logger* get_logfile_logger(const std::string& filename = "/var/log/libstorage.log");
 
 
+    /**
+     * Returns a Logger that logs to the standard libstorage log file
+     * ("/var/log/libstorage.log") or to a given file like the logger
+     * returned by get_logfile_logger(). The log lines are written by a
+     * background thread in batches, so logging only blocks the caller if
+     * many log lines are queued. Use flush_logger() to wait until all
+     * queued log lines are written.
+     *
+     * Note that this method only uses the given filename the first time
+     * it is called.
+     */
+    Logger* get_async_logfile_logger(const std::string& filename = "/var/log/libstorage.log");
+
+
+    /**
+     * Returns a Logger that logs JSON lines to "/var/log/libstorage.json"
+     * or to a given file. Every line is a JSON object with the time, log
+     * level, file, line, function, thread id, the correlation id of the
+     * current probe, commit or action and the message. Executed commands
+     * are logged as one record including exit code, stdout and stderr.
+     * Like the logger returned by get_async_logfile_logger() the lines
+     * are written by a background thread.
+     *
+     * Note that this method only uses the given filename the first time
+     * it is called.
+     */
+    Logger* get_json_logfile_logger(const std::string& filename = "/var/log/libstorage.json");
+
+
+    /**
+     * Wait until all log lines queued so far by the current logger are
+     * written. Only has an effect for the loggers returned by
+     * get_async_logfile_logger() and get_json_logfile_logger().
+     */
+    void flush_logger();
+
+
     /**
      * Class to make some exceptions log-level DEBUG instead of WARNING.
+     * Only affects the current thread.
      */
     class Silencer
     {
@@ -107,13 +146,16 @@ namespace storage
 	void turn_on();
 	void turn_off();
 
-	static bool is_any_active() { return count > 0; }
+	/**
+	 * Whether a Silencer is active in the current thread.
+	 */
+	static bool is_any_active();
 
     private:
 
 	bool active;
 
-	static int count;
+	static thread_local int count;
 
     };
 
@@ -21,7 +21,12 @@
  */
 
 
+#include <atomic>
+#include <mutex>
+#include <set>
+
 #include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/AsyncLogger.h"
 
 
 namespace storage
@@ -67,8 +72,16 @@ namespace storage
     close_log_stream(LogLevel log_level, const char* file, unsigned line, const char* func,
 		     ostringstream* stream)
     {
+	// The AsyncLogger takes the whole message and splits it into lines
+	// in its background thread.
+
 	Logger* logger = get_logger();
-	if (logger)
+	AsyncLogger* async_logger = dynamic_cast<AsyncLogger*>(logger);
+	if (async_logger)
+	{
+	    async_logger->write_message(log_level, component.c_str(), file, line, func, stream->str());
+	}
+	else if (logger)
 	{
 	    string content = stream->str();
 	    string::size_type pos1 = 0;
@@ -87,4 +100,78 @@ namespace storage
 	delete stream;
     }
 
+
+    const char*
+    intern_log_string(const string& s)
+    {
+	static std::mutex mutex;
+	static set<string> strings;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return strings.insert(s).first->c_str();
+    }
+
+
+    bool
+    query_log_command(LogLevel log_level)
+    {
+	Logger* logger = get_logger();
+	if (logger && dynamic_cast<JsonLogger*>(logger))
+	{
+	    return logger->test(log_level, component);
+	}
+
+	return false;
+    }
+
+
+    void
+    log_command(LogLevel log_level, const char* file, unsigned line, const char* func,
+		LogCommand&& log_command)
+    {
+	JsonLogger* json_logger = dynamic_cast<JsonLogger*>(get_logger());
+	if (json_logger)
+	    json_logger->write_command(log_level, component.c_str(), file, line, func, std::move(log_command));
+    }
+
+
+    namespace
+    {
+
+	thread_local string current_correlation_id;
+
+	atomic<unsigned int> next_correlation_number(1);
+
+    }
+
+
+    LogCorrelation::LogCorrelation(const char* kind)
+	: previous(current_correlation_id)
+    {
+	string id = kind + string("-") + to_string(next_correlation_number++);
+
+	current_correlation_id = previous.empty() ? id : previous + "/" + id;
+    }
+
+
+    LogCorrelation::~LogCorrelation()
+    {
+	current_correlation_id = previous;
+    }
+
+
+    const string&
+    LogCorrelation::get_current()
+    {
+	return current_correlation_id;
+    }
+
+
+    void
+    LogCorrelation::set_current(const string& id)
+    {
+	current_correlation_id = id;
+    }
+
 }
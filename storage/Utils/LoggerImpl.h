@@ -37,9 +37,65 @@ namespace storage
 
     std::ostringstream* open_log_stream();
 
+    /**
+     * The strings file and func must be valid for the lifetime of the
+     * process, e.g. literals, see intern_log_string().
+     */
     void close_log_stream(LogLevel log_level, const char* file, unsigned line,
 			  const char* func, std::ostringstream*);
 
+    /**
+     * Return a copy of the string that is valid for the lifetime of the
+     * process. Used for file and function names that are not literals.
+     * Every distinct string is kept, so only use it for a small set of
+     * strings.
+     */
+    const char* intern_log_string(const std::string& s);
+
+    struct LogCommand;
+
+    /**
+     * Whether commands are logged with a structured record by
+     * log_command() instead of log lines. Only the JSON logger takes
+     * structured records.
+     */
+    bool query_log_command(LogLevel log_level);
+
+    void log_command(LogLevel log_level, const char* file, unsigned line, const char* func,
+		     LogCommand&& log_command);
+
+
+    /**
+     * Sets a new correlation id for the log records of the current thread
+     * for the lifetime of the object, e.g. for a probe, a commit or an
+     * action. The id is nested in the id of the enclosing object, e.g.
+     * "commit-2/action-7". Only the JSON logger writes the correlation id.
+     */
+    class LogCorrelation
+    {
+    public:
+
+	LogCorrelation(const char* kind);
+	~LogCorrelation();
+
+	LogCorrelation(const LogCorrelation&) = delete;
+	LogCorrelation& operator=(const LogCorrelation&) = delete;
+
+	static const std::string& get_current();
+
+	/**
+	 * Set the correlation id of the current thread, e.g. for worker
+	 * threads to take over the id of the spawning thread.
+	 */
+	static void set_current(const std::string& id);
+
+    private:
+
+	const std::string previous;
+
+    };
+
+
 #define y2deb(op) y2log_op(storage::LogLevel::DEBUG, __FILE__, __LINE__, __FUNCTION__, op)
 #define y2mil(op) y2log_op(storage::LogLevel::MILESTONE, __FILE__, __LINE__, __FUNCTION__, op)
 #define y2war(op) y2log_op(storage::LogLevel::WARNING, __FILE__, __LINE__, __FUNCTION__, op)
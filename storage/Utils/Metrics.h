@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_METRICS_H
+#define STORAGE_METRICS_H
+
+
+#include <string>
+#include <vector>
+#include <map>
+
+
+namespace storage
+{
+
+    /**
+     * A histogram in a metrics snapshot. Like in Prometheus the buckets
+     * are cumulative: bucket_counts[i] is the number of observations less
+     * than or equal to bucket_bounds[i]. Observations greater than the
+     * last bound are only included in count.
+     */
+    class MetricsHistogram
+    {
+    public:
+
+	std::vector<double> bucket_bounds;
+	std::vector<unsigned long long> bucket_counts;
+
+	unsigned long long count = 0;
+	double sum = 0.0;
+
+    };
+
+
+    /**
+     * A snapshot of the runtime metrics of the library.
+     *
+     * The names follow the Prometheus conventions, with labels included in
+     * the name, e.g. 'commands_total{tool="parted"}'. Durations are in
+     * seconds.
+     *
+     * Counters:
+     *  - commands_total{tool="..."}: Commands run, including commands
+     *    replayed from a mockup.
+     *  - command_output_bytes_total: Bytes of stdout and stderr of commands.
+     *  - devicegraph_copies_total: Copies of devicegraphs.
+     *  - device_clones_total, holder_clones_total: Devices and holders
+     *    cloned while copying devicegraphs.
+     *  - find_vertex_total: Lookups of devices by sid.
+     *  - device_lookups_total{function="..."}: Lookups of devices with
+     *    find_by_name, find_by_uuid and find_by_any_name, e.g. via
+     *    BlkDevice::find_by_name().
+     *  - actions_committed_total{type="..."}: Actions committed, by type
+     *    of the action, e.g. Create or Mount.
+     *
+     * Histograms:
+     *  - command_duration_seconds: Runtime of commands.
+     *  - udev_settle_duration_seconds: Time spent in 'udevadm settle'.
+     *
+     * The metrics are global for the process and are never reset.
+     */
+    class MetricsSnapshot
+    {
+    public:
+
+	std::map<std::string, unsigned long long> counters;
+	std::map<std::string, MetricsHistogram> histograms;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#include <algorithm>
+#include <mutex>
+
+#include "storage/Utils/MetricsImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	std::mutex registry_mutex;
+
+	map<string, unique_ptr<MetricsCounter>> counters;
+
+	map<string, unique_ptr<MetricsHistogramImpl>> histograms;
+
+    }
+
+
+    MetricsCounter&
+    MetricsCounterFamily::counter(const string& value)
+    {
+	{
+	    std::shared_lock<std::shared_mutex> lock(mutex);
+
+	    map<string, MetricsCounter*>::const_iterator it = counters.find(value);
+	    if (it != counters.end())
+		return *it->second;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(mutex);
+
+	MetricsCounter*& counter = counters[value];
+	if (!counter)
+	    counter = &Metrics::counter(name + "{" + label + "=\"" + value + "\"}");
+
+	return *counter;
+    }
+
+
+    MetricsHistogramImpl::MetricsHistogramImpl(const vector<double>& bucket_bounds)
+	: bucket_bounds(bucket_bounds),
+	  bucket_counts(new std::atomic<unsigned long long>[bucket_bounds.size() + 1])
+    {
+	for (size_t i = 0; i < bucket_bounds.size() + 1; ++i)
+	    bucket_counts[i] = 0;
+    }
+
+
+    void
+    MetricsHistogramImpl::observe(double value)
+    {
+	size_t i = lower_bound(bucket_bounds.begin(), bucket_bounds.end(), value) - bucket_bounds.begin();
+	bucket_counts[i].fetch_add(1, memory_order_relaxed);
+
+	count.fetch_add(1, memory_order_relaxed);
+
+	double old_sum = sum.load(memory_order_relaxed);
+	while (!sum.compare_exchange_weak(old_sum, old_sum + value, memory_order_relaxed))
+	    ;
+    }
+
+
+    MetricsHistogram
+    MetricsHistogramImpl::snapshot() const
+    {
+	MetricsHistogram ret;
+
+	ret.bucket_bounds = bucket_bounds;
+
+	unsigned long long cumulative = 0;
+	for (size_t i = 0; i < bucket_bounds.size(); ++i)
+	{
+	    cumulative += bucket_counts[i].load(memory_order_relaxed);
+	    ret.bucket_counts.push_back(cumulative);
+	}
+
+	// Without a lock the count can be behind the buckets.
+
+	ret.count = max(cumulative + bucket_counts[bucket_bounds.size()].load(memory_order_relaxed),
+			count.load(memory_order_relaxed));
+	ret.sum = sum.load(memory_order_relaxed);
+
+	return ret;
+    }
+
+
+    const vector<double> Metrics::default_duration_bounds = {
+	0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0
+    };
+
+
+    MetricsCounter&
+    Metrics::counter(const string& name)
+    {
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	unique_ptr<MetricsCounter>& counter = counters[name];
+	if (!counter)
+	    counter = make_unique<MetricsCounter>();
+
+	return *counter;
+    }
+
+
+    MetricsHistogramImpl&
+    Metrics::histogram(const string& name, const vector<double>& bucket_bounds)
+    {
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	unique_ptr<MetricsHistogramImpl>& histogram = histograms[name];
+	if (!histogram)
+	    histogram = make_unique<MetricsHistogramImpl>(bucket_bounds);
+
+	return *histogram;
+    }
+
+
+    MetricsSnapshot
+    Metrics::snapshot()
+    {
+	MetricsSnapshot ret;
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	for (const map<string, unique_ptr<MetricsCounter>>::value_type& key_value : counters)
+	    ret.counters[key_value.first] = key_value.second->get();
+
+	for (const map<string, unique_ptr<MetricsHistogramImpl>>::value_type& key_value : histograms)
+	    ret.histograms[key_value.first] = key_value.second->snapshot();
+
+	return ret;
+    }
+
+}
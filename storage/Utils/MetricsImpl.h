@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_METRICS_IMPL_H
+#define STORAGE_METRICS_IMPL_H
+
+
+#include <atomic>
+#include <memory>
+#include <map>
+#include <shared_mutex>
+#include <boost/noncopyable.hpp>
+
+#include "storage/Utils/Metrics.h"
+
+
+namespace storage
+{
+    using std::string;
+    using std::vector;
+
+
+    /**
+     * A counter. Incrementing is lock-free.
+     */
+    class MetricsCounter : private boost::noncopyable
+    {
+    public:
+
+	void increment(unsigned long long n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+
+	unsigned long long get() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+
+	std::atomic<unsigned long long> value { 0 };
+
+    };
+
+
+    /**
+     * A histogram with fixed bucket bounds. Observing is lock-free.
+     */
+    class MetricsHistogramImpl : private boost::noncopyable
+    {
+    public:
+
+	MetricsHistogramImpl(const vector<double>& bucket_bounds);
+
+	void observe(double value);
+
+	MetricsHistogram snapshot() const;
+
+    private:
+
+	const vector<double> bucket_bounds;
+
+	/**
+	 * Not cumulative, one more than bucket_bounds for observations above
+	 * the last bound.
+	 */
+	std::unique_ptr<std::atomic<unsigned long long>[]> bucket_counts;
+
+	std::atomic<unsigned long long> count { 0 };
+	std::atomic<double> sum { 0.0 };
+
+    };
+
+
+    /**
+     * Counters with the same name and one label, e.g.
+     * commands_total{tool="parted"}. Looking up the counter of a known
+     * label value only takes a shared lock of the family, not the mutex of
+     * the registry.
+     */
+    class MetricsCounterFamily : private boost::noncopyable
+    {
+    public:
+
+	MetricsCounterFamily(const string& name, const string& label)
+	    : name(name), label(label) {}
+
+	MetricsCounter& counter(const string& value);
+
+    private:
+
+	const string name;
+	const string label;
+
+	std::shared_mutex mutex;
+
+	std::map<string, MetricsCounter*> counters;
+
+    };
+
+
+    /**
+     * Registry of the metrics of the process.
+     *
+     * Looking up a metric by name takes a mutex. Callers on hot paths
+     * should keep the returned reference, e.g. in a static variable, which
+     * is valid for the lifetime of the process, or use a
+     * MetricsCounterFamily.
+     */
+    class Metrics
+    {
+    public:
+
+	static MetricsCounter& counter(const string& name);
+
+	/**
+	 * Return the histogram with the name. The bucket bounds are only
+	 * used when the histogram is created. The default bounds are
+	 * suitable for durations in seconds.
+	 */
+	static MetricsHistogramImpl& histogram(const string& name, const vector<double>& bucket_bounds =
+					       default_duration_bounds);
+
+	static MetricsSnapshot snapshot();
+
+	static const vector<double> default_duration_bounds;
+
+    };
+
+}
+
+#endif
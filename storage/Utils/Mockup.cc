@@ -21,7 +21,13 @@
  */
 
 
+#include <math.h>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
 #include "storage/Utils/Mockup.h"
+#include "storage/Utils/MockupBinary.h"
 #include "storage/Utils/XmlFile.h"
 #include "storage/Utils/ExceptionImpl.h"
 #include "storage/Utils/LoggerImpl.h"
@@ -31,9 +37,69 @@
 namespace storage
 {
 
+    string_view
+    Mockup::Lines::operator[](size_t i) const
+    {
+	if (lines)
+	    return (*lines)[i];
+
+	return string_view(pool + spans[2 * i], spans[2 * i + 1]);
+    }
+
+
+    vector<string>
+    Mockup::Lines::to_vector() const
+    {
+	if (lines)
+	    return *lines;
+
+	vector<string> ret;
+	ret.reserve(n);
+
+	for (size_t i = 0; i < n; ++i)
+	    ret.emplace_back((*this)[i]);
+
+	return ret;
+    }
+
+
+    string_view
+    Mockup::Lines::buffer() const
+    {
+	if (!pool)
+	    ST_THROW(Exception("lines have no buffer"));
+
+	if (n == 0)
+	    return string_view(pool, 0);
+
+	return string_view(pool + spans[0], spans[2 * n - 2] + spans[2 * n - 1] + 1 - spans[0]);
+    }
+
+
     void
     Mockup::load(const string& filename)
     {
+	State& current = state();
+
+	if (MockupBinary::is_binary(filename))
+	{
+	    if (current.binary)
+		ST_THROW(Exception("binary mockup already loaded"));
+
+	    current.binary = std::make_unique<const MockupBinary>(filename);
+
+	    return;
+	}
+
+	load_xml(filename);
+    }
+
+
+    void
+    Mockup::load_xml(const string& filename)
+    {
+	State& current = state();
+
 	XmlFile xml(filename);
 
 	const xmlNode* root_node = xml.getRootElement();
@@ -60,6 +126,11 @@ namespace storage
 		getChildValue(command_node, "stderr", command.stderr);
 		getChildValue(command_node, "exit-code", command.exit_code);
 
+		// The latency is saved in microseconds.
+		unsigned long long latency_us = 0;
+		getChildValue(command_node, "latency", latency_us);
+		const double latency = latency_us * 1e-6;
+
 #ifdef OCCAMS_RAZOR
 		// Unfortunately the check is not so effective as one
 		// might expected since the output of udevadm info is
@@ -68,7 +139,7 @@ namespace storage
 
 		if (command.stdout.size() > threshold)
 		{
-		    for (const map<string, Command>::value_type& tmp : commands)
+		    for (const map<string, Command>::value_type& tmp : current.commands)
 		    {
 			if (tmp.second == command)
 			{
@@ -81,8 +152,11 @@ namespace storage
 
 		for (const string& name : names)
 		{
-		    if (!commands.emplace(name, command).second)
+		    if (!current.commands.emplace(name, command).second)
 			ST_THROW(Exception(sformat("command \"%s\" already loaded for mockup", name)));
+
+		    if (latency > 0.0)
+			current.command_latencies[name] = latency;
 		}
 	    }
 	}
@@ -101,10 +175,15 @@ namespace storage
 		File file;
 		getChildValue(file_node, "content", file.content);
 
+		// The latency is saved in microseconds.
+		unsigned long long latency_us = 0;
+		getChildValue(file_node, "latency", latency_us);
+		const double latency = latency_us * 1e-6;
+
 #ifdef OCCAMS_RAZOR
 		if (file.content.size() > threshold)
 		{
-		    for (const map<string, File>::value_type& tmp : files)
+		    for (const map<string, File>::value_type& tmp : current.files)
 		    {
 			if (tmp.second == file)
 			{
@@ -117,8 +196,11 @@ namespace storage
 
 		for (const string& name : names)
 		{
-		    if (!files.emplace(name, file).second)
+		    if (!current.files.emplace(name, file).second)
 			ST_THROW(Exception(sformat("file \"%s\" already loaded for mockup", name)));
+
+		    if (latency > 0.0)
+			current.file_latencies[name] = latency;
 		}
 	    }
 	}
@@ -136,6 +218,9 @@ namespace storage
 	xmlNode* comment = xmlNewComment(string(" " + generated_string() + " ").c_str());
 	xmlAddPrevSibling(mockup_node, comment);
 
+	const map<string, Command> commands = all_commands();
+	const map<string, File> files = all_files();
+
 	if (!commands.empty())
 	{
 	    xmlNode* commands_node = xmlNewChild(mockup_node, "Commands");
@@ -148,6 +233,9 @@ namespace storage
 		setChildValue(command_node, "stdout", it.second.stdout);
 		setChildValue(command_node, "stderr", it.second.stderr);
 		setChildValueIf(command_node, "exit-code", it.second.exit_code, it.second.exit_code != 0);
+
+		const unsigned long long latency_us = llround(get_command_latency(it.first) * 1e6);
+		setChildValueIf(command_node, "latency", latency_us, latency_us > 0);
 	    }
 	}
 
@@ -161,6 +249,9 @@ namespace storage
 
 		setChildValue(file_node, "name", it.first);
 		setChildValue(file_node, "content", it.second.content);
+
+		const unsigned long long latency_us = llround(get_file_latency(it.first) * 1e6);
+		setChildValueIf(file_node, "latency", latency_us, latency_us > 0);
 	    }
 	}
 
@@ -168,75 +259,351 @@ namespace storage
     }
 
 
+    void
+    Mockup::save_binary(const string& filename)
+    {
+	const map<string, Command> commands = all_commands();
+	const map<string, File> files = all_files();
+
+	map<string, double> command_latencies;
+	for (const map<string, Command>::value_type& it : commands)
+	    command_latencies[it.first] = get_command_latency(it.first);
+
+	map<string, double> file_latencies;
+	for (const map<string, File>::value_type& it : files)
+	    file_latencies[it.first] = get_file_latency(it.first);
+
+	MockupBinary::save(filename, commands, command_latencies, files, file_latencies);
+    }
+
+
+    double
+    Mockup::get_command_latency(const string& name)
+    {
+	State& current = state();
+
+	if (current.commands.find(name) != current.commands.end())
+	{
+	    map<string, double>::const_iterator it = current.command_latencies.find(name);
+	    return it != current.command_latencies.end() ? it->second : 0.0;
+	}
+
+	if (current.binary && current.erased_commands.count(name) == 0)
+	{
+	    const MockupBinary::Entry* entry = current.binary->find(MockupBinary::Kind::COMMAND, name);
+	    if (entry)
+		return current.binary->latency(*entry);
+	}
+
+	return 0.0;
+    }
+
+
+    double
+    Mockup::get_file_latency(const string& name)
+    {
+	State& current = state();
+
+	if (current.files.find(name) != current.files.end())
+	{
+	    map<string, double>::const_iterator it = current.file_latencies.find(name);
+	    return it != current.file_latencies.end() ? it->second : 0.0;
+	}
+
+	if (current.binary && current.erased_files.count(name) == 0)
+	{
+	    const MockupBinary::Entry* entry = current.binary->find(MockupBinary::Kind::FILE, name);
+	    if (entry)
+		return current.binary->latency(*entry);
+	}
+
+	return 0.0;
+    }
+
+
+    void
+    Mockup::replay_latency(double latency)
+    {
+	State& current = state();
+
+	if (current.mode != Mode::PLAYBACK || current.latency_scale <= 0.0 || latency <= 0.0)
+	    return;
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(latency * current.latency_scale));
+    }
+
+
+    void
+    Mockup::clear()
+    {
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	current.commands.clear();
+	current.files.clear();
+
+	current.command_latencies.clear();
+	current.file_latencies.clear();
+
+	current.binary.reset();
+
+	current.erased_commands.clear();
+	current.erased_files.clear();
+    }
+
+
+    map<string, Mockup::Command>
+    Mockup::all_commands()
+    {
+	State& current = state();
+
+	map<string, Command> ret = current.commands;
+
+	if (current.binary)
+	{
+	    for (size_t i = 0; i < current.binary->size(); ++i)
+	    {
+		const MockupBinary::Entry& entry = current.binary->entry(i);
+		if (entry.kind != MockupBinary::Kind::COMMAND)
+		    continue;
+
+		const string name(current.binary->name(entry));
+		if (current.erased_commands.count(name) == 0)
+		    ret.emplace(name, current.binary->command(entry));
+	    }
+	}
+
+	return ret;
+    }
+
+
+    map<string, Mockup::File>
+    Mockup::all_files()
+    {
+	State& current = state();
+
+	map<string, File> ret = current.files;
+
+	if (current.binary)
+	{
+	    for (size_t i = 0; i < current.binary->size(); ++i)
+	    {
+		const MockupBinary::Entry& entry = current.binary->entry(i);
+		if (entry.kind != MockupBinary::Kind::FILE)
+		    continue;
+
+		const string name(current.binary->name(entry));
+		if (current.erased_files.count(name) == 0)
+		    ret.emplace(name, current.binary->file(entry));
+	    }
+	}
+
+	return ret;
+    }
+
+
     bool
     Mockup::has_command(const string& name)
     {
-	return commands.find(name) != commands.end();
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	if (current.commands.find(name) != current.commands.end())
+	    return true;
+
+	return current.binary && current.erased_commands.count(name) == 0 &&
+	    current.binary->find(MockupBinary::Kind::COMMAND, name);
     }
 
 
     const Mockup::Command&
     Mockup::get_command(const string& name)
     {
-	map<string, Command>::const_iterator it = commands.find(name);
-	if (it == commands.end())
-	    ST_THROW(Exception("no mockup found for command '" + name + "'"));
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	map<string, Command>::const_iterator it = current.commands.find(name);
+	if (it == current.commands.end())
+	{
+	    // Entries of the current.binary mockup are copied on demand since a
+	    // reference is returned.
+
+	    const MockupBinary::Entry* entry = nullptr;
+	    if (current.binary && current.erased_commands.count(name) == 0)
+		entry = current.binary->find(MockupBinary::Kind::COMMAND, name);
+
+	    if (!entry)
+		ST_THROW(Exception("no mockup found for command '" + name + "'"));
+
+	    it = current.commands.emplace(name, current.binary->command(*entry)).first;
+	}
 
 #ifdef OCCAMS_RAZOR
-	used_commands.insert(name);
+	current.used_commands.insert(name);
 #endif
 
 	return it->second;
     }
 
 
+    Mockup::CommandView
+    Mockup::get_command_view(const string& name)
+    {
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+#ifdef OCCAMS_RAZOR
+	current.used_commands.insert(name);
+#endif
+
+	map<string, Command>::const_iterator it = current.commands.find(name);
+	if (it != current.commands.end())
+	    return { it->second.stdout, it->second.stderr, it->second.exit_code, get_command_latency(name) };
+
+	if (current.binary && current.erased_commands.count(name) == 0)
+	{
+	    const MockupBinary::Entry* entry = current.binary->find(MockupBinary::Kind::COMMAND, name);
+	    if (entry)
+		return { current.binary->lines(*entry, 0), current.binary->lines(*entry, 1),
+			 entry->exit_code, current.binary->latency(*entry) };
+	}
+
+	ST_THROW(Exception("no mockup found for command '" + name + "'"));
+    }
+
+
     void
-    Mockup::set_command(const string& name, const Command& command)
+    Mockup::set_command(const string& name, const Command& command, double latency)
     {
-	commands[name] = command;
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	current.commands[name] = command;
+	current.erased_commands.erase(name);
+
+	if (latency > 0.0)
+	    current.command_latencies[name] = latency;
+	else
+	    current.command_latencies.erase(name);
     }
 
 
     void
     Mockup::erase_command(const string& name)
     {
-	commands.erase(name);
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	current.commands.erase(name);
+	current.command_latencies.erase(name);
+	if (current.binary)
+	    current.erased_commands.insert(name);
     }
 
 
     bool
     Mockup::has_file(const string& name)
     {
-	return files.find(name) != files.end();
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	if (current.files.find(name) != current.files.end())
+	    return true;
+
+	return current.binary && current.erased_files.count(name) == 0 &&
+	    current.binary->find(MockupBinary::Kind::FILE, name);
     }
 
 
     const Mockup::File&
     Mockup::get_file(const string& name)
     {
-	map<string, File>::const_iterator it = files.find(name);
-	if (it == files.end())
-	    ST_THROW(Exception("no mockup found for file '" + name + "'"));
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	map<string, File>::const_iterator it = current.files.find(name);
+	if (it == current.files.end())
+	{
+	    const MockupBinary::Entry* entry = nullptr;
+	    if (current.binary && current.erased_files.count(name) == 0)
+		entry = current.binary->find(MockupBinary::Kind::FILE, name);
+
+	    if (!entry)
+		ST_THROW(Exception("no mockup found for file '" + name + "'"));
+
+	    it = current.files.emplace(name, current.binary->file(*entry)).first;
+	}
 
 #ifdef OCCAMS_RAZOR
-	used_files.insert(name);
+	current.used_files.insert(name);
 #endif
 
 	return it->second;
     }
 
 
+    Mockup::FileView
+    Mockup::get_file_view(const string& name)
+    {
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+#ifdef OCCAMS_RAZOR
+	current.used_files.insert(name);
+#endif
+
+	map<string, File>::const_iterator it = current.files.find(name);
+	if (it != current.files.end())
+	    return { it->second.content, get_file_latency(name) };
+
+	if (current.binary && current.erased_files.count(name) == 0)
+	{
+	    const MockupBinary::Entry* entry = current.binary->find(MockupBinary::Kind::FILE, name);
+	    if (entry)
+		return { current.binary->lines(*entry, 0), current.binary->latency(*entry) };
+	}
+
+	ST_THROW(Exception("no mockup found for file '" + name + "'"));
+    }
+
+
     void
-    Mockup::set_file(const string& name, const File& file)
+    Mockup::set_file(const string& name, const File& file, double latency)
     {
-	files[name] = file;
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	current.files[name] = file;
+	current.erased_files.erase(name);
+
+	if (latency > 0.0)
+	    current.file_latencies[name] = latency;
+	else
+	    current.file_latencies.erase(name);
     }
 
 
     void
     Mockup::erase_file(const string& name)
     {
-	files.erase(name);
+	State& current = state();
+
+	std::lock_guard<std::mutex> lock(current.mutex);
+
+	current.files.erase(name);
+	current.file_latencies.erase(name);
+	if (current.binary)
+	    current.erased_files.insert(name);
     }
 
 
@@ -245,20 +612,22 @@ namespace storage
     {
 #ifdef OCCAMS_RAZOR
 
+	State& current = state();
+
 	bool ok = true;
 
-	for (const map<string, Command>::value_type& tmp : commands)
+	for (const map<string, Command>::value_type& tmp : all_commands())
 	{
-	    if (used_commands.count(tmp.first) == 0)
+	    if (current.used_commands.count(tmp.first) == 0)
 	    {
 		y2err("unused command mockup '" << tmp.first << "'");
 		ok = false;
 	    }
 	}
 
-	for (const map<string, File>::value_type& tmp : files)
+	for (const map<string, File>::value_type& tmp : all_files())
 	{
-	    if (used_files.count(tmp.first) == 0)
+	    if (current.used_files.count(tmp.first) == 0)
 	    {
 		y2err("unused file mockup '" << tmp.first << "'");
 		ok = false;
@@ -272,14 +641,32 @@ namespace storage
     }
 
 
-    Mockup::Mode Mockup::mode = Mockup::Mode::NONE;
+    Mockup::State::State()
+    {
+    }
 
-    map<string, Mockup::Command> Mockup::commands;
-    map<string, Mockup::File> Mockup::files;
 
-#ifdef OCCAMS_RAZOR
-    set<string> Mockup::used_commands;
-    set<string> Mockup::used_files;
-#endif
+    Mockup::State::~State()
+    {
+    }
+
+
+    Mockup::Guard::Guard(const std::shared_ptr<State>& state)
+	: previous(current_state)
+    {
+	if (state)
+	    current_state = state;
+    }
+
+
+    Mockup::Guard::~Guard()
+    {
+	current_state = previous;
+    }
+
+
+    thread_local std::shared_ptr<Mockup::State> Mockup::current_state;
+
+    Mockup::State Mockup::default_state;
 
 }
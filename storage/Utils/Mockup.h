@@ -26,8 +26,13 @@
 
 
 #include <string>
+#include <string_view>
+#include <vector>
 #include <map>
 #include <set>
+#include <memory>
+#include <mutex>
+#include <cstdint>
 
 #include "storage/Utils/Remote.h"
 
@@ -47,10 +52,21 @@
 namespace storage
 {
     using std::string;
+    using std::string_view;
+    using std::vector;
     using std::map;
     using std::set;
 
 
+    class MockupBinary;
+
+
+    /**
+     * The mockup can be loaded from and saved to XML or a binary format,
+     * see MockupBinary. Entries set at runtime, e.g. during recording or
+     * by testsuites, take precedence over the entries of a loaded binary
+     * mockup.
+     */
     class Mockup
     {
     public:
@@ -58,41 +74,239 @@ namespace storage
 	typedef RemoteCommand Command;
 	typedef RemoteFile File;
 
+	/**
+	 * View of the lines of a command output or of a file content. The
+	 * lines either live in a vector or in the mmap'ed binary
+	 * mockup. In both cases the view is valid as long as the mockup
+	 * entry is neither changed nor erased.
+	 */
+	class Lines
+	{
+	public:
+
+	    Lines(const vector<string>& lines) : lines(&lines) {}
+	    Lines(const char* pool, const uint32_t* spans, size_t n) : pool(pool), spans(spans), n(n) {}
+
+	    size_t size() const { return lines ? lines->size() : n; }
+	    bool empty() const { return size() == 0; }
+
+	    string_view operator[](size_t i) const;
+
+	    vector<string> to_vector() const;
+
+	    /**
+	     * Whether the lines are also available as one buffer, only the
+	     * case for lines in the binary mockup.
+	     */
+	    bool has_buffer() const { return pool; }
+
+	    /**
+	     * Return the lines, each followed by a newline, as one buffer
+	     * without copying. Only available if has_buffer().
+	     */
+	    string_view buffer() const;
+
+	private:
+
+	    const vector<string>* lines = nullptr;
+
+	    const char* pool = nullptr;
+	    const uint32_t* spans = nullptr;
+	    size_t n = 0;
+
+	};
+
+	/**
+	 * The latency is the wall time in seconds the command or the read
+	 * of the file took while recording, zero if unknown.
+	 */
+	struct CommandView
+	{
+	    Lines stdout;
+	    Lines stderr;
+	    int exit_code;
+	    double latency;
+	};
+
+	struct FileView
+	{
+	    Lines content;
+	    double latency;
+	};
+
 	enum class Mode
 	{
 	    NONE, PLAYBACK, RECORD
 	};
 
-	static Mode get_mode() { return mode; }
-	static void set_mode(Mode mode) { Mockup::mode = mode; }
+	/**
+	 * All data of a mockup. A Storage probing from or recording to a
+	 * mockup has its own state. Probing makes it the current state of
+	 * the thread and it stays current, so that e.g. testsuites can modify
+	 * the mockup after probing. Without a current state the
+	 * process-wide default state is used.
+	 */
+	class State
+	{
+	public:
+
+	    State();
+	    ~State();
+
+	    State(const State&) = delete;
+	    State& operator=(const State&) = delete;
+
+	private:
+
+	    friend class Mockup;
+
+	    Mode mode = Mode::NONE;
+
+	    map<string, Command> commands;
+	    map<string, File> files;
+
+	    /**
+	     * Loaded binary mockup, if any.
+	     */
+	    std::unique_ptr<const MockupBinary> binary;
+
+	    /**
+	     * Entries of the binary mockup erased at runtime.
+	     */
+	    set<string> erased_commands;
+	    set<string> erased_files;
+
+	    /**
+	     * Latencies of the commands and files set at runtime.
+	     */
+	    map<string, double> command_latencies;
+	    map<string, double> file_latencies;
 
+	    double latency_scale = 0.0;
+
+	    // Commands may be recorded from several threads, e.g. when run
+	    // via the SystemCmdPool.
+	    std::mutex mutex;
+
+#ifdef OCCAMS_RAZOR
+	    set<string> used_commands;
+	    set<string> used_files;
+#endif
+
+	};
+
+	/**
+	 * Sets the state as the current state of the thread for the
+	 * lifetime of the object. With nullptr the current state is kept.
+	 */
+	class Guard
+	{
+	public:
+
+	    Guard(const std::shared_ptr<State>& state);
+	    ~Guard();
+
+	    Guard(const Guard&) = delete;
+	    Guard& operator=(const Guard&) = delete;
+
+	private:
+
+	    const std::shared_ptr<State> previous;
+
+	};
+
+	/**
+	 * Get the current state of the thread, nullptr if the default
+	 * state is used.
+	 */
+	static const std::shared_ptr<State>& get_current_state() { return current_state; }
+
+	/**
+	 * Set the current state of the thread, e.g. for worker threads to
+	 * take over the state of the spawning thread.
+	 */
+	static void set_current_state(const std::shared_ptr<State>& state) { current_state = state; }
+
+	static Mode get_mode() { return state().mode; }
+	static void set_mode(Mode mode) { state().mode = mode; }
+
+	/**
+	 * Load the mockup from the file. The format, XML or binary, is
+	 * detected from the content.
+	 */
 	static void load(const string& filename);
+
+	/**
+	 * Save the mockup in XML format.
+	 */
 	static void save(const string& filename);
 
+	/**
+	 * Save the mockup in binary format.
+	 */
+	static void save_binary(const string& filename);
+
+	/**
+	 * Drop all commands and files, including a loaded binary mockup.
+	 */
+	static void clear();
+
 	static bool has_command(const string& name);
 	static const Command& get_command(const string& name);
-	static void set_command(const string& name, const Command& command);
+	static void set_command(const string& name, const Command& command, double latency = 0.0);
 	static void erase_command(const string& name);
 
+	/**
+	 * Get the command output without copying it. Used for playback.
+	 */
+	static CommandView get_command_view(const string& name);
+
 	static bool has_file(const string& name);
 	static const File& get_file(const string& name);
-	static void set_file(const string& name, const File& file);
+	static void set_file(const string& name, const File& file, double latency = 0.0);
 	static void erase_file(const string& name);
 
+	/**
+	 * Get the file content without copying it. Used for playback.
+	 */
+	static FileView get_file_view(const string& name);
+
+	/**
+	 * Scale factor for the recorded latencies during playback. With zero,
+	 * the default, the latencies are not reproduced.
+	 */
+	static double get_latency_scale() { return state().latency_scale; }
+	static void set_latency_scale(double latency_scale) { state().latency_scale = latency_scale; }
+
+	/**
+	 * Sleep for the scaled latency if reproducing latencies is enabled.
+	 */
+	static void replay_latency(double latency);
+
 	static void occams_razor();
 
     private:
 
-	static Mode mode;
+	static thread_local std::shared_ptr<State> current_state;
+
+	static State default_state;
+
+	static State& state() { return current_state ? *current_state : default_state; }
 
-	static map<string, Command> commands;
-	static map<string, File> files;
+	static double get_command_latency(const string& name);
+	static double get_file_latency(const string& name);
+
+	static void load_xml(const string& filename);
+
+	/**
+	 * Get all commands and files, including the ones from the binary
+	 * mockup.
+	 */
+	static map<string, Command> all_commands();
+	static map<string, File> all_files();
 
 #ifdef OCCAMS_RAZOR
 	const static size_t threshold = 4;
-
-	static set<string> used_commands;
-	static set<string> used_files;
 #endif
 
     };
@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#include "storage/Utils/MockupBinary.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/Format.h"
+
+
+namespace storage
+{
+
+    using namespace std;
+
+
+    namespace
+    {
+
+	const char magic[8] = { 'L', 'S', 'N', 'G', 'M', 'O', 'C', 'K' };
+
+	const uint32_t version = 3;
+
+	const uint32_t byte_order = 0x01020304;
+
+
+	/**
+	 * Collects the strings and spans while saving. Identical strings are
+	 * only stored once.
+	 */
+	class Writer
+	{
+	public:
+
+	    uint32_t add_string(const string& s)
+	    {
+		spans.push_back({ add_to_pool(s), (uint32_t)(s.size()) });
+
+		return spans.size() - 1;
+	    }
+
+	    /**
+	     * The lines are stored joined, each followed by a newline, so
+	     * that they are also available as one buffer, see
+	     * Mockup::Lines::buffer().
+	     */
+	    void add_lines(const vector<string>& lines, uint32_t& first, uint32_t& count)
+	    {
+		first = spans.size();
+		count = lines.size();
+
+		string buffer;
+		for (const string& line : lines)
+		{
+		    buffer.append(line);
+		    buffer.push_back('\n');
+		}
+
+		uint32_t offset = add_to_pool(buffer);
+
+		for (const string& line : lines)
+		{
+		    spans.push_back({ offset, (uint32_t)(line.size()) });
+		    offset += line.size() + 1;
+		}
+	    }
+
+	    void add_entry(MockupBinary::Kind kind, const string& name, const vector<string>& lines0,
+			   const vector<string>& lines1, int exit_code, double latency)
+	    {
+		MockupBinary::Entry entry;
+		memset(&entry, 0, sizeof(entry));
+
+		entry.kind = kind;
+		entry.exit_code = exit_code;
+		entry.name = add_string(name);
+		add_lines(lines0, entry.first[0], entry.count[0]);
+		add_lines(lines1, entry.first[1], entry.count[1]);
+		entry.latency = min(latency * 1e6 + 0.5, (double)(UINT32_MAX));
+
+		entries.push_back(entry);
+	    }
+
+	    void save(const string& filename)
+	    {
+		uint32_t num_buckets = 1;
+		while (num_buckets < entries.size())
+		    num_buckets <<= 1;
+
+		vector<uint32_t> buckets(num_buckets, 0);
+
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+		    MockupBinary::Entry& entry = entries[i];
+
+		    const Span& span = spans[entry.name];
+		    const string_view name(pool.data() + span.offset, span.length);
+
+		    uint32_t& bucket = buckets[MockupBinary::hash(entry.kind, name) & (num_buckets - 1)];
+		    entry.next = bucket;
+		    bucket = i + 1;
+		}
+
+		MockupBinary::Header header;
+		memset(&header, 0, sizeof(header));
+
+		memcpy(header.magic, magic, sizeof(magic));
+		header.version = version;
+		header.byte_order = byte_order;
+		header.num_buckets = num_buckets;
+		header.num_entries = entries.size();
+		header.num_spans = spans.size();
+		header.pool_size = pool.size();
+
+		ofstream s(filename, ios::binary | ios::trunc);
+
+		s.write((const char*)(&header), sizeof(header));
+		s.write((const char*)(buckets.data()), buckets.size() * sizeof(uint32_t));
+		s.write((const char*)(entries.data()), entries.size() * sizeof(MockupBinary::Entry));
+		s.write((const char*)(spans.data()), spans.size() * sizeof(Span));
+		s.write(pool.data(), pool.size());
+
+		s.close();
+
+		if (!s)
+		    ST_THROW(IOException(sformat("writing '%s' failed", filename)));
+	    }
+
+	private:
+
+	    typedef MockupBinary::Span Span;
+
+	    uint32_t add_to_pool(const string& s)
+	    {
+		map<string, uint32_t>::const_iterator it = offsets.find(s);
+		if (it == offsets.end())
+		{
+		    if (pool.size() + s.size() > UINT32_MAX)
+			ST_THROW(Exception("binary mockup too big"));
+
+		    it = offsets.emplace(s, pool.size()).first;
+		    pool.append(s);
+		}
+
+		return it->second;
+	    }
+
+	    map<string, uint32_t> offsets;
+	    string pool;
+	    vector<Span> spans;
+	    vector<MockupBinary::Entry> entries;
+
+	};
+
+    }
+
+
+    MockupBinary::MockupBinary(const string& filename)
+    {
+	int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	    ST_THROW(IOException(sformat("open of '%s' failed, %s", filename, strerror(errno))));
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+	    int errno_saved = errno;
+	    close(fd);
+	    ST_THROW(IOException(sformat("stat of '%s' failed, %s", filename, strerror(errno_saved))));
+	}
+
+	length = st.st_size;
+
+	if (length < sizeof(Header))
+	{
+	    close(fd);
+	    ST_THROW(Exception(sformat("binary mockup '%s' too short", filename)));
+	}
+
+	addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	int errno_saved = errno;
+	close(fd);
+
+	if (addr == MAP_FAILED)
+	{
+	    addr = nullptr;
+	    ST_THROW(IOException(sformat("mmap of '%s' failed, %s", filename, strerror(errno_saved))));
+	}
+
+	try
+	{
+	    check();
+	}
+	catch (const Exception& exception)
+	{
+	    ST_CAUGHT(exception);
+
+	    munmap(addr, length);
+
+	    ST_RETHROW(exception);
+	}
+
+	y2mil("loaded binary mockup '" << filename << "' with " << header->num_entries << " entries");
+    }
+
+
+    MockupBinary::~MockupBinary()
+    {
+	if (addr)
+	    munmap(addr, length);
+    }
+
+
+    void
+    MockupBinary::check()
+    {
+	const char* data = (const char*)(addr);
+
+	const Header* tmp = (const Header*)(data);
+
+	if (memcmp(tmp->magic, magic, sizeof(magic)) != 0)
+	    ST_THROW(Exception("wrong magic in binary mockup"));
+
+	if (tmp->byte_order != byte_order)
+	    ST_THROW(Exception("wrong byte order in binary mockup"));
+
+	if (tmp->version != version)
+	    ST_THROW(Exception(sformat("unsupported version %d of binary mockup", tmp->version)));
+
+	if (tmp->num_buckets == 0 || (tmp->num_buckets & (tmp->num_buckets - 1)) != 0)
+	    ST_THROW(Exception("invalid number of buckets in binary mockup"));
+
+	const uint64_t expected = sizeof(Header) + (uint64_t)(tmp->num_buckets) * sizeof(uint32_t) +
+	    (uint64_t)(tmp->num_entries) * sizeof(Entry) + (uint64_t)(tmp->num_spans) * sizeof(Span) +
+	    tmp->pool_size;
+
+	if (expected != length)
+	    ST_THROW(Exception("wrong size of binary mockup"));
+
+	header = tmp;
+	buckets = (const uint32_t*)(data + sizeof(Header));
+	entries = (const Entry*)(buckets + header->num_buckets);
+	spans = (const Span*)(entries + header->num_entries);
+	pool = (const char*)(spans + header->num_spans);
+
+	for (uint32_t i = 0; i < header->num_buckets; ++i)
+	    if (buckets[i] > header->num_entries)
+		ST_THROW(Exception("invalid bucket in binary mockup"));
+
+	for (uint32_t i = 0; i < header->num_spans; ++i)
+	    if ((uint64_t)(spans[i].offset) + spans[i].length > header->pool_size)
+		ST_THROW(Exception("invalid span in binary mockup"));
+
+	for (uint32_t i = 0; i < header->num_entries; ++i)
+	{
+	    const Entry& entry = entries[i];
+
+	    if (entry.kind != Kind::COMMAND && entry.kind != Kind::FILE)
+		ST_THROW(Exception("invalid entry kind in binary mockup"));
+
+	    if (entry.next > header->num_entries || entry.name >= header->num_spans)
+		ST_THROW(Exception("invalid entry in binary mockup"));
+
+	    for (int j = 0; j < 2; ++j)
+	    {
+		if ((uint64_t)(entry.first[j]) + entry.count[j] > header->num_spans)
+		    ST_THROW(Exception("invalid entry in binary mockup"));
+
+		// Mockup::Lines::buffer() relies on the lines being joined.
+
+		for (uint32_t k = entry.first[j]; k < entry.first[j] + entry.count[j]; ++k)
+		{
+		    const uint64_t end = (uint64_t)(spans[k].offset) + spans[k].length;
+
+		    if (end >= header->pool_size || pool[end] != '\n')
+			ST_THROW(Exception("invalid lines in binary mockup"));
+
+		    if (k + 1 < entry.first[j] + entry.count[j] && spans[k + 1].offset != end + 1)
+			ST_THROW(Exception("invalid lines in binary mockup"));
+		}
+	    }
+	}
+    }
+
+
+    bool
+    MockupBinary::is_binary(const string& filename)
+    {
+	ifstream s(filename, ios::binary);
+
+	char tmp[sizeof(magic)];
+	s.read(tmp, sizeof(tmp));
+
+	return s && memcmp(tmp, magic, sizeof(magic)) == 0;
+    }
+
+
+    void
+    MockupBinary::save(const string& filename, const map<string, Mockup::Command>& commands,
+		       const map<string, double>& command_latencies, const map<string, Mockup::File>& files,
+		       const map<string, double>& file_latencies)
+    {
+	Writer writer;
+
+	for (const map<string, Mockup::Command>::value_type& tmp : commands)
+	{
+	    map<string, double>::const_iterator it = command_latencies.find(tmp.first);
+
+	    writer.add_entry(Kind::COMMAND, tmp.first, tmp.second.stdout, tmp.second.stderr,
+			     tmp.second.exit_code, it != command_latencies.end() ? it->second : 0.0);
+	}
+
+	for (const map<string, Mockup::File>::value_type& tmp : files)
+	{
+	    map<string, double>::const_iterator it = file_latencies.find(tmp.first);
+
+	    writer.add_entry(Kind::FILE, tmp.first, tmp.second.content, {}, 0,
+			     it != file_latencies.end() ? it->second : 0.0);
+	}
+
+	writer.save(filename);
+    }
+
+
+    uint32_t
+    MockupBinary::hash(Kind kind, string_view name)
+    {
+	// FNV-1a
+
+	uint32_t h = 2166136261;
+
+	h = (h ^ (uint32_t)(kind)) * 16777619;
+
+	for (char c : name)
+	    h = (h ^ (unsigned char)(c)) * 16777619;
+
+	return h;
+    }
+
+
+    const MockupBinary::Entry*
+    MockupBinary::find(Kind kind, string_view name) const
+    {
+	uint32_t i = buckets[hash(kind, name) & (header->num_buckets - 1)];
+
+	// The chain length is limited by the number of entries, so a
+	// corrupt chain cannot loop forever.
+
+	for (uint32_t n = 0; i != 0 && n < header->num_entries; ++n)
+	{
+	    const Entry& entry = entries[i - 1];
+
+	    if (entry.kind == kind && get_string(entry.name) == name)
+		return &entry;
+
+	    i = entry.next;
+	}
+
+	return nullptr;
+    }
+
+
+    string_view
+    MockupBinary::get_string(uint32_t span) const
+    {
+	return string_view(pool + spans[span].offset, spans[span].length);
+    }
+
+
+    string_view
+    MockupBinary::name(const Entry& entry) const
+    {
+	return get_string(entry.name);
+    }
+
+
+    Mockup::Lines
+    MockupBinary::lines(const Entry& entry, int i) const
+    {
+	return Mockup::Lines(pool, (const uint32_t*)(spans + entry.first[i]), entry.count[i]);
+    }
+
+
+    Mockup::Command
+    MockupBinary::command(const Entry& entry) const
+    {
+	return Mockup::Command(lines(entry, 0).to_vector(), lines(entry, 1).to_vector(), entry.exit_code);
+    }
+
+
+    Mockup::File
+    MockupBinary::file(const Entry& entry) const
+    {
+	return Mockup::File(lines(entry, 0).to_vector());
+    }
+
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_MOCKUP_BINARY_H
+#define STORAGE_MOCKUP_BINARY_H
+
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <cstdint>
+#include <boost/noncopyable.hpp>
+
+#include "storage/Utils/Mockup.h"
+
+
+namespace storage
+{
+    using std::string;
+    using std::string_view;
+    using std::map;
+
+
+    /**
+     * Binary mockup format. The file is mmap'ed and entries are looked
+     * up via a hash index, so loading is independent of the size of the
+     * mockup and lines are handed out without copying.
+     *
+     * Layout (host byte order, detected via the byte order mark):
+     *
+     *   Header
+     *   uint32_t buckets[num_buckets]	index + 1 of first entry, 0 if empty
+     *   Entry entries[num_entries]
+     *   Span spans[num_spans]		offset and length of a string in the pool
+     *   char pool[pool_size]
+     *
+     * Each name of a command or file has its own entry. The lines of a
+     * command output or file content are stored joined in the pool, each
+     * followed by a newline, so that they can also be handed out as one
+     * buffer. Identical strings are stored only once in the pool.
+     */
+    class MockupBinary : private boost::noncopyable
+    {
+    public:
+
+	enum class Kind : uint32_t
+	{
+	    COMMAND = 0, FILE = 1
+	};
+
+	struct Header
+	{
+	    char magic[8];
+	    uint32_t version;
+	    uint32_t byte_order;
+	    uint32_t num_buckets;
+	    uint32_t num_entries;
+	    uint32_t num_spans;
+	    uint32_t reserved;
+	    uint64_t pool_size;
+	};
+
+	/**
+	 * For commands lines[0] is stdout and lines[1] is stderr. For files
+	 * lines[0] is the content. The latency is in microseconds.
+	 */
+	struct Entry
+	{
+	    Kind kind;
+	    int32_t exit_code;
+	    uint32_t name;
+	    uint32_t next;
+	    uint32_t first[2];
+	    uint32_t count[2];
+	    uint32_t latency;
+	};
+
+	struct Span
+	{
+	    uint32_t offset;
+	    uint32_t length;
+	};
+
+	/**
+	 * Maps the file and checks its consistency.
+	 *
+	 * @throw Exception
+	 */
+	MockupBinary(const string& filename);
+	~MockupBinary();
+
+	/**
+	 * Check whether the file starts with the magic of the binary
+	 * format.
+	 */
+	static bool is_binary(const string& filename);
+
+	static void save(const string& filename, const map<string, Mockup::Command>& commands,
+			 const map<string, double>& command_latencies, const map<string, Mockup::File>& files,
+			 const map<string, double>& file_latencies);
+
+	size_t size() const { return header->num_entries; }
+	const Entry& entry(size_t i) const { return entries[i]; }
+
+	const Entry* find(Kind kind, string_view name) const;
+
+	string_view name(const Entry& entry) const;
+	Mockup::Lines lines(const Entry& entry, int i) const;
+
+	/**
+	 * Latency in seconds.
+	 */
+	double latency(const Entry& entry) const { return entry.latency * 1e-6; }
+
+	Mockup::Command command(const Entry& entry) const;
+	Mockup::File file(const Entry& entry) const;
+
+	static uint32_t hash(Kind kind, string_view name);
+
+    private:
+
+	void* addr = nullptr;
+	size_t length = 0;
+
+	const Header* header = nullptr;
+	const uint32_t* buckets = nullptr;
+	const Entry* entries = nullptr;
+	const Span* spans = nullptr;
+	const char* pool = nullptr;
+
+	string_view get_string(uint32_t span) const;
+
+	void check();
+
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include "storage/Utils/OperationBudget.h"
+#include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/LoggerImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    // Thread-local so that several Storage objects can run operations at
+    // the same time. Threads of the SystemCmdPool take over the budget,
+    // see ThreadContext.
+    static thread_local const OperationBudget* current_budget = nullptr;
+
+
+    OperationBudget::OperationBudget(chrono::seconds timeout, function<bool()> cancelled)
+	: timeout(timeout), deadline(clock::now() + timeout), cancelled(cancelled),
+	  owner(this_thread::get_id()), cancel_flag(false), previous(current_budget)
+    {
+	current_budget = this;
+
+	if (has_deadline())
+	    y2mil("operation budget " << timeout.count() << "s");
+    }
+
+
+    OperationBudget::~OperationBudget()
+    {
+	current_budget = previous;
+    }
+
+
+    const OperationBudget*
+    OperationBudget::get_current()
+    {
+	return current_budget;
+    }
+
+
+    void
+    OperationBudget::set_current(const OperationBudget* operation_budget)
+    {
+	current_budget = operation_budget;
+    }
+
+
+    bool
+    OperationBudget::is_exhausted() const
+    {
+	return has_deadline() && clock::now() >= deadline;
+    }
+
+
+    bool
+    OperationBudget::is_cancelled() const
+    {
+	if (cancel_flag)
+	    return true;
+
+	if (cancelled && this_thread::get_id() == owner && cancelled())
+	    cancel_flag = true;
+
+	return cancel_flag;
+    }
+
+
+    void
+    OperationBudget::poll()
+    {
+	const OperationBudget* budget = get_current();
+	if (budget)
+	    budget->is_cancelled();
+    }
+
+
+    void
+    OperationBudget::check()
+    {
+	const OperationBudget* budget = get_current();
+	if (!budget)
+	    return;
+
+	if (budget->is_cancelled())
+	    ST_THROW(CommandCancelledException(nullptr, "Operation cancelled"));
+
+	if (budget->is_exhausted())
+	    ST_THROW(CommandCancelledException(nullptr, "Time budget exhausted"));
+    }
+
+}
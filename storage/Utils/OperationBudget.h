@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_OPERATION_BUDGET_H
+#define STORAGE_OPERATION_BUDGET_H
+
+
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <boost/noncopyable.hpp>
+
+
+namespace storage
+{
+
+    /**
+     * Time budget and cancellation for a whole operation, e.g. probe or
+     * commit. While an object exists it is the current budget and every
+     * SystemCmd checks it before and while running. When the budget is
+     * exhausted or the operation is cancelled the running command is killed
+     * and a CommandCancelledException is thrown.
+     *
+     * Budgets do not nest: the constructor saves and the destructor restores
+     * the previous budget.
+     *
+     * The cancelled function is only called on the thread that created the
+     * budget since it may be a callback into a scripting language (SWIG
+     * director). Worker threads only see the result of the last call.
+     */
+    class OperationBudget : private boost::noncopyable
+    {
+    public:
+
+	typedef std::chrono::steady_clock clock;
+
+	/**
+	 * A timeout of zero means no time limit. The cancelled function may be
+	 * empty.
+	 */
+	OperationBudget(std::chrono::seconds timeout, std::function<bool()> cancelled);
+	~OperationBudget();
+
+	/**
+	 * Return the current budget of the thread or nullptr.
+	 */
+	static const OperationBudget* get_current();
+
+	/**
+	 * Set the current budget of the thread, e.g. for worker threads to
+	 * take over the budget of the spawning thread.
+	 */
+	static void set_current(const OperationBudget* operation_budget);
+
+	bool has_deadline() const { return timeout.count() > 0; }
+	clock::time_point get_deadline() const { return deadline; }
+
+	bool has_cancel_check() const { return (bool)(cancelled); }
+
+	/**
+	 * Return true if the time budget is exhausted.
+	 */
+	bool is_exhausted() const;
+
+	/**
+	 * Return true if the operation was cancelled. On the thread that
+	 * created the budget this calls the cancelled function, on other
+	 * threads it only reports the result of previous calls.
+	 */
+	bool is_cancelled() const;
+
+	/**
+	 * Calls the cancelled function of the current budget if the current
+	 * thread created the budget. For threads waiting for worker threads.
+	 */
+	static void poll();
+
+	/**
+	 * Throws a CommandCancelledException if the current budget is exhausted
+	 * or the operation was cancelled.
+	 */
+	static void check();
+
+    private:
+
+	const std::chrono::seconds timeout;
+	const clock::time_point deadline;
+	const std::function<bool()> cancelled;
+
+	const std::thread::id owner;
+	mutable std::atomic<bool> cancel_flag;
+
+	const OperationBudget* previous;
+
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <exception>
+
+#include "storage/Utils/ParallelFor.h"
+#include "storage/Utils/ThreadContext.h"
+#include "storage/Utils/OperationBudget.h"
+#include "storage/Utils/LoggerImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    void
+    parallel_for(size_t n, unsigned int size, const std::function<void(size_t)>& func)
+    {
+	vector<exception_ptr> eps(n);
+
+	atomic<size_t> next(0);
+
+	auto work = [n, &func, &next, &eps]() {
+	    for (size_t i = next++; i < n; i = next++)
+	    {
+		try
+		{
+		    func(i);
+		}
+		catch (...)
+		{
+		    eps[i] = current_exception();
+		}
+	    }
+	};
+
+	const size_t num_threads = min<size_t>(max(size, 1U), n);
+
+	y2deb("parallel_for n:" << n << " threads:" << num_threads);
+
+	vector<thread> threads;
+
+	const ThreadContext thread_context;
+
+	mutex finished_mutex;
+	condition_variable finished_condition;
+	size_t finished = 0;
+
+	for (size_t i = 1; i < num_threads; ++i)
+	{
+	    threads.emplace_back([&work, &thread_context, &finished_mutex, &finished_condition, &finished]() {
+		ThreadContext::Guard guard(thread_context);
+		work();
+
+		{
+		    lock_guard<mutex> lock(finished_mutex);
+		    ++finished;
+		}
+
+		finished_condition.notify_one();
+	    });
+	}
+
+	work();
+
+	// Only the calling thread may call the cancel callback, so poll it
+	// while waiting for the other threads, see OperationBudget.
+
+	const OperationBudget* budget = OperationBudget::get_current();
+	if (budget && budget->has_cancel_check())
+	{
+	    unique_lock<mutex> lock(finished_mutex);
+
+	    while (!finished_condition.wait_for(lock, chrono::milliseconds(100),
+						[&finished, &threads]() { return finished == threads.size(); }))
+	    {
+		lock.unlock();
+		OperationBudget::poll();
+		lock.lock();
+	    }
+	}
+
+	for (thread& t : threads)
+	    t.join();
+
+	for (const exception_ptr& ep : eps)
+	{
+	    if (ep)
+		rethrow_exception(ep);
+	}
+    }
+
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_PARALLEL_FOR_H
+#define STORAGE_PARALLEL_FOR_H
+
+
+#include <cstddef>
+#include <functional>
+
+
+namespace storage
+{
+
+    /**
+     * Call func for every index from 0 to n - 1 using at most size threads
+     * (including the calling thread). Each index is processed exactly once
+     * but in no particular order.
+     *
+     * If calls throw, the exception of the call with the lowest index is
+     * rethrown after all calls have finished. So the result does not
+     * depend on the scheduling.
+     */
+    void parallel_for(size_t n, unsigned int size, const std::function<void(size_t)>& func);
+
+}
+
+
+#endif
@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <memory>
+#include <fstream>
+#include <regex>
+#include <set>
+#include <boost/algorithm/string.hpp>
+#include <boost/crc.hpp>
+
+#include "storage/Utils/ProbeCache.h"
+#include "storage/Utils/XmlFile.h"
+#include "storage/Utils/AppUtil.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/Format.h"
+
+
+namespace storage
+{
+
+    using namespace std;
+
+
+    // Thread-local so that several Storage objects can probe at the same
+    // time, see ThreadContext.
+    static thread_local ProbeCache* current = nullptr;
+
+
+    // Increased whenever the format changes, e.g. version 2 keeps stdout
+    // as one buffer instead of lines. Files with another version are
+    // ignored.
+    static const unsigned int file_version = 2;
+
+
+    static string
+    read_file(const string& path)
+    {
+	ifstream s(path);
+
+	string ret;
+	getline(s, ret, '\0');
+
+	return boost::trim_right_copy(ret);
+    }
+
+
+    ProbeCache::ProbeCache(Mode mode, const string& filename, const string& udev_data_dir,
+			   const string& lvm_backup_dir)
+	: mode(mode), filename(filename), udev_data_dir(udev_data_dir), lvm_backup_dir(lvm_backup_dir),
+	  previous(current)
+    {
+	load();
+
+	global_marker = calculate_global_marker();
+
+	y2mil("probe cache " << (mode == Mode::VALIDATE ? "validating" : "using") << " " << filename <<
+	      " with " << entries.size() << " entries");
+
+	current = this;
+    }
+
+
+    ProbeCache::~ProbeCache()
+    {
+	y2mil("probe cache hits:" << hits << " misses:" << misses << " mismatches:" << mismatches);
+
+	current = previous;
+    }
+
+
+    ProbeCache*
+    ProbeCache::get_current()
+    {
+	return current;
+    }
+
+
+    void
+    ProbeCache::set_current(ProbeCache* probe_cache)
+    {
+	current = probe_cache;
+    }
+
+
+    void
+    ProbeCache::load()
+    {
+	if (access(filename.c_str(), R_OK) != 0)
+	    return;
+
+	try
+	{
+	    XmlFile xml(filename);
+
+	    const xmlNode* root_node = xml.getRootElement();
+	    if (!root_node)
+		ST_THROW(Exception("root node not found"));
+
+	    const xmlNode* probe_cache_node = getChildNode(root_node, "ProbeCache");
+	    if (!probe_cache_node)
+		ST_THROW(Exception("ProbeCache node not found"));
+
+	    unsigned int version = 0;
+	    getChildValue(probe_cache_node, "version", version);
+	    if (version != file_version)
+		ST_THROW(Exception(sformat("unsupported version %u", version)));
+
+	    for (const xmlNode* command_node : getChildNodes(probe_cache_node, "Command"))
+	    {
+		string name;
+		Entry entry;
+
+		getChildValue(command_node, "name", name);
+		getChildValue(command_node, "key", entry.key);
+		getChildValue(command_node, "stdout", entry.output.stdout);
+		getChildValue(command_node, "stderr", entry.output.stderr);
+		getChildValue(command_node, "exit-code", entry.output.exit_code);
+
+		entries[name] = std::move(entry);
+	    }
+	}
+	catch (const Exception& exception)
+	{
+	    ST_CAUGHT(exception);
+
+	    y2war("ignoring probe cache " << filename);
+
+	    entries.clear();
+	}
+    }
+
+
+    void
+    ProbeCache::save() const
+    {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	XmlFile xml;
+
+	xmlNode* probe_cache_node = xmlNewNode("ProbeCache");
+	xml.setRootElement(probe_cache_node);
+
+	setChildValue(probe_cache_node, "version", file_version);
+
+	for (const map<string, Entry>::value_type& value : entries)
+	{
+	    xmlNode* command_node = xmlNewChild(probe_cache_node, "Command");
+
+	    setChildValue(command_node, "name", value.first);
+	    setChildValue(command_node, "key", value.second.key);
+	    setChildValueIf(command_node, "stdout", value.second.output.stdout,
+			    !value.second.output.stdout.empty());
+	    setChildValue(command_node, "stderr", value.second.output.stderr);
+	    setChildValueIf(command_node, "exit-code", value.second.output.exit_code,
+			    value.second.output.exit_code != 0);
+	}
+
+	const string data = xml.save_to_string();
+
+	// The cache contains e.g. labels and LUKS headers so only root may
+	// read it. mkostemp() creates the file exclusively with mode 0600 so
+	// the content is never readable by others. Renaming replaces the
+	// cache file atomically.
+
+	string tmp_filename = filename + ".XXXXXX";
+
+	int fd = mkostemp(&tmp_filename[0], O_CLOEXEC);
+	if (fd < 0)
+	    ST_THROW(IOException(sformat("mkostemp for '%s' failed, %s", filename, stringerror(errno))));
+
+	const char* p = data.data();
+	size_t left = data.size();
+
+	while (left > 0)
+	{
+	    ssize_t r = write(fd, p, left);
+	    if (r < 0 && errno == EINTR)
+		continue;
+
+	    if (r < 0)
+	    {
+		int errnum = errno;
+		close(fd);
+		unlink(tmp_filename.c_str());
+		ST_THROW(IOException(sformat("write to '%s' failed, %s", tmp_filename, stringerror(errnum))));
+	    }
+
+	    p += r;
+	    left -= r;
+	}
+
+	close(fd);
+
+	if (rename(tmp_filename.c_str(), filename.c_str()) != 0)
+	{
+	    int errnum = errno;
+	    unlink(tmp_filename.c_str());
+	    ST_THROW(IOException(sformat("rename of '%s' failed, %s", tmp_filename, stringerror(errnum))));
+	}
+    }
+
+
+    bool
+    ProbeCache::is_cacheable(const string& command)
+    {
+	// Commands with side effects must always be run. Also commands whose
+	// output depends on the content of filesystems, e.g. df or lsattr,
+	// since writing files does not change any marker.
+
+	static const char* const prefixes[] = {
+	    MOUNT_BIN " ", UMOUNT_BIN " ", UDEVADM_BIN " settle",
+	    DF_BIN " ", LSATTR_BIN " ",
+	    BTRFS_BIN " subvolume ", BTRFS_BIN " qgroup ", BTRFS_BIN " filesystem df ",
+	    BTRFS_BIN " --format json qgroup ", BTRFS_BIN " --format json filesystem df ",
+	    DUMPE2FS_BIN " ", RESIZE2FS_BIN " ", NTFSRESIZE_BIN " "
+	};
+
+	for (const char* prefix : prefixes)
+	{
+	    if (boost::starts_with(command, prefix))
+		return false;
+	}
+
+	return true;
+    }
+
+
+    bool
+    ProbeCache::Output::operator==(const Output& rhs) const
+    {
+	return stdout == rhs.stdout && stderr == rhs.stderr && exit_code == rhs.exit_code;
+    }
+
+
+    bool
+    ProbeCache::lookup(const string& name, Output& output)
+    {
+	const string tmp = key(name);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	map<string, Entry>::const_iterator it = entries.find(name);
+	if (mode == Mode::USE && !tmp.empty() && it != entries.end() && it->second.key == tmp)
+	{
+	    y2mil("probe cache hit for '" << name << "'");
+
+	    output = it->second.output;
+	    ++hits;
+	    return true;
+	}
+
+	++misses;
+	return false;
+    }
+
+
+    void
+    ProbeCache::store(const string& name, Output&& output)
+    {
+	const string tmp = key(name);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	map<string, Entry>::iterator it = entries.find(name);
+
+	if (mode == Mode::VALIDATE && !tmp.empty() && it != entries.end() && it->second.key == tmp &&
+	    !(it->second.output == output))
+	{
+	    y2err("probe cache mismatch for '" << name << "'");
+	    ++mismatches;
+	}
+
+	if (tmp.empty())
+	{
+	    if (it != entries.end())
+		entries.erase(it);
+	}
+	else
+	{
+	    entries[name] = { tmp, std::move(output) };
+	}
+    }
+
+
+    string
+    ProbeCache::key(const string& name)
+    {
+	// The device names are either quoted, e.g. 'parted ... '/dev/sda'', or
+	// part of a mockup key, e.g. 'btrfs ... (device:/dev/sda1)'.
+
+	static const regex device_regex("/dev/[^' )]+", regex::extended);
+
+	set<string> devices;
+
+	for (sregex_iterator it(name.begin(), name.end(), device_regex); it != sregex_iterator(); ++it)
+	    devices.insert(it->str());
+
+	if (devices.empty())
+	    return global_marker;
+
+	string ret;
+
+	for (const string& device : devices)
+	{
+	    const string& tmp = device_marker(device);
+	    if (tmp.empty())
+		return "";
+
+	    ret += (ret.empty() ? "" : " ") + tmp;
+	}
+
+	return ret;
+    }
+
+
+    string
+    ProbeCache::marker(const string& majorminor) const
+    {
+	struct stat st;
+	if (stat((udev_data_dir + "/b" + majorminor).c_str(), &st) != 0)
+	    return "";
+
+	const string path = SYSFS_DIR "/dev/block/" + majorminor;
+
+	// For partitions the disk sequence number is only available for the
+	// disk.
+
+	const string diskseq = read_file(path + (access((path + "/partition").c_str(), F_OK) == 0 ?
+						"/../diskseq" : "/diskseq"));
+
+	return sformat("%s:%s:%s:%d.%09d", majorminor, read_file(path + "/size"), diskseq,
+		       st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+    }
+
+
+    const string&
+    ProbeCache::device_marker(const string& device)
+    {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	map<string, string>::const_iterator it = device_markers.find(device);
+	if (it != device_markers.end())
+	    return it->second;
+
+	string tmp;
+
+	struct stat st;
+	if (stat(device.c_str(), &st) == 0 && S_ISBLK(st.st_mode))
+	    tmp = marker(sformat("%d:%d", major(st.st_rdev), minor(st.st_rdev)));
+
+	return device_markers[device] = tmp;
+    }
+
+
+    string
+    ProbeCache::dm_state() const
+    {
+	// udev does not watch device mapper devices (OPTIONS+="nowatch" in
+	// the dm rules), so e.g. renaming a device mapper device does not
+	// necessarily change any udev database entry.
+
+	string ret;
+
+	unique_ptr<DIR, int (*)(DIR*)> dir(opendir(SYSFS_DIR "/block"), closedir);
+	if (!dir)
+	    return ret;
+
+	vector<string> names;
+
+	while (const struct dirent* entry = readdir(dir.get()))
+	{
+	    if (boost::starts_with(entry->d_name, "dm-"))
+		names.push_back(entry->d_name);
+	}
+
+	sort(names.begin(), names.end());
+
+	for (const string& name : names)
+	{
+	    const string path = SYSFS_DIR "/block/" + name + "/dm";
+
+	    ret += sformat("%s:%s:%s:%s\n", name, read_file(path + "/name"), read_file(path + "/uuid"),
+			   read_file(path + "/suspended"));
+	}
+
+	return ret;
+    }
+
+
+    string
+    ProbeCache::lvm_state() const
+    {
+	// LVM metadata on device mapper devices, e.g. a PV on LUKS, is not
+	// covered by the udev database entries either. LVM writes a backup
+	// of the metadata of a VG on every change (unless disabled), so use
+	// the modification times of the backup files.
+
+	string ret;
+
+	unique_ptr<DIR, int (*)(DIR*)> dir(opendir(lvm_backup_dir.c_str()), closedir);
+	if (!dir)
+	    return ret;
+
+	vector<string> names;
+
+	while (const struct dirent* entry = readdir(dir.get()))
+	{
+	    if (entry->d_name[0] != '.')
+		names.push_back(entry->d_name);
+	}
+
+	sort(names.begin(), names.end());
+
+	for (const string& name : names)
+	{
+	    struct stat st;
+	    if (stat((lvm_backup_dir + "/" + name).c_str(), &st) == 0)
+		ret += sformat("%s:%d.%09d\n", name, st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+	}
+
+	return ret;
+    }
+
+
+    string
+    ProbeCache::calculate_global_marker() const
+    {
+	string data;
+
+	ifstream s(PROC_DIR "/partitions");
+
+	string line;
+	while (getline(s, line))
+	{
+	    vector<string> columns;
+	    boost::split(columns, boost::trim_copy(line), boost::is_any_of(" \t"), boost::token_compress_on);
+	    if (columns.size() != 4 || columns[0] == "major")
+		continue;
+
+	    const string tmp = marker(columns[0] + ":" + columns[1]);
+	    if (tmp.empty())
+	    {
+		y2mil("no probe cache for global commands due to " << columns[3]);
+		return "";
+	    }
+
+	    data += tmp + "\n";
+	}
+
+	// The state of MD RAIDs is added since e.g. a resync does not write
+	// to the devices.
+
+	data += read_file(PROC_DIR "/mdstat");
+
+	data += dm_state();
+	data += lvm_state();
+
+	// CRC-64/XZ
+	boost::crc_optimal<64, 0x42F0E1EBA9EA3693, 0xFFFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF, true, true> crc;
+	crc.process_bytes(data.data(), data.size());
+
+	return sformat("global:%016llx", (unsigned long long)(crc.checksum()));
+    }
+
+}
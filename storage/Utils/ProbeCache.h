@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_PROBE_CACHE_H
+#define STORAGE_PROBE_CACHE_H
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <boost/noncopyable.hpp>
+
+#include "storage/Utils/StorageDefines.h"
+
+
+namespace storage
+{
+
+    using std::string;
+    using std::vector;
+    using std::map;
+
+
+    /**
+     * Persistent cache of command output used during probing. While an
+     * object exists it is the current cache and SystemCmd consults it.
+     *
+     * Every entry is stored together with a key made of generation markers:
+     * For commands referring to devices the markers of these devices
+     * (device number, size, disk sequence number and modification time of
+     * the udev database entry). For all other commands, e.g. blkid or lvm
+     * fullreport, a marker covering all block devices, /proc/mdstat, the
+     * device mapper devices and the LVM metadata backups. An entry is only
+     * used if the key is unchanged.
+     *
+     * In validation mode cached entries are not used. Instead the output of
+     * the commands is compared with the cached entries and mismatches are
+     * logged.
+     */
+    class ProbeCache : private boost::noncopyable
+    {
+    public:
+
+	enum class Mode { USE, VALIDATE };
+
+	/**
+	 * The output of a command. stdout is kept as one buffer like
+	 * SystemCmd captures it with capture_buffer, so storing and playing
+	 * back needs no splitting into lines.
+	 */
+	struct Output
+	{
+	    string stdout;
+	    vector<string> stderr;
+	    int exit_code = 0;
+
+	    bool operator==(const Output& rhs) const;
+	};
+
+	/**
+	 * Loads the cache file if it exists. Problems reading the file are
+	 * only logged. The udev data and LVM backup directories can only be
+	 * changed for testsuites.
+	 */
+	ProbeCache(Mode mode, const string& filename, const string& udev_data_dir = UDEV_DATA_DIR,
+		   const string& lvm_backup_dir = LVM_BACKUP_DIR);
+	~ProbeCache();
+
+	/**
+	 * Return the current cache of the thread or nullptr.
+	 */
+	static ProbeCache* get_current();
+
+	/**
+	 * Set the current cache of the thread, e.g. for worker threads to
+	 * take over the cache of the spawning thread.
+	 */
+	static void set_current(ProbeCache* probe_cache);
+
+	/**
+	 * Save the cache file. The directory of the file must exist.
+	 *
+	 * @throw Exception
+	 */
+	void save() const;
+
+	/**
+	 * Whether the output of the command may be cached at all. E.g.
+	 * mount is not since it has side effects and df is not since its
+	 * output changes with the content of the filesystem.
+	 */
+	static bool is_cacheable(const string& command);
+
+	/**
+	 * Lookup the command. Returns true if a valid entry was found (never
+	 * in validation mode).
+	 */
+	bool lookup(const string& name, Output& output);
+
+	/**
+	 * Store the output of a command that was run.
+	 */
+	void store(const string& name, Output&& output);
+
+	unsigned int get_hits() const { return hits; }
+	unsigned int get_misses() const { return misses; }
+	unsigned int get_mismatches() const { return mismatches; }
+
+    private:
+
+	struct Entry
+	{
+	    string key;
+	    Output output;
+	};
+
+	const Mode mode;
+	const string filename;
+	const string udev_data_dir;
+	const string lvm_backup_dir;
+
+	ProbeCache* previous;
+
+	mutable std::mutex mutex;
+
+	map<string, Entry> entries;
+
+	string global_marker;
+	map<string, string> device_markers;
+
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int mismatches = 0;
+
+	string key(const string& name);
+
+	string marker(const string& majorminor) const;
+	const string& device_marker(const string& device);
+	string dm_state() const;
+	string lvm_state() const;
+	string calculate_global_marker() const;
+
+	void load();
+
+    };
+
+}
+
+#endif
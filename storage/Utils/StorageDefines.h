@@ -49,9 +49,15 @@
 
 #define LOCKFILE_DIR "/run/libstorage-ng"
 
+#define UDEV_DATA_DIR "/run/udev/data"
+
+#define LVM_BACKUP_DIR ETC_DIR "/lvm/backup"
+
 
 // files
 
+#define PROBE_CACHE_FILE LOCKFILE_DIR "/probe-cache.xml"
+
 #define DEV_NULL_FILE DEV_DIR "/null"
 #define DEV_ZERO_FILE DEV_DIR "/zero"
 #define DEV_URANDOM_FILE DEV_DIR "/urandom"
@@ -75,6 +81,8 @@
 
 #define MDADM_BIN "/sbin/mdadm"
 
+#define LVM_BIN "/sbin/lvm"
+
 #define PVCREATE_BIN "/sbin/pvcreate"
 #define PVREMOVE_BIN "/sbin/pvremove"
 #define PVRESIZE_BIN "/sbin/pvresize"
@@ -35,6 +35,8 @@
 #include <map>
 #include <set>
 #include <optional>
+#include <string_view>
+#include <charconv>
 #include <boost/io/ios_state.hpp>
 
 #include "storage/Utils/AppUtil.h"
@@ -63,6 +65,22 @@ namespace storage
     }
 
 
+    /**
+     * Parse an integer at the start of d (after leading blanks) without the
+     * overhead of a stringstream. Returns false and leaves v untouched if d does
+     * not start with a number.
+     */
+    template<class Value>
+    bool parse_integer(std::string_view d, Value& v)
+    {
+	std::string_view::size_type pos = d.find_first_not_of(" \t");
+	if (pos == std::string_view::npos)
+	    return false;
+
+	return std::from_chars(d.data() + pos, d.data() + d.size(), v).ec == std::errc();
+    }
+
+
     template<class Value>
     std::ostream& operator<<(std::ostream& s, const std::list<Value>& l)
     {
@@ -27,6 +27,8 @@
 #include <fcntl.h>
 #include <langinfo.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
+#include <signal.h>
 #include <string>
 #include <sstream>
 #include <boost/algorithm/string.hpp>
@@ -36,10 +38,15 @@ extern char **environ;
 #include "storage/Utils/ExceptionImpl.h"
 #include "storage/Utils/Stopwatch.h"
 #include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/AsyncLogger.h"
 #include "storage/Utils/SystemCmd.h"
 #include "storage/Utils/Mockup.h"
+#include "storage/Utils/ProbeCache.h"
 #include "storage/Utils/StorageDefines.h"
 #include "storage/Utils/AppUtil.h"
+#include "storage/Utils/OperationBudget.h"
+#include "storage/Utils/Trace.h"
+#include "storage/Utils/MetricsImpl.h"
 
 
 #define SYSCALL_FAILED( SYSCALL_MSG ) \
@@ -75,7 +82,7 @@ namespace storage
 
 
     SystemCmd::SystemCmd(const Options& options)
-	: options(options), _cmdRet(0), _cmdPid(0)
+	: options(options), _cmdRet(0), _cmdPid(0), _killable(false)
     {
 	y2mil("constructor SystemCmd(\"" << command() << "\")");
 
@@ -84,6 +91,8 @@ namespace storage
 
 	init();
 
+	const Stopwatch stopwatch;
+
 	try
 	{
 	    execute();
@@ -95,6 +104,8 @@ namespace storage
 	    ST_RETHROW( exception );
 	}
 
+	update_metrics(stopwatch.read());
+
 	if (do_throw() && !options.verify(_cmdRet))
 	{
 	    string s = "command '" + command() + "' failed:\n\n";
@@ -123,9 +134,13 @@ namespace storage
     {
         _childStdin = NULL;
 	_files[0] = _files[1] = NULL;
+	_stdoutFd = -1;
+	_stdoutSplit = false;
 	_pfds[0].events = POLLOUT; // stdin
 	_pfds[1].events = POLLIN;  // stdout
 	_pfds[2].events = POLLIN;  // stderr
+	_pfds[3].events = POLLIN;  // pidfd
+	_pfds[3].fd = -1;
     }
 
 
@@ -138,17 +153,19 @@ namespace storage
             _childStdin = NULL;
         }
 
-	if ( _files[IDX_STDOUT] )
-	{
-	    fclose( _files[IDX_STDOUT] );
-	    _files[IDX_STDOUT] = NULL;
-	}
+	closeStdout();
 
 	if ( _files[IDX_STDERR] )
 	{
 	    fclose( _files[IDX_STDERR] );
 	    _files[IDX_STDERR] = NULL;
 	}
+
+	if ( _pfds[3].fd >= 0 )
+	{
+	    close( _pfds[3].fd );
+	    _pfds[3].fd = -1;
+	}
     }
 
 
@@ -170,59 +187,196 @@ namespace storage
     }
 
 
+    /**
+     * Open a pidfd for the child process. The pidfd becomes readable when the
+     * child terminates so that poll() wakes up immediately instead of relying on
+     * the poll timeout. Returns -1 if pidfds are not supported (Linux < 5.3).
+     */
+    static int
+    pidfd_open(pid_t pid)
+    {
+#ifdef SYS_pidfd_open
+	return syscall(SYS_pidfd_open, pid, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+    }
+
+
+    /**
+     * Join lines to a buffer as if read from a command.
+     */
+    static void
+    join_lines(const Mockup::Lines& lines, string& buffer)
+    {
+	size_t size = 0;
+	for (size_t i = 0; i < lines.size(); ++i)
+	    size += lines[i].size() + 1;
+
+	buffer.clear();
+	buffer.reserve(size);
+
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+	    buffer.append(lines[i]);
+	    buffer.push_back('\n');
+	}
+    }
+
+
     int
     SystemCmd::execute()
     {
 	// TODO the command handling could need a better concept
 
+	OperationBudget::check();
+
+	TraceSpan trace_span(boost::starts_with(command(), UDEVADM_BIN " settle") ? "udev" : "command",
+			     command());
+
 	if (Mockup::get_mode() == Mockup::Mode::PLAYBACK)
 	{
-	    const Mockup::Command& mockup_command = Mockup::get_command(mockup_key());
-	    _outputLines[IDX_STDOUT] = mockup_command.stdout;
-	    _outputLines[IDX_STDERR] = mockup_command.stderr;
+	    const Mockup::CommandView mockup_command = Mockup::get_command_view(mockup_key());
+	    invalidate();
+	    if (options.capture_buffer && mockup_command.stdout.has_buffer())
+		_stdoutMockup = mockup_command.stdout.buffer();
+	    else if (options.capture_buffer)
+		join_lines(mockup_command.stdout, _stdoutBuffer);
+	    else
+		_outputLines[IDX_STDOUT] = mockup_command.stdout.to_vector();
+	    _outputLines[IDX_STDERR] = mockup_command.stderr.to_vector();
 	    _cmdRet = mockup_command.exit_code;
 
+	    Mockup::replay_latency(mockup_command.latency);
+
 	    if (_cmdRet == 127 && do_throw())
 		ST_THROW(CommandNotFoundException(this));
 
 	    return 0;
 	}
 
+	const Stopwatch stopwatch;
+
 	int ret;
 
 	if (get_remote_callbacks())
 	{
 	    const RemoteCommand remote_command = get_remote_callbacks()->get_command(command());
-	    _outputLines[IDX_STDOUT] = remote_command.stdout;
+	    if (options.capture_buffer)
+		join_lines(remote_command.stdout, _stdoutBuffer);
+	    else
+		_outputLines[IDX_STDOUT] = remote_command.stdout;
 	    _outputLines[IDX_STDERR] = remote_command.stderr;
 	    _cmdRet = remote_command.exit_code;
 	    ret = 0;
 	}
 	else
 	{
+	    ProbeCache* probe_cache = ProbeCache::get_current();
+	    if (probe_cache && !ProbeCache::is_cacheable(command()))
+		probe_cache = nullptr;
+
+	    ProbeCache::Output cached_output;
+	    if (probe_cache && probe_cache->lookup(mockup_key(), cached_output))
+	    {
+		if (options.capture_buffer)
+		    _stdoutBuffer = std::move(cached_output.stdout);
+		else
+		    _outputLines[IDX_STDOUT] = LinesView(cached_output.stdout).to_vector();
+		_outputLines[IDX_STDERR] = std::move(cached_output.stderr);
+		_cmdRet = cached_output.exit_code;
+
+		if (_cmdRet == 127 && do_throw())
+		    ST_THROW(CommandNotFoundException(this));
+
+		return 0;
+	    }
+
 	    y2mil("SystemCmd Executing:\"" << command() << "\"");
 	    y2mil("timestamp " << timestamp());
 	    ret = doExecute();
+
+	    if (probe_cache)
+	    {
+		// Store the raw buffer so that stdout is not split into lines
+		// just for the cache.
+		ProbeCache::Output output;
+		if (options.capture_buffer)
+		    output.stdout = _stdoutBuffer;
+		else
+		    join_lines(_outputLines[IDX_STDOUT], output.stdout);
+		output.stderr = stderr();
+		output.exit_code = retcode();
+
+		probe_cache->store(mockup_key(), std::move(output));
+	    }
 	}
 
 	if (Mockup::get_mode() == Mockup::Mode::RECORD)
 	{
-	    Mockup::set_command(mockup_key(), Mockup::Command(stdout(), stderr(), retcode()));
+	    Mockup::set_command(mockup_key(), Mockup::Command(stdout(), stderr(), retcode()), stopwatch.read());
 	}
 
 	return ret;
     }
 
 
+    void
+    SystemCmd::update_metrics(double duration) const
+    {
+	static MetricsCounterFamily commands("commands_total", "tool");
+	static MetricsCounter& output_bytes = Metrics::counter("command_output_bytes_total");
+	static MetricsHistogramImpl& command_duration = Metrics::histogram("command_duration_seconds");
+	static MetricsHistogramImpl& udev_settle_duration = Metrics::histogram("udev_settle_duration_seconds");
+
+	// Skip assignments of environment variables to get the tool.
+
+	string tool;
+
+	for (const string& word : splitString(command(), " ", false))
+	{
+	    if (word.find('=') == string::npos)
+	    {
+		tool = word.substr(word.rfind('/') + 1);
+		break;
+	    }
+	}
+
+	commands.counter(tool).increment();
+
+	unsigned long long bytes = 0;
+
+	if (options.capture_buffer)
+	    bytes += _stdoutBuffer.size();
+	else
+	    for (const string& line : _outputLines[IDX_STDOUT])
+		bytes += line.size() + 1;
+
+	for (const string& line : _outputLines[IDX_STDERR])
+	    bytes += line.size() + 1;
+
+	output_bytes.increment(bytes);
+
+	command_duration.observe(duration);
+
+	if (boost::starts_with(command(), UDEVADM_BIN " settle"))
+	    udev_settle_duration.observe(duration);
+    }
+
+
     int
     SystemCmd::doExecute()
     {
 	y2deb("command:" << command());
 
+	_logCommand = query_log_command(LogLevel::MILESTONE);
+
 	Stopwatch stopwatch;
 
         _childStdin = NULL;
 	_files[IDX_STDERR] = _files[IDX_STDOUT] = NULL;
+	_stdoutFd = -1;
 	invalidate();
 	int sin[2];
 	int sout[2];
@@ -264,10 +418,17 @@ namespace storage
 
 	    const vector<const char*> env = make_env();
 
+	    // A command that may be killed runs in its own process group so that
+	    // also the children of the shell are killed.
+	    _killable = options.timeout.count() > 0 || OperationBudget::get_current();
+
 	    switch( (_cmdPid=fork()) )
 	    {
 		case 0: // child process
 
+		    if ( _killable )
+			setpgid( 0, 0 );
+
 		    if ( dup2( sin[0], STDIN_FILENO )<0 )
 		    {
 			SYSCALL_FAILED_NOTHROW( "dup2 stdin failed in child process" );
@@ -311,6 +472,8 @@ namespace storage
 		    break;
 
 		default: // parent process
+		    if ( _killable )
+			setpgid( _cmdPid, _cmdPid ); // avoid race with child, might fail
 		    if ( close( sin[0] ) < 0 )
 		    {
 			SYSCALL_FAILED_NOTHROW( "close( stdin ) in parent failed" );
@@ -331,10 +494,17 @@ namespace storage
 			SYSCALL_FAILED_NOTHROW( "fdopen( stdin ) failed" );
 		    }
 
-		    _files[IDX_STDOUT] = fdopen( sout[0], "r" );
-		    if ( _files[IDX_STDOUT] == NULL )
+		    if (options.capture_buffer)
+		    {
+			_stdoutFd = sout[0];
+		    }
+		    else
 		    {
-			SYSCALL_FAILED_NOTHROW( "fdopen( stdout ) failed" );
+			_files[IDX_STDOUT] = fdopen( sout[0], "r" );
+			if ( _files[IDX_STDOUT] == NULL )
+			{
+			    SYSCALL_FAILED_NOTHROW( "fdopen( stdout ) failed" );
+			}
 		    }
 		    _files[IDX_STDERR] = fdopen( serr[0], "r" );
 		    if ( _files[IDX_STDERR] == NULL )
@@ -342,7 +512,12 @@ namespace storage
 			SYSCALL_FAILED_NOTHROW( "fdopen( stderr ) failed" );
 		    }
 
+		    _pfds[3].fd = pidfd_open(_cmdPid);
+		    if (_pfds[3].fd < 0)
+			y2deb("pidfd_open failed, errno:" << errno);
+
 		    doWait( _cmdRet );
+
 		    y2mil("stopwatch " << stopwatch << " for \"" << command() << "\"");
 
 		    break;
@@ -357,8 +532,12 @@ namespace storage
 	    y2err("system (\"" << command() << "\") = " << _cmdRet);
 	}
 	checkOutput();
+	if (options.capture_buffer && !_logCommand)
+	    logStdoutBuffer();
 	y2mil("system() Returns:" << _cmdRet);
-	if ( _cmdRet!=0 )
+	if (_logCommand)
+	    logCommand();
+	else if ( _cmdRet!=0 )
 	    logOutput();
 	return _cmdRet;
     }
@@ -370,11 +549,38 @@ namespace storage
 	int waitpidRet;
 	int cmdStatus;
 
+	typedef chrono::steady_clock clock;
+
+	const OperationBudget* budget = OperationBudget::get_current();
+
+	clock::time_point deadline = clock::time_point::max();
+	if (options.timeout.count() > 0)
+	    deadline = clock::now() + options.timeout;
+	if (budget && budget->has_deadline())
+	    deadline = min(deadline, budget->get_deadline());
+
+	Abort abort = Abort::NONE;
+	clock::time_point kill_time;
+	bool killed = false;
+
 	do
 	{
+	    // Wake up in time for the next deadline. Without pidfd support or
+	    // with a cancel check also wake up periodically.
+
+	    clock::duration next = budget && budget->has_cancel_check() ? chrono::milliseconds(100) :
+		chrono::milliseconds(1000);
+
+	    if (abort == Abort::NONE && deadline != clock::time_point::max())
+		next = min(next, max(deadline - clock::now(), clock::duration::zero()));
+	    else if (abort != Abort::NONE && !killed)
+		next = min(next, max(kill_time - clock::now(), clock::duration::zero()));
+
+	    int timeout = chrono::ceil<chrono::milliseconds>(next).count();
+
 	    y2deb("[1] fd:" << _pfds[1].fd << " ev:" << hex << (unsigned)(_pfds[1].events) << dec << " "
 		  "[2] fd:" << _pfds[2].fd << " ev:" << hex << (unsigned)(_pfds[2].events));
-	    int sel = poll( _pfds, 3, 1000 );
+	    int sel = poll( _pfds, 4, timeout );
 	    if (sel < 0)
 	    {
 		SYSCALL_FAILED_NOTHROW( "poll() failed" );
@@ -389,22 +595,73 @@ namespace storage
 	    }
 	    waitpidRet = waitpid( _cmdPid, &cmdStatus, WNOHANG );
 	    y2deb("Wait ret:" << waitpidRet);
+
+	    if ( waitpidRet == 0 )
+	    {
+		if (abort == Abort::NONE)
+		{
+		    if (budget && budget->is_cancelled())
+			abort = Abort::CANCELLED;
+		    else if (budget && budget->is_exhausted())
+			abort = Abort::EXHAUSTED;
+		    else if (clock::now() >= deadline)
+			abort = Abort::TIMEOUT;
+
+		    if (abort != Abort::NONE)
+		    {
+			y2war("terminating pid:" << _cmdPid << " \"" << command() << "\"");
+			terminate(SIGTERM);
+			kill_time = clock::now() + options.kill_grace;
+		    }
+		}
+		else if (!killed && clock::now() >= kill_time)
+		{
+		    y2war("killing pid:" << _cmdPid << " \"" << command() << "\"");
+		    terminate(SIGKILL);
+		    killed = true;
+		}
+	    }
 	}
 	while ( waitpidRet == 0 );
 
 	if ( waitpidRet != 0 )
 	{
 	    checkOutput();
+	    if ( _pfds[3].fd >= 0 )
+	    {
+		close( _pfds[3].fd );
+		_pfds[3].fd = -1;
+	    }
             if ( _childStdin )
             {
                 fclose( _childStdin );
                 _childStdin = NULL;
             }
-	    fclose( _files[IDX_STDOUT] );
-	    _files[IDX_STDOUT] = NULL;
+	    closeStdout();
 	    fclose( _files[IDX_STDERR] );
 	    _files[IDX_STDERR] = NULL;
-	    if (WIFEXITED(cmdStatus))
+	    if (abort != Abort::NONE)
+	    {
+		cmdRet_ret = -1;
+		if (_logCommand)
+		    logCommand();
+		else
+		    logOutput();
+
+		switch (abort)
+		{
+		    case Abort::TIMEOUT:
+			ST_THROW(CommandTimeoutException(this));
+
+		    case Abort::CANCELLED:
+			ST_THROW(CommandCancelledException(this, "Command cancelled"));
+
+		    case Abort::EXHAUSTED:
+		    case Abort::NONE:
+			ST_THROW(CommandCancelledException(this, "Time budget exhausted"));
+		}
+	    }
+	    else if (WIFEXITED(cmdStatus))
 	    {
 		cmdRet_ret = WEXITSTATUS(cmdStatus);
 		if ( cmdRet_ret == SHELL_RET_COMMAND_NOT_EXECUTABLE )
@@ -431,6 +688,14 @@ namespace storage
     }
 
 
+    void
+    SystemCmd::terminate(int signal) const
+    {
+	if (kill(_killable ? -_cmdPid : _cmdPid, signal) < 0)
+	    SYSCALL_FAILED_NOTHROW( "kill() failed" );
+    }
+
+
     void
     SystemCmd::invalidate()
     {
@@ -439,6 +704,10 @@ namespace storage
 	    _outputLines[streamIndex].clear();
 	    _newLineSeen[streamIndex] = true;
 	}
+
+	_stdoutBuffer.clear();
+	_stdoutMockup = string_view();
+	_stdoutSplit = false;
     }
 
 
@@ -448,12 +717,92 @@ namespace storage
 	y2deb("NewLine out:" << _newLineSeen[IDX_STDOUT] << " err:" << _newLineSeen[IDX_STDERR]);
 	if (_files[IDX_STDOUT])
 	    getUntilEOF(_files[IDX_STDOUT], _outputLines[IDX_STDOUT], _newLineSeen[IDX_STDOUT], false);
+	else if (_stdoutFd >= 0)
+	    readUntilEOF();
 	if (_files[IDX_STDERR])
 	    getUntilEOF(_files[IDX_STDERR], _outputLines[IDX_STDERR], _newLineSeen[IDX_STDERR], true);
 	y2deb("NewLine out:" << _newLineSeen[IDX_STDOUT] << " err:" << _newLineSeen[IDX_STDERR]);
     }
 
 
+    void
+    SystemCmd::readUntilEOF()
+    {
+	// Grow the buffer geometrically and read directly into it. The file
+	// descriptor is non-blocking so reading stops at EAGAIN.
+
+	const string::size_type chunk = 64 * 1024;
+
+	while (true)
+	{
+	    string::size_type old_size = _stdoutBuffer.size();
+
+	    if (_stdoutBuffer.capacity() < old_size + chunk)
+		_stdoutBuffer.reserve(max(2 * _stdoutBuffer.capacity(), old_size + chunk));
+
+	    _stdoutBuffer.resize(old_size + chunk);
+
+	    ssize_t count = read(_stdoutFd, &_stdoutBuffer[old_size], chunk);
+
+	    _stdoutBuffer.resize(old_size + max(count, (ssize_t) 0));
+
+	    if (count > 0)
+		continue;
+
+	    if (count < 0 && errno == EINTR)
+		continue;
+
+	    if (count < 0 && errno != EAGAIN)
+		SYSCALL_FAILED_NOTHROW( "read( stdout ) failed" );
+
+	    break;
+	}
+    }
+
+
+    void
+    SystemCmd::closeStdout()
+    {
+	if ( _files[IDX_STDOUT] )
+	{
+	    fclose( _files[IDX_STDOUT] );
+	    _files[IDX_STDOUT] = NULL;
+	}
+
+	if ( _stdoutFd >= 0 )
+	{
+	    close( _stdoutFd );
+	    _stdoutFd = -1;
+	}
+    }
+
+
+    const vector<string>&
+    SystemCmd::stdout() const
+    {
+	if (options.capture_buffer && !_stdoutSplit)
+	{
+	    _outputLines[IDX_STDOUT] = stdout_lines().to_vector();
+	    _stdoutSplit = true;
+	}
+
+	return _outputLines[IDX_STDOUT];
+    }
+
+
+    LinesView
+    SystemCmd::stdout_lines() const
+    {
+	if (!options.capture_buffer)
+	    ST_THROW(Exception("stdout_lines needs capture_buffer"));
+
+	if (_stdoutMockup.data())
+	    return LinesView(_stdoutMockup);
+
+	return LinesView(_stdoutBuffer);
+    }
+
+
     void
     SystemCmd::sendStdin()
     {
@@ -564,7 +913,7 @@ namespace storage
     void
     SystemCmd::addLine(const string& text, vector<string>& lines) const
     {
-	if (lines.size() < options.log_line_limit)
+	if (lines.size() < options.log_line_limit && !_logCommand)
 	{
 	    y2mil("Adding Line " << lines.size() + 1 << " \"" << text << "\"");
 	}
@@ -577,6 +926,25 @@ namespace storage
     }
 
 
+    void
+    SystemCmd::logStdoutBuffer() const
+    {
+	y2mil("pid:" << _cmdPid << " read bytes:" << _stdoutBuffer.size());
+
+	unsigned int count = 0;
+
+	for (std::string_view line : stdout_lines())
+	{
+	    if (++count <= options.log_line_limit)
+		y2mil("Adding Line " << count << " \"" << line << "\"");
+	    else if (query_log_level(LogLevel::DEBUG))
+		y2deb("Adding Line " << count << " \"" << line << "\"");
+	    else
+		break;
+	}
+    }
+
+
     void
     SystemCmd::logOutput() const
     {
@@ -616,6 +984,41 @@ namespace storage
     }
 
 
+    void
+    SystemCmd::logCommand() const
+    {
+	LogCommand record;
+
+	record.command = command();
+	record.exit_code = _cmdRet;
+
+	if (options.capture_buffer)
+	{
+	    for (std::string_view line : stdout_lines())
+	    {
+		if (record.stdout_lines.size() < options.log_line_limit)
+		    record.stdout_lines.emplace_back(line);
+		else
+		    ++record.omitted_stdout_lines;
+	    }
+	}
+	else
+	{
+	    const vector<string>& lines = _outputLines[IDX_STDOUT];
+	    size_t n = min<size_t>(lines.size(), options.log_line_limit);
+	    record.stdout_lines.assign(lines.begin(), lines.begin() + n);
+	    record.omitted_stdout_lines = lines.size() - n;
+	}
+
+	const vector<string>& lines = _outputLines[IDX_STDERR];
+	size_t n = min<size_t>(lines.size(), options.log_line_limit);
+	record.stderr_lines.assign(lines.begin(), lines.begin() + n);
+	record.omitted_stderr_lines = lines.size() - n;
+
+	log_command(LogLevel::MILESTONE, __FILE__, __LINE__, __FUNCTION__, std::move(record));
+    }
+
+
     vector<const char*>
     SystemCmd::make_env() const
     {
@@ -29,11 +29,14 @@
 #include <stdio.h>
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <chrono>
 #include <functional>
 #include <boost/noncopyable.hpp>
 
 #include "storage/Utils/Exception.h"
+#include "storage/Utils/LinesIterator.h"
 
 
 namespace storage
@@ -97,6 +100,27 @@ namespace storage
 	     */
 	    vector<string> env;
 
+	    /**
+	     * If true stdout is captured with read(2) into one contiguous buffer
+	     * instead of being split into lines while reading. Intended for
+	     * commands with large output. Parsers should use stdout_lines() then.
+	     */
+	    bool capture_buffer = false;
+
+	    /**
+	     * Timeout for the command. Zero means no timeout. When the timeout
+	     * expires the command is terminated with SIGTERM and, if still
+	     * running after kill_grace, with SIGKILL. Afterwards a
+	     * CommandTimeoutException is thrown, independent of the throw
+	     * behaviour. Additionally the current OperationBudget applies.
+	     */
+	    std::chrono::milliseconds timeout = std::chrono::milliseconds::zero();
+
+	    /**
+	     * Time between SIGTERM and SIGKILL when terminating the command.
+	     */
+	    std::chrono::milliseconds kill_grace = std::chrono::seconds(5);
+
 	};
 
 	/**
@@ -125,12 +149,25 @@ namespace storage
 	 **/
 	int execute();
 
+	/**
+	 * Update the metrics for commands after execute.
+	 */
+	void update_metrics(double duration) const;
+
     public:
 
 	/**
-	 * Return the output lines collected on stdout so far.
+	 * Return the output lines collected on stdout so far. With capture_buffer
+	 * the lines are split from the buffer on first use.
 	 */
-	const vector<string>& stdout() const { return _outputLines[IDX_STDOUT]; }
+	const vector<string>& stdout() const;
+
+	/**
+	 * Return a view of the stdout lines without copying them. Only available
+	 * with capture_buffer. During playback of a binary mockup the view
+	 * points into the mockup.
+	 */
+	LinesView stdout_lines() const;
 
 	/**
 	 * Return the output lines collected on stderr so far.
@@ -163,6 +200,8 @@ namespace storage
 
 	enum OutputStream { IDX_STDOUT, IDX_STDERR };
 
+	enum class Abort { NONE, TIMEOUT, CANCELLED, EXHAUSTED };
+
 	void init();
 	void cleanup();
 	void invalidate();
@@ -170,6 +209,8 @@ namespace storage
 	int doExecute();
 	bool doWait(int& cmdRet_ret);
 	void checkOutput();
+	void readUntilEOF();
+	void closeStdout();
         void sendStdin();
 	void getUntilEOF(FILE* file, vector<string>& lines,
 			 bool& newLineSeen_ret, bool isStderr) const;
@@ -177,7 +218,11 @@ namespace storage
 			    string& text, vector<string>& lines) const;
 	void addLine(const string& text, vector<string>& lines) const;
 
+	void terminate(int signal) const;
+
 	void logOutput() const;
+	void logStdoutBuffer() const;
+	void logCommand() const;
 
 	bool do_throw() const { return options.throw_behaviour == DoThrow; }
 
@@ -188,11 +233,28 @@ namespace storage
 
 	FILE* _files[2];
         FILE* _childStdin;
-	vector<string> _outputLines[2];
+	int _stdoutFd;
+	mutable vector<string> _outputLines[2];
+	string _stdoutBuffer;
+	mutable bool _stdoutSplit;
 	bool _newLineSeen[2];
 	int _cmdRet;
 	int _cmdPid;
-	struct pollfd _pfds[3];
+	bool _killable;
+	struct pollfd _pfds[4];
+
+	/**
+	 * Whether the output is logged with one structured record by
+	 * logCommand() instead of log lines.
+	 */
+	bool _logCommand = false;
+
+	/**
+	 * With capture_buffer during playback of a binary mockup the stdout
+	 * buffer in the mockup, used instead of _stdoutBuffer to avoid
+	 * copying.
+	 */
+	std::string_view _stdoutMockup;
 
 	/**
 	 * Constructs the environment for the child process.
@@ -228,6 +290,7 @@ namespace storage
 		_cmd = sysCmd->command();
 		setMsg( msg + ": \"" + _cmd + "\"" );
 		_cmdRet = sysCmd->retcode();
+		_stdout = sysCmd->stdout();
 		_stderr = sysCmd->stderr();
 	    }
 	    else
@@ -251,6 +314,12 @@ namespace storage
 	 */
 	int cmdRet() const { return _cmdRet; }
 
+	/**
+	 * Return the stdout output of the command. If the command was
+	 * terminated this is the output read so far.
+	 */
+	const vector<string> & stdout() const { return _stdout; }
+
 	/**
 	 * Return the stderr output of the command. If the command could not be
 	 * started, this will be empty.
@@ -260,6 +329,7 @@ namespace storage
     protected:
 	string _cmd;
 	int    _cmdRet;
+	vector<string> _stdout;
 	vector<string> _stderr;
     };
 
@@ -286,6 +356,41 @@ namespace storage
 
 
 
+    /**
+     * Exception thrown if a command was terminated since its timeout expired.
+     * The exception includes the output read so far.
+     */
+    class CommandTimeoutException : public SystemCmdException
+    {
+    public:
+	CommandTimeoutException(const SystemCmd* sysCmd)
+	    : SystemCmdException(sysCmd, "Command timed out")
+	    {}
+
+	virtual ~CommandTimeoutException() noexcept
+	    {}
+    };
+
+
+    /**
+     * Exception thrown if a command was terminated, or not even started,
+     * since the operation (probe or commit) was cancelled or its time budget
+     * is exhausted, see OperationBudget. Callers should not continue the
+     * operation.
+     */
+    class CommandCancelledException : public SystemCmdException
+    {
+    public:
+	CommandCancelledException(const SystemCmd* sysCmd, const string& msg)
+	    : SystemCmdException(sysCmd, msg)
+	    {}
+
+	virtual ~CommandCancelledException() noexcept
+	    {}
+    };
+
+
+
     inline string
     quote(const string& str)
     {
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include "storage/Utils/SystemCmdPool.h"
+#include "storage/Utils/ThreadContext.h"
+#include "storage/Utils/OperationBudget.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/EnvironmentImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    SystemCmdPool::SystemCmdPool(unsigned int size)
+	: size(max(size, 1U))
+    {
+    }
+
+
+    SystemCmdPool::~SystemCmdPool()
+    {
+	{
+	    unique_lock<std::mutex> lock(mutex);
+	    stopping = true;
+	}
+
+	condition.notify_all();
+
+	for (thread& worker : workers)
+	    worker.join();
+    }
+
+
+    SystemCmdPool&
+    SystemCmdPool::get_global()
+    {
+	static SystemCmdPool global(command_pool_size());
+
+	return global;
+    }
+
+
+    SystemCmdFuture
+    SystemCmdPool::submit(const SystemCmd::Options& options)
+    {
+	task_t task([options, thread_context = ThreadContext()]() {
+	    ThreadContext::Guard guard(thread_context);
+	    return make_unique<SystemCmd>(options);
+	});
+
+	SystemCmdFuture future = task.get_future();
+
+	{
+	    unique_lock<std::mutex> lock(mutex);
+
+	    tasks.push_back(std::move(task));
+
+	    if (tasks.size() > idle && workers.size() < size)
+	    {
+		y2deb("starting command pool worker " << workers.size() + 1 << " of " << size);
+		workers.emplace_back(&SystemCmdPool::run, this);
+	    }
+	}
+
+	condition.notify_one();
+
+	return future;
+    }
+
+
+    SystemCmdFuture
+    SystemCmdPool::submit(const string& command, SystemCmd::ThrowBehaviour throw_behaviour)
+    {
+	return submit(SystemCmd::Options(command, throw_behaviour));
+    }
+
+
+    void
+    SystemCmdPool::run()
+    {
+	while (true)
+	{
+	    task_t task;
+
+	    {
+		unique_lock<std::mutex> lock(mutex);
+
+		++idle;
+		condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+		--idle;
+
+		if (tasks.empty())
+		    return;
+
+		task = std::move(tasks.front());
+		tasks.pop_front();
+	    }
+
+	    // Exceptions are stored in the future.
+	    task();
+	}
+    }
+
+
+    vector<unique_ptr<SystemCmd>>
+    wait_all(vector<SystemCmdFuture>& futures)
+    {
+	vector<unique_ptr<SystemCmd>> ret;
+	exception_ptr ep;
+
+	const OperationBudget* budget = OperationBudget::get_current();
+
+	for (SystemCmdFuture& future : futures)
+	{
+	    // Only the calling thread may call the cancel callback, so poll it
+	    // while waiting for the workers, see OperationBudget.
+
+	    if (budget && budget->has_cancel_check())
+	    {
+		while (future.wait_for(chrono::milliseconds(100)) != future_status::ready)
+		    OperationBudget::poll();
+	    }
+
+	    try
+	    {
+		ret.push_back(future.get());
+	    }
+	    catch (...)
+	    {
+		if (!ep)
+		    ep = current_exception();
+
+		ret.push_back(nullptr);
+	    }
+	}
+
+	if (ep)
+	    rethrow_exception(ep);
+
+	return ret;
+    }
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_SYSTEM_CMD_POOL_H
+#define STORAGE_SYSTEM_CMD_POOL_H
+
+
+#include <memory>
+#include <future>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <boost/noncopyable.hpp>
+
+#include "storage/Utils/SystemCmd.h"
+
+
+namespace storage
+{
+
+    /**
+     * Future for a command submitted to the SystemCmdPool. Once ready it holds the
+     * finished SystemCmd (with stdout, stderr and exit code) or the exception thrown
+     * while running the command.
+     */
+    typedef std::future<std::unique_ptr<SystemCmd>> SystemCmdFuture;
+
+
+    /**
+     * Bounded pool of worker threads running SystemCmds in the background. The
+     * number of workers limits the number of concurrently running commands. Further
+     * commands are queued in FIFO order.
+     *
+     * Workers are started lazily on the first submit.
+     */
+    class SystemCmdPool : private boost::noncopyable
+    {
+    public:
+
+	SystemCmdPool(unsigned int size);
+	~SystemCmdPool();
+
+	/**
+	 * Get the process-wide pool. The size can be set with the environment
+	 * variable LIBSTORAGE_CMD_POOL_SIZE.
+	 */
+	static SystemCmdPool& get_global();
+
+	/**
+	 * Queue the command for execution and return a future for it. If the
+	 * command fails and the throw behaviour is DoThrow the exception is
+	 * rethrown from the get() of the future.
+	 */
+	SystemCmdFuture submit(const SystemCmd::Options& options);
+
+	/**
+	 * Convenience function where only the command and the throw behaviour
+	 * can be specified.
+	 */
+	SystemCmdFuture submit(const string& command, SystemCmd::ThrowBehaviour throw_behaviour =
+			       SystemCmd::NoThrow);
+
+	unsigned int get_size() const { return size; }
+
+    private:
+
+	typedef std::packaged_task<std::unique_ptr<SystemCmd>()> task_t;
+
+	void run();
+
+	const unsigned int size;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	std::deque<task_t> tasks;
+	std::vector<std::thread> workers;
+
+	unsigned int idle = 0;
+	bool stopping = false;
+
+    };
+
+
+    /**
+     * Wait for all futures and return the finished commands in the order of the
+     * futures. Rethrows the first exception after all commands have finished.
+     */
+    vector<std::unique_ptr<SystemCmd>> wait_all(vector<SystemCmdFuture>& futures);
+
+}
+
+
+#endif
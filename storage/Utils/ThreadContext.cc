@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include "storage/Utils/ThreadContext.h"
+#include "storage/Utils/ProbeCache.h"
+#include "storage/Utils/OperationBudget.h"
+#include "storage/Utils/LoggerImpl.h"
+
+
+namespace storage
+{
+
+    ThreadContext::ThreadContext()
+	: mockup_state(Mockup::get_current_state()), probe_cache(ProbeCache::get_current()),
+	  operation_budget(OperationBudget::get_current()), correlation_id(LogCorrelation::get_current())
+    {
+    }
+
+
+    void
+    ThreadContext::apply() const
+    {
+	Mockup::set_current_state(mockup_state);
+	ProbeCache::set_current(probe_cache);
+	OperationBudget::set_current(operation_budget);
+	LogCorrelation::set_current(correlation_id);
+    }
+
+
+    ThreadContext::Guard::Guard(const ThreadContext& thread_context)
+    {
+	thread_context.apply();
+    }
+
+
+    ThreadContext::Guard::~Guard()
+    {
+	previous.apply();
+    }
+
+}
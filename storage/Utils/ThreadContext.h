@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_THREAD_CONTEXT_H
+#define STORAGE_THREAD_CONTEXT_H
+
+
+#include <string>
+#include <memory>
+
+#include "storage/Utils/Mockup.h"
+
+
+namespace storage
+{
+
+    class ProbeCache;
+    class OperationBudget;
+
+
+    /**
+     * The thread-local state of an operation, e.g. of a probe: the
+     * mockup state, the probe cache, the operation budget and the
+     * correlation id for logging. Since this state is thread-local
+     * several Storage objects can run operations at the same time.
+     *
+     * Worker threads, e.g. of parallel_for() or the SystemCmdPool, take
+     * over the context of the thread that queued the work.
+     */
+    class ThreadContext
+    {
+    public:
+
+	/**
+	 * Captures the context of the current thread.
+	 */
+	ThreadContext();
+
+	class Guard;
+
+    private:
+
+	void apply() const;
+
+	std::shared_ptr<Mockup::State> mockup_state;
+	ProbeCache* probe_cache;
+	const OperationBudget* operation_budget;
+	std::string correlation_id;
+
+    };
+
+
+    /**
+     * Sets the context for the current thread for the lifetime of the
+     * object.
+     */
+    class ThreadContext::Guard
+    {
+    public:
+
+	Guard(const ThreadContext& thread_context);
+	~Guard();
+
+	Guard(const Guard&) = delete;
+	Guard& operator=(const Guard&) = delete;
+
+    private:
+
+	const ThreadContext previous;
+
+    };
+
+}
+
+
+#endif
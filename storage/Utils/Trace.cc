@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <json-c/json.h>
+#include <atomic>
+#include <mutex>
+
+#include "storage/Utils/Trace.h"
+#include "storage/Utils/LoggerImpl.h"
+
+
+namespace storage
+{
+    using namespace std;
+
+
+    namespace
+    {
+
+	struct Event
+	{
+	    const char* category;
+	    string name;
+	    long tid;
+	    long long ts;	// in microseconds
+	    long long dur;	// in microseconds
+	    vector<pair<const char*, string>> args;
+	};
+
+
+	/**
+	 * Limit for the number of recorded spans to avoid unbounded memory
+	 * usage in long running programs.
+	 */
+	const size_t max_events = 1000000;
+
+
+	std::atomic<int> tracers(0);
+
+	std::mutex events_mutex;
+
+	vector<Event> events;
+
+	size_t dropped_events = 0;
+
+	const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+
+	long
+	get_tid()
+	{
+	    static thread_local const long tid = syscall(SYS_gettid);
+
+	    return tid;
+	}
+
+
+	long long
+	microseconds(chrono::steady_clock::duration duration)
+	{
+	    return chrono::duration_cast<chrono::microseconds>(duration).count();
+	}
+
+
+	json_object*
+	to_json(const Event& event, long pid)
+	{
+	    json_object* json_event = json_object_new_object();
+
+	    json_object_object_add(json_event, "name", json_object_new_string(event.name.c_str()));
+	    json_object_object_add(json_event, "cat", json_object_new_string(event.category));
+	    json_object_object_add(json_event, "ph", json_object_new_string("X"));
+	    json_object_object_add(json_event, "ts", json_object_new_int64(event.ts));
+	    json_object_object_add(json_event, "dur", json_object_new_int64(event.dur));
+	    json_object_object_add(json_event, "pid", json_object_new_int64(pid));
+	    json_object_object_add(json_event, "tid", json_object_new_int64(event.tid));
+
+	    if (!event.args.empty())
+	    {
+		json_object* json_args = json_object_new_object();
+
+		for (const pair<const char*, string>& arg : event.args)
+		    json_object_object_add(json_args, arg.first, json_object_new_string(arg.second.c_str()));
+
+		json_object_object_add(json_event, "args", json_args);
+	    }
+
+	    return json_event;
+	}
+
+    }
+
+
+    Tracer::Tracer(const string& filename)
+	: filename(filename)
+    {
+	y2mil("tracing to " << filename);
+
+	std::lock_guard<std::mutex> lock(events_mutex);
+
+	// Spans from an earlier trace are dropped.
+
+	if (tracers++ == 0)
+	{
+	    events.clear();
+	    dropped_events = 0;
+	}
+    }
+
+
+    Tracer::~Tracer()
+    {
+	--tracers;
+
+	write();
+    }
+
+
+    void
+    Tracer::write() const
+    {
+	const long pid = getpid();
+
+	json_object* root = json_object_new_object();
+	json_object* json_events = json_object_new_array();
+
+	json_object* process_name = json_object_new_object();
+	json_object_object_add(process_name, "name", json_object_new_string("process_name"));
+	json_object_object_add(process_name, "ph", json_object_new_string("M"));
+	json_object_object_add(process_name, "pid", json_object_new_int64(pid));
+	json_object* process_name_args = json_object_new_object();
+	json_object_object_add(process_name_args, "name", json_object_new_string("libstorage-ng"));
+	json_object_object_add(process_name, "args", process_name_args);
+	json_object_array_add(json_events, process_name);
+
+	size_t size;
+
+	{
+	    std::lock_guard<std::mutex> lock(events_mutex);
+
+	    size = events.size();
+
+	    for (const Event& event : events)
+		json_object_array_add(json_events, to_json(event, pid));
+
+	    if (dropped_events > 0)
+		y2war("trace dropped " << dropped_events << " spans");
+	}
+
+	json_object_object_add(root, "traceEvents", json_events);
+	json_object_object_add(root, "displayTimeUnit", json_object_new_string("ms"));
+
+	if (json_object_to_file_ext(filename.c_str(), root, JSON_C_TO_STRING_PLAIN) != 0)
+	    y2err("writing trace to " << filename << " failed");
+	else
+	    y2mil("wrote " << size << " spans to " << filename);
+
+	json_object_put(root);
+    }
+
+
+    bool
+    Tracer::is_enabled()
+    {
+	return tracers > 0;
+    }
+
+
+    TraceSpan::TraceSpan(const char* category, const char* name)
+	: enabled(Tracer::is_enabled()), category(category)
+    {
+	if (enabled)
+	{
+	    TraceSpan::name = name;
+	    start_time = chrono::steady_clock::now();
+	}
+    }
+
+
+    TraceSpan::TraceSpan(const char* category, const string& name)
+	: enabled(Tracer::is_enabled()), category(category)
+    {
+	if (enabled)
+	{
+	    TraceSpan::name = name;
+	    start_time = chrono::steady_clock::now();
+	}
+    }
+
+
+    TraceSpan::~TraceSpan()
+    {
+	if (!enabled)
+	    return;
+
+	const chrono::steady_clock::time_point stop_time = chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(events_mutex);
+
+	if (events.size() >= max_events)
+	{
+	    ++dropped_events;
+	    return;
+	}
+
+	events.push_back({ category, std::move(name), get_tid(), microseconds(start_time - epoch),
+		microseconds(stop_time - start_time), std::move(args) });
+    }
+
+
+    void
+    TraceSpan::add_arg(const char* key, const string& value)
+    {
+	if (enabled)
+	    args.emplace_back(key, value);
+    }
+
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+
+#ifndef STORAGE_TRACE_H
+#define STORAGE_TRACE_H
+
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <boost/noncopyable.hpp>
+
+
+namespace storage
+{
+    using std::string;
+    using std::vector;
+
+
+    /**
+     * Collects trace spans and writes them in the Chrome trace event
+     * format, see
+     * https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU.
+     *
+     * While at least one Tracer exists spans are recorded. All Tracers
+     * share the recorded spans. Constructing a Tracer while no other
+     * exists drops the spans of an earlier trace.
+     */
+    class Tracer : private boost::noncopyable
+    {
+    public:
+
+	Tracer(const string& filename);
+
+	/**
+	 * Writes the trace file.
+	 */
+	~Tracer();
+
+	/**
+	 * Write all spans recorded so far to the trace file. Errors are
+	 * only logged.
+	 */
+	void write() const;
+
+	/**
+	 * Return whether spans are recorded.
+	 */
+	static bool is_enabled();
+
+    private:
+
+	const string filename;
+
+    };
+
+
+    /**
+     * A span in the trace. The span starts with the construction and ends
+     * with the destruction of the object. Spans nest by time, so spans
+     * constructed while another span of the same thread exists are shown
+     * as its children.
+     *
+     * If no Tracer exists the object does nothing.
+     */
+    class TraceSpan : private boost::noncopyable
+    {
+    public:
+
+	TraceSpan(const char* category, const char* name);
+	TraceSpan(const char* category, const string& name);
+
+	~TraceSpan();
+
+	/**
+	 * Add an attribute to the span, e.g. the device name or the
+	 * command.
+	 */
+	void add_arg(const char* key, const string& value);
+
+    private:
+
+	const bool enabled;
+
+	const char* category;
+	string name;
+	vector<std::pair<const char*, string>> args;
+
+	std::chrono::steady_clock::time_point start_time;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_UEVENT_MONITOR_H
+#define STORAGE_UEVENT_MONITOR_H
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <boost/noncopyable.hpp>
+
+
+namespace storage
+{
+
+    /**
+     * Listens to kernel uevents and collects the names of changed block
+     * devices, e.g. to be passed to Storage::reprobe().
+     *
+     * The monitor only reports devices, it does not wait for udev to
+     * process the events. This is done during probing.
+     */
+    class UeventMonitor : private boost::noncopyable
+    {
+    public:
+
+	/**
+	 * Open the netlink socket.
+	 *
+	 * @throw Exception
+	 */
+	UeventMonitor();
+
+	~UeventMonitor();
+
+	/**
+	 * File descriptor of the netlink socket, e.g. for poll(). Readable
+	 * when uevents are pending.
+	 */
+	int get_fd() const;
+
+	/**
+	 * Read all pending uevents and return the names of the block devices
+	 * that were added, removed or changed, e.g. "/dev/sda". Does not
+	 * block. Each device is reported only once.
+	 *
+	 * @throw Exception
+	 */
+	std::vector<std::string> get_changed_devices();
+
+    public:
+
+	class Impl;
+
+	Impl& get_impl() { return *impl; }
+	const Impl& get_impl() const { return *impl; }
+
+    private:
+
+	const std::unique_ptr<Impl> impl;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "storage/Utils/UeventMonitorImpl.h"
+#include "storage/Utils/ExceptionImpl.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/Format.h"
+#include "storage/Utils/StorageTmpl.h"
+
+
+namespace storage
+{
+
+    using namespace std;
+
+
+    UeventMonitor::Impl::Impl()
+    {
+	fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+	if (fd < 0)
+	    ST_THROW(Exception(sformat("socket for uevents failed, errno:%d (%s)", errno,
+				       strerror(errno))));
+
+	struct sockaddr_nl addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = 1;	// kernel uevents
+
+	if (bind(fd, (struct sockaddr*)(&addr), sizeof(addr)) != 0)
+	{
+	    int errnum = errno;
+	    close(fd);
+	    ST_THROW(Exception(sformat("bind for uevents failed, errno:%d (%s)", errnum,
+				       strerror(errnum))));
+	}
+    }
+
+
+    UeventMonitor::Impl::~Impl()
+    {
+	close(fd);
+    }
+
+
+    vector<string>
+    UeventMonitor::Impl::get_changed_devices()
+    {
+	set<string> devices;
+
+	char buffer[8192];
+
+	while (true)
+	{
+	    ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+	    if (length < 0)
+	    {
+		if (errno == EINTR)
+		    continue;
+
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		    break;
+
+		// ENOBUFS means that uevents were lost.
+		ST_THROW(Exception(sformat("recv for uevents failed, errno:%d (%s)", errno,
+					   strerror(errno))));
+	    }
+
+	    parse(buffer, length, devices);
+	}
+
+	vector<string> ret(devices.begin(), devices.end());
+
+	y2mil("changed devices " << ret);
+
+	return ret;
+    }
+
+
+    void
+    UeventMonitor::Impl::parse(const char* message, size_t length, set<string>& devices)
+    {
+	bool is_block = false;
+	string devname;
+
+	// The message consists of null terminated strings, the first one
+	// being the header.
+
+	for (size_t pos = strnlen(message, length) + 1; pos < length; )
+	{
+	    const char* field = message + pos;
+	    size_t field_length = strnlen(field, length - pos);
+
+	    if (strncmp(field, "SUBSYSTEM=", 10) == 0)
+		is_block = string(field + 10, field_length - 10) == "block";
+	    else if (strncmp(field, "DEVNAME=", 8) == 0)
+		devname = string(field + 8, field_length - 8);
+
+	    pos += field_length + 1;
+	}
+
+	if (is_block && !devname.empty())
+	    devices.insert(devname[0] == '/' ? devname : DEV_DIR "/" + devname);
+    }
+
+}
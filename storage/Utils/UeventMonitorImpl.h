@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_UEVENT_MONITOR_IMPL_H
+#define STORAGE_UEVENT_MONITOR_IMPL_H
+
+
+#include <set>
+
+#include "storage/Utils/UeventMonitor.h"
+
+
+namespace storage
+{
+
+    using std::string;
+    using std::vector;
+    using std::set;
+
+
+    class UeventMonitor::Impl
+    {
+    public:
+
+	Impl();
+	~Impl();
+
+	int get_fd() const { return fd; }
+
+	vector<string> get_changed_devices();
+
+	/**
+	 * Parse a kernel uevent message, e.g. "change@/devices/...\0ACTION=change\0
+	 * SUBSYSTEM=block\0DEVNAME=sda\0...", and add the device name of block
+	 * devices to devices.
+	 */
+	static void parse(const char* message, size_t length, set<string>& devices);
+
+    private:
+
+	int fd = -1;
+
+    };
+
+}
+
+#endif
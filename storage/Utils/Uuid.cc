@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#include "storage/Utils/Uuid.h"
+#include "storage/Utils/Format.h"
+
+
+namespace storage
+{
+
+    string
+    format_uuid(const unsigned char uuid[16])
+    {
+	// boost::format prints unsigned chars as characters so they must be
+	// converted to unsigned ints.
+
+	unsigned int b[16];
+	for (int i = 0; i < 16; ++i)
+	    b[i] = uuid[i];
+
+	return sformat("%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+		       b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7],
+		       b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]);
+    }
+
+
+    string
+    format_mixed_endian_guid(const unsigned char guid[16])
+    {
+	const unsigned char uuid[16] = {
+	    guid[3], guid[2], guid[1], guid[0], guid[5], guid[4], guid[7], guid[6],
+	    guid[8], guid[9], guid[10], guid[11], guid[12], guid[13], guid[14], guid[15]
+	};
+
+	return format_uuid(uuid);
+    }
+
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2023 SUSE LLC
+ *
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of version 2 of the GNU General Public License as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, contact Novell, Inc.
+ *
+ * To contact Novell about this file by physical or electronic mail, you may
+ * find current contact information at www.novell.com.
+ */
+
+
+#ifndef STORAGE_UUID_H
+#define STORAGE_UUID_H
+
+
+#include <string>
+
+
+namespace storage
+{
+
+    using std::string;
+
+
+    /**
+     * Format the 16 bytes of a UUID stored in big endian (as defined in
+     * RFC 4122), e.g. "6a0c2e4b-8a2d-4462-9b5e-1f0e93134caf".
+     */
+    string format_uuid(const unsigned char uuid[16]);
+
+    /**
+     * Format the 16 bytes of a GUID stored in mixed endian, i.e. with the
+     * first three fields in little endian, as used e.g. by GPT and
+     * BitLocker. The result has the same form as for format_uuid().
+     */
+    string format_mixed_endian_guid(const unsigned char guid[16]);
+
+}
+
+
+#endif
@@ -0,0 +1,286 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fstream>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+
+#include "storage/SystemInfo/BlkidProbe.h"
+#include "storage/SystemInfo/CmdBlkid.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/StorageDefines.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+const string tree = "blkid-probe-tree";
+
+
+void
+write_file(const string& filename, const string& content)
+{
+    ofstream s(filename);
+    s << content << '\n';
+}
+
+
+void
+set_mtime(const string& filename, time_t sec)
+{
+    const struct timespec times[2] = { { sec, 0 }, { sec, 0 } };
+    BOOST_REQUIRE(utimensat(AT_FDCWD, filename.c_str(), times, 0) == 0);
+}
+
+
+/**
+ * Creates a fake udev database and sysfs with the disk sda (8:0) and its
+ * partition sda1 (8:1).
+ */
+void
+setup_tree()
+{
+    system(("rm -rf " + tree).c_str());
+
+    for (const char* dir : { "", "/udev", "/udev/data", "/udev/watch", "/sys", "/sys/dev",
+			       "/sys/dev/block", "/sys/devices", "/sys/devices/sda",
+			       "/sys/devices/sda/sda1" })
+	mkdir((tree + dir).c_str(), 0755);
+
+    write_file(tree + "/sys/devices/sda/diskseq", "7");
+    write_file(tree + "/sys/devices/sda/sda1/partition", "1");
+
+    symlink("../../devices/sda", (tree + "/sys/dev/block/8:0").c_str());
+    symlink("../../devices/sda/sda1", (tree + "/sys/dev/block/8:1").c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(parse_partitions)
+{
+    setup_tree();
+
+    mkdir((tree + "/sys/block").c_str(), 0755);
+    mkdir((tree + "/sys/block/dm-0").c_str(), 0755);
+    mkdir((tree + "/sys/block/dm-0/dm").c_str(), 0755);
+    write_file(tree + "/sys/block/dm-0/dm/name", "cr_home");
+
+    const vector<string> lines = {
+	"major minor  #blocks  name",
+	"",
+	"   8        0  500107608 sda",
+	"   8        1     524288 sda1",
+	"   8        2          1 sda2",
+	"   8        5  499582279 sda5",
+	" 254        0  499580231 dm-0",
+	" 254        1    1048576 dm-1",
+    };
+
+    const vector<string> devices = BlkidProbe::parse_partitions(lines, tree + "/sys");
+
+    const vector<string> expected = {
+	"/dev/sda", "/dev/sda1", "/dev/sda5", "/dev/mapper/cr_home", "/dev/dm-1"
+    };
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(devices.begin(), devices.end(), expected.begin(), expected.end());
+}
+
+
+BOOST_AUTO_TEST_CASE(key)
+{
+    setup_tree();
+
+    const string udev_data_dir = tree + "/udev/data";
+    const string sysfs_dir = tree + "/sys";
+
+    BlkidProbe::Key key;
+
+    // Neither watched nor in the udev database.
+
+    BOOST_CHECK(!BlkidProbe::get_key(makedev(8, 0), key, udev_data_dir, sysfs_dir));
+
+    // Watched but not in the udev database.
+
+    write_file(tree + "/udev/watch/b8:0", "");
+    write_file(tree + "/udev/watch/b8:1", "");
+
+    BOOST_CHECK(!BlkidProbe::get_key(makedev(8, 0), key, udev_data_dir, sysfs_dir));
+
+    write_file(udev_data_dir + "/b8:0", "");
+    write_file(udev_data_dir + "/b8:1", "");
+    set_mtime(udev_data_dir + "/b8:0", 1000000000);
+    set_mtime(udev_data_dir + "/b8:1", 1000000000);
+
+    BlkidProbe::Key disk_key;
+    BOOST_REQUIRE(BlkidProbe::get_key(makedev(8, 0), disk_key, udev_data_dir, sysfs_dir));
+    BOOST_CHECK_EQUAL(disk_key.majorminor, makedev(8, 0));
+    BOOST_CHECK_EQUAL(disk_key.diskseq, "7");
+
+    // For the partition the disk sequence number of the disk is used.
+
+    BlkidProbe::Key partition_key;
+    BOOST_REQUIRE(BlkidProbe::get_key(makedev(8, 1), partition_key, udev_data_dir, sysfs_dir));
+    BOOST_CHECK_EQUAL(partition_key.diskseq, "7");
+    BOOST_CHECK(partition_key != disk_key);
+
+    // Unchanged.
+
+    BOOST_REQUIRE(BlkidProbe::get_key(makedev(8, 1), key, udev_data_dir, sysfs_dir));
+    BOOST_CHECK(key == partition_key);
+
+    // The udev database entry was updated, e.g. after mkfs.
+
+    set_mtime(udev_data_dir + "/b8:1", 1000000001);
+
+    BOOST_REQUIRE(BlkidProbe::get_key(makedev(8, 1), key, udev_data_dir, sysfs_dir));
+    BOOST_CHECK(key != partition_key);
+
+    partition_key = key;
+
+    // The disk was replaced, e.g. a new loop device or medium.
+
+    write_file(tree + "/sys/devices/sda/diskseq", "8");
+
+    BOOST_REQUIRE(BlkidProbe::get_key(makedev(8, 1), key, udev_data_dir, sysfs_dir));
+    BOOST_CHECK(key != partition_key);
+    BOOST_CHECK_EQUAL(key.diskseq, "8");
+
+    // No longer watched.
+
+    unlink((tree + "/udev/watch/b8:1").c_str());
+
+    BOOST_CHECK(!BlkidProbe::get_key(makedev(8, 1), key, udev_data_dir, sysfs_dir));
+
+    system(("rm -rf " + tree).c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(probe_image)
+{
+    // Only possible if built with libblkid.
+
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    setenv("LIBSTORAGE_NATIVE_BLKID", "yes", 1);
+
+    if (!BlkidProbe::is_usable())
+    {
+	BOOST_TEST_MESSAGE("libblkid not usable");
+	return;
+    }
+
+    // Minimal swap signature: version, last page and number of bad pages,
+    // followed by UUID and label, and the magic at the end of the first
+    // page.
+
+    const string image = "blkid-probe-swap.img";
+
+    vector<char> data(64 * 1024, 0);
+
+    const uint32_t header[3] = { 1, 15, 0 };
+    memcpy(&data[1024], header, sizeof(header));
+
+    const unsigned char uuid[16] = { 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+				     0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef };
+    memcpy(&data[1036], uuid, sizeof(uuid));
+
+    memcpy(&data[1052], "test", 4);
+    memcpy(&data[4096 - 10], "SWAPSPACE2", 10);
+
+    {
+	ofstream s(image, ios::binary);
+	s.write(data.data(), data.size());
+    }
+
+    const map<string, string> tags = BlkidProbe::probe(image);
+
+    BOOST_CHECK_EQUAL(tags.at("TYPE"), "swap");
+    BOOST_CHECK_EQUAL(tags.at("UUID"), "01234567-89ab-cdef-0123-456789abcdef");
+    BOOST_CHECK_EQUAL(tags.at("LABEL"), "test");
+
+    // The tags are mapped like the output of the blkid command.
+
+    Blkid blkid(image);
+
+    const Blkid::Entry& entry = blkid.get_sole_entry()->second;
+
+    BOOST_CHECK(entry.is_fs);
+    BOOST_CHECK(entry.fs_type == FsType::SWAP);
+    BOOST_CHECK_EQUAL(entry.fs_uuid, "01234567-89ab-cdef-0123-456789abcdef");
+    BOOST_CHECK_EQUAL(entry.fs_label, "test");
+
+    unlink(image.c_str());
+}
+
+
+string
+to_string(const Blkid& blkid)
+{
+    ostringstream s;
+    s << blkid;
+    return s.str();
+}
+
+
+BOOST_AUTO_TEST_CASE(native_vs_command)
+{
+    // Probing images with libblkid must give the same result as the blkid
+    // command. Only possible if built with libblkid. Filesystems whose
+    // mkfs is not available are skipped.
+
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    setenv("LIBSTORAGE_NATIVE_BLKID", "yes", 1);
+
+    if (!BlkidProbe::is_usable() || access(BLKID_BIN, X_OK) != 0)
+    {
+	BOOST_TEST_MESSAGE("libblkid or blkid not usable");
+	return;
+    }
+
+    const string image = "blkid-probe-mkfs.img";
+
+    const vector<string> mkfses = {
+	MKFS_EXT2_BIN " -q -F -t ext4 -L test",
+	MKSWAP_BIN " -L test",
+	MKFS_FAT_BIN " -n TEST",
+	MKFS_BTRFS_BIN " -q -f -L test",
+	MKFS_XFS_BIN " -q -f -L test"
+    };
+
+    for (const string& mkfs : mkfses)
+    {
+	if (access(mkfs.substr(0, mkfs.find(' ')).c_str(), X_OK) != 0)
+	    continue;
+
+	// Sparse image large enough for all filesystems.
+
+	unlink(image.c_str());
+	ofstream(image, ios::binary);
+	BOOST_REQUIRE(truncate(image.c_str(), 512 * 1024 * 1024) == 0);
+
+	if (system((mkfs + " '" + image + "' > /dev/null 2>&1").c_str()) != 0)
+	{
+	    BOOST_TEST_MESSAGE("'" << mkfs << "' failed");
+	    continue;
+	}
+
+	setenv("LIBSTORAGE_NATIVE_BLKID", "yes", 1);
+	const string native = to_string(Blkid(image));
+
+	setenv("LIBSTORAGE_NATIVE_BLKID", "no", 1);
+	const string command = to_string(Blkid(image));
+
+	BOOST_TEST_MESSAGE(mkfs << ": " << command);
+
+	BOOST_CHECK_EQUAL(native, command);
+    }
+
+    unlink(image.c_str());
+}
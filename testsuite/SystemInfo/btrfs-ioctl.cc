@@ -0,0 +1,127 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <stdlib.h>
+#include <fstream>
+#include <functional>
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+#include <linux/btrfs_tree.h>
+
+#include "storage/SystemInfo/BtrfsIoctl.h"
+#include "storage/SystemInfo/CmdBtrfs.h"
+#include "storage/SystemInfo/CmdLsattr.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Enum.h"
+#include "storage/Filesystems/BtrfsImpl.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+BOOST_AUTO_TEST_CASE(raid_level)
+{
+    BOOST_CHECK_EQUAL(toString(BtrfsIoctl::raid_level(BTRFS_BLOCK_GROUP_DATA)), "SINGLE");
+    BOOST_CHECK_EQUAL(toString(BtrfsIoctl::raid_level(BTRFS_BLOCK_GROUP_METADATA | BTRFS_BLOCK_GROUP_DUP)), "DUP");
+    BOOST_CHECK_EQUAL(toString(BtrfsIoctl::raid_level(BTRFS_BLOCK_GROUP_DATA | BTRFS_BLOCK_GROUP_RAID0)), "RAID0");
+    BOOST_CHECK_EQUAL(toString(BtrfsIoctl::raid_level(BTRFS_BLOCK_GROUP_DATA | BTRFS_BLOCK_GROUP_RAID10)), "RAID10");
+    BOOST_CHECK_EQUAL(toString(BtrfsIoctl::raid_level(BTRFS_BLOCK_GROUP_SYSTEM | BTRFS_BLOCK_GROUP_RAID1C3)), "RAID1C3");
+    BOOST_CHECK_EQUAL(toString(BtrfsIoctl::raid_level(BTRFS_BLOCK_GROUP_DATA | BTRFS_BLOCK_GROUP_RAID6)), "RAID6");
+}
+
+
+BOOST_AUTO_TEST_CASE(format_uuid)
+{
+    const unsigned char null_uuid[16] = { 0 };
+    BOOST_CHECK_EQUAL(BtrfsIoctl::format_uuid(null_uuid), "-");
+
+    const unsigned char uuid[16] = { 0x6a, 0x0c, 0x2e, 0x4b, 0x8a, 0x2d, 0x44, 0x62, 0x9b, 0x5e,
+				     0x1f, 0x0e, 0x93, 0x13, 0x4c, 0xaf };
+    BOOST_CHECK_EQUAL(BtrfsIoctl::format_uuid(uuid), "6a0c2e4b-8a2d-4462-9b5e-1f0e93134caf");
+}
+
+
+BOOST_AUTO_TEST_CASE(is_listed)
+{
+    // Subvolume 256 is in the top-level subvolume, 257 in 256 and 258 in
+    // 257. Subvolume 259 was deleted and 260 in 259 and 261 in 260 are
+    // orphans. 262 has a parent without root item.
+
+    const map<unsigned long long, unsigned long long> parent_ids = {
+	{ 256, BTRFS_FS_TREE_OBJECTID }, { 257, 256 }, { 258, 257 }, { 259, 0 }, { 260, 259 },
+	{ 261, 260 }, { 262, 300 }, { 263, 264 }, { 264, 263 }
+    };
+
+    BOOST_CHECK(BtrfsIoctl::is_listed(256, parent_ids));
+    BOOST_CHECK(BtrfsIoctl::is_listed(258, parent_ids));
+
+    BOOST_CHECK(!BtrfsIoctl::is_listed(259, parent_ids));
+    BOOST_CHECK(!BtrfsIoctl::is_listed(260, parent_ids));
+    BOOST_CHECK(!BtrfsIoctl::is_listed(261, parent_ids));
+    BOOST_CHECK(!BtrfsIoctl::is_listed(262, parent_ids));
+
+    // Loops must not hang.
+
+    BOOST_CHECK(!BtrfsIoctl::is_listed(263, parent_ids));
+}
+
+
+/*
+ * Differential test of the BtrfsIoctl against the btrfs and lsattr commands
+ * on all mounted btrfs. Does nothing if there are none or if not run as
+ * root.
+ */
+
+template <typename Type>
+string
+to_string_with(bool native, std::function<Type()> func)
+{
+    setenv("LIBSTORAGE_NATIVE_BTRFS", native ? "yes" : "no", 1);
+
+    ostringstream s;
+    s << func();
+
+    unsetenv("LIBSTORAGE_NATIVE_BTRFS");
+
+    return s.str();
+}
+
+
+template <typename Type>
+void
+check(std::function<Type()> func)
+{
+    BOOST_CHECK_EQUAL(to_string_with<Type>(true, func), to_string_with<Type>(false, func));
+}
+
+
+BOOST_AUTO_TEST_CASE(differential)
+{
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    if (geteuid() != 0)
+	return;
+
+    ifstream proc_mounts("/proc/mounts");
+
+    string line;
+    while (getline(proc_mounts, line))
+    {
+	vector<string> columns;
+	boost::split(columns, line, boost::is_any_of(" "));
+	if (columns.size() < 3 || columns[2] != "btrfs")
+	    continue;
+
+	const string& device = columns[0];
+	const string& mount_point = columns[1];
+
+	check<CmdBtrfsSubvolumeList>([&]() { return CmdBtrfsSubvolumeList(device, mount_point); });
+	check<CmdBtrfsSubvolumeShow>([&]() { return CmdBtrfsSubvolumeShow(device, mount_point); });
+	check<CmdBtrfsSubvolumeGetDefault>([&]() { return CmdBtrfsSubvolumeGetDefault(device, mount_point); });
+	check<CmdBtrfsFilesystemDf>([&]() { return CmdBtrfsFilesystemDf(device, mount_point); });
+	check<CmdBtrfsQgroupShow>([&]() { return CmdBtrfsQgroupShow(device, mount_point); });
+	check<CmdLsattr>([&]() { return CmdLsattr(CmdLsattr::key_t(device, ""), mount_point, ""); });
+    }
+}
@@ -61,3 +61,16 @@ BOOST_AUTO_TEST_CASE(parse_empty)
 {
     check({}, {});
 }
+
+
+BOOST_AUTO_TEST_CASE(parse_bad_id)
+{
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command(BTRFS_BIN " subvolume list -a -puq (device:/dev/system/btrfs)", vector<string>{
+	"ID x gen 10 parent 5 top level 5 parent_uuid - uuid a3dc5067-ec7e-f046-8538-e768583d1f4e path 1a"
+    });
+
+    BOOST_CHECK_THROW({
+	CmdBtrfsSubvolumeList cmd_btrfs_subvolume_list(CmdBtrfsSubvolumeList::key_t("/dev/system/btrfs"), "/btrfs");
+    }, Exception);
+}
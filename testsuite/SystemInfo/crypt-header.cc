@@ -0,0 +1,146 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <string.h>
+#include <endian.h>
+#include <boost/test/unit_test.hpp>
+
+#include "storage/SystemInfo/CryptHeader.h"
+#include "storage/SystemInfo/CmdCryptsetup.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/SystemCmd.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+/*
+ * The objects are constructed using empty mockup output and then filled by
+ * CryptHeader.
+ */
+
+string
+parse_luks(const string& name, const string& data)
+{
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command(CRYPTSETUP_BIN " luksDump " + quote(name), vector<string>());
+
+    CmdCryptsetupLuksDump cmd_cryptsetup_luks_dump(name);
+    CryptHeader::parse_luks(cmd_cryptsetup_luks_dump, data);
+
+    ostringstream s;
+    s << cmd_cryptsetup_luks_dump;
+    return s.str();
+}
+
+
+string
+parse_bitlk(const string& name, const string& data)
+{
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command(CRYPTSETUP_BIN " bitlkDump " + quote(name), vector<string>());
+
+    CmdCryptsetupBitlkDump cmd_cryptsetup_bitlk_dump(name);
+    CryptHeader::parse_bitlk(cmd_cryptsetup_bitlk_dump, data);
+
+    ostringstream s;
+    s << cmd_cryptsetup_bitlk_dump;
+    return s.str();
+}
+
+
+void
+put(string& data, size_t offset, const string& value)
+{
+    memcpy(&data[offset], value.data(), value.size());
+}
+
+
+template <typename Type>
+void
+put(string& data, size_t offset, Type value)
+{
+    memcpy(&data[offset], &value, sizeof(value));
+}
+
+
+string
+luks_header(unsigned int version)
+{
+    string data(4096, '\0');
+
+    put(data, 0, string("LUKS\xba\xbe"));
+    put<uint16_t>(data, 6, htobe16(version));
+
+    return data;
+}
+
+
+BOOST_AUTO_TEST_CASE(luks1)
+{
+    string data = luks_header(1);
+
+    put(data, 8, string("aes"));
+    put(data, 40, string("xts-plain64"));
+    put(data, 72, string("sha256"));
+    put<uint32_t>(data, 108, htobe32(64));
+    put(data, 168, string("f0b3c940-6bf1-4afa-8ba4-fa4d97b026b6"));
+
+    BOOST_CHECK_EQUAL(parse_luks("/dev/sdc1", data), "name:/dev/sdc1 uuid:f0b3c940-6bf1-4afa-8ba4-fa4d97b026b6 "
+		      "encryption-type:luks1 cipher:aes-xts-plain64 key-size:64");
+}
+
+
+BOOST_AUTO_TEST_CASE(luks2)
+{
+    string data = luks_header(2);
+
+    put<uint64_t>(data, 8, htobe64(16384));
+    put(data, 24, string("test"));
+    put(data, 168, string("dfcefa36-2548-45b7-98f4-700bd80fa67a"));
+
+    data.resize(16384, '\0');
+
+    put(data, 4096, string(R"({"keyslots":{"1":{"type":"luks2","key_size":32,"kdf":{"type":"pbkdf2"}},)"
+			   R"("0":{"type":"luks2","key_size":16,"kdf":{"type":"argon2id"}}},)"
+			   R"("segments":{"0":{"type":"crypt","encryption":"aegis128-random",)"
+			   R"("integrity":{"type":"aead"}}},"digests":{},"config":{}})"));
+
+    BOOST_CHECK_EQUAL(parse_luks("/dev/sdc1", data), "name:/dev/sdc1 uuid:dfcefa36-2548-45b7-98f4-700bd80fa67a "
+		      "encryption-type:luks2 cipher:aegis128-random key-size:16 pbkdf:argon2id integrity:aead");
+}
+
+
+BOOST_AUTO_TEST_CASE(no_luks)
+{
+    BOOST_CHECK_THROW(parse_luks("/dev/sdc1", string(4096, '\0')), Exception);
+
+    string data = luks_header(2);
+    put<uint64_t>(data, 8, htobe64(16384));
+
+    // header size larger than data
+    BOOST_CHECK_THROW(parse_luks("/dev/sdc1", data), Exception);
+}
+
+
+BOOST_AUTO_TEST_CASE(bitlk)
+{
+    string data(64 + 48, '\0');
+
+    put(data, 0, string("-FVE-FS-"));
+    put<uint16_t>(data, 10, htole16(2));
+
+    const unsigned char guid[16] = { 0xdb, 0x41, 0x25, 0xdc, 0x5b, 0x27, 0x84, 0x4c, 0x85, 0xe0,
+				     0x0a, 0x74, 0x3b, 0x3f, 0xf2, 0x29 };
+    put(data, 64 + 16, string((const char*) guid, sizeof(guid)));
+    put<uint16_t>(data, 64 + 36, htole16(0x8004));
+
+    BOOST_CHECK_EQUAL(parse_bitlk("/dev/sda3", data), "name:/dev/sda3 uuid:dc2541db-275b-4c84-85e0-0a743b3ff229 "
+		      "cipher:aes-xts-plain64 key-size:32");
+
+    put<uint16_t>(data, 64 + 36, htole16(0x1234));
+    BOOST_CHECK_THROW(parse_bitlk("/dev/sda3", data), Exception);
+}
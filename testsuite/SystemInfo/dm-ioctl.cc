@@ -0,0 +1,73 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <functional>
+#include <boost/test/unit_test.hpp>
+
+#include "storage/SystemInfo/DmIoctl.h"
+#include "storage/SystemInfo/CmdDmsetup.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/StorageDefines.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+BOOST_AUTO_TEST_CASE(subsystem)
+{
+    BOOST_CHECK_EQUAL(DmIoctl::subsystem(""), "");
+    BOOST_CHECK_EQUAL(DmIoctl::subsystem("CRYPT-LUKS2-08b5a71487124c758ac004ff7d2912bb-crypto"), "CRYPT");
+    BOOST_CHECK_EQUAL(DmIoctl::subsystem("LVM-Q2S3i0Gx9E0ZsB6j0N1lEbrMZ0kBexR0"), "LVM");
+    BOOST_CHECK_EQUAL(DmIoctl::subsystem("mpath-36005076305ffc5b50000000000003a1c"), "mpath");
+}
+
+
+/*
+ * Differential test of the DmIoctl against dmsetup. Does nothing if not run
+ * as root or dmsetup or the device-mapper driver is not available.
+ */
+
+template <typename Type>
+string
+to_string_with(bool native)
+{
+    setenv("LIBSTORAGE_NATIVE_DMSETUP", native ? "yes" : "no", 1);
+
+    ostringstream s;
+    s << Type();
+
+    unsetenv("LIBSTORAGE_NATIVE_DMSETUP");
+
+    return s.str();
+}
+
+
+bool
+has_device_mapper()
+{
+    // The control device can exist even if the driver is not available.
+
+    int fd = open(DEV_MAPPER_DIR "/control", O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+	return false;
+
+    close(fd);
+    return true;
+}
+
+
+BOOST_AUTO_TEST_CASE(differential)
+{
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    if (geteuid() != 0 || access(DMSETUP_BIN, X_OK) != 0 || !has_device_mapper())
+	return;
+
+    BOOST_CHECK_EQUAL(to_string_with<CmdDmsetupInfo>(true), to_string_with<CmdDmsetupInfo>(false));
+    BOOST_CHECK_EQUAL(to_string_with<CmdDmsetupTable>(true), to_string_with<CmdDmsetupTable>(false));
+}
@@ -79,3 +79,14 @@ BOOST_AUTO_TEST_CASE(parse_no_devices)
 
     check(input, output);
 }
+
+
+BOOST_AUTO_TEST_CASE(parse_bad_stripes)
+{
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command(DMSETUP_BIN " table", vector<string>{
+	"test-fast: 0 409600 striped two 128 8:17 2048 8:18 2048"
+    });
+
+    BOOST_CHECK_THROW({ CmdDmsetupTable cmddmsetuptable; }, Exception);
+}
@@ -0,0 +1,186 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/SystemInfo/CmdLvm.h"
+#include "storage/SystemInfo/SystemInfoImpl.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/StorageDefines.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+const string fullreport_command = LVM_BIN " fullreport --reportformat json --config 'log { command_names = 0 "
+    "prefix = \"\" }' --units b --nosuffix --all --configreport pv --options pv_name,pv_uuid,vg_name,vg_uuid,"
+    "pv_attr,pe_start --configreport vg --options vg_name,vg_uuid,vg_attr,vg_extent_size,vg_extent_count,"
+    "vg_free_count --configreport lv --options lv_name,lv_uuid,vg_name,vg_uuid,lv_role,lv_attr,lv_size,"
+    "origin_size,pool_lv,pool_lv_uuid,origin,origin_uuid,data_lv,data_lv_uuid,metadata_lv,metadata_lv_uuid "
+    "--configreport seg --options lv_uuid,segtype,stripes,stripe_size,chunk_size --configreport pvseg "
+    "--options pv_uuid";
+
+
+template <typename Type>
+string
+to_str(const Type& cmd)
+{
+    ostringstream parsed;
+    parsed.setf(std::ios::boolalpha);
+    parsed << cmd;
+
+    return parsed.str();
+}
+
+
+void
+check(const vector<string>& input, const vector<string>& pvs_output, const vector<string>& vgs_output,
+      const vector<string>& lvs_output)
+{
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command(fullreport_command, input);
+
+    CmdLvmFullreport cmd_lvm_fullreport;
+
+    BOOST_REQUIRE(cmd_lvm_fullreport.is_available());
+
+    BOOST_CHECK_EQUAL(to_str(cmd_lvm_fullreport.get_cmd_pvs()), boost::join(pvs_output, "\n") + "\n");
+    BOOST_CHECK_EQUAL(to_str(cmd_lvm_fullreport.get_cmd_vgs()), boost::join(vgs_output, "\n") + "\n");
+    BOOST_CHECK_EQUAL(to_str(cmd_lvm_fullreport.get_cmd_lvs()), boost::join(lvs_output, "\n") + "\n");
+}
+
+
+BOOST_AUTO_TEST_CASE(parse1)
+{
+    // The VG "test" has a striped LV with several segments and a cached
+    // LV. "/dev/sdd1" is an orphan PV.
+
+    vector<string> input = {
+	"  {",
+	"      \"report\": [",
+	"          {",
+	"              \"vg\": [",
+	"                  {\"vg_name\":\"test\", \"vg_uuid\":\"55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC\", \"vg_attr\":\"wz--n-\", \"vg_extent_size\":\"4194304\", \"vg_extent_count\":\"7677\", \"vg_free_count\":\"1533\"}",
+	"              ]",
+	"              ,",
+	"              \"pv\": [",
+	"                  {\"pv_name\":\"/dev/sdb1\", \"pv_uuid\":\"Tq1Tyx-gXGj-lrPl-UsbW-VbEx-cFjA-mnSz7e\", \"vg_name\":\"test\", \"vg_uuid\":\"55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC\", \"pv_attr\":\"a--\", \"pe_start\":\"1048576\"},",
+	"                  {\"pv_name\":\"/dev/sdc1\", \"pv_uuid\":\"4wH0Iu-fVbI-wL6E-0C4A-3XBm-9Cn8-6Bv6Qd\", \"vg_name\":\"test\", \"vg_uuid\":\"55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC\", \"pv_attr\":\"a--\", \"pe_start\":\"1048576\"}",
+	"              ]",
+	"              ,",
+	"              \"lv\": [",
+	"                  {\"lv_name\":\"striped\", \"lv_uuid\":\"3Kzffs-MSVL-qrEM-1Oca-t286-VtBJ-VIa2Xw\", \"vg_name\":\"test\", \"vg_uuid\":\"55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC\", \"lv_role\":\"public\", \"lv_attr\":\"-wi-a-----\", \"lv_size\":\"12884901888\", \"origin_size\":\"\", \"pool_lv\":\"\", \"pool_lv_uuid\":\"\", \"origin\":\"\", \"origin_uuid\":\"\", \"data_lv\":\"\", \"data_lv_uuid\":\"\", \"metadata_lv\":\"\", \"metadata_lv_uuid\":\"\"},",
+	"                  {\"lv_name\":\"cached\", \"lv_uuid\":\"R3wAkS-5BJp-VwEe-DS9r-gBJG-jlgB-MvwUGG\", \"vg_name\":\"test\", \"vg_uuid\":\"55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC\", \"lv_role\":\"public\", \"lv_attr\":\"Cwi-a-C---\", \"lv_size\":\"10737418240\", \"origin_size\":\"10737418240\", \"pool_lv\":\"[cached-pool]\", \"pool_lv_uuid\":\"su0ZFA-ejBI-M3VL-gQDD-UNcu-W0o8-2aBdtj\", \"origin\":\"\", \"origin_uuid\":\"\", \"data_lv\":\"\", \"data_lv_uuid\":\"\", \"metadata_lv\":\"\", \"metadata_lv_uuid\":\"\"}",
+	"              ]",
+	"              ,",
+	"              \"pvseg\": [",
+	"                  {\"pv_uuid\":\"Tq1Tyx-gXGj-lrPl-UsbW-VbEx-cFjA-mnSz7e\"},",
+	"                  {\"pv_uuid\":\"4wH0Iu-fVbI-wL6E-0C4A-3XBm-9Cn8-6Bv6Qd\"}",
+	"              ]",
+	"              ,",
+	"              \"seg\": [",
+	"                  {\"lv_uuid\":\"3Kzffs-MSVL-qrEM-1Oca-t286-VtBJ-VIa2Xw\", \"segtype\":\"linear\", \"stripes\":\"1\", \"stripe_size\":\"0\", \"chunk_size\":\"0\"},",
+	"                  {\"lv_uuid\":\"3Kzffs-MSVL-qrEM-1Oca-t286-VtBJ-VIa2Xw\", \"segtype\":\"striped\", \"stripes\":\"2\", \"stripe_size\":\"65536\", \"chunk_size\":\"0\"},",
+	"                  {\"lv_uuid\":\"R3wAkS-5BJp-VwEe-DS9r-gBJG-jlgB-MvwUGG\", \"segtype\":\"cache\", \"stripes\":\"1\", \"stripe_size\":\"0\", \"chunk_size\":\"65536\"}",
+	"              ]",
+	"          }",
+	"          ,",
+	"          {",
+	"              \"vg\": [",
+	"                  {\"vg_name\":\"\", \"vg_uuid\":\"\", \"vg_attr\":\"\", \"vg_extent_size\":\"0\", \"vg_extent_count\":\"0\", \"vg_free_count\":\"0\"}",
+	"              ]",
+	"              ,",
+	"              \"pv\": [",
+	"                  {\"pv_name\":\"/dev/sdd1\", \"pv_uuid\":\"Cz2aM1-DTmN-OZ5O-pPqj-bOlu-jr5F-ga1Ii1\", \"vg_name\":\"\", \"vg_uuid\":\"\", \"pv_attr\":\"---\", \"pe_start\":\"1048576\"}",
+	"              ]",
+	"              ,",
+	"              \"lv\": [",
+	"              ]",
+	"              ,",
+	"              \"pvseg\": [",
+	"                  {\"pv_uuid\":\"Cz2aM1-DTmN-OZ5O-pPqj-bOlu-jr5F-ga1Ii1\"}",
+	"              ]",
+	"              ,",
+	"              \"seg\": [",
+	"              ]",
+	"          }",
+	"      ]",
+	"  }"
+    };
+
+    vector<string> pvs_output = {
+	"pv:{ pv-name:/dev/sdb1 pv-uuid:Tq1Tyx-gXGj-lrPl-UsbW-VbEx-cFjA-mnSz7e vg-name:test vg-uuid:55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC pe-start:1048576 }",
+	"pv:{ pv-name:/dev/sdc1 pv-uuid:4wH0Iu-fVbI-wL6E-0C4A-3XBm-9Cn8-6Bv6Qd vg-name:test vg-uuid:55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC pe-start:1048576 }",
+	"pv:{ pv-name:/dev/sdd1 pv-uuid:Cz2aM1-DTmN-OZ5O-pPqj-bOlu-jr5F-ga1Ii1 vg-name: vg-uuid: pe-start:1048576 }"
+    };
+
+    vector<string> vgs_output = {
+	"vg:{ vg-name:test vg-uuid:55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC extent-size:4194304 extent-count:7677 free-extent-count:1533 }"
+    };
+
+    vector<string> lvs_output = {
+	"lv:{ lv-name:cached lv-uuid:R3wAkS-5BJp-VwEe-DS9r-gBJG-jlgB-MvwUGG vg-name:test vg-uuid:55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC lv-type:cache role:public active:true size:10737418240 origin-size:10737418240 pool-name:[cached-pool] pool-uuid:su0ZFA-ejBI-M3VL-gQDD-UNcu-W0o8-2aBdtj segments:<stripes:1 chunk-size:65536> }",
+	"lv:{ lv-name:striped lv-uuid:3Kzffs-MSVL-qrEM-1Oca-t286-VtBJ-VIa2Xw vg-name:test vg-uuid:55auVT-aQ8G-MPiA-uXy1-dvJa-XNOs-6BWsXC lv-type:normal role:public active:true size:12884901888 segments:<stripes:1 stripes:2 stripe-size:65536> }"
+    };
+
+    check(input, pvs_output, vgs_output, lvs_output);
+}
+
+
+BOOST_AUTO_TEST_CASE(fallback)
+{
+    // Without fullreport, e.g. with old LVM, pvs, vgs and lvs are used.
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::erase_command(fullreport_command);
+    Mockup::set_command(VGS_BIN " --reportformat json --config 'log { command_names = 0 prefix = \"\" }' "
+			"--units b --nosuffix --options vg_name,vg_uuid,vg_attr,vg_extent_size,"
+			"vg_extent_count,vg_free_count", RemoteCommand({
+			    "  {",
+			    "      \"report\": [",
+			    "          {",
+			    "              \"vg\": [",
+			    "                  {\"vg_name\":\"system\", \"vg_uuid\":\"OMPzXF-m3am-1zIl-AVdQ-i5Wx-tmyN-cevmRn\", \"vg_attr\":\"wz--n-\", \"vg_extent_size\":\"4194304\", \"vg_extent_count\":\"230400\", \"vg_free_count\":\"71666\"}",
+			    "              ]",
+			    "          }",
+			    "      ]",
+			    "  }"
+			}, {}, 0));
+
+    CmdLvmFullreport cmd_lvm_fullreport;
+
+    BOOST_CHECK(!cmd_lvm_fullreport.is_available());
+
+    SystemInfo::Impl system_info;
+
+    BOOST_CHECK_EQUAL(to_str(system_info.getCmdVgs()), "vg:{ vg-name:system vg-uuid:OMPzXF-m3am-1zIl-AVdQ-i5Wx-tmyN-cevmRn "
+		      "extent-size:4194304 extent-count:230400 free-extent-count:71666 }\n");
+}
+
+
+BOOST_AUTO_TEST_CASE(fallback_unsupported)
+{
+    // LVM without fullreport exits with ENO_SUCH_CMD.
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command(fullreport_command, RemoteCommand({}, { "No such command 'fullreport'.  Try 'help'." }, 2));
+
+    CmdLvmFullreport cmd_lvm_fullreport;
+
+    BOOST_CHECK(!cmd_lvm_fullreport.is_available());
+}
+
+
+BOOST_AUTO_TEST_CASE(failure)
+{
+    // Other failures, e.g. a locking problem, are not hidden by the fallback.
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command(fullreport_command, RemoteCommand({}, { "Reading VG system without a lock." }, 5));
+
+    BOOST_CHECK_THROW({ CmdLvmFullreport cmd_lvm_fullreport; }, SystemCmdException);
+}
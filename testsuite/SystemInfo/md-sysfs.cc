@@ -0,0 +1,214 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <stdlib.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/SystemInfo/MdSysfs.h"
+#include "storage/SystemInfo/ProcMdstat.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Devices/MdImpl.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/Exception.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+BOOST_AUTO_TEST_CASE(metadata)
+{
+    BOOST_CHECK_EQUAL(MdSysfs::metadata("1.2"), "1.2");
+    BOOST_CHECK_EQUAL(MdSysfs::metadata("0.90"), "0.90");
+    BOOST_CHECK_EQUAL(MdSysfs::metadata("external:imsm"), "imsm");
+    BOOST_CHECK_EQUAL(MdSysfs::metadata("external:ddf"), "ddf");
+    BOOST_CHECK_EQUAL(MdSysfs::metadata("external:/md127/0"), "");
+}
+
+
+BOOST_AUTO_TEST_CASE(level)
+{
+    BOOST_CHECK_EQUAL(toString(MdSysfs::level("raid1", "1.2")), "RAID1");
+    BOOST_CHECK_EQUAL(toString(MdSysfs::level("raid0", "external:/md127/0")), "RAID0");
+    BOOST_CHECK_EQUAL(toString(MdSysfs::level("", "external:imsm")), "CONTAINER");
+    BOOST_CHECK_EQUAL(toString(MdSysfs::level("", "1.2")), "unknown");
+    BOOST_CHECK_EQUAL(toString(MdSysfs::level("", "external:/md127/0")), "unknown");
+}
+
+
+BOOST_AUTO_TEST_CASE(role)
+{
+    BOOST_CHECK_EQUAL(MdSysfs::role("0", "in_sync"), "0");
+    BOOST_CHECK_EQUAL(MdSysfs::role("3", "in_sync,write_mostly"), "3");
+    BOOST_CHECK_EQUAL(MdSysfs::role("none", "spare"), "spare");
+    BOOST_CHECK_EQUAL(MdSysfs::role("journal", "journal"), "spare");
+    BOOST_CHECK_EQUAL(MdSysfs::role("1", "faulty"), "spare");
+}
+
+
+BOOST_AUTO_TEST_CASE(uuid_from_sysfs)
+{
+    BOOST_CHECK_EQUAL(MdSysfs::uuid_from_sysfs("7d0f0b1c-6b0b-a4e8-1a2b-3c4d5e6f7a8b"),
+		      "7d0f0b1c:6b0ba4e8:1a2b3c4d:5e6f7a8b");
+    BOOST_CHECK_EQUAL(MdSysfs::uuid_from_sysfs("00000000-0000-0000-0000-000000000000"), "");
+}
+
+
+/**
+ * Writes an image with an MD superblock of version 1.x at offset.
+ */
+void
+write_superblock_image(const string& filename, unsigned long long offset)
+{
+    const unsigned char superblock[32] = {
+	0xfc, 0x4e, 0x2b, 0xa9, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x7d, 0x0f, 0x0b, 0x1c, 0x6b, 0x0b, 0xa4, 0xe8, 0x1a, 0x2b, 0x3c, 0x4d, 0x5e, 0x6f, 0x7a, 0x8b
+    };
+
+    ofstream s(filename, ios::binary | ios::trunc);
+    s.seekp(1024 * 1024 - 1);
+    s.put('\0');
+    s.seekp(offset);
+    s.write((const char*) superblock, sizeof(superblock));
+}
+
+
+BOOST_AUTO_TEST_CASE(uuid_from_superblock)
+{
+    write_superblock_image("md-sysfs.img", 4096);
+    BOOST_CHECK_EQUAL(MdSysfs::uuid_from_superblock("md-sysfs.img", "1.2"), "7d0f0b1c:6b0ba4e8:1a2b3c4d:5e6f7a8b");
+    BOOST_CHECK_THROW(MdSysfs::uuid_from_superblock("md-sysfs.img", "1.1"), Exception);
+
+    write_superblock_image("md-sysfs.img", 0);
+    BOOST_CHECK_EQUAL(MdSysfs::uuid_from_superblock("md-sysfs.img", "1.1"), "7d0f0b1c:6b0ba4e8:1a2b3c4d:5e6f7a8b");
+
+    write_superblock_image("md-sysfs.img", 1024 * 1024 - 8192);
+    BOOST_CHECK_EQUAL(MdSysfs::uuid_from_superblock("md-sysfs.img", "1.0"), "7d0f0b1c:6b0ba4e8:1a2b3c4d:5e6f7a8b");
+
+    unlink("md-sysfs.img");
+}
+
+
+/**
+ * Creates a fake sysfs directory of an MD RAID with one device and a fake
+ * udev database entry.
+ */
+void
+write_fake(const string& metadata_version, const string& level, const string& uuid,
+	   const vector<string>& udev_properties)
+{
+    system("rm -rf md-sysfs-fake");
+
+    mkdir("md-sysfs-fake", 0755);
+    mkdir("md-sysfs-fake/md", 0755);
+    mkdir("md-sysfs-fake/md/dev-sdb", 0755);
+
+    ofstream("md-sysfs-fake/md/metadata_version") << metadata_version << '\n';
+    ofstream("md-sysfs-fake/md/level") << level << '\n';
+    ofstream("md-sysfs-fake/md/array_state") << "inactive\n";
+    ofstream("md-sysfs-fake/md/dev-sdb/slot") << "none\n";
+    ofstream("md-sysfs-fake/md/dev-sdb/state") << "spare\n";
+
+    if (!uuid.empty())
+	ofstream("md-sysfs-fake/md/uuid") << uuid << '\n';
+
+    ofstream udev("md-sysfs-fake/udev");
+    for (const string& udev_property : udev_properties)
+	udev << "E:" << udev_property << '\n';
+}
+
+
+string
+read_fake(const string& device)
+{
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command(MDADM_BIN " --detail '" + device + "' --export", vector<string>{});
+
+    MdadmDetail mdadm_detail(device);
+
+    MdSysfs(device, "md-sysfs-fake/md", "md-sysfs-fake/udev").read(mdadm_detail);
+
+    ostringstream s;
+    s << mdadm_detail;
+    return s.str();
+}
+
+
+BOOST_AUTO_TEST_CASE(inactive_raid)
+{
+    // udev has no MD_UUID for inactive MD RAIDs but the kernel knows the
+    // UUID.
+
+    write_fake("1.2", "raid1", "7d0f0b1c-6b0b-a4e8-1a2b-3c4d5e6f7a8b", {});
+
+    BOOST_CHECK_EQUAL(read_fake("/dev/md0"), "device:/dev/md0 uuid:7d0f0b1c:6b0ba4e8:1a2b3c4d:5e6f7a8b "
+		      "devname: metadata:1.2 level:RAID1 roles:</dev/sdb:spare>\n");
+}
+
+
+BOOST_AUTO_TEST_CASE(container)
+{
+    // For external metadata the kernel reports the null UUID. The UUID of a
+    // container is only known to mdadm, so without udev data reading fails.
+
+    write_fake("external:imsm", "", "00000000-0000-0000-0000-000000000000", {});
+
+    BOOST_CHECK_THROW(read_fake("/dev/md127"), Exception);
+
+    write_fake("external:imsm", "", "00000000-0000-0000-0000-000000000000",
+	       { "MD_UUID=9f5c3a51:24b1e6c5:0c1a4e3f:2d6b7e8a", "MD_DEVNAME=imsm0" });
+
+    BOOST_CHECK_EQUAL(read_fake("/dev/md127"), "device:/dev/md127 uuid:9f5c3a51:24b1e6c5:0c1a4e3f:2d6b7e8a "
+		      "devname:imsm0 metadata:imsm level:CONTAINER roles:</dev/sdb:spare>\n");
+
+    system("rm -rf md-sysfs-fake");
+}
+
+
+/*
+ * Differential test of the MdSysfs against mdadm on all MD RAIDs. Does
+ * nothing if there are none or if not run as root.
+ */
+
+string
+to_string_with(bool native, const string& device)
+{
+    setenv("LIBSTORAGE_NATIVE_MDADM", native ? "yes" : "no", 1);
+
+    ostringstream s;
+    s << MdadmDetail(device);
+
+    unsetenv("LIBSTORAGE_NATIVE_MDADM");
+
+    return s.str();
+}
+
+
+BOOST_AUTO_TEST_CASE(differential)
+{
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    if (geteuid() != 0)
+	return;
+
+    DIR* dir = opendir("/sys/block");
+    BOOST_REQUIRE(dir);
+
+    while (const struct dirent* entry = readdir(dir))
+    {
+	const string name = entry->d_name;
+	if (!boost::starts_with(name, "md"))
+	    continue;
+
+	const string device = "/dev/" + name;
+
+	BOOST_CHECK_EQUAL(to_string_with(true, device), to_string_with(false, device));
+    }
+
+    closedir(dir);
+}
@@ -0,0 +1,454 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <glob.h>
+#include <regex>
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/crc.hpp>
+
+#include "storage/SystemInfo/CmdParted.h"
+#include "storage/SystemInfo/PartitionTableReader.h"
+#include "storage/Devices/PartitionImpl.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/XmlFile.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/Format.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+/*
+ * Differential test of the PartitionTableReader against parted: For every
+ * parted output in the probe mockups an image with the partition table
+ * parted reported is created. Reading the image with the
+ * PartitionTableReader must give the same result.
+ */
+
+
+const char* image = "partition-table-reader.img";
+
+
+void
+put_le(vector<unsigned char>& buffer, size_t offset, unsigned long long value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+	buffer[offset + i] = value >> (8 * i);
+}
+
+
+unsigned int
+crc32(const unsigned char* p, size_t size)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(p, size);
+    return crc.checksum();
+}
+
+
+void
+put_guid(vector<unsigned char>& buffer, size_t offset, const string& guid)
+{
+    string hex = boost::erase_all_copy(guid, "-");
+
+    unsigned char tmp[16];
+    for (int i = 0; i < 16; ++i)
+	tmp[i] = stoi(hex.substr(2 * i, 2), nullptr, 16);
+
+    // first three fields are little endian
+    const int order[16] = { 3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15 };
+    for (int i = 0; i < 16; ++i)
+	buffer[offset + i] = tmp[order[i]];
+}
+
+
+string
+id_to_guid(unsigned int id)
+{
+    static const map<unsigned int, string> flag_ids = {
+	{ ID_BIOS_BOOT, "21686148-6449-6e6f-744e-656564454649" },
+	{ ID_DIAG, "de94bba4-06d1-4d40-a16a-bfd50179d6ac" },
+	{ ID_ESP, "c12a7328-f81f-11d2-ba4b-00a0c93ec93b" },
+	{ ID_IRST, "d3bfe2de-3daf-11df-ba40-e3a556d89593" },
+	{ ID_LINUX_HOME, "933ac7e1-2eb4-4f13-b844-0e14e2aef915" },
+	{ ID_LVM, "e6d6d379-f507-44c2-a23c-238f2a3df928" },
+	{ ID_MICROSOFT_RESERVED, "e3c9e316-0b5c-4db8-817d-f92df00215ae" },
+	{ ID_PREP, "9e1a2d38-c612-4316-aa26-8b49521e5a8b" },
+	{ ID_RAID, "a19d880f-05fc-4d3b-a006-743f0f84911e" },
+	{ ID_WINDOWS_BASIC_DATA, "ebd0a0a2-b9e5-4433-87c0-68b6b72699c7" },
+    };
+
+    map<unsigned int, string>::const_iterator it1 = flag_ids.find(id);
+    if (it1 != flag_ids.end())
+	return it1->second;
+
+    map<unsigned int, const char*>::const_iterator it2 = Parted::id_to_uuid.find(id);
+    if (it2 != Parted::id_to_uuid.end())
+	return it2->second;
+
+    // some type unknown to libstorage-ng
+    return "824cc7a0-36a8-11e3-890a-952519ad3f61";
+}
+
+
+class Image
+{
+public:
+
+    Image(unsigned long long num_sectors)
+	: num_sectors(num_sectors)
+    {
+	fd = open(image, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	BOOST_REQUIRE(fd >= 0);
+	BOOST_REQUIRE(ftruncate(fd, num_sectors * 512) == 0);
+    }
+
+    ~Image()
+    {
+	close(fd);
+	unlink(image);
+    }
+
+    void write(unsigned long long sector, const vector<unsigned char>& data)
+    {
+	BOOST_REQUIRE(pwrite(fd, data.data(), data.size(), sector * 512) == (ssize_t)(data.size()));
+    }
+
+    const unsigned long long num_sectors;
+
+private:
+
+    int fd;
+
+};
+
+
+void
+write_gpt(Image& image, const Parted& parted)
+{
+    const unsigned long long num_entries = parted.get_primary_slots() > 0 ? parted.get_primary_slots() : 128;
+    const unsigned long long entry_sectors = (num_entries * 128 + 511) / 512;
+
+    const unsigned long long alternate_lba = image.num_sectors - 1 - (parted.is_gpt_undersized() ? 2048 : 0);
+
+    vector<unsigned char> mbr(512, 0);
+    mbr[446] = parted.is_gpt_pmbr_boot() ? 0x80 : 0x00;
+    mbr[446 + 4] = 0xee;
+    put_le(mbr, 446 + 8, 1, 4);
+    put_le(mbr, 446 + 12, min(image.num_sectors - 1, 0xffffffffULL), 4);
+    mbr[510] = 0x55;
+    mbr[511] = 0xaa;
+    image.write(0, mbr);
+
+    vector<unsigned char> entries(entry_sectors * 512, 0);
+
+    for (const Parted::Entry& entry : parted.get_entries())
+    {
+	size_t offset = (entry.number - 1) * 128;
+
+	put_guid(entries, offset, id_to_guid(entry.id));
+	put_guid(entries, offset + 16, sformat("%08x-0000-0000-0000-000000000000", entry.number));
+	put_le(entries, offset + 32, entry.region.get_start(), 8);
+	put_le(entries, offset + 40, entry.region.get_end(), 8);
+	put_le(entries, offset + 48, entry.legacy_boot ? 1 << 2 : 0, 8);
+
+	for (size_t i = 0; i < entry.name.size() && i < 36; ++i)
+	    put_le(entries, offset + 56 + 2 * i, (unsigned char)(entry.name[i]), 2);
+    }
+
+    unsigned int entries_crc = crc32(entries.data(), num_entries * 128);
+
+    auto write_header = [&](unsigned long long my_lba, unsigned long long other_lba,
+			    unsigned long long entries_lba) {
+	vector<unsigned char> header(512, 0);
+	memcpy(header.data(), "EFI PART", 8);
+	put_le(header, 8, 0x00010000, 4);
+	put_le(header, 12, 92, 4);
+	put_le(header, 24, my_lba, 8);
+	put_le(header, 32, other_lba, 8);
+	put_le(header, 40, 2 + entry_sectors, 8);
+	put_le(header, 48, alternate_lba - entry_sectors - 1, 8);
+	put_guid(header, 56, "9b2a7d2b-6b9c-4f1e-8f30-2a8b7d1c5e41");
+	put_le(header, 72, entries_lba, 8);
+	put_le(header, 80, num_entries, 4);
+	put_le(header, 84, 128, 4);
+	put_le(header, 88, entries_crc, 4);
+	put_le(header, 16, crc32(header.data(), 92), 4);
+	image.write(my_lba, header);
+	image.write(entries_lba, entries);
+    };
+
+    write_header(1, alternate_lba, 2);
+
+    if (!parted.is_gpt_backup_broken())
+	write_header(alternate_lba, 1, alternate_lba - entry_sectors);
+}
+
+
+bool
+write_msdos(Image& image, const Parted& parted)
+{
+    vector<unsigned char> mbr(512, 0);
+
+    const Parted::Entry* extended = nullptr;
+    vector<const Parted::Entry*> logicals;
+
+    for (const Parted::Entry& entry : parted.get_entries())
+    {
+	if (entry.id > 0xff)
+	    return false;
+
+	if (entry.type == PartitionType::LOGICAL)
+	{
+	    logicals.push_back(&entry);
+	    continue;
+	}
+
+	size_t offset = 446 + 16 * (entry.number - 1);
+	mbr[offset] = entry.boot ? 0x80 : 0x00;
+	mbr[offset + 4] = entry.id;
+	put_le(mbr, offset + 8, entry.region.get_start(), 4);
+	put_le(mbr, offset + 12, entry.region.get_length(), 4);
+
+	if (entry.type == PartitionType::EXTENDED)
+	    extended = &entry;
+    }
+
+    mbr[510] = 0x55;
+    mbr[511] = 0xaa;
+    image.write(0, mbr);
+
+    if (!extended)
+	return logicals.empty();
+
+    // The first EBR is at the start of the extended partition, the others
+    // directly before the logical partition.
+
+    vector<unsigned long long> ebr_lbas;
+    for (size_t i = 0; i < logicals.size(); ++i)
+    {
+	unsigned long long ebr_lba = i == 0 ? extended->region.get_start() : logicals[i]->region.get_start() - 1;
+	if (ebr_lba >= logicals[i]->region.get_start() || (i > 0 && ebr_lba <= logicals[i - 1]->region.get_end()))
+	    return false;
+
+	ebr_lbas.push_back(ebr_lba);
+    }
+
+    if (logicals.empty())
+	ebr_lbas.push_back(extended->region.get_start());
+
+    for (size_t i = 0; i < ebr_lbas.size(); ++i)
+    {
+	vector<unsigned char> ebr(512, 0);
+
+	if (!logicals.empty())
+	{
+	    ebr[446] = logicals[i]->boot ? 0x80 : 0x00;
+	    ebr[446 + 4] = logicals[i]->id;
+	    put_le(ebr, 446 + 8, logicals[i]->region.get_start() - ebr_lbas[i], 4);
+	    put_le(ebr, 446 + 12, logicals[i]->region.get_length(), 4);
+	}
+
+	if (i + 1 < ebr_lbas.size())
+	{
+	    ebr[446 + 16 + 4] = 0x05;
+	    put_le(ebr, 446 + 16 + 8, ebr_lbas[i + 1] - extended->region.get_start(), 4);
+	    put_le(ebr, 446 + 16 + 12, logicals[i + 1]->region.get_end() + 1 - ebr_lbas[i + 1], 4);
+	}
+
+	ebr[510] = 0x55;
+	ebr[511] = 0xaa;
+	image.write(ebr_lbas[i], ebr);
+    }
+
+    return true;
+}
+
+
+string
+normalize(const Parted& parted, bool with_primary_slots)
+{
+    ostringstream tmp;
+    tmp << parted;
+
+    string ret = tmp.str();
+
+    // drop device name
+    ret.erase(0, ret.find(' '));
+
+    if (!with_primary_slots)
+	ret = regex_replace(ret, regex(" primary-slots:[0-9]+"), "");
+
+    return ret;
+}
+
+
+void
+check(const string& mockup_filename, const string& device, bool json, int& checked)
+{
+    PartedVersion::parse_version(json ? "parted (GNU parted) 3.5" : "parted (GNU parted) 3.4");
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+
+    const Parted parted(device);
+
+    if (parted.get_label() != PtType::GPT && parted.get_label() != PtType::MSDOS)
+	return;
+
+    // An MS-DOS partition table without partitions is not handled natively.
+
+    if (parted.get_region().get_block_size() != 512 ||
+	(parted.get_label() == PtType::MSDOS && parted.get_entries().empty()))
+	return;
+
+    Image image(parted.get_region().get_length());
+
+    if (parted.get_label() == PtType::GPT)
+	write_gpt(image, parted);
+    else if (!write_msdos(image, parted))
+	return;
+
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    const Parted native(::image);
+
+    BOOST_CHECK_MESSAGE(normalize(native, parted.get_primary_slots() >= 0) ==
+			normalize(parted, parted.get_primary_slots() >= 0),
+			mockup_filename << " " << device << "\nnative:\n" << native << "parted:\n" << parted);
+
+    ++checked;
+}
+
+
+BOOST_AUTO_TEST_CASE(differential)
+{
+    setenv("LIBSTORAGE_OS_FLAVOUR", "suse", 1);
+    setenv("LIBSTORAGE_NATIVE_PARTED", "yes", 1);
+
+    const regex parted_rx(PARTED_BIN " --script --(json|machine) '(/dev/[^']+)' unit s print");
+
+    glob_t globbuf;
+    BOOST_REQUIRE(glob("../probe/*-mockup.xml", 0, nullptr, &globbuf) == 0);
+
+    int checked = 0;
+
+    for (size_t i = 0; i < globbuf.gl_pathc; ++i)
+    {
+	const string mockup_filename = globbuf.gl_pathv[i];
+
+	// Only the parted commands of the mockup are needed. Mockup::load()
+	// cannot be used since it does not allow to load several mockups.
+
+	XmlFile xml(mockup_filename);
+
+	const xmlNode* mockup_node = getChildNode(xml.getRootElement(), "Mockup");
+	const xmlNode* commands_node = mockup_node ? getChildNode(mockup_node, "Commands") : nullptr;
+	if (!commands_node)
+	    continue;
+
+	vector<pair<string, bool>> devices;
+
+	for (const xmlNode* command_node : getChildNodes(commands_node))
+	{
+	    string name;
+	    getChildValue(command_node, "name", name);
+
+	    Mockup::Command command;
+	    getChildValue(command_node, "stdout", command.stdout);
+	    getChildValue(command_node, "stderr", command.stderr);
+
+	    smatch match;
+	    if (!regex_match(name, match, parted_rx))
+		continue;
+
+	    Mockup::set_command(name, command);
+
+	    devices.emplace_back(match[2], match[1] == "json");
+	}
+
+	for (const pair<string, bool>& device : devices)
+	    check(mockup_filename, device.first, device.second, checked);
+    }
+
+    globfree(&globbuf);
+
+    BOOST_TEST_MESSAGE("checked " << checked << " partition tables");
+
+    BOOST_CHECK_GT(checked, 50);
+}
+
+
+/**
+ * Create a Parted object for the image via a mockup so that the
+ * PartitionTableReader can be tested directly.
+ */
+Parted
+loop_parted(const Image& image)
+{
+    PartedVersion::parse_version("parted (GNU parted) 3.4");
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+
+    Mockup::set_command(PARTED_BIN " --script --machine '" + string(::image) + "' unit s print",
+			RemoteCommand({ "BYT;", sformat("%s:%llus:file:512:512:loop:Image:;", ::image,
+							image.num_sectors) }));
+
+    Parted parted(::image);
+
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    return parted;
+}
+
+BOOST_AUTO_TEST_CASE(fat_boot_sector)
+{
+    // A FAT boot sector has the same signature as an MS-DOS partition
+    // table and must be left to parted.
+
+    Image image(2048);
+
+    vector<unsigned char> mbr(512, 0);
+
+    mbr[446 + 4] = 0x83;
+    put_le(mbr, 446 + 8, 64, 4);
+    put_le(mbr, 446 + 12, 1024, 4);
+
+    mbr[510] = 0x55;
+    mbr[511] = 0xaa;
+
+    // Without a valid BIOS parameter block "FAT" is just some boot code.
+
+    memcpy(&mbr[0x36], "FAT16   ", 8);
+    image.write(0, mbr);
+
+    Parted parted1 = loop_parted(image);
+    BOOST_CHECK(PartitionTableReader(::image).read(parted1));
+    BOOST_CHECK(parted1.get_label() == PtType::MSDOS);
+
+    // 512 bytes per sector, 4 sectors per cluster, 1 reserved sector and 2
+    // FATs.
+
+    put_le(mbr, 0x0b, 512, 2);
+    mbr[0x0d] = 4;
+    put_le(mbr, 0x0e, 1, 2);
+    mbr[0x10] = 2;
+    image.write(0, mbr);
+
+    Parted parted2 = loop_parted(image);
+    BOOST_CHECK(!PartitionTableReader(::image).read(parted2));
+
+    // Same for FAT32.
+
+    memset(&mbr[0x36], 0, 8);
+    memcpy(&mbr[0x52], "FAT32   ", 8);
+    image.write(0, mbr);
+
+    Parted parted3 = loop_parted(image);
+    BOOST_CHECK(!PartitionTableReader(::image).read(parted3));
+}
@@ -0,0 +1,170 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/Utils/AsyncLogger.h"
+#include "storage/Utils/LoggerImpl.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+vector<string>
+read_lines(const string& filename)
+{
+    vector<string> lines;
+
+    ifstream s(filename);
+
+    string line;
+    while (getline(s, line))
+	lines.push_back(line);
+
+    return lines;
+}
+
+
+BOOST_AUTO_TEST_CASE(format)
+{
+    const string filename = "async-logger-format.log";
+
+    unlink(filename.c_str());
+
+    {
+	AsyncLogger logger(filename);
+	logger.write(LogLevel::WARNING, "libstorage", "Foo.cc", 42, "bar", "hello world");
+	logger.flush();
+
+	const vector<string> lines = read_lines(filename);
+	BOOST_REQUIRE_EQUAL(lines.size(), 1);
+	BOOST_CHECK(boost::ends_with(lines[0], " <2> [libstorage] Foo.cc(bar):42 hello world"));
+    }
+
+    unlink(filename.c_str());
+}
+
+
+/**
+ * Check that a message with several lines is split in the background
+ * thread and every line gets the same prefix.
+ */
+BOOST_AUTO_TEST_CASE(multiple_lines)
+{
+    const string filename = "async-logger-multiple-lines.log";
+
+    unlink(filename.c_str());
+
+    {
+	AsyncLogger logger(filename);
+
+	set_logger(&logger);
+
+	y2mil("first\nsecond\n\nfourth\n");
+	y2mil("");
+
+	flush_logger();
+    }
+
+    const vector<string> lines = read_lines(filename);
+    BOOST_REQUIRE_EQUAL(lines.size(), 4);
+    BOOST_CHECK(boost::ends_with(lines[0], " first"));
+    BOOST_CHECK(boost::ends_with(lines[1], " second"));
+    BOOST_CHECK(boost::ends_with(lines[2], " "));
+    BOOST_CHECK(boost::ends_with(lines[3], " fourth"));
+
+    for (const string& line : lines)
+	BOOST_CHECK_EQUAL(line.substr(0, line.rfind(' ')), lines[0].substr(0, lines[0].rfind(' ')));
+
+    unlink(filename.c_str());
+}
+
+
+/**
+ * Check that with several threads and a small ring buffer no log line is
+ * lost and the log lines of every thread keep their order.
+ */
+BOOST_AUTO_TEST_CASE(threads)
+{
+    const string filename = "async-logger-threads.log";
+
+    const int num_threads = 8;
+    const int num_lines = 2000;
+
+    unlink(filename.c_str());
+
+    {
+	AsyncLogger logger(filename, AsyncLogger::format_text, 64);
+
+	set_logger(&logger);
+
+	vector<thread> threads;
+
+	for (int t = 0; t < num_threads; ++t)
+	{
+	    threads.emplace_back([t]() {
+		for (int i = 0; i < num_lines; ++i)
+		    y2mil("thread " << t << " line " << i);
+	    });
+	}
+
+	for (thread& thread : threads)
+	    thread.join();
+
+	flush_logger();
+
+	BOOST_CHECK_EQUAL(read_lines(filename).size(), num_threads * num_lines);
+    }
+
+    // The destructor of the logger resets the current logger.
+    BOOST_CHECK(!get_logger());
+
+    vector<int> next(num_threads, 0);
+
+    for (const string& line : read_lines(filename))
+    {
+	string::size_type pos = line.find("thread ");
+	BOOST_REQUIRE(pos != string::npos);
+
+	int t, i;
+	BOOST_REQUIRE(sscanf(line.c_str() + pos, "thread %d line %d", &t, &i) == 2);
+	BOOST_REQUIRE(t >= 0 && t < num_threads);
+	BOOST_CHECK_EQUAL(i, next[t]);
+	next[t] = i + 1;
+    }
+
+    for (int t = 0; t < num_threads; ++t)
+	BOOST_CHECK_EQUAL(next[t], num_lines);
+
+    unlink(filename.c_str());
+}
+
+
+/**
+ * Check that the destructor writes all queued log lines.
+ */
+BOOST_AUTO_TEST_CASE(destructor)
+{
+    const string filename = "async-logger-destructor.log";
+
+    unlink(filename.c_str());
+
+    {
+	AsyncLogger logger(filename);
+
+	for (int i = 0; i < 100; ++i)
+	    logger.write(LogLevel::MILESTONE, "libstorage", "Foo.cc", i, "bar", "hello");
+    }
+
+    BOOST_CHECK_EQUAL(read_lines(filename).size(), 100);
+
+    unlink(filename.c_str());
+}
@@ -0,0 +1,176 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+#include <fstream>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/Utils/AsyncLogger.h"
+#include "storage/Utils/LoggerImpl.h"
+#include "storage/Utils/JsonFile.h"
+#include "storage/Utils/SystemCmd.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+vector<string>
+read_lines(const string& filename)
+{
+    vector<string> lines;
+
+    ifstream s(filename);
+
+    string line;
+    while (getline(s, line))
+	lines.push_back(line);
+
+    return lines;
+}
+
+
+BOOST_AUTO_TEST_CASE(multiple_lines)
+{
+    // Every line of a message is written as an object.
+
+    const string filename = "json-logger-multiple-lines.log";
+
+    unlink(filename.c_str());
+
+    {
+	JsonLogger logger(filename);
+	set_logger(&logger);
+
+	y2mil("first\nsecond");
+
+	flush_logger();
+    }
+
+    const vector<string> lines = read_lines(filename);
+    BOOST_REQUIRE_EQUAL(lines.size(), 2);
+
+    string message;
+
+    JsonFile json_file1(vector<string>{ lines[0] });
+    BOOST_CHECK(get_child_value(json_file1.get_root(), "message", message));
+    BOOST_CHECK_EQUAL(message, "first");
+
+    JsonFile json_file2(vector<string>{ lines[1] });
+    BOOST_CHECK(get_child_value(json_file2.get_root(), "message", message));
+    BOOST_CHECK_EQUAL(message, "second");
+
+    unlink(filename.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(record)
+{
+    const string filename = "json-logger-record.log";
+
+    unlink(filename.c_str());
+
+    {
+	JsonLogger logger(filename);
+	set_logger(&logger);
+
+	{
+	    LogCorrelation log_correlation1("commit");
+	    LogCorrelation log_correlation2("action");
+
+	    y2war("hello \"world\"");
+	}
+
+	y2mil("bye");
+
+	flush_logger();
+
+	const vector<string> lines = read_lines(filename);
+	BOOST_REQUIRE_EQUAL(lines.size(), 2);
+
+	JsonFile json_file1(vector<string>{ lines[0] });
+
+	string level, file, function, message, correlation_id;
+	int line, tid;
+
+	BOOST_CHECK(get_child_value(json_file1.get_root(), "level", level));
+	BOOST_CHECK_EQUAL(level, "warning");
+
+	BOOST_CHECK(get_child_value(json_file1.get_root(), "file", file));
+	BOOST_CHECK(boost::ends_with(file, "json-logger.cc"));
+
+	BOOST_CHECK(get_child_value(json_file1.get_root(), "line", line));
+	BOOST_CHECK(line > 0);
+
+	BOOST_CHECK(get_child_value(json_file1.get_root(), "function", function));
+	BOOST_CHECK_EQUAL(function, "test_method");
+
+	BOOST_CHECK(get_child_value(json_file1.get_root(), "tid", tid));
+	BOOST_CHECK(tid > 0);
+
+	BOOST_CHECK(get_child_value(json_file1.get_root(), "message", message));
+	BOOST_CHECK_EQUAL(message, "hello \"world\"");
+
+	BOOST_CHECK(get_child_value(json_file1.get_root(), "correlation_id", correlation_id));
+	BOOST_CHECK(boost::starts_with(correlation_id, "commit-"));
+	BOOST_CHECK(correlation_id.find("/action-") != string::npos);
+
+	JsonFile json_file2(vector<string>{ lines[1] });
+
+	BOOST_CHECK(!get_child_value(json_file2.get_root(), "correlation_id", correlation_id));
+    }
+
+    unlink(filename.c_str());
+}
+
+
+/**
+ * Check that the output of a command is logged as one record.
+ */
+BOOST_AUTO_TEST_CASE(command)
+{
+    const string filename = "json-logger-command.log";
+
+    unlink(filename.c_str());
+
+    {
+	JsonLogger logger(filename);
+	set_logger(&logger);
+
+	SystemCmd cmd("echo one ; echo two ; echo three >&2 ; exit 1", SystemCmd::NoThrow);
+
+	flush_logger();
+
+	int num_records = 0;
+
+	for (const string& line : read_lines(filename))
+	{
+	    BOOST_CHECK(line.find("Adding Line") == string::npos);
+	    BOOST_CHECK(line.find("stdout:") == string::npos);
+
+	    JsonFile json_file(vector<string>{ line });
+
+	    string command;
+	    if (!get_child_value(json_file.get_root(), "command", command))
+		continue;
+
+	    ++num_records;
+
+	    BOOST_CHECK_EQUAL(command, "echo one ; echo two ; echo three >&2 ; exit 1");
+
+	    int exit_code;
+	    BOOST_CHECK(get_child_value(json_file.get_root(), "exit_code", exit_code));
+	    BOOST_CHECK_EQUAL(exit_code, 1);
+
+	    BOOST_CHECK(line.find("\"stdout\":[\"one\",\"two\"]") != string::npos);
+	    BOOST_CHECK(line.find("\"stderr\":[\"three\"]") != string::npos);
+	}
+
+	BOOST_CHECK_EQUAL(num_records, 1);
+    }
+
+    unlink(filename.c_str());
+}
@@ -0,0 +1,60 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/Utils/LinesIterator.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+string
+join(const LinesView& lines_view)
+{
+    return boost::join(lines_view.to_vector(), "|");
+}
+
+
+BOOST_AUTO_TEST_CASE(test1)
+{
+    BOOST_CHECK_EQUAL(LinesView("").size(), 0);
+    BOOST_CHECK(LinesView("").empty());
+
+    BOOST_CHECK_EQUAL(LinesView("\n").size(), 1);
+    BOOST_CHECK_EQUAL(join(LinesView("\n")), "");
+
+    BOOST_CHECK_EQUAL(LinesView("a").size(), 1);
+    BOOST_CHECK_EQUAL(join(LinesView("a")), "a");
+
+    BOOST_CHECK_EQUAL(LinesView("a\n").size(), 1);
+    BOOST_CHECK_EQUAL(join(LinesView("a\n")), "a");
+
+    BOOST_CHECK_EQUAL(LinesView("a\nb").size(), 2);
+    BOOST_CHECK_EQUAL(join(LinesView("a\nb")), "a|b");
+
+    BOOST_CHECK_EQUAL(LinesView("a\n\nb\n\n").size(), 4);
+    BOOST_CHECK_EQUAL(join(LinesView("a\n\nb\n\n")), "a||b|");
+}
+
+
+BOOST_AUTO_TEST_CASE(test2)
+{
+    string buffer = "hello\nworld\n";
+
+    LinesView lines_view(buffer);
+
+    LinesView::const_iterator it = lines_view.begin();
+    BOOST_CHECK_EQUAL(*it, "hello");
+    BOOST_CHECK_EQUAL(it->data(), buffer.data());
+
+    ++it;
+    BOOST_CHECK_EQUAL(*it, "world");
+    BOOST_CHECK_EQUAL(it->data(), buffer.data() + 6);
+
+    ++it;
+    BOOST_CHECK(it == lines_view.end());
+}
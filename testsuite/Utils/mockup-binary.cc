@@ -0,0 +1,203 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <unistd.h>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/MockupBinary.h"
+#include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/AsciiFile.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+const string binary_filename = "mockup-binary.bin";
+const string xml_filename = "mockup-binary.xml";
+
+
+void
+setup()
+{
+    Mockup::clear();
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+
+    Mockup::set_command("hello", RemoteCommand({ "hello", "", "world" }, { "warning" }, 0));
+    Mockup::set_command("hello --again", RemoteCommand({ "hello", "", "world" }, {}, 0));
+    Mockup::set_command("fail", RemoteCommand({}, { "error" }, 1));
+    Mockup::set_file("/etc/fstab", RemoteFile({ "/dev/sda1 / btrfs defaults 0 0" }));
+    Mockup::set_file("/etc/empty", RemoteFile());
+}
+
+
+vector<string>
+to_vector(const Mockup::Lines& lines)
+{
+    return lines.to_vector();
+}
+
+
+BOOST_AUTO_TEST_CASE(round_trip)
+{
+    setup();
+
+    Mockup::save_binary(binary_filename);
+
+    BOOST_CHECK(MockupBinary::is_binary(binary_filename));
+
+    Mockup::clear();
+    Mockup::load(binary_filename);
+
+    BOOST_CHECK(Mockup::has_command("hello"));
+    BOOST_CHECK(!Mockup::has_command("unknown"));
+    BOOST_CHECK(!Mockup::has_command("/etc/fstab"));
+
+    Mockup::CommandView hello = Mockup::get_command_view("hello");
+    BOOST_CHECK_EQUAL(hello.stdout.size(), 3);
+    BOOST_CHECK_EQUAL(hello.stdout[0], "hello");
+    BOOST_CHECK_EQUAL(hello.stdout[1], "");
+    BOOST_CHECK_EQUAL(hello.stdout[2], "world");
+    BOOST_CHECK(to_vector(hello.stderr) == vector<string>({ "warning" }));
+    BOOST_CHECK_EQUAL(hello.exit_code, 0);
+
+    BOOST_CHECK(Mockup::get_command("fail") == RemoteCommand({}, { "error" }, 1));
+
+    BOOST_CHECK(to_vector(Mockup::get_file_view("/etc/fstab").content) ==
+		vector<string>({ "/dev/sda1 / btrfs defaults 0 0" }));
+    BOOST_CHECK(Mockup::get_file_view("/etc/empty").content.empty());
+
+    BOOST_CHECK_THROW(Mockup::get_command_view("unknown"), Exception);
+    BOOST_CHECK_THROW(Mockup::get_file_view("/etc/unknown"), Exception);
+
+    // Convert back to XML and load that.
+
+    Mockup::save(xml_filename);
+
+    Mockup::clear();
+    Mockup::load(xml_filename);
+
+    // The XML format does not keep empty lines.
+
+    BOOST_CHECK(Mockup::get_command("hello") == RemoteCommand({ "hello", "world" }, { "warning" }, 0));
+    BOOST_CHECK(Mockup::get_command("hello --again") == RemoteCommand({ "hello", "world" }, {}, 0));
+    BOOST_CHECK(Mockup::get_command("fail") == RemoteCommand({}, { "error" }, 1));
+    BOOST_CHECK(Mockup::get_file("/etc/fstab") == RemoteFile({ "/dev/sda1 / btrfs defaults 0 0" }));
+    BOOST_CHECK(Mockup::get_file("/etc/empty") == RemoteFile());
+
+    Mockup::clear();
+
+    unlink(binary_filename.c_str());
+    unlink(xml_filename.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(override_and_erase)
+{
+    setup();
+
+    Mockup::save_binary(binary_filename);
+
+    Mockup::clear();
+    Mockup::load(binary_filename);
+
+    Mockup::set_command("hello", RemoteCommand({ "bye" }, {}, 0));
+    BOOST_CHECK(to_vector(Mockup::get_command_view("hello").stdout) == vector<string>({ "bye" }));
+
+    Mockup::erase_command("hello --again");
+    BOOST_CHECK(!Mockup::has_command("hello --again"));
+
+    Mockup::erase_file("/etc/fstab");
+    BOOST_CHECK(!Mockup::has_file("/etc/fstab"));
+
+    Mockup::set_file("/etc/fstab", RemoteFile({ "x" }));
+    BOOST_CHECK(Mockup::has_file("/etc/fstab"));
+
+    Mockup::clear();
+
+    unlink(binary_filename.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(playback)
+{
+    setup();
+
+    Mockup::save_binary(binary_filename);
+
+    Mockup::clear();
+    Mockup::load(binary_filename);
+
+    SystemCmd cmd("hello");
+    BOOST_CHECK(cmd.stdout() == vector<string>({ "hello", "", "world" }));
+    BOOST_CHECK(cmd.stderr() == vector<string>({ "warning" }));
+    BOOST_CHECK_EQUAL(cmd.retcode(), 0);
+
+    AsciiFile fstab("/etc/fstab");
+    BOOST_CHECK(fstab.get_lines() == vector<string>({ "/dev/sda1 / btrfs defaults 0 0" }));
+
+    Mockup::clear();
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    unlink(binary_filename.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(playback_capture_buffer)
+{
+    setup();
+
+    Mockup::save_binary(binary_filename);
+
+    Mockup::clear();
+    Mockup::load(binary_filename);
+
+    SystemCmd::Options options("hello");
+    options.capture_buffer = true;
+
+    SystemCmd cmd(options);
+    BOOST_CHECK(cmd.stdout_lines().to_vector() == vector<string>({ "hello", "", "world" }));
+    BOOST_CHECK(cmd.stdout() == vector<string>({ "hello", "", "world" }));
+
+    // The lines point into the mapped mockup, so no copy was made.
+
+    const Mockup::Lines lines = Mockup::get_command_view("hello").stdout;
+    BOOST_REQUIRE(lines.has_buffer());
+    BOOST_CHECK_EQUAL(lines.buffer(), "hello\n\nworld\n");
+
+    const string_view first = *cmd.stdout_lines().begin();
+    BOOST_CHECK(first.data() == lines[0].data());
+    BOOST_CHECK(first.data() == lines.buffer().data());
+
+    // Lines without output.
+
+    SystemCmd::Options fail_options("fail", SystemCmd::NoThrow);
+    fail_options.capture_buffer = true;
+
+    SystemCmd fail(fail_options);
+    BOOST_CHECK(fail.stdout_lines().empty());
+    BOOST_CHECK(fail.stdout().empty());
+    BOOST_CHECK_EQUAL(fail.retcode(), 1);
+
+    Mockup::clear();
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    unlink(binary_filename.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(corrupt)
+{
+    {
+	ofstream s(binary_filename);
+	s << "LSNGMOCK garbage";
+    }
+
+    BOOST_CHECK(MockupBinary::is_binary(binary_filename));
+    BOOST_CHECK_THROW(Mockup::load(binary_filename), Exception);
+
+    unlink(binary_filename.c_str());
+}
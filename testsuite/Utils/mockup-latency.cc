@@ -0,0 +1,100 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/Stopwatch.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+const string xml_filename = "mockup-latency.xml";
+const string binary_filename = "mockup-latency.bin";
+
+
+void
+setup()
+{
+    Mockup::clear();
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_latency_scale(0.0);
+
+    Mockup::set_command("slow", RemoteCommand({ "done" }), 0.2);
+    Mockup::set_command("fast", RemoteCommand({ "done" }));
+    Mockup::set_file("/proc/slow", RemoteFile({ "data" }), 0.05);
+}
+
+
+BOOST_AUTO_TEST_CASE(record)
+{
+    Mockup::clear();
+    Mockup::set_mode(Mockup::Mode::RECORD);
+
+    SystemCmd cmd("sleep 0.1");
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+
+    BOOST_CHECK_GE(Mockup::get_command_view("sleep 0.1").latency, 0.1);
+
+    Mockup::clear();
+    Mockup::set_mode(Mockup::Mode::NONE);
+}
+
+
+BOOST_AUTO_TEST_CASE(save_and_load)
+{
+    setup();
+
+    Mockup::save(xml_filename);
+
+    Mockup::clear();
+    Mockup::load(xml_filename);
+
+    BOOST_CHECK_CLOSE(Mockup::get_command_view("slow").latency, 0.2, 0.001);
+    BOOST_CHECK_EQUAL(Mockup::get_command_view("fast").latency, 0.0);
+    BOOST_CHECK_CLOSE(Mockup::get_file_view("/proc/slow").latency, 0.05, 0.001);
+
+    Mockup::save_binary(binary_filename);
+
+    Mockup::clear();
+    Mockup::load(binary_filename);
+
+    BOOST_CHECK_CLOSE(Mockup::get_command_view("slow").latency, 0.2, 0.001);
+    BOOST_CHECK_EQUAL(Mockup::get_command_view("fast").latency, 0.0);
+    BOOST_CHECK_CLOSE(Mockup::get_file_view("/proc/slow").latency, 0.05, 0.001);
+
+    Mockup::clear();
+
+    unlink(xml_filename.c_str());
+    unlink(binary_filename.c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(replay)
+{
+    setup();
+
+    {
+	Stopwatch stopwatch;
+	SystemCmd cmd("slow");
+	BOOST_CHECK_LT(stopwatch.read(), 0.1);
+    }
+
+    Mockup::set_latency_scale(0.5);
+
+    {
+	Stopwatch stopwatch;
+	SystemCmd cmd("slow");
+	BOOST_CHECK_GE(stopwatch.read(), 0.1);
+    }
+
+    Mockup::clear();
+    Mockup::set_latency_scale(0.0);
+    Mockup::set_mode(Mockup::Mode::NONE);
+}
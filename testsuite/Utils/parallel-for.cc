@@ -0,0 +1,91 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+#include "storage/Utils/ParallelFor.h"
+#include "storage/Utils/OperationBudget.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+BOOST_AUTO_TEST_CASE(all_indices_once)
+{
+    for (unsigned int size : { 0, 1, 3, 16 })
+    {
+	vector<atomic<int>> counts(100);
+
+	parallel_for(counts.size(), size, [&counts](size_t i) { ++counts[i]; });
+
+	for (const atomic<int>& count : counts)
+	    BOOST_CHECK_EQUAL(count.load(), 1);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(no_indices)
+{
+    parallel_for(0, 4, [](size_t i) { BOOST_FAIL("called"); });
+}
+
+
+BOOST_AUTO_TEST_CASE(lowest_exception)
+{
+    atomic<int> calls(0);
+
+    try
+    {
+	parallel_for(50, 4, [&calls](size_t i) {
+	    ++calls;
+	    if (i == 17 || i == 42)
+		throw runtime_error(to_string(i));
+	});
+
+	BOOST_FAIL("no exception");
+    }
+    catch (const runtime_error& e)
+    {
+	BOOST_CHECK_EQUAL(e.what(), string("17"));
+    }
+
+    // An exception does not stop the other calls.
+
+    BOOST_CHECK_EQUAL(calls.load(), 50);
+}
+
+
+BOOST_AUTO_TEST_CASE(cancel_only_on_calling_thread)
+{
+    // The cancel function must only be called on the thread that created
+    // the budget. The other threads must still see the cancellation.
+
+    const thread::id calling_thread = this_thread::get_id();
+
+    atomic<int> polls(0);
+    atomic<bool> foreign_call(false);
+
+    OperationBudget operation_budget(chrono::seconds(0), [&]() {
+	if (this_thread::get_id() != calling_thread)
+	    foreign_call = true;
+	return ++polls >= 5;
+    });
+
+    atomic<int> calls(0);
+
+    parallel_for(8, 4, [&calls](size_t i) {
+	while (!OperationBudget::get_current()->is_cancelled())
+	    this_thread::sleep_for(chrono::milliseconds(1));
+	++calls;
+    });
+
+    BOOST_CHECK(!foreign_call);
+    BOOST_CHECK_EQUAL(calls.load(), 8);
+}
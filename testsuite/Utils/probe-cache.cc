@@ -0,0 +1,391 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "storage/Utils/ProbeCache.h"
+#include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/Exception.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+const string filename = "probe-cache.xml";
+const string udev_data_dir = "probe-cache-udev";
+
+
+/**
+ * Creates fake udev database entries for all block devices so that the
+ * global marker is available.
+ */
+void
+setup()
+{
+    unlink(filename.c_str());
+
+    mkdir(udev_data_dir.c_str(), 0755);
+
+    ifstream s("/proc/partitions");
+
+    string line;
+    while (getline(s, line))
+    {
+	vector<string> columns;
+	boost::split(columns, boost::trim_copy(line), boost::is_any_of(" \t"), boost::token_compress_on);
+	if (columns.size() == 4 && columns[0] != "major")
+	    ofstream(udev_data_dir + "/b" + columns[0] + ":" + columns[1]);
+    }
+}
+
+
+/**
+ * Returns the name of a block device of the system usable for device
+ * markers or an empty string.
+ */
+string
+first_device()
+{
+    ifstream s("/proc/partitions");
+
+    string line;
+    while (getline(s, line))
+    {
+	vector<string> columns;
+	boost::split(columns, boost::trim_copy(line), boost::is_any_of(" \t"), boost::token_compress_on);
+	if (columns.size() != 4 || columns[0] == "major")
+	    continue;
+
+	const string device = "/dev/" + columns[3];
+
+	struct stat st;
+	if (stat(device.c_str(), &st) == 0 && S_ISBLK(st.st_mode))
+	    return device;
+    }
+
+    return "";
+}
+
+
+ProbeCache::Output
+make_output(const string& stdout)
+{
+    ProbeCache::Output output;
+    output.stdout = stdout;
+    return output;
+}
+
+
+BOOST_AUTO_TEST_CASE(hit)
+{
+    setup();
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	SystemCmd cmd("../helpers/echoargs hello");
+
+	BOOST_CHECK_EQUAL(probe_cache.get_hits(), 0);
+	BOOST_CHECK_EQUAL(probe_cache.get_misses(), 1);
+
+	probe_cache.save();
+    }
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	SystemCmd cmd("../helpers/echoargs hello");
+
+	BOOST_CHECK_EQUAL(probe_cache.get_hits(), 1);
+	BOOST_CHECK_EQUAL(probe_cache.get_misses(), 0);
+
+	BOOST_CHECK_EQUAL(boost::join(cmd.stdout(), "\n"), "stdout #1: hello");
+    }
+
+    BOOST_CHECK(!ProbeCache::get_current());
+}
+
+
+BOOST_AUTO_TEST_CASE(hit_capture_buffer)
+{
+    // With capture_buffer the output is stored and played back as one
+    // buffer. The entry can also be used without capture_buffer.
+
+    setup();
+
+    SystemCmd::Options options("../helpers/echoargs one two");
+    options.capture_buffer = true;
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	SystemCmd cmd(options);
+
+	probe_cache.save();
+    }
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	SystemCmd cmd(options);
+
+	BOOST_CHECK_EQUAL(probe_cache.get_hits(), 1);
+
+	vector<string> lines;
+	for (string_view line : cmd.stdout_lines())
+	    lines.emplace_back(line);
+
+	BOOST_CHECK_EQUAL(boost::join(lines, "\n"), "stdout #1: one\nstdout #2: two");
+    }
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	SystemCmd cmd("../helpers/echoargs one two");
+
+	BOOST_CHECK_EQUAL(probe_cache.get_hits(), 1);
+
+	BOOST_CHECK_EQUAL(boost::join(cmd.stdout(), "\n"), "stdout #1: one\nstdout #2: two");
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(missing_device)
+{
+    // No marker available for the device, so never cached.
+
+    setup();
+
+    for (int i = 0; i < 2; ++i)
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	SystemCmd cmd("../helpers/echoargs /dev/does-not-exist");
+
+	BOOST_CHECK_EQUAL(probe_cache.get_hits(), 0);
+
+	probe_cache.save();
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(validate)
+{
+    setup();
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	probe_cache.store("../helpers/echoargs world", make_output("wrong\n"));
+
+	probe_cache.save();
+    }
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::VALIDATE, filename, udev_data_dir);
+
+	SystemCmd cmd("../helpers/echoargs world");
+
+	BOOST_CHECK_EQUAL(probe_cache.get_hits(), 0);
+	BOOST_CHECK_EQUAL(probe_cache.get_mismatches(), 1);
+
+	BOOST_CHECK_EQUAL(boost::join(cmd.stdout(), "\n"), "stdout #1: world");
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(device_in_mockup_key)
+{
+    // The device in a mockup key like '(device:/dev/sda1)' must be found
+    // without the closing parenthesis.
+
+    const string device = first_device();
+    if (device.empty())
+    {
+	BOOST_TEST_MESSAGE("no block device available");
+	return;
+    }
+
+    setup();
+
+    const string name = BTRFS_BIN " filesystem show (device:" + device + ")";
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	probe_cache.store(name, make_output("cached\n"));
+
+	probe_cache.save();
+    }
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	ProbeCache::Output output;
+	BOOST_CHECK(probe_cache.lookup(name, output));
+	BOOST_CHECK_EQUAL(output.stdout, "cached\n");
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(stale_df)
+{
+    // The output of df changes with every write to the filesystem without
+    // changing any marker, so an old entry must not be used.
+
+    setup();
+
+    const string name = DF_BIN " --block-size=1 --output=size,used,avail,fstype '.'";
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	probe_cache.store(name, make_output("stale\n"));
+
+	probe_cache.save();
+    }
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	SystemCmd cmd(name);
+
+	BOOST_CHECK_EQUAL(probe_cache.get_hits(), 0);
+	BOOST_CHECK_NE(boost::join(cmd.stdout(), "\n"), "stale");
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(invalidated_lsattr)
+{
+    // The nocow attribute can be changed with chattr without changing the
+    // marker of the device used in the mockup key.
+
+    const string device = first_device();
+    if (device.empty())
+    {
+	BOOST_TEST_MESSAGE("no block device available");
+	return;
+    }
+
+    setup();
+
+    SystemCmd::Options options(LSATTR_BIN " -d '.'");
+    options.mockup_key = LSATTR_BIN " -d (device:" + device + " path:.)";
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	probe_cache.store(options.mockup_key, make_output("---------------C------ .\n"));
+
+	probe_cache.save();
+    }
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	SystemCmd cmd(options);
+
+	BOOST_CHECK_EQUAL(probe_cache.get_hits(), 0);
+	BOOST_CHECK_NE(boost::join(cmd.stdout(), "\n"), "---------------C------ .");
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(save_permissions)
+{
+    // The cache file must only be readable by the owner, also regardless
+    // of the umask.
+
+    setup();
+
+    mode_t old_umask = umask(022);
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir);
+
+	probe_cache.store("../helpers/echoargs secret", make_output("secret\n"));
+
+	probe_cache.save();
+    }
+
+    umask(old_umask);
+
+    struct stat st;
+    BOOST_REQUIRE(stat(filename.c_str(), &st) == 0);
+    BOOST_CHECK_EQUAL(st.st_mode & 0777, 0600);
+
+    // The directory is not created.
+
+    ProbeCache probe_cache(ProbeCache::Mode::USE, "does-not-exist/" + filename, udev_data_dir);
+    BOOST_CHECK_THROW(probe_cache.save(), Exception);
+}
+
+
+BOOST_AUTO_TEST_CASE(changed_lvm_backup)
+{
+    // Changes of the LVM metadata are not necessarily visible in the udev
+    // database, e.g. for a PV on LUKS, so the LVM backup files are part of
+    // the global marker.
+
+    setup();
+
+    const string lvm_backup_dir = "probe-cache-lvm";
+    const string lvm_backup_file = lvm_backup_dir + "/system";
+
+    mkdir(lvm_backup_dir.c_str(), 0755);
+    ofstream(lvm_backup_file.c_str());
+
+    const struct timespec times1[2] = { { 0, UTIME_OMIT }, { 1000000, 0 } };
+    utimensat(AT_FDCWD, lvm_backup_file.c_str(), times1, 0);
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir, lvm_backup_dir);
+
+	probe_cache.store("../helpers/echoargs lvm", make_output("cached\n"));
+
+	probe_cache.save();
+    }
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir, lvm_backup_dir);
+
+	ProbeCache::Output output;
+	BOOST_CHECK(probe_cache.lookup("../helpers/echoargs lvm", output));
+    }
+
+    const struct timespec times2[2] = { { 0, UTIME_OMIT }, { 2000000, 0 } };
+    utimensat(AT_FDCWD, lvm_backup_file.c_str(), times2, 0);
+
+    {
+	ProbeCache probe_cache(ProbeCache::Mode::USE, filename, udev_data_dir, lvm_backup_dir);
+
+	ProbeCache::Output output;
+	BOOST_CHECK(!probe_cache.lookup("../helpers/echoargs lvm", output));
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(cacheable)
+{
+    BOOST_CHECK(ProbeCache::is_cacheable(PARTED_BIN " --script --json '/dev/sda' unit s print"));
+    BOOST_CHECK(ProbeCache::is_cacheable(BTRFS_BIN " filesystem show"));
+
+    BOOST_CHECK(!ProbeCache::is_cacheable(MOUNT_BIN " -t 'btrfs' '/dev/sda1' '/tmp/libstorage-abc'"));
+    BOOST_CHECK(!ProbeCache::is_cacheable(UDEVADM_BIN_SETTLE));
+
+    BOOST_CHECK(!ProbeCache::is_cacheable(DF_BIN " --block-size=1 --output=size,used,avail,fstype '/home'"));
+    BOOST_CHECK(!ProbeCache::is_cacheable(LSATTR_BIN " -d '/tmp/libstorage-abc/var'"));
+    BOOST_CHECK(!ProbeCache::is_cacheable(BTRFS_BIN " subvolume list -a -puq '/tmp/libstorage-abc'"));
+    BOOST_CHECK(!ProbeCache::is_cacheable(BTRFS_BIN " --format json qgroup show -rep --raw '/tmp/libstorage-abc'"));
+    BOOST_CHECK(!ProbeCache::is_cacheable(BTRFS_BIN " filesystem df '/tmp/libstorage-abc'"));
+    BOOST_CHECK(!ProbeCache::is_cacheable(RESIZE2FS_BIN " -P '/dev/sda1'"));
+    BOOST_CHECK(!ProbeCache::is_cacheable(NTFSRESIZE_BIN " --force --info '/dev/sda2'"));
+}
@@ -0,0 +1,100 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <string>
+#include <vector>
+
+#include "storage/Utils/SystemCmdPool.h"
+#include "storage/Utils/Stopwatch.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+string
+join(const vector<string>& input)
+{
+    return boost::join(input, "\n") + "\n";
+}
+
+
+BOOST_AUTO_TEST_CASE(submit_and_collect)
+{
+    SystemCmdPool pool(2);
+
+    vector<SystemCmdFuture> futures;
+
+    for (int i = 0; i < 5; ++i)
+	futures.push_back(pool.submit("../helpers/echoargs hello " + to_string(i)));
+
+    vector<unique_ptr<SystemCmd>> cmds = wait_all(futures);
+
+    BOOST_REQUIRE_EQUAL(cmds.size(), 5);
+
+    for (int i = 0; i < 5; ++i)
+    {
+	vector<string> stdout = {
+	    "stdout #1: hello",
+	    "stdout #2: " + to_string(i)
+	};
+
+	BOOST_CHECK_EQUAL(join(cmds[i]->stdout()), join(stdout));
+	BOOST_CHECK(cmds[i]->stderr().empty());
+	BOOST_CHECK_EQUAL(cmds[i]->retcode(), 0);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(retcode)
+{
+    SystemCmdFuture future = SystemCmdPool::get_global().submit("../helpers/retcode 42");
+
+    BOOST_CHECK_EQUAL(future.get()->retcode(), 42);
+}
+
+
+BOOST_AUTO_TEST_CASE(exception_in_command)
+{
+    SystemCmdPool pool(1);
+
+    SystemCmdFuture future = pool.submit("/bin/wrglbrmpf", SystemCmd::DoThrow);
+
+    BOOST_CHECK_THROW(future.get(), CommandNotFoundException);
+}
+
+
+BOOST_AUTO_TEST_CASE(bounded_concurrency)
+{
+    // With two workers four commands sleeping 0.2s each need at least 0.4s.
+
+    SystemCmdPool pool(2);
+
+    Stopwatch stopwatch;
+
+    vector<SystemCmdFuture> futures;
+
+    for (int i = 0; i < 4; ++i)
+	futures.push_back(pool.submit("sleep 0.2"));
+
+    wait_all(futures);
+
+    BOOST_CHECK_GE(stopwatch.read(), 0.4);
+    BOOST_CHECK_LT(stopwatch.read(), 0.8);
+}
+
+
+BOOST_AUTO_TEST_CASE(fast_reaping)
+{
+    // Completion must not wait for the poll() timeout of one second.
+
+    Stopwatch stopwatch;
+
+    SystemCmd cmd("../helpers/retcode 0");
+
+    BOOST_CHECK_LT(stopwatch.read(), 0.5);
+}
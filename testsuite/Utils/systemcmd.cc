@@ -13,6 +13,8 @@
 #include "storage/Utils/Exception.h"
 #include "storage/Utils/Mockup.h"
 #include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/OperationBudget.h"
+#include "storage/Utils/Stopwatch.h"
 
 
 using namespace std;
@@ -181,3 +183,126 @@ BOOST_AUTO_TEST_CASE(env)
     BOOST_CHECK(cmd.retcode() == 0);
     BOOST_CHECK_EQUAL(join(cmd.stdout()), join(stdout));
 }
+
+
+BOOST_AUTO_TEST_CASE(capture_buffer)
+{
+    vector<string> stdout = {
+	"line #1: stdout #1: mixed",
+	"line #3: stdout #2: stdout",
+	"line #5: stdout #3: stderr"
+    };
+
+    vector<string> stderr = {
+	"line #2: stderr #1: to",
+	"line #4: stderr #2: and"
+    };
+
+    SystemCmd::Options options("../helpers/echoargs_mixed mixed to stdout and stderr");
+    options.capture_buffer = true;
+
+    SystemCmd cmd(options);
+
+    BOOST_CHECK_EQUAL(join(cmd.stdout_lines().to_vector()), join(stdout));
+    BOOST_CHECK_EQUAL(join(cmd.stdout()), join(stdout));
+    BOOST_CHECK_EQUAL(join(cmd.stderr()), join(stderr));
+}
+
+
+BOOST_AUTO_TEST_CASE(capture_buffer_large)
+{
+    SystemCmd::Options options("seq 1 100000");
+    options.capture_buffer = true;
+
+    SystemCmd cmd(options);
+
+    BOOST_CHECK_EQUAL(cmd.stdout_lines().size(), 100000);
+    BOOST_CHECK_EQUAL(cmd.stdout().front(), "1");
+    BOOST_CHECK_EQUAL(cmd.stdout().back(), "100000");
+}
+
+
+BOOST_AUTO_TEST_CASE(capture_buffer_playback)
+{
+    vector<string> stdout = {
+	"hello",
+	"",
+	"world"
+    };
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::set_command("hello world", RemoteCommand(stdout, {}, 0));
+
+    SystemCmd::Options options("hello world");
+    options.capture_buffer = true;
+
+    SystemCmd cmd(options);
+
+    BOOST_CHECK_EQUAL(join(cmd.stdout_lines().to_vector()), join(stdout));
+
+    Mockup::set_mode(Mockup::Mode::NONE);
+}
+
+
+BOOST_AUTO_TEST_CASE(timeout)
+{
+    // The shell and the sleep must both be killed.
+
+    SystemCmd::Options options("echo hello ; sleep 10 ; echo world", SystemCmd::DoThrow);
+    options.timeout = chrono::milliseconds(200);
+
+    Stopwatch stopwatch;
+
+    try
+    {
+	SystemCmd cmd(options);
+	BOOST_FAIL("no exception thrown");
+    }
+    catch (const CommandTimeoutException& exception)
+    {
+	BOOST_CHECK_EQUAL(join(exception.stdout()), join({ "hello" }));
+    }
+
+    BOOST_CHECK_LT(stopwatch.read(), 2.0);
+}
+
+
+BOOST_AUTO_TEST_CASE(timeout_no_throw)
+{
+    // Even with NoThrow the command must not appear successful.
+
+    SystemCmd::Options options("sleep 10");
+    options.timeout = chrono::milliseconds(200);
+
+    BOOST_CHECK_THROW(SystemCmd cmd(options), CommandTimeoutException);
+}
+
+
+BOOST_AUTO_TEST_CASE(budget_cancel)
+{
+    Stopwatch stopwatch;
+
+    OperationBudget budget(chrono::seconds(0), [&stopwatch]() { return stopwatch.read() > 0.2; });
+
+    BOOST_CHECK_THROW(SystemCmd cmd("sleep 10"), CommandCancelledException);
+
+    BOOST_CHECK_LT(stopwatch.read(), 2.0);
+
+    // Further commands fail immediately.
+
+    BOOST_CHECK_THROW(SystemCmd cmd("../helpers/retcode 0"), CommandCancelledException);
+}
+
+
+BOOST_AUTO_TEST_CASE(budget_restored)
+{
+    {
+	OperationBudget budget(chrono::seconds(0), []() { return true; });
+	BOOST_CHECK(OperationBudget::get_current() == &budget);
+    }
+
+    BOOST_CHECK(OperationBudget::get_current() == nullptr);
+
+    SystemCmd cmd("../helpers/retcode 0");
+    BOOST_CHECK_EQUAL(cmd.retcode(), 0);
+}
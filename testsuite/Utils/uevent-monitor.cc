@@ -0,0 +1,47 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Utils/UeventMonitorImpl.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+template <size_t N>
+void
+parse(const char (&message)[N], set<string>& devices)
+{
+    UeventMonitor::Impl::parse(message, N - 1, devices);
+}
+
+
+BOOST_AUTO_TEST_CASE(parse1)
+{
+    set<string> devices;
+
+    parse("change@/devices/pci0000:00/0000:00:1f.2/ata1/host0/target0:0:0/0:0:0:0/block/sda\0"
+	  "ACTION=change\0DEVPATH=/devices/pci0000:00/0000:00:1f.2/ata1/host0/target0:0:0/0:0:0:0/block/sda\0"
+	  "SUBSYSTEM=block\0DEVNAME=sda\0DEVTYPE=disk\0SEQNUM=4711\0MAJOR=8\0MINOR=0\0", devices);
+
+    BOOST_CHECK(devices == set<string>({ "/dev/sda" }));
+}
+
+
+BOOST_AUTO_TEST_CASE(parse2)
+{
+    set<string> devices;
+
+    // Not a block device.
+
+    parse("add@/devices/virtual/net/tap0\0ACTION=add\0SUBSYSTEM=net\0INTERFACE=tap0\0", devices);
+
+    // Block device with name in subdirectory.
+
+    parse("remove@/devices/virtual/block/dm-0\0ACTION=remove\0SUBSYSTEM=block\0DEVNAME=mapper/test\0", devices);
+
+    BOOST_CHECK(devices == set<string>({ "/dev/mapper/test" }));
+}
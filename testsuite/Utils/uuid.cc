@@ -0,0 +1,31 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Utils/Uuid.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+BOOST_AUTO_TEST_CASE(test_format_uuid)
+{
+    const unsigned char uuid[16] = { 0x6a, 0x0c, 0x2e, 0x4b, 0x8a, 0x2d, 0x44, 0x62,
+				     0x9b, 0x5e, 0x1f, 0x0e, 0x93, 0x13, 0x4c, 0xaf };
+
+    BOOST_CHECK_EQUAL(format_uuid(uuid), "6a0c2e4b-8a2d-4462-9b5e-1f0e93134caf");
+}
+
+
+BOOST_AUTO_TEST_CASE(test_format_mixed_endian_guid)
+{
+    // The GPT partition type GUID for Linux filesystems as stored on disk.
+
+    const unsigned char guid[16] = { 0xaf, 0x3d, 0xc6, 0x0f, 0x83, 0x84, 0x72, 0x47,
+				     0x8e, 0x79, 0x3d, 0x69, 0xd8, 0x47, 0x7d, 0xe4 };
+
+    BOOST_CHECK_EQUAL(format_mixed_endian_guid(guid), "0fc63daf-8483-4772-8e79-3d69d8477de4");
+}
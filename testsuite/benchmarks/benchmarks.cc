@@ -0,0 +1,475 @@
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <memory>
+
+#include "storage/Storage.h"
+#include "storage/Environment.h"
+#include "storage/Devicegraph.h"
+#include "storage/Actiongraph.h"
+#include "storage/Devices/BlkDevice.h"
+#include "storage/Devices/Partitionable.h"
+#include "storage/Devices/PartitionTable.h"
+#include "storage/Filesystems/BlkFilesystem.h"
+#include "storage/EtcFstab.h"
+#include "storage/Version.h"
+#include "storage/Utils/Logger.h"
+#include "storage/Utils/LightProbe.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Stopwatch.h"
+#include "storage/Utils/Format.h"
+#include "storage/Utils/StorageDefines.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+/**
+ * Runs benchmarks of frequently used library functions on mockups of
+ * different sizes and writes the results as JSON.
+ *
+ * Each benchmark is repeated until it ran at least min_iterations times
+ * and at least min_time seconds. Minimum and median are the most stable
+ * numbers to compare between releases.
+ */
+
+
+struct Parameters
+{
+    double min_time = 1.0;
+    unsigned int min_iterations = 5;
+    bool log = false;
+    string output_filename;
+};
+
+Parameters parameters;
+
+
+/**
+ * Logger discarding everything, so that the benchmarks do not measure
+ * writing the log.
+ */
+class NullLogger : public Logger
+{
+public:
+
+    virtual bool test(LogLevel log_level, const string& component) override { return false; }
+
+    virtual void write(LogLevel log_level, const string& component, const string& file, int line,
+		       const string& function, const string& content) override {}
+
+};
+
+
+struct Result
+{
+    string benchmark;
+    string size;
+    unsigned int devices = 0;
+    vector<double> durations;
+};
+
+
+class Benchmarks
+{
+public:
+
+    Benchmarks(const string& size, const string& mockup_filename);
+
+    void run_all();
+
+    void run_light_probe();
+
+    const vector<Result>& get_results() const { return results; }
+
+private:
+
+    const string size;
+    const string mockup_filename;
+
+    unsigned int devices = 0;
+
+    vector<Result> results;
+
+    /**
+     * Calls setup (not measured) and then code (measured) repeatedly.
+     */
+    void run(const string& benchmark, function<void()> setup, function<void()> code);
+
+    void run(const string& benchmark, function<void()> code) { run(benchmark, [](){}, code); }
+
+    static void modify(Devicegraph* devicegraph);
+
+};
+
+
+Benchmarks::Benchmarks(const string& size, const string& mockup_filename)
+    : size(size), mockup_filename(mockup_filename)
+{
+}
+
+
+void
+Benchmarks::run(const string& benchmark, function<void()> setup, function<void()> code)
+{
+    cerr << "running " << benchmark << " on " << size << '\n';
+
+    Result result;
+    result.benchmark = benchmark;
+    result.size = size;
+    result.devices = devices;
+
+    Stopwatch total;
+
+    while (result.durations.size() < parameters.min_iterations || total.read() < parameters.min_time)
+    {
+	setup();
+
+	Stopwatch stopwatch;
+
+	code();
+
+	result.durations.push_back(stopwatch.read());
+    }
+
+    results.push_back(result);
+}
+
+
+/**
+ * Replace every filesystem with an ext4, so that the actiongraph has
+ * delete and create actions for every filesystem.
+ */
+void
+Benchmarks::modify(Devicegraph* devicegraph)
+{
+    for (BlkDevice* blk_device : BlkDevice::get_all(devicegraph))
+    {
+	if (!blk_device->has_blk_filesystem())
+	    continue;
+
+	blk_device->remove_descendants(View::REMOVE);
+	blk_device->create_blk_filesystem(FsType::EXT4);
+    }
+}
+
+
+void
+Benchmarks::run_all()
+{
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename(mockup_filename);
+
+    // Loading a mockup adds to the loaded one, so clear it before every
+    // probe.
+
+    Mockup::clear();
+
+    Storage storage(environment);
+    storage.probe();
+
+    const Devicegraph* probed = storage.get_probed();
+    devices = probed->num_devices();
+
+    run("probe", []() {
+	Mockup::clear();
+    }, [&storage]() {
+	storage.probe();
+    });
+
+    probed = storage.get_probed();
+
+    run("copy_devicegraph", [&storage]() {
+	if (storage.exist_devicegraph("copy"))
+	    storage.remove_devicegraph("copy");
+    }, [&storage]() {
+	storage.copy_devicegraph("probed", "copy");
+    });
+
+    run("equal_devicegraph", [&storage]() {
+	storage.equal_devicegraph("probed", "staging");
+    });
+
+    modify(storage.get_staging());
+
+    run("calculate_actiongraph", [&storage]() {
+	storage.calculate_actiongraph();
+    });
+
+    // The compound actions are generated by calculate_actiongraph(), so
+    // use a separate actiongraph.
+
+    unique_ptr<Actiongraph> tmp;
+
+    run("get_compound_actions", [&storage, &tmp]() {
+	tmp = make_unique<Actiongraph>(storage, storage.get_system(), storage.get_staging());
+    }, [&tmp]() {
+	tmp->generate_compound_actions();
+	tmp->get_compound_actions();
+    });
+
+    const string devicegraph_filename = sformat("/tmp/libstorage-benchmark-%d.xml", getpid());
+
+    run("devicegraph_save", [probed, &devicegraph_filename]() {
+	probed->save(devicegraph_filename);
+    });
+
+    Devicegraph* loaded = storage.create_devicegraph("loaded");
+
+    run("devicegraph_load", [loaded, &devicegraph_filename]() {
+	loaded->load(devicegraph_filename, true);
+    });
+
+    unlink(devicegraph_filename.c_str());
+
+    vector<string> names;
+    for (const BlkDevice* blk_device : BlkDevice::get_all(probed))
+	names.push_back(blk_device->get_name());
+
+    run("find_by_name", [probed, &names]() {
+	for (const string& name : names)
+	    BlkDevice::find_by_name(probed, name);
+    });
+
+    vector<const PartitionTable*> partition_tables;
+    for (const Partitionable* partitionable : Partitionable::get_all(probed))
+    {
+	if (partitionable->has_partition_table())
+	    partition_tables.push_back(partitionable->get_partition_table());
+    }
+
+    run("get_unused_partition_slots", [&partition_tables]() {
+	for (const PartitionTable* partition_table : partition_tables)
+	    partition_table->get_unused_partition_slots();
+    });
+
+    // Probing left the mockup in playback mode, but the fstab is a real
+    // file.
+
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    // An fstab with one entry per filesystem. Modifying changes the mount
+    // options of every entry, removes the first entry and adds a new one.
+    // The result is written to another file to keep the input unchanged.
+
+    const string fstab_filename = sformat("/tmp/libstorage-benchmark-%d.fstab", getpid());
+    const string fstab_out_filename = fstab_filename + ".out";
+
+    {
+	EtcFstab etc_fstab("");
+
+	unsigned int i = 0;
+	for (const BlkFilesystem* blk_filesystem : BlkFilesystem::get_all(probed))
+	    etc_fstab.add(new FstabEntry("UUID=" + blk_filesystem->get_uuid(), sformat("/data/%d", i++),
+					 blk_filesystem->get_type()));
+
+	etc_fstab.write(fstab_filename);
+    }
+
+    run("etc_fstab", [&fstab_filename, &fstab_out_filename]() {
+	EtcFstab etc_fstab(fstab_filename);
+
+	for (int i = 0; i < etc_fstab.get_entry_count(); ++i)
+	    etc_fstab.get_entry(i)->set_mount_opts(MountOpts("noatime"));
+
+	etc_fstab.remove(0);
+	etc_fstab.add(new FstabEntry("LABEL=extra", "/extra", FsType::XFS));
+
+	etc_fstab.write(fstab_out_filename);
+    });
+
+    unlink(fstab_out_filename.c_str());
+    unlink(fstab_filename.c_str());
+}
+
+
+/**
+ * light_probe() reads the sysfs of the host, so the results are only
+ * comparable on the same host.
+ */
+void
+Benchmarks::run_light_probe()
+{
+    Mockup::set_mode(Mockup::Mode::NONE);
+
+    run("light_probe", []() {
+	light_probe();
+    });
+}
+
+
+double
+median(vector<double> durations)
+{
+    sort(durations.begin(), durations.end());
+
+    const size_t n = durations.size();
+
+    return n % 2 == 1 ? durations[n / 2] : (durations[n / 2 - 1] + durations[n / 2]) / 2.0;
+}
+
+
+void
+write_json(ostream& s, const vector<Result>& results)
+{
+    s << "{\n"
+      << "  \"version\": \"" LIBSTORAGE_NG_VERSION_STRING "\",\n"
+      << "  \"unit\": \"s\",\n"
+      << "  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+	const Result& result = results[i];
+	const vector<double>& durations = result.durations;
+
+	const double sum = accumulate(durations.begin(), durations.end(), 0.0);
+
+	s << "    { \"benchmark\": \"" << result.benchmark << "\", \"size\": \"" << result.size << "\", "
+	  << "\"devices\": " << result.devices << ", \"iterations\": " << durations.size() << ", "
+	  << "\"min\": " << *min_element(durations.begin(), durations.end()) << ", "
+	  << "\"median\": " << median(durations) << ", "
+	  << "\"mean\": " << sum / durations.size() << ", "
+	  << "\"max\": " << *max_element(durations.begin(), durations.end()) << " }"
+	  << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+
+    s << "  ]\n"
+      << "}\n";
+}
+
+
+void
+doit(const vector<pair<string, string>>& mockups)
+{
+    NullLogger null_logger;
+
+    if (parameters.log)
+	set_logger(get_logfile_logger());
+    else
+	set_logger(&null_logger);
+
+    vector<Result> results;
+
+    for (const pair<string, string>& mockup : mockups)
+    {
+	Benchmarks benchmarks(mockup.first, mockup.second);
+	benchmarks.run_all();
+
+	const vector<Result>& tmp = benchmarks.get_results();
+	results.insert(results.end(), tmp.begin(), tmp.end());
+    }
+
+    if (access(SYSFS_DIR "/block", R_OK) == 0)
+    {
+	Benchmarks benchmarks("host", "");
+	benchmarks.run_light_probe();
+
+	const vector<Result>& tmp = benchmarks.get_results();
+	results.insert(results.end(), tmp.begin(), tmp.end());
+    }
+
+    set_logger(nullptr);
+
+    if (parameters.output_filename.empty())
+    {
+	write_json(cout, results);
+    }
+    else
+    {
+	ofstream s(parameters.output_filename);
+	write_json(s, results);
+    }
+}
+
+
+void usage() __attribute__ ((__noreturn__));
+
+void
+usage()
+{
+    cerr << "benchmarks [--min-time seconds] [--min-iterations n] [--log] [--output filename]\n"
+	"    size=mockup-filename...\n"
+	"\n"
+	"Runs the benchmarks on every mockup and writes the results as JSON to stdout or\n"
+	"the output file. The size is only used as label in the results. Additionally\n"
+	"light_probe() is run on the host with the size \"host\".\n";
+    exit(EXIT_FAILURE);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    const struct option options[] = {
+	{ "min-time",		required_argument,	0,	1 },
+	{ "min-iterations",	required_argument,	0,	2 },
+	{ "log",		no_argument,		0,	3 },
+	{ "output",		required_argument,	0,	4 },
+	{ 0, 0, 0, 0 }
+    };
+
+    while (true)
+    {
+	int option_index = 0;
+	int c = getopt_long(argc, argv, "", options, &option_index);
+	if (c == -1)
+	    break;
+
+	switch (c)
+	{
+	    case 1:
+		parameters.min_time = atof(optarg);
+		break;
+
+	    case 2:
+		parameters.min_iterations = atoi(optarg);
+		break;
+
+	    case 3:
+		parameters.log = true;
+		break;
+
+	    case 4:
+		parameters.output_filename = optarg;
+		break;
+
+	    default:
+		usage();
+	}
+    }
+
+    if (optind == argc)
+	usage();
+
+    vector<pair<string, string>> mockups;
+
+    for (int i = optind; i < argc; ++i)
+    {
+	const string arg = argv[i];
+
+	string::size_type pos = arg.find('=');
+	if (pos == string::npos || pos == 0 || pos + 1 == arg.size())
+	    usage();
+
+	mockups.emplace_back(arg.substr(0, pos), arg.substr(pos + 1));
+    }
+
+    try
+    {
+	doit(mockups);
+    }
+    catch (const exception& e)
+    {
+	cerr << "exception occured: " << e.what() << '\n';
+	exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
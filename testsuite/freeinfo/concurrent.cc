@@ -0,0 +1,196 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <thread>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Devices/Disk.h"
+#include "storage/Devices/Gpt.h"
+#include "storage/Devices/Partition.h"
+#include "storage/Filesystems/BlkFilesystem.h"
+#include "storage/Devicegraph.h"
+#include "storage/Storage.h"
+#include "storage/Environment.h"
+#include "storage/Utils/Logger.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/HumanString.h"
+#include "storage/FreeInfo.h"
+
+
+/*
+ * Check that the const functions of a devicegraph can be used from several
+ * threads at the same time, including the resize information that is
+ * detected on demand.
+ */
+
+
+using namespace std;
+using namespace storage;
+
+
+const unsigned long long spg = GiB / 512;	// sectors per GiB
+
+
+unsigned long long
+counter(const MetricsSnapshot& metrics, const string& name)
+{
+    map<string, unsigned long long>::const_iterator it = metrics.counters.find(name);
+    return it == metrics.counters.end() ? 0 : it->second;
+}
+
+
+/**
+ * Query the devicegraph and return the results as text.
+ */
+string
+query(const Devicegraph* devicegraph)
+{
+    ostringstream s;
+
+    devicegraph->check();
+
+    s << devicegraph->num_devices() << " " << devicegraph->num_holders() << '\n';
+
+    const Disk* sda = Disk::find_by_name(devicegraph, "/dev/sda");
+
+    for (const Partition* partition : sda->get_partition_table()->get_partitions())
+    {
+	s << partition->get_name() << " " << partition->detect_resize_info() << '\n';
+
+	const BlkFilesystem* blk_filesystem = partition->get_blk_filesystem();
+	s << blk_filesystem->get_displayname() << " " << blk_filesystem->detect_resize_info() << '\n';
+
+	for (const Device* ancestor : blk_filesystem->get_ancestors(false))
+	    s << " " << ancestor->get_displayname();
+
+	s << '\n';
+    }
+
+    return s.str();
+}
+
+
+BOOST_AUTO_TEST_CASE(concurrent_queries)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::NONE, TargetMode::DIRECT);
+
+    Storage storage(environment);
+
+    Devicegraph* staging = storage.get_staging();
+
+    // Create disk with ext4 and ntfs filesystems.
+
+    Disk* sda = Disk::create(staging, "/dev/sda", Region(0, 100 * spg, 512));
+
+    PartitionTable* gpt = sda->create_partition_table(PtType::GPT);
+
+    for (int i = 1; i <= 4; ++i)
+    {
+	Partition* partition = gpt->create_partition("/dev/sda" + to_string(i), Region(i * 10 * spg, 10 * spg, 512),
+						     PartitionType::PRIMARY);
+	partition->create_blk_filesystem(i % 2 == 1 ? FsType::EXT4 : FsType::NTFS);
+    }
+
+    // Copy staging devicegraph to system devicegraph so that querying
+    // the resize-info uses external commands.
+
+    storage.remove_devicegraph("system");
+    storage.copy_devicegraph("staging", "system");
+
+    // Setup mocking to what querying resize-info needs.
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+
+    for (int i = 1; i <= 4; i += 2)
+    {
+	Mockup::set_command(DUMPE2FS_BIN " -h '/dev/sda" + to_string(i) + "'", vector<string> {
+	    "Filesystem features:      64bit",
+	    "Block size:               4096",
+	});
+
+	Mockup::set_command(RESIZE2FS_BIN " -P '/dev/sda" + to_string(i) + "'", vector<string> {
+	    "Estimated minimum size of the filesystem: 100000"
+	});
+    }
+
+    for (int i = 2; i <= 4; i += 2)
+    {
+	Mockup::set_command(NTFSRESIZE_BIN " --force --info '/dev/sda" + to_string(i) + "'", vector<string> {
+	    "You might resize at 1073741824 bytes or 1 GB (freeing 9 GB)."
+	});
+    }
+
+    Mockup::set_command(UDEVADM_BIN_SETTLE, vector<string> {});
+
+    const MetricsSnapshot before = storage.get_metrics();
+
+    // Half of the threads query the staging devicegraph directly, the
+    // others a copy of it. The results are only checked after joining
+    // the threads since Boost.Test assertions must not be used in threads.
+
+    const int num_threads = 8;
+    const int rounds = 20;
+
+    vector<string> results(num_threads);
+    vector<string> errors(num_threads);
+
+    vector<thread> threads;
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+	threads.emplace_back([&storage, staging, &results, &errors, i]() {
+	    try
+	    {
+		unique_ptr<Devicegraph> copy;
+		if (i % 2 == 1)
+		{
+		    copy = make_unique<Devicegraph>(&storage);
+		    staging->copy(*copy);
+		}
+
+		for (int round = 0; round < rounds; ++round)
+		{
+		    string result = query(copy ? copy.get() : staging);
+
+		    if (round > 0 && result != results[i])
+		    {
+			errors[i] = "different results in round " + to_string(round);
+			return;
+		    }
+
+		    results[i] = result;
+		}
+	    }
+	    catch (const exception& e)
+	    {
+		errors[i] = e.what();
+	    }
+	});
+    }
+
+    for (thread& thread : threads)
+	thread.join();
+
+    const MetricsSnapshot after = storage.get_metrics();
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+	BOOST_CHECK_MESSAGE(errors[i].empty(), errors[i]);
+	BOOST_CHECK_EQUAL(results[i], results[0]);
+    }
+
+    BOOST_CHECK_EQUAL(results[0], query(staging));
+
+    // The resize-info of each filesystem is detected only once.
+
+    BOOST_CHECK_EQUAL(counter(after, "commands_total{tool=\"resize2fs\"}") -
+		      counter(before, "commands_total{tool=\"resize2fs\"}"), 2);
+
+    BOOST_CHECK_EQUAL(counter(after, "commands_total{tool=\"ntfsresize\"}") -
+		      counter(before, "commands_total{tool=\"ntfsresize\"}"), 2);
+}
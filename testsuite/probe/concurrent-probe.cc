@@ -0,0 +1,142 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <unistd.h>
+#include <thread>
+#include <regex>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/Environment.h"
+#include "storage/Storage.h"
+#include "storage/Devicegraph.h"
+#include "storage/Devices/Device.h"
+#include "storage/Utils/Logger.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+/**
+ * Description of the devicegraph without sids since the sids depend on the
+ * order in which the threads create devices.
+ */
+string
+description(const Devicegraph* devicegraph)
+{
+    const regex sid_rx(" sid:[0-9]+");
+
+    vector<string> lines;
+
+    for (const Device* device : Device::get_all(devicegraph))
+    {
+	ostringstream s;
+	s << *device;
+
+	for (const Device* child : device->get_children())
+	    s << " child:" << child->get_displayname();
+
+	lines.push_back(regex_replace(s.str(), sid_rx, ""));
+    }
+
+    sort(lines.begin(), lines.end());
+
+    return boost::join(lines, "\n");
+}
+
+
+string
+probe(const string& name)
+{
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename(name + "-mockup.xml");
+
+    Storage storage(environment);
+    storage.probe();
+
+    const Devicegraph* probed = storage.get_probed();
+    probed->check();
+
+    return description(probed);
+}
+
+
+/**
+ * Probe the mockup several times and compare the result with the expected
+ * description. Problems are reported in error since Boost.Test assertions
+ * must not be used in threads.
+ */
+void
+probe_rounds(const string& name, const string& expected, int rounds, string& error)
+{
+    try
+    {
+	for (int round = 0; round < rounds; ++round)
+	{
+	    if (probe(name) != expected)
+	    {
+		error = "unexpected devicegraph in round " + to_string(round);
+		return;
+	    }
+	}
+    }
+    catch (const exception& e)
+    {
+	error = e.what();
+    }
+}
+
+
+/**
+ * Probe different mockups with several Storage objects in parallel
+ * threads. Each probe must give the same result as a probe without other
+ * threads.
+ */
+BOOST_AUTO_TEST_CASE(concurrent_probe)
+{
+    setenv("LIBSTORAGE_OS_FLAVOUR", "suse", 1);
+
+    const string log_filename = "concurrent-probe.log";
+
+    unlink(log_filename.c_str());
+
+    set_logger(get_async_logfile_logger(log_filename));
+
+    // The versions of the tools, e.g. parted, are queried only once per
+    // process so all mockups must use the same versions.
+
+    const vector<string> names = { "md1", "md2", "lvm1", "luks1", "btrfs1", "bcache1", "dasd1",
+				   "multipath1" };
+
+    const int threads_per_name = 2;
+    const int rounds = 3;
+
+    // Probe each mockup without other threads first.
+
+    vector<string> expected;
+
+    for (const string& name : names)
+	expected.push_back(probe(name));
+
+    vector<string> errors(names.size() * threads_per_name);
+
+    vector<thread> threads;
+
+    for (size_t i = 0; i < errors.size(); ++i)
+	threads.emplace_back(probe_rounds, names[i % names.size()], expected[i % names.size()],
+			     rounds, ref(errors[i]));
+
+    for (thread& thread : threads)
+	thread.join();
+
+    flush_logger();
+    set_logger(get_stdout_logger());
+
+    for (size_t i = 0; i < errors.size(); ++i)
+	BOOST_CHECK_MESSAGE(errors[i].empty(), names[i % names.size()] << ": " << errors[i]);
+
+    unlink(log_filename.c_str());
+}
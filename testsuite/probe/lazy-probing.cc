@@ -0,0 +1,289 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <unistd.h>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Environment.h"
+#include "storage/Storage.h"
+#include "storage/Devicegraph.h"
+#include "storage/Actiongraph.h"
+#include "storage/Devices/BlkDevice.h"
+#include "storage/Filesystems/Btrfs.h"
+#include "storage/Filesystems/BtrfsSubvolume.h"
+#include "storage/Filesystems/BtrfsQgroup.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+string
+subvolumes(const Devicegraph* devicegraph)
+{
+    const Btrfs* btrfs = to_btrfs(BlkDevice::find_by_name(devicegraph, "/dev/sdb1")->get_blk_filesystem());
+
+    vector<const BtrfsSubvolume*> btrfs_subvolumes = btrfs->get_btrfs_subvolumes();
+    sort(btrfs_subvolumes.begin(), btrfs_subvolumes.end(), BtrfsSubvolume::compare_by_id);
+
+    string ret;
+
+    for (const BtrfsSubvolume* btrfs_subvolume : btrfs_subvolumes)
+	ret += to_string(btrfs_subvolume->get_id()) + ":" + btrfs_subvolume->get_path() + " ";
+
+    return ret;
+}
+
+
+/**
+ * Check that with lazy probing the subvolumes and qgroups of btrfs are only
+ * probed on first access, also by const functions, and then end up in all
+ * devicegraphs with the same sids.
+ */
+BOOST_AUTO_TEST_CASE(lazy_probing)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("btrfs5-mockup.xml");
+    environment.set_lazy_probing(true);
+
+    Storage storage(environment);
+    storage.probe();
+
+    const Devicegraph* probed = storage.get_probed();
+    probed->check();
+
+    Devicegraph expected(&storage);
+    expected.load("btrfs5-devicegraph.xml");
+
+    // The subvolumes (except of the top-level subvolume) and the qgroups
+    // are missing.
+
+    BOOST_CHECK_EQUAL(probed->num_devices(), expected.num_devices() - 3 - 7);
+
+    // Const functions also probe the details.
+
+    // The subvolumes are created after probing and thus have other sids
+    // than in the expected devicegraph. So compare ids and paths.
+
+    BOOST_CHECK_EQUAL(subvolumes(probed), subvolumes(&expected));
+
+    Devicegraph* staging = storage.get_staging();
+
+    probed->check();
+    staging->check();
+
+    BOOST_CHECK_EQUAL(storage.get_system()->num_devices(), expected.num_devices());
+    BOOST_CHECK_EQUAL(staging->num_devices(), expected.num_devices());
+
+    // Same sids in probed and staging, so nothing to do.
+
+    BOOST_CHECK(storage.calculate_actiongraph()->empty());
+}
+
+
+/**
+ * Check that the postponed details are saved in the XML and that
+ * calculating the actiongraph probes them.
+ */
+BOOST_AUTO_TEST_CASE(lazy_probing_save_and_actiongraph)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("btrfs5-mockup.xml");
+    environment.set_lazy_probing(true);
+
+    Storage storage(environment);
+    storage.probe();
+
+    storage.get_probed()->save("lazy-probing.xml");
+
+    Devicegraph loaded(&storage);
+    loaded.load("lazy-probing.xml");
+
+    BOOST_CHECK(loaded == *storage.get_probed());
+
+    BOOST_CHECK(storage.calculate_actiongraph()->empty());
+
+    // All devicegraphs of the storage object now have the details but not
+    // the loaded one.
+
+    BOOST_CHECK_EQUAL(subvolumes(storage.get_probed()), subvolumes(storage.get_staging()));
+    BOOST_CHECK(loaded != *storage.get_probed());
+
+    // Accessing the details of the loaded devicegraph probes them there
+    // too.
+
+    BOOST_CHECK_EQUAL(subvolumes(&loaded), subvolumes(storage.get_probed()));
+    BOOST_CHECK(loaded == *storage.get_probed());
+
+    // A devicegraph loaded from XML with postponed details cannot be
+    // probed with ProbeMode::READ_DEVICEGRAPH.
+
+    Environment environment2(true, ProbeMode::READ_DEVICEGRAPH, TargetMode::DIRECT);
+    environment2.set_devicegraph_filename("lazy-probing.xml");
+
+    Storage storage2(environment2);
+    storage2.probe();
+
+    BOOST_CHECK_THROW(subvolumes(storage2.get_probed()), Exception);
+    BOOST_CHECK_THROW(storage2.probe_lazy_details(), Exception);
+
+    unlink("lazy-probing.xml");
+}
+
+
+/**
+ * Check that getting the top-level subvolume probes the details so that
+ * creating a subvolume on it does not duplicate a probed subvolume.
+ */
+BOOST_AUTO_TEST_CASE(lazy_probing_top_level)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("btrfs5-mockup.xml");
+    environment.set_lazy_probing(true);
+
+    Storage storage(environment);
+    storage.probe();
+
+    Devicegraph* staging = storage.get_staging();
+
+    Btrfs* btrfs = to_btrfs(BlkDevice::find_by_name(staging, "/dev/sdb1")->get_blk_filesystem());
+
+    BtrfsSubvolume* top_level = btrfs->get_top_level_btrfs_subvolume();
+
+    const string before = subvolumes(staging);
+    BOOST_CHECK_EQUAL(before, subvolumes(storage.get_system()));
+
+    top_level->create_btrfs_subvolume("new");
+
+    BOOST_CHECK_EQUAL(subvolumes(staging), "-1:new " + before);
+
+    staging->check();
+}
+
+
+/**
+ * Check that after Storage::probe_lazy_details() the details can be read
+ * from several threads at the same time. Also uses the views that filter
+ * qgroups and snapshots.
+ */
+BOOST_AUTO_TEST_CASE(lazy_probing_concurrent_reads)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("btrfs5-mockup.xml");
+    environment.set_lazy_probing(true);
+
+    Storage storage(environment);
+    storage.probe();
+    storage.probe_lazy_details();
+
+    const Devicegraph* probed = storage.get_probed();
+
+    auto query = [probed]() {
+	const Btrfs* btrfs = to_btrfs(BlkDevice::find_by_name(probed, "/dev/sdb1")->get_blk_filesystem());
+
+	string ret = subvolumes(probed);
+
+	ret += to_string(btrfs->get_btrfs_qgroups().size()) + " ";
+	ret += to_string(btrfs->get_descendants(false, View::ALL).size()) + " ";
+	ret += to_string(btrfs->get_descendants(false, View::CLASSIC).size()) + " ";
+	ret += to_string(btrfs->get_default_btrfs_subvolume()->get_id());
+
+	probed->check();
+
+	return ret;
+    };
+
+    const string expected = query();
+
+    const int num_threads = 8;
+
+    vector<string> results(num_threads);
+
+    vector<thread> threads;
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+	threads.emplace_back([&query, &results, i]() {
+	    try
+	    {
+		for (int round = 0; round < 20; ++round)
+		    results[i] = query();
+	    }
+	    catch (const exception& e)
+	    {
+		results[i] = e.what();
+	    }
+	});
+    }
+
+    for (thread& thread : threads)
+	thread.join();
+
+    for (int i = 0; i < num_threads; ++i)
+	BOOST_CHECK_EQUAL(results[i], expected);
+}
+
+
+/**
+ * Check that several threads accessing the postponed details at the same
+ * time via const functions probe them only once.
+ */
+BOOST_AUTO_TEST_CASE(lazy_probing_concurrent_first_access)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("btrfs5-mockup.xml");
+    environment.set_lazy_probing(true);
+
+    Storage storage(environment);
+    storage.probe();
+
+    const Devicegraph* probed = storage.get_probed();
+
+    // Find the btrfs before starting the threads since probing the details
+    // modifies the devicegraph.
+
+    const Btrfs* btrfs = to_btrfs(BlkDevice::find_by_name(probed, "/dev/sdb1")->get_blk_filesystem());
+
+    const int num_threads = 8;
+
+    vector<string> results(num_threads);
+
+    vector<thread> threads;
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+	threads.emplace_back([btrfs, &results, i]() {
+	    try
+	    {
+		results[i] = to_string(btrfs->get_btrfs_subvolumes().size()) + " " +
+		    to_string(btrfs->get_btrfs_qgroups().size());
+	    }
+	    catch (const exception& e)
+	    {
+		results[i] = e.what();
+	    }
+	});
+    }
+
+    for (thread& thread : threads)
+	thread.join();
+
+    for (int i = 0; i < num_threads; ++i)
+	BOOST_CHECK_EQUAL(results[i], "4 7");
+
+    probed->check();
+
+    BOOST_CHECK_EQUAL(subvolumes(probed), subvolumes(storage.get_staging()));
+}
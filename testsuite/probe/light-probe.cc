@@ -0,0 +1,48 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Utils/LightProbe.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Logger.h"
+#include "storage/Utils/StorageDefines.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+BOOST_AUTO_TEST_CASE(mockup)
+{
+    set_logger(get_stdout_logger());
+
+    Mockup::set_mode(Mockup::Mode::PLAYBACK);
+    Mockup::load("md1-mockup.xml");
+
+    BOOST_CHECK(light_probe());
+
+    Mockup::clear();
+    Mockup::set_mode(Mockup::Mode::NONE);
+}
+
+
+BOOST_AUTO_TEST_CASE(sysfs)
+{
+    set_logger(get_stdout_logger());
+
+    // Only checks that reading the sysfs of the host works and gives a
+    // stable result, the timing is measured by the benchmarks.
+
+    if (access(SYSFS_DIR "/block", R_OK) != 0)
+    {
+	BOOST_TEST_MESSAGE(SYSFS_DIR "/block not available");
+	return;
+    }
+
+    const bool found = light_probe();
+
+    BOOST_CHECK_EQUAL(light_probe(), found);
+}
@@ -0,0 +1,65 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Environment.h"
+#include "storage/Storage.h"
+#include "storage/Devicegraph.h"
+#include "storage/Devices/BlkDevice.h"
+#include "storage/Utils/Logger.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+unsigned long long
+counter(const MetricsSnapshot& metrics, const string& name)
+{
+    map<string, unsigned long long>::const_iterator it = metrics.counters.find(name);
+    return it == metrics.counters.end() ? 0 : it->second;
+}
+
+
+/**
+ * Check that probing updates the metrics.
+ */
+BOOST_AUTO_TEST_CASE(metrics)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("md1-mockup.xml");
+
+    Storage storage(environment);
+
+    const MetricsSnapshot before = storage.get_metrics();
+
+    storage.probe();
+
+    const BlkDevice* md0 = BlkDevice::find_by_name(storage.get_probed(), "/dev/md0");
+    storage.get_probed()->find_device(md0->get_sid());
+
+    const MetricsSnapshot after = storage.get_metrics();
+
+    BOOST_CHECK_GT(counter(after, "commands_total{tool=\"blkid\"}"), counter(before, "commands_total{tool=\"blkid\"}"));
+    BOOST_CHECK_GT(counter(after, "commands_total{tool=\"udevadm\"}"), counter(before, "commands_total{tool=\"udevadm\"}"));
+    BOOST_CHECK_GT(counter(after, "command_output_bytes_total"), counter(before, "command_output_bytes_total"));
+
+    BOOST_CHECK_GE(counter(after, "devicegraph_copies_total"), counter(before, "devicegraph_copies_total") + 2);
+    BOOST_CHECK_GT(counter(after, "device_clones_total"), counter(before, "device_clones_total"));
+    BOOST_CHECK_GT(counter(after, "find_vertex_total"), counter(before, "find_vertex_total"));
+    BOOST_CHECK_GT(counter(after, "device_lookups_total{function=\"find_by_name\"}"),
+		   counter(before, "device_lookups_total{function=\"find_by_name\"}"));
+
+    const MetricsHistogram& udev_settle = after.histograms.at("udev_settle_duration_seconds");
+    BOOST_CHECK_GT(udev_settle.count, 0);
+    BOOST_CHECK_EQUAL(udev_settle.bucket_bounds.size(), udev_settle.bucket_counts.size());
+    BOOST_CHECK(is_sorted(udev_settle.bucket_counts.begin(), udev_settle.bucket_counts.end()));
+    BOOST_CHECK_LE(udev_settle.bucket_counts.back(), udev_settle.count);
+
+    const MetricsHistogram& command_duration = after.histograms.at("command_duration_seconds");
+    BOOST_CHECK_GT(command_duration.count, udev_settle.count);
+}
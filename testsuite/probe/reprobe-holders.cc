@@ -0,0 +1,77 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/Environment.h"
+#include "storage/Storage.h"
+#include "storage/Devicegraph.h"
+#include "storage/Devices/BlkDevice.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/StorageDefines.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+map<string, sid_t>
+sids_by_name(const Devicegraph* devicegraph)
+{
+    map<string, sid_t> ret;
+
+    for (const BlkDevice* blk_device : BlkDevice::get_all(devicegraph))
+	ret[blk_device->get_name()] = blk_device->get_sid();
+
+    return ret;
+}
+
+
+void
+modify_command(const string& name, const string& from, const string& to)
+{
+    Mockup::Command command = Mockup::get_command(name);
+
+    for (string& line : command.stdout)
+	boost::replace_all(line, from, to);
+
+    Mockup::set_command(name, command);
+}
+
+
+BOOST_AUTO_TEST_CASE(reprobe_holders)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("luks1-mockup.xml");
+
+    Storage storage(environment);
+    storage.probe();
+
+    const Devicegraph* probed = storage.get_probed();
+
+    const map<string, sid_t> sids = sids_by_name(probed);
+
+    BOOST_CHECK_EQUAL(BlkDevice::find_by_name(probed, "/dev/mapper/cr_home")->get_sysfs_name(), "dm-0");
+
+    // The LUKS on sda2 is opened again and gets a new dm device. Only sda
+    // is reported as changed.
+
+    modify_command(UDEVADM_BIN " info '/dev/mapper/cr_home'", "dm-0", "dm-1");
+
+    for (const string& file : { "size", "alignment_offset", "ro", "queue/optimal_io_size",
+				"queue/logical_block_size" })
+	Mockup::set_file("/sys/devices/virtual/block/dm-1/" + file,
+			 Mockup::get_file("/sys/devices/virtual/block/dm-0/" + file));
+
+    storage.reprobe({ "/dev/sda" });
+
+    const BlkDevice* luks = BlkDevice::find_by_name(probed, "/dev/mapper/cr_home");
+    BOOST_CHECK_EQUAL(luks->get_sysfs_name(), "dm-1");
+    BOOST_CHECK_EQUAL(luks->get_sysfs_path(), "/devices/virtual/block/dm-1");
+
+    BOOST_CHECK(sids_by_name(probed) == sids);
+}
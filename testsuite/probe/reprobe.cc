@@ -0,0 +1,94 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/Environment.h"
+#include "storage/Storage.h"
+#include "storage/Devicegraph.h"
+#include "storage/Devices/Partition.h"
+#include "storage/Filesystems/BlkFilesystem.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/StorageDefines.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+map<string, sid_t>
+sids_by_name(const Devicegraph* devicegraph)
+{
+    map<string, sid_t> ret;
+
+    for (const BlkDevice* blk_device : BlkDevice::get_all(devicegraph))
+    {
+	ret[blk_device->get_name()] = blk_device->get_sid();
+
+	if (blk_device->has_blk_filesystem())
+	    ret["fs on " + blk_device->get_name()] = blk_device->get_blk_filesystem()->get_sid();
+    }
+
+    return ret;
+}
+
+
+void
+modify_command(const string& name, const string& from, const string& to)
+{
+    Mockup::Command command = Mockup::get_command(name);
+
+    for (string& line : command.stdout)
+	boost::replace_all(line, from, to);
+
+    Mockup::set_command(name, command);
+}
+
+
+BOOST_AUTO_TEST_CASE(reprobe)
+{
+    set_logger(get_stdout_logger());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("disk-mockup.xml");
+
+    Storage storage(environment);
+    storage.probe();
+
+    const Devicegraph* probed = storage.get_probed();
+
+    const map<string, sid_t> sids = sids_by_name(probed);
+
+    BOOST_CHECK_EQUAL(BlkDevice::find_by_name(probed, "/dev/sdb")->get_blk_filesystem()->get_label(), "HOME");
+    BOOST_CHECK(to_partition(BlkDevice::find_by_name(probed, "/dev/sda2"))->is_boot());
+
+    // Change the label of the filesystem on sdb and the boot flag on sda.
+
+    modify_command(BLKID_BIN " -c '/dev/null'", "LABEL=\"HOME\"", "LABEL=\"DATA\"");
+    modify_command(PARTED_BIN " --script --json '/dev/sda' unit s print", "\"boot\"", "");
+
+    // Only sdb is reported as changed. The blkid output covers all devices
+    // and is read again, the parted output for sda is still cached.
+
+    storage.reprobe({ "/dev/sdb" });
+
+    BOOST_CHECK_EQUAL(storage.get_probed(), probed);
+    probed->check();
+
+    BOOST_CHECK_EQUAL(BlkDevice::find_by_name(probed, "/dev/sdb")->get_blk_filesystem()->get_label(), "DATA");
+    BOOST_CHECK(to_partition(BlkDevice::find_by_name(probed, "/dev/sda2"))->is_boot());
+
+    BOOST_CHECK(sids_by_name(probed) == sids);
+
+    // Now sda is also reported as changed.
+
+    storage.reprobe({ "/dev/sda" });
+
+    BOOST_CHECK(!to_partition(BlkDevice::find_by_name(probed, "/dev/sda2"))->is_boot());
+
+    BOOST_CHECK(sids_by_name(probed) == sids);
+    BOOST_CHECK(sids_by_name(storage.get_system()) == sids);
+}
+
@@ -0,0 +1,116 @@
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE libstorage
+
+#include <boost/test/unit_test.hpp>
+
+#include "storage/Environment.h"
+#include "storage/Storage.h"
+#include "storage/Utils/Logger.h"
+#include "storage/Utils/JsonFile.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+struct Span
+{
+    string name;
+    string cat;
+    unsigned int ts;
+    unsigned int dur;
+};
+
+
+vector<Span>
+read_spans(const string& filename)
+{
+    vector<Span> spans;
+
+    JsonFile json_file(filename);
+
+    vector<json_object*> events;
+    BOOST_REQUIRE(get_child_nodes(json_file.get_root(), "traceEvents", events));
+
+    for (json_object* event : events)
+    {
+	string ph;
+	BOOST_REQUIRE(get_child_value(event, "ph", ph));
+	if (ph != "X")
+	    continue;
+
+	Span span;
+	BOOST_REQUIRE(get_child_value(event, "name", span.name));
+	BOOST_REQUIRE(get_child_value(event, "cat", span.cat));
+	BOOST_REQUIRE(get_child_value(event, "ts", span.ts));
+	BOOST_REQUIRE(get_child_value(event, "dur", span.dur));
+
+	spans.push_back(span);
+    }
+
+    return spans;
+}
+
+
+const Span*
+find_span(const vector<Span>& spans, const string& name)
+{
+    for (const Span& span : spans)
+	if (span.name == name)
+	    return &span;
+
+    return nullptr;
+}
+
+
+/**
+ * Check that probing with tracing enabled writes the spans of the probe
+ * passes and of the system information in the Chrome trace event format.
+ */
+BOOST_AUTO_TEST_CASE(trace)
+{
+    set_logger(get_stdout_logger());
+
+    const string filename = "trace.json";
+
+    unlink(filename.c_str());
+
+    Environment environment(true, ProbeMode::READ_MOCKUP, TargetMode::DIRECT);
+    environment.set_mockup_filename("md1-mockup.xml");
+    environment.set_trace_filename(filename);
+
+    {
+	Storage storage(environment);
+	storage.probe();
+    }
+
+    const vector<Span> spans = read_spans(filename);
+
+    const Span* probe = find_span(spans, "probe");
+    BOOST_REQUIRE(probe);
+    BOOST_CHECK_EQUAL(probe->cat, "storage");
+
+    for (const char* name : { "pass 1a", "pass 1b", "pass 1c", "pass 1d", "pass 1e", "pass 1f", "pass 2" })
+    {
+	const Span* pass = find_span(spans, name);
+	BOOST_REQUIRE_MESSAGE(pass, "span " << name << " missing");
+
+	BOOST_CHECK_EQUAL(pass->cat, "prober");
+	BOOST_CHECK(pass->ts >= probe->ts);
+	BOOST_CHECK(pass->ts + pass->dur <= probe->ts + probe->dur);
+    }
+
+    BOOST_CHECK(find_span(spans, "storage::Blkid"));
+    BOOST_CHECK(find_span(spans, "copy devicegraph"));
+
+    const Span* udev_settle = find_span(spans, "/usr/bin/udevadm settle --timeout=20");
+    BOOST_REQUIRE(udev_settle);
+    BOOST_CHECK_EQUAL(udev_settle->cat, "udev");
+
+    const Span* blkid = find_span(spans, "/sbin/blkid -c '/dev/null'");
+    BOOST_REQUIRE(blkid);
+    BOOST_CHECK_EQUAL(blkid->cat, "command");
+
+    unlink(filename.c_str());
+}
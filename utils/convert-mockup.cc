@@ -0,0 +1,60 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/Logger.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+void usage() __attribute__ ((__noreturn__));
+
+void
+usage()
+{
+    cerr << "convert-mockup [--binary] input-filename output-filename\n"
+	"\n"
+	"The format of the input is detected automatically. The output is XML unless\n"
+	"--binary is given.\n";
+    exit(EXIT_FAILURE);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    bool binary = false;
+
+    if (argc > 1 && strcmp(argv[1], "--binary") == 0)
+    {
+	binary = true;
+	--argc;
+	++argv;
+    }
+
+    if (argc != 3)
+	usage();
+
+    set_logger(get_logfile_logger());
+
+    try
+    {
+	Mockup::load(argv[1]);
+
+	if (binary)
+	    Mockup::save_binary(argv[2]);
+	else
+	    Mockup::save(argv[2]);
+    }
+    catch (const exception& e)
+    {
+	cerr << "exception occured: " << e.what() << '\n';
+	exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
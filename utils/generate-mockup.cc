@@ -0,0 +1,1109 @@
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <iostream>
+#include <random>
+#include <numeric>
+#include <boost/algorithm/string.hpp>
+
+#include "storage/Storage.h"
+#include "storage/Environment.h"
+#include "storage/Devicegraph.h"
+#include "storage/Devices/DiskImpl.h"
+#include "storage/Devices/Gpt.h"
+#include "storage/Devices/PartitionImpl.h"
+#include "storage/Devices/MdImpl.h"
+#include "storage/Devices/LvmVgImpl.h"
+#include "storage/Devices/LvmPvImpl.h"
+#include "storage/Devices/LvmLvImpl.h"
+#include "storage/Devices/LuksImpl.h"
+#include "storage/Filesystems/XfsImpl.h"
+#include "storage/Holders/User.h"
+#include "storage/Holders/MdUser.h"
+#include "storage/Holders/Subdevice.h"
+#include "storage/Utils/Mockup.h"
+#include "storage/Utils/SystemCmd.h"
+#include "storage/Utils/Logger.h"
+#include "storage/Utils/StorageDefines.h"
+#include "storage/Utils/Format.h"
+
+
+using namespace std;
+using namespace storage;
+
+
+/**
+ * Generates a mockup of a system with a configurable number of disks,
+ * partitions, MD RAIDs, LVM VGs and LVs, optionally with LUKS on the LVs,
+ * plus the devicegraph expected when probing the mockup.
+ *
+ * All disks are identical SATA disks with a GPT holding the same number
+ * of equally sized partitions. Each MD RAID is a RAID1 using two
+ * partitions on different disks. The PVs for the VGs are taken from the
+ * MD RAIDs first and then from the remaining partitions. Every block
+ * device not otherwise used gets a XFS.
+ */
+
+
+struct Parameters
+{
+    unsigned int disks = 2;
+    unsigned int partitions = 2;
+    unsigned int mds = 0;
+    unsigned int vgs = 0;
+    unsigned int pvs_per_vg = 1;
+    unsigned int lvs = 1;
+    bool luks = false;
+    unsigned int seed = 42;
+    bool binary = false;
+    string mockup_filename = "generated-mockup.xml";
+    string devicegraph_filename = "generated-devicegraph.xml";
+};
+
+Parameters parameters;
+
+
+const unsigned long long partition_sectors = 4 * GiB / 512;
+const unsigned long long pe_start = 1 * MiB;
+const unsigned long long extent_size = 4 * MiB;
+
+// Must match the options used in CmdLvm.cc.
+#define LVM_OPTIONS "--reportformat json --config 'log { command_names = 0 prefix = \"\" }' " \
+    "--units b --nosuffix"
+
+const char* linux_type_uuid = "0fc63daf-8483-4772-8e79-3d69d8477de4";
+const char* raid_type_uuid = "a19d880f-05fc-4d3b-a006-743f0f84911e";
+const char* lvm_type_uuid = "e6d6d379-f507-44c2-a23c-238f2a3df928";
+
+
+/**
+ * A block device of the generated system with everything needed to
+ * generate the output of udevadm, blkid and the files in sysfs.
+ */
+struct Node
+{
+    string name;
+    string sysfs_name;
+    string sysfs_path;
+    bool partition = false;
+    unsigned int major = 0;
+    unsigned int minor = 0;
+    unsigned long long sectors = 0;
+
+    vector<string> links;
+    vector<string> properties;
+
+    string dm_table_name;
+    string uuid;
+
+    string blkid_name;
+    string blkid_tags;
+
+    BlkDevice* blk_device = nullptr;
+
+    string majorminor() const { return sformat("%d:%d", major, minor); }
+};
+
+
+class Generator
+{
+public:
+
+    Generator(Devicegraph* devicegraph)
+	: devicegraph(devicegraph), random(parameters.seed)
+    {
+    }
+
+    void generate();
+
+private:
+
+    Devicegraph* devicegraph;
+
+    mt19937_64 random;
+
+    vector<Node> disks;
+    vector<vector<Node>> partitions;
+    vector<Node> mds;
+    vector<Node> lvs;
+    vector<Node> lukses;
+
+    vector<pair<Node*, LvmPv*>> lvm_pvs;
+
+    vector<string> parted_flags;
+
+    unsigned int next_dm_minor = 0;
+    unsigned int next_ext_minor = 0;
+
+    vector<string> dmsetup_table;
+    vector<string> crypttab;
+
+    string hex(unsigned int digits);
+    string uuid();
+    string md_uuid();
+    string lvm_uuid();
+
+    static string disk_name(unsigned int i);
+    static vector<unsigned int> sorted_by_name(const vector<string>& names);
+
+    void generate_disks();
+    void generate_mds();
+    void generate_lvm();
+    void generate_partitions();
+    void generate_holders();
+    void generate_lukses();
+    void generate_filesystems();
+
+    void add_filesystem(Node& node);
+
+    Node& find_partition(unsigned int n);
+
+    void emit_node(const Node& node) const;
+    void emit_parted(unsigned int i) const;
+    void emit_common() const;
+
+};
+
+
+string
+Generator::hex(unsigned int digits)
+{
+    string ret;
+
+    for (unsigned int i = 0; i < digits; ++i)
+	ret += "0123456789abcdef"[random() % 16];
+
+    return ret;
+}
+
+
+string
+Generator::uuid()
+{
+    return hex(8) + "-" + hex(4) + "-" + hex(4) + "-" + hex(4) + "-" + hex(12);
+}
+
+
+string
+Generator::md_uuid()
+{
+    return hex(8) + ":" + hex(8) + ":" + hex(8) + ":" + hex(8);
+}
+
+
+string
+Generator::lvm_uuid()
+{
+    const char* chars = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+    string ret;
+
+    for (unsigned int n : { 6, 4, 4, 4, 4, 4, 6 })
+    {
+	if (!ret.empty())
+	    ret += "-";
+
+	for (unsigned int i = 0; i < n; ++i)
+	    ret += chars[random() % 62];
+    }
+
+    return ret;
+}
+
+
+/**
+ * Name of the disk with index i the way the kernel names SCSI disks, so
+ * sda to sdz, sdaa to sdzz and so on.
+ */
+string
+Generator::disk_name(unsigned int i)
+{
+    string ret;
+
+    for (unsigned int n = i + 1; n > 0; n = (n - 1) / 26)
+	ret.insert(ret.begin(), 'a' + (n - 1) % 26);
+
+    return "sd" + ret;
+}
+
+
+void
+Generator::generate_disks()
+{
+    for (unsigned int i = 0; i < parameters.disks; ++i)
+    {
+	// Major and minor numbers as assigned by the sd driver. Partitions
+	// beyond the 15th get dynamic numbers from the block extended
+	// major.
+
+	static const unsigned int sd_majors[] = { 8, 65, 66, 67, 68, 69, 70, 71, 128, 129, 130,
+						  131, 132, 133, 134, 135 };
+
+	const string serial = sformat("GEN%08d", i);
+	const string by_id = "ata-GENERATED_DISK_" + serial;
+	const string by_path = sformat("pci-0000:00:1f.2-ata-%d", i + 1);
+
+	Node disk;
+	disk.sysfs_name = disk_name(i);
+	disk.name = DEV_DIR "/" + disk.sysfs_name;
+	disk.sysfs_path = sformat("/devices/pci0000:00/0000:00:1f.2/ata%d/host%d/target%d:0:0/%d:0:0:0/block/",
+				  i + 1, i, i, i) + disk.sysfs_name;
+	disk.major = sd_majors[(i >> 4) & 0xf];
+	disk.minor = ((i & 0xf) << 4) | ((i & 0xfff00) << 12);
+	disk.sectors = 2048 + parameters.partitions * partition_sectors + 2048;
+	disk.links = { "disk/by-id/" + by_id, "disk/by-path/" + by_path };
+	disk.properties = { "ID_PART_TABLE_TYPE=gpt", "ID_SERIAL_SHORT=" + serial };
+
+	Disk* d = Disk::create(devicegraph, disk.name, Region(0, disk.sectors, 512));
+	d->get_impl().set_sysfs_name(disk.sysfs_name);
+	d->get_impl().set_sysfs_path(disk.sysfs_path);
+	d->get_impl().set_udev_paths({ by_path });
+	d->get_impl().set_udev_ids({ by_id });
+	d->get_impl().set_range(256);
+	d->get_impl().set_rotational(true);
+	disk.blk_device = d;
+
+	vector<Node> tmp;
+
+	for (unsigned int j = 0; j < parameters.partitions; ++j)
+	{
+	    const string partuuid = uuid();
+
+	    Node partition;
+	    partition.partition = true;
+	    partition.sysfs_name = disk.sysfs_name + to_string(j + 1);
+	    partition.name = DEV_DIR "/" + partition.sysfs_name;
+	    partition.sysfs_path = disk.sysfs_path + "/" + partition.sysfs_name;
+	    if (j < 15)
+	    {
+		partition.major = disk.major;
+		partition.minor = disk.minor + j + 1;
+	    }
+	    else
+	    {
+		partition.major = 259;
+		partition.minor = next_ext_minor++;
+	    }
+	    partition.sectors = partition_sectors;
+	    partition.links = { "disk/by-id/" + by_id + sformat("-part%d", j + 1),
+				"disk/by-path/" + by_path + sformat("-part%d", j + 1),
+				"disk/by-partuuid/" + partuuid };
+	    partition.properties = { sformat("PARTN=%d", j + 1), "ID_PART_ENTRY_SCHEME=gpt",
+				     "ID_PART_ENTRY_UUID=" + partuuid };
+	    partition.blkid_name = partition.name;
+	    partition.blkid_tags = "PARTUUID=\"" + partuuid + "\"";
+	    partition.uuid = partuuid;
+
+	    tmp.push_back(partition);
+	}
+
+	disks.push_back(disk);
+	partitions.push_back(tmp);
+    }
+
+    parted_flags.assign(parameters.disks * parameters.partitions, "");
+}
+
+
+void
+Generator::generate_partitions()
+{
+    for (unsigned int i = 0; i < parameters.disks; ++i)
+    {
+	Disk* disk = to_disk(disks[i].blk_device);
+
+	PartitionTable* gpt = disk->create_partition_table(PtType::GPT);
+
+	for (unsigned int j = 0; j < parameters.partitions; ++j)
+	{
+	    Node& partition = partitions[i][j];
+
+	    Partition* p = gpt->create_partition(partition.name, Region(2048 + j * partition_sectors,
+									partition_sectors, 512),
+						 PartitionType::PRIMARY);
+	    p->get_impl().set_sysfs_name(partition.sysfs_name);
+	    p->get_impl().set_sysfs_path(partition.sysfs_path);
+	    p->get_impl().set_udev_paths({ disk->get_udev_paths().front() + sformat("-part%d", j + 1) });
+	    p->get_impl().set_udev_ids({ disk->get_udev_ids().front() + sformat("-part%d", j + 1) });
+	    p->get_impl().set_uuid(partition.uuid);
+
+	    const string& flag = parted_flags[j * parameters.disks + i];
+	    if (flag == "raid")
+		p->set_id(ID_RAID);
+	    else if (flag == "lvm")
+		p->set_id(ID_LVM);
+
+	    partition.blk_device = p;
+	}
+    }
+}
+
+
+/**
+ * Indices of names in the order of sorted names. Ties keep their order.
+ */
+vector<unsigned int>
+Generator::sorted_by_name(const vector<string>& names)
+{
+    vector<unsigned int> ret(names.size());
+    iota(ret.begin(), ret.end(), 0);
+
+    stable_sort(ret.begin(), ret.end(), [&names](unsigned int lhs, unsigned int rhs) {
+	return names[lhs] < names[rhs];
+    });
+
+    return ret;
+}
+
+
+/**
+ * Find partition n when enumerating the partitions by partition number
+ * first, so consecutive partitions are always on different disks (given
+ * there are at least two disks).
+ */
+Node&
+Generator::find_partition(unsigned int n)
+{
+    return partitions[n % parameters.disks][n / parameters.disks];
+}
+
+
+void
+Generator::generate_mds()
+{
+    for (unsigned int k = 0; k < parameters.mds; ++k)
+    {
+	const string uuid = md_uuid();
+	const string label = sformat("any:%d", k);
+
+	Node md;
+	md.sysfs_name = sformat("md%d", k);
+	md.name = DEV_DIR "/" + md.sysfs_name;
+	md.sysfs_path = "/devices/virtual/block/" + md.sysfs_name;
+	md.major = 9;
+	md.minor = k;
+	md.sectors = partition_sectors - 8192;
+	md.links = { "disk/by-id/md-uuid-" + uuid };
+	md.properties = { "MD_LEVEL=raid1", "MD_DEVICES=2", "MD_METADATA=1.0", "MD_UUID=" + uuid,
+			  "MD_NAME=" + label };
+
+	Md* m = Md::create(devicegraph, md.name);
+	m->get_impl().set_region(Region(0, md.sectors, 512));
+	m->get_impl().set_sysfs_name(md.sysfs_name);
+	m->get_impl().set_sysfs_path(md.sysfs_path);
+	m->get_impl().set_udev_ids({ "md-uuid-" + uuid });
+	m->get_impl().set_range(256);
+	m->get_impl().set_md_level(MdLevel::RAID1);
+	m->get_impl().set_metadata("1.0");
+	m->get_impl().set_uuid(uuid);
+	md.blk_device = m;
+
+	string dashed_uuid = uuid.substr(0, 8) + "-" + uuid.substr(9, 4) + "-" + uuid.substr(13, 4) + "-" +
+	    uuid.substr(18, 4) + "-" + uuid.substr(22, 8) + uuid.substr(31, 4);
+
+	for (unsigned int role = 0; role < 2; ++role)
+	{
+	    Node& partition = find_partition(2 * k + role);
+
+	    partition.blkid_tags = "UUID=\"" + dashed_uuid + "\" UUID_SUB=\"" + this->uuid() + "\" LABEL=\"" +
+		label + "\" TYPE=\"linux_raid_member\" " + partition.blkid_tags;
+	    partition.properties.push_back("ID_FS_TYPE=linux_raid_member");
+	    partition.properties.push_back("ID_FS_UUID=" + dashed_uuid);
+
+	    parted_flags[2 * k + role] = "raid";
+
+	    const string tmp = partition.sysfs_name;
+	    md.properties.push_back(sformat("MD_DEVICE_dev_%s_ROLE=%d", tmp.c_str(), role));
+	    md.properties.push_back(sformat("MD_DEVICE_dev_%s_DEV=%s", tmp.c_str(), partition.name.c_str()));
+
+	}
+
+	mds.push_back(md);
+    }
+}
+
+
+void
+Generator::generate_lvm()
+{
+    // The candidates for PVs, first the MD RAIDs, then the unused
+    // partitions.
+
+    vector<Node*> candidates;
+
+    for (Node& md : mds)
+	candidates.push_back(&md);
+
+    for (unsigned int n = 2 * parameters.mds; n < parameters.disks * parameters.partitions; ++n)
+	candidates.push_back(&find_partition(n));
+
+    if (parameters.vgs * parameters.pvs_per_vg > candidates.size())
+	throw runtime_error("not enough partitions or MD RAIDs for the PVs");
+
+    vector<string> pvs_lines;
+    vector<string> vgs_lines;
+    vector<string> lvs_lines;
+
+    // Like during probing first all VGs, then all PVs and finally all LVs
+    // are created, each sorted by name (so vg10 comes before vg2). That
+    // way the sids match the probed devicegraph.
+
+    vector<string> vg_names;
+    for (unsigned int v = 0; v < parameters.vgs; ++v)
+	vg_names.push_back(sformat("vg%d", v));
+
+    vector<LvmVg*> lvm_vgs(parameters.vgs, nullptr);
+
+    for (unsigned int v : sorted_by_name(vg_names))
+    {
+	lvm_vgs[v] = LvmVg::create(devicegraph, vg_names[v]);
+	lvm_vgs[v]->get_impl().set_uuid(lvm_uuid());
+    }
+
+    vector<string> pv_names;
+    vector<string> pv_uuids;
+
+    for (unsigned int n = 0; n < parameters.vgs * parameters.pvs_per_vg; ++n)
+    {
+	Node& node = *candidates[n];
+	const string pv_uuid = lvm_uuid();
+
+	node.blkid_tags = "UUID=\"" + pv_uuid + "\" TYPE=\"LVM2_member\" " + node.blkid_tags;
+	node.properties.push_back("ID_FS_TYPE=LVM2_member");
+	node.properties.push_back("ID_FS_UUID=" + pv_uuid);
+	node.links.push_back("disk/by-id/lvm-pv-uuid-" + pv_uuid);
+
+	if (node.partition)
+	    parted_flags[n - mds.size() + 2 * parameters.mds] = "lvm";
+
+	pv_names.push_back(node.name);
+	pv_uuids.push_back(pv_uuid);
+    }
+
+    vector<unsigned long long> extent_counts(parameters.vgs, 0);
+
+    for (unsigned int n : sorted_by_name(pv_names))
+    {
+	Node& node = *candidates[n];
+	const LvmVg* lvm_vg = lvm_vgs[n / parameters.pvs_per_vg];
+
+	pvs_lines.push_back(sformat("{\"pv_name\":\"%s\", \"pv_uuid\":\"%s\", \"vg_name\":\"%s\", "
+				    "\"vg_uuid\":\"%s\", \"pv_attr\":\"a--\", \"pe_start\":\"%llu\"}",
+				    node.name.c_str(), pv_uuids[n].c_str(), lvm_vg->get_vg_name().c_str(),
+				    lvm_vg->get_impl().get_uuid().c_str(), pe_start));
+
+	LvmPv* lvm_pv = LvmPv::create(devicegraph);
+	lvm_pv->get_impl().set_uuid(pv_uuids[n]);
+	lvm_pv->get_impl().set_pe_start(pe_start);
+	Subdevice::create(devicegraph, lvm_pv, lvm_vg);
+
+	lvm_pvs.emplace_back(&node, lvm_pv);
+
+	extent_counts[n / parameters.pvs_per_vg] += (node.sectors * 512 - pe_start) / extent_size;
+    }
+
+    vector<Node> tmp_lvs;
+    vector<string> lv_names;
+    vector<unsigned int> lv_vgs;
+    vector<unsigned long long> lv_extents(parameters.vgs, 0);
+
+    for (unsigned int v = 0; v < parameters.vgs; ++v)
+    {
+	const string& vg_name = vg_names[v];
+	const string& vg_uuid = lvm_vgs[v]->get_impl().get_uuid();
+
+	lv_extents[v] = extent_counts[v] / (parameters.lvs + 1);
+	if (lv_extents[v] == 0)
+	    throw runtime_error("VG too small for the LVs");
+
+	for (unsigned int l = 0; l < parameters.lvs; ++l)
+	{
+	    // Probing sorts the LVs by name only, so the names are unique
+	    // across all VGs to have a well-defined order.
+	    const string lv_name = sformat("lv%d", v * parameters.lvs + l);
+	    const string lv_uuid = lvm_uuid();
+	    const string dm_table_name = vg_name + "-" + lv_name;
+
+	    Node lv;
+	    lv.sysfs_name = sformat("dm-%d", next_dm_minor);
+	    lv.name = DEV_DIR "/" + vg_name + "/" + lv_name;
+	    lv.sysfs_path = "/devices/virtual/block/" + lv.sysfs_name;
+	    lv.major = 254;
+	    lv.minor = next_dm_minor++;
+	    lv.sectors = lv_extents[v] * extent_size / 512;
+	    lv.links = { vg_name + "/" + lv_name, "mapper/" + dm_table_name,
+			 "disk/by-id/dm-name-" + dm_table_name };
+	    lv.properties = { "DM_NAME=" + dm_table_name, "DM_VG_NAME=" + vg_name, "DM_LV_NAME=" + lv_name };
+	    lv.dm_table_name = dm_table_name;
+	    lv.uuid = lv_uuid;
+	    lv.blkid_name = DEV_MAPPER_DIR "/" + dm_table_name;
+
+	    lvs_lines.push_back(sformat("{\"lv_name\":\"%s\", \"lv_uuid\":\"%s\", \"vg_name\":\"%s\", "
+					"\"vg_uuid\":\"%s\", \"lv_role\":\"public\", \"lv_attr\":\"-wi-a-----\", "
+					"\"lv_size\":\"%llu\", \"segtype\":\"linear\", \"stripes\":\"1\", "
+					"\"stripe_size\":\"0\", \"chunk_size\":\"0\", \"pool_lv\":\"\", "
+					"\"pool_lv_uuid\":\"\", \"origin\":\"\", \"origin_uuid\":\"\", "
+					"\"data_lv\":\"\", \"data_lv_uuid\":\"\", \"metadata_lv\":\"\", "
+					"\"metadata_lv_uuid\":\"\"}", lv_name.c_str(), lv_uuid.c_str(),
+					vg_name.c_str(), vg_uuid.c_str(), lv_extents[v] * extent_size));
+
+	    // The real mapping is irrelevant for probing.
+	    dmsetup_table.push_back(sformat("%s: 0 %llu linear %s %llu", dm_table_name.c_str(), lv.sectors,
+					    candidates[v * parameters.pvs_per_vg]->majorminor().c_str(),
+					    pe_start / 512));
+
+	    tmp_lvs.push_back(lv);
+	    lv_names.push_back(lv_name);
+	    lv_vgs.push_back(v);
+	}
+
+	vgs_lines.push_back(sformat("{\"vg_name\":\"%s\", \"vg_uuid\":\"%s\", \"vg_attr\":\"wz--n-\", "
+				    "\"vg_extent_size\":\"%llu\", \"vg_extent_count\":\"%llu\", "
+				    "\"vg_free_count\":\"%llu\"}", vg_name.c_str(), vg_uuid.c_str(),
+				    extent_size, extent_counts[v], extent_counts[v] - parameters.lvs * lv_extents[v]));
+    }
+
+    for (unsigned int i : sorted_by_name(lv_names))
+    {
+	Node& lv = tmp_lvs[i];
+	const unsigned int v = lv_vgs[i];
+
+	LvmLv* lvm_lv = lvm_vgs[v]->create_lvm_lv(lv_names[i], LvType::NORMAL, lv_extents[v] * extent_size);
+	lvm_lv->get_impl().set_sysfs_name(lv.sysfs_name);
+	lvm_lv->get_impl().set_sysfs_path(lv.sysfs_path);
+	lvm_lv->get_impl().set_uuid(lv.uuid);
+	lvm_lv->get_impl().set_used_extents(lv_extents[v]);
+	lvm_lv->get_impl().set_stripes(1);
+	lv.blk_device = lvm_lv;
+
+	lvs.push_back(lv);
+    }
+
+    auto report = [](const char* type, const vector<string>& lines) {
+	vector<string> ret = { "  {", "      \"report\": [", "          {",
+			       sformat("              \"%s\": [", type) };
+	for (size_t i = 0; i < lines.size(); ++i)
+	    ret.push_back("                  " + lines[i] + (i + 1 < lines.size() ? "," : ""));
+	ret.insert(ret.end(), { "              ]", "          }", "      ]", "  }" });
+	return ret;
+    };
+
+    Mockup::set_command(PVS_BIN " " LVM_OPTIONS " --all --options pv_name,pv_uuid,vg_name,vg_uuid,pv_attr,"
+			"pe_start", RemoteCommand(report("pv", pvs_lines), {}, 0));
+    Mockup::set_command(VGS_BIN " " LVM_OPTIONS " --options vg_name,vg_uuid,vg_attr,vg_extent_size,"
+			"vg_extent_count,vg_free_count", RemoteCommand(report("vg", vgs_lines), {}, 0));
+    Mockup::set_command(LVS_BIN " " LVM_OPTIONS " --all --options lv_name,lv_uuid,vg_name,vg_uuid,lv_role,"
+			"lv_attr,lv_size,origin_size,pool_lv,pool_lv_uuid,origin,origin_uuid,data_lv,"
+			"data_lv_uuid,metadata_lv,metadata_lv_uuid,segtype,stripes,stripe_size,chunk_size",
+			RemoteCommand(report("lv", lvs_lines), {}, 0));
+}
+
+
+/**
+ * Add the holders between the partitions and the MD RAIDs and between the
+ * block devices and the PVs. Only possible once the partitions exist.
+ */
+void
+Generator::generate_holders()
+{
+    for (unsigned int k = 0; k < parameters.mds; ++k)
+    {
+	Md* md = to_md(mds[k].blk_device);
+
+	for (unsigned int role = 0; role < 2; ++role)
+	{
+	    MdUser* md_user = md->add_device(find_partition(2 * k + role).blk_device);
+	    md_user->set_sort_key(role + 1);
+	}
+
+	// Adding devices recalculates the size, restore the probed one.
+	md->get_impl().set_region(Region(0, mds[k].sectors, 512));
+    }
+
+    for (const pair<Node*, LvmPv*>& tmp : lvm_pvs)
+	User::create(devicegraph, tmp.first->blk_device, tmp.second);
+
+    // Recalculates the regions of the VGs.
+    for (LvmVg* lvm_vg : LvmVg::get_all(devicegraph))
+	lvm_vg->set_extent_size(extent_size);
+}
+
+
+void
+Generator::add_filesystem(Node& node)
+{
+    const string fs_uuid = uuid();
+
+    node.blkid_tags = "UUID=\"" + fs_uuid + "\" TYPE=\"xfs\" " + node.blkid_tags;
+    node.properties.push_back("ID_FS_TYPE=xfs");
+    node.properties.push_back("ID_FS_UUID=" + fs_uuid);
+    node.links.push_back("disk/by-uuid/" + fs_uuid);
+
+    BlkFilesystem* blk_filesystem = node.blk_device->create_blk_filesystem(FsType::XFS);
+    blk_filesystem->get_impl().set_uuid(fs_uuid);
+}
+
+
+void
+Generator::emit_node(const Node& node) const
+{
+    vector<string> lines = {
+	"P: " + node.sysfs_path,
+	"N: " + node.sysfs_name
+    };
+
+    for (const string& link : node.links)
+	lines.push_back("S: " + link);
+
+    lines.push_back("E: DEVPATH=" + node.sysfs_path);
+    lines.push_back("E: DEVNAME=" DEV_DIR "/" + node.sysfs_name);
+    lines.push_back(string("E: DEVTYPE=") + (node.partition ? "partition" : "disk"));
+    lines.push_back(sformat("E: MAJOR=%d", node.major));
+    lines.push_back(sformat("E: MINOR=%d", node.minor));
+    lines.push_back("E: SUBSYSTEM=block");
+
+    for (const string& property : node.properties)
+	lines.push_back("E: " + property);
+
+    Mockup::set_command(UDEVADM_BIN " info " + quote(node.name), RemoteCommand(lines, {}, 0));
+
+    const string path = SYSFS_DIR + node.sysfs_path;
+
+    Mockup::set_file(path + "/size", RemoteFile({ to_string(node.sectors) }));
+    Mockup::set_file(path + "/alignment_offset", RemoteFile({ "0" }));
+    Mockup::set_file(path + "/ro", RemoteFile({ "0" }));
+
+    if (!node.partition)
+    {
+	Mockup::set_file(path + "/ext_range", RemoteFile({ "256" }));
+	Mockup::set_file(path + "/queue/logical_block_size", RemoteFile({ "512" }));
+	Mockup::set_file(path + "/queue/optimal_io_size", RemoteFile({ "0" }));
+	Mockup::set_file(path + "/queue/rotational", RemoteFile({ "1" }));
+	Mockup::set_file(path + "/queue/dax", RemoteFile({ "0" }));
+	Mockup::set_file(path + "/queue/zoned", RemoteFile({ "none" }));
+    }
+}
+
+
+void
+Generator::emit_parted(unsigned int i) const
+{
+    const Node& disk = disks[i];
+
+    vector<string> lines = {
+	"{",
+	"   \"disk\": {",
+	"      \"path\": \"" + disk.name + "\",",
+	sformat("      \"size\": \"%llus\",", disk.sectors),
+	"      \"model\": \"ATA GENERATED DISK\",",
+	"      \"transport\": \"scsi\",",
+	"      \"logical-sector-size\": 512,",
+	"      \"physical-sector-size\": 512,",
+	"      \"label\": \"gpt\",",
+	"      \"max-partitions\": 128,",
+	"      \"partitions\": ["
+    };
+
+    for (unsigned int j = 0; j < parameters.partitions; ++j)
+    {
+	const unsigned long long start = 2048 + j * partition_sectors;
+	const string& flag = parted_flags[j * parameters.disks + i];
+
+	lines.push_back(j == 0 ? "         {" : "         },{");
+	lines.push_back(sformat("            \"number\": %d,", j + 1));
+	lines.push_back(sformat("            \"start\": \"%llus\",", start));
+	lines.push_back(sformat("            \"end\": \"%llus\",", start + partition_sectors - 1));
+	lines.push_back(sformat("            \"size\": \"%llus\",", partition_sectors));
+	lines.push_back("            \"type\": \"primary\",");
+
+	if (flag.empty())
+	{
+	    lines.push_back(sformat("            \"type-uuid\": \"%s\"", linux_type_uuid));
+	}
+	else
+	{
+	    lines.push_back(sformat("            \"type-uuid\": \"%s\",", flag == "raid" ? raid_type_uuid :
+				    lvm_type_uuid));
+	    lines.push_back("            \"flags\": [");
+	    lines.push_back("                \"" + flag + "\"");
+	    lines.push_back("            ]");
+	}
+    }
+
+    if (parameters.partitions > 0)
+	lines.push_back("         }");
+
+    lines.insert(lines.end(), { "      ]", "   }", "}" });
+
+    Mockup::set_command(PARTED_BIN " --script --json " + quote(disk.name) + " unit s print",
+			RemoteCommand(lines, {}, 0));
+}
+
+
+void
+Generator::emit_common() const
+{
+    vector<string> sys_block;
+    vector<string> blkid;
+    vector<string> mdstat = { "Personalities : [raid1]" };
+    vector<string> mdadm_conf = { "DEVICE containers partitions" };
+
+    for (unsigned int i = 0; i < parameters.disks; ++i)
+    {
+	sys_block.push_back(disks[i].sysfs_name);
+
+	Mockup::set_command(STAT_BIN " --format '%f' " + quote(disks[i].name), RemoteCommand({ "61b0" }, {}, 0));
+
+	emit_node(disks[i]);
+	emit_parted(i);
+
+	for (const Node& partition : partitions[i])
+	{
+	    emit_node(partition);
+
+	    blkid.push_back(partition.blkid_name + ": " + partition.blkid_tags);
+	}
+    }
+
+    for (const Node& md : mds)
+    {
+	sys_block.push_back(md.sysfs_name);
+
+	Mockup::set_command(STAT_BIN " --format '%f' " + quote(md.name), RemoteCommand({ "61b0" }, {}, 0));
+
+	emit_node(md);
+
+	if (!md.blkid_tags.empty())
+	    blkid.push_back(md.name + ": " + md.blkid_tags);
+
+	string members;
+	for (const string& property : md.properties)
+	{
+	    if (boost::starts_with(property, "MD_DEVICE_dev_") && boost::ends_with(property, "_ROLE=0"))
+		members = property.substr(14, property.size() - 14 - 7) + "[0] " + members;
+	    else if (boost::starts_with(property, "MD_DEVICE_dev_") && boost::ends_with(property, "_ROLE=1"))
+		members += property.substr(14, property.size() - 14 - 7) + "[1] ";
+	}
+
+	mdstat.push_back(md.sysfs_name + " : active raid1 " + members);
+	mdstat.push_back(sformat("      %llu blocks super 1.0 [2/2] [UU]", md.sectors / 2));
+
+	for (const string& property : md.properties)
+	{
+	    if (boost::starts_with(property, "MD_UUID="))
+		mdadm_conf.push_back("ARRAY " + md.name + " UUID=" + property.substr(8));
+	}
+
+	Mockup::set_command(MDADM_BIN " --detail " + quote(md.name) + " --export",
+			    RemoteCommand(md.properties, {}, 0));
+    }
+
+    mdstat.push_back("unused devices: <none>");
+
+    for (const Node& node : lvs)
+    {
+	sys_block.push_back(node.sysfs_name);
+
+	emit_node(node);
+
+	blkid.push_back(node.blkid_name + ": " + node.blkid_tags);
+    }
+
+    for (const Node& node : lukses)
+    {
+	sys_block.push_back(node.sysfs_name);
+
+	emit_node(node);
+
+	blkid.push_back(node.blkid_name + ": " + node.blkid_tags);
+    }
+
+    Mockup::set_command(LS_BIN " -1 --sort=none " + quote(SYSFS_DIR "/block"), RemoteCommand(sys_block, {}, 0));
+    Mockup::set_command(BLKID_BIN " -c '/dev/null'", RemoteCommand(blkid, {}, 0));
+    Mockup::set_command(DMSETUP_BIN " table", RemoteCommand(dmsetup_table, {}, 0));
+
+    Mockup::set_command(LS_BIN " -1l --sort=none " + quote(DEV_DIR "/md"), RemoteCommand({ "total 0" }, {}, 0));
+
+    Mockup::set_file("/proc/mdstat", RemoteFile(mdstat));
+    Mockup::set_file("/etc/mdadm.conf", RemoteFile(mdadm_conf));
+    Mockup::set_file("/etc/crypttab", RemoteFile(crypttab));
+    Mockup::set_file("/etc/fstab", RemoteFile());
+    Mockup::set_file("/proc/mounts", RemoteFile());
+    Mockup::set_file("/proc/swaps", RemoteFile({ "Filename\t\t\t\tType\t\tSize\t\tUsed\t\tPriority" }));
+
+    Mockup::set_command(UDEVADM_BIN_SETTLE, RemoteCommand());
+    Mockup::set_command(GETCONF_BIN " PAGESIZE", RemoteCommand({ "4096" }, {}, 0));
+    Mockup::set_command(UNAME_BIN " -m", RemoteCommand({ "x86_64" }, {}, 0));
+    Mockup::set_command(TEST_BIN " -d " + quote(SYSFS_DIR "/firmware/efi/efivars"), RemoteCommand({}, {}, 1));
+    Mockup::set_command(PARTED_BIN " --version", RemoteCommand({ "parted (GNU parted) 3.5" }, {}, 0));
+    Mockup::set_command(LSSCSI_BIN " --version", RemoteCommand({}, { "release: 0.32  2021/05/05 [svn: r167]" }, 0));
+    Mockup::set_command(LSSCSI_BIN " --transport", RemoteCommand());
+    Mockup::set_command(MULTIPATH_BIN " -d -v 2 -ll", RemoteCommand());
+    Mockup::set_command(DMRAID_BIN " --sets=active -ccc", RemoteCommand({ "no raid disks" }, {}, 1));
+}
+
+
+void
+Generator::generate_lukses()
+{
+    for (Node& lv : lvs)
+    {
+	const string luks_uuid = uuid();
+	const string dm_table_name = "cr_" + boost::replace_all_copy(lv.dm_table_name, "-", "_");
+
+	lv.blkid_tags = "UUID=\"" + luks_uuid + "\" TYPE=\"crypto_LUKS\"";
+	lv.properties.push_back("ID_FS_TYPE=crypto_LUKS");
+	lv.properties.push_back("ID_FS_UUID=" + luks_uuid);
+	lv.links.push_back("disk/by-uuid/" + luks_uuid);
+
+	Node luks;
+	luks.sysfs_name = sformat("dm-%d", next_dm_minor);
+	luks.name = DEV_MAPPER_DIR "/" + dm_table_name;
+	luks.sysfs_path = "/devices/virtual/block/" + luks.sysfs_name;
+	luks.major = 254;
+	luks.minor = next_dm_minor++;
+	luks.sectors = lv.sectors - 4096;
+	luks.links = { "mapper/" + dm_table_name, "disk/by-id/dm-name-" + dm_table_name };
+	luks.properties = { "DM_NAME=" + dm_table_name };
+	luks.dm_table_name = dm_table_name;
+	luks.blkid_name = luks.name;
+
+	dmsetup_table.push_back(sformat("%s: 0 %llu crypt aes-xts-plain64 %s 0 %s 4096", dm_table_name.c_str(),
+					luks.sectors, string(128, '0').c_str(), lv.majorminor().c_str()));
+
+	crypttab.push_back(dm_table_name + "  UUID=" + luks_uuid);
+
+	Mockup::set_command(CRYPTSETUP_BIN " luksDump " + quote(lv.name),
+			    RemoteCommand({ "Version:       \t1", "Cipher name:    aes", "Cipher mode:    xts-plain64",
+					    "MK bits:        512" }, {}, 0));
+
+	Encryption* encryption = lv.blk_device->create_encryption(dm_table_name, EncryptionType::LUKS1);
+	encryption->get_impl().set_region(Region(0, luks.sectors, 512));
+	encryption->get_impl().set_sysfs_name(luks.sysfs_name);
+	encryption->get_impl().set_sysfs_path(luks.sysfs_path);
+	encryption->get_impl().set_cipher("aes-xts-plain64");
+	encryption->get_impl().set_key_size(64);
+	encryption->get_impl().set_crypttab_blk_device_name("UUID=" + luks_uuid);
+	encryption->set_mount_by(MountByType::UUID);
+	encryption->set_in_etc_crypttab(true);
+	to_luks(encryption)->get_impl().set_uuid(luks_uuid);
+	luks.blk_device = encryption;
+
+	lukses.push_back(luks);
+    }
+}
+
+
+/**
+ * Put a XFS on every block device without children. The block devices are
+ * processed in the same order as during probing.
+ */
+void
+Generator::generate_filesystems()
+{
+    map<const BlkDevice*, Node*> nodes;
+
+    for (vector<Node>* tmp : { &disks, &mds, &lvs, &lukses })
+	for (Node& node : *tmp)
+	    nodes[node.blk_device] = &node;
+
+    for (vector<Node>& tmp : partitions)
+	for (Node& node : tmp)
+	    nodes[node.blk_device] = &node;
+
+    for (BlkDevice* blk_device : BlkDevice::get_all(devicegraph))
+    {
+	if (blk_device->has_children())
+	    continue;
+
+	add_filesystem(*nodes.at(blk_device));
+    }
+}
+
+
+/**
+ * The devices of the expected devicegraph are created in the same order
+ * as during probing so that the sids match.
+ */
+void
+Generator::generate()
+{
+    generate_disks();
+    generate_mds();
+    generate_lvm();
+    generate_partitions();
+    generate_holders();
+
+    if (parameters.luks)
+	generate_lukses();
+
+    generate_filesystems();
+
+    emit_common();
+}
+
+
+void
+doit()
+{
+    set_logger(get_logfile_logger());
+
+    Environment environment(true, ProbeMode::NONE, TargetMode::DIRECT);
+
+    Storage storage(environment);
+
+    Devicegraph* devicegraph = storage.get_staging();
+
+    Mockup::set_mode(Mockup::Mode::RECORD);
+
+    Generator generator(devicegraph);
+    generator.generate();
+
+    devicegraph->check();
+    devicegraph->save(parameters.devicegraph_filename);
+
+    if (parameters.binary)
+	Mockup::save_binary(parameters.mockup_filename);
+    else
+	Mockup::save(parameters.mockup_filename);
+}
+
+
+void usage() __attribute__ ((__noreturn__));
+
+void
+usage()
+{
+    cerr << "generate-mockup [--disks n] [--partitions n] [--mds n] [--vgs n] [--pvs-per-vg n] "
+	"[--lvs n] [--luks] [--seed n] [--binary] [--mockup-filename filename] "
+	"[--devicegraph-filename filename]\n"
+	"\n"
+	"Generates a mockup with n disks, n partitions per disk, n MD RAID1s, n VGs with n\n"
+	"PVs each and n LVs per VG, optionally with LUKS on the LVs, together with the\n"
+	"devicegraph expected when probing the mockup.\n";
+    exit(EXIT_FAILURE);
+}
+
+
+unsigned int
+to_number(const char* s)
+{
+    char* end;
+    unsigned long n = strtoul(s, &end, 10);
+    if (*s == '\0' || *end != '\0')
+    {
+	cerr << sformat("Invalid number '%s'.", s) << endl;
+	usage();
+    }
+
+    return n;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    const struct option options[] = {
+	{ "disks",			required_argument,	0,	1 },
+	{ "partitions",			required_argument,	0,	2 },
+	{ "mds",			required_argument,	0,	3 },
+	{ "vgs",			required_argument,	0,	4 },
+	{ "pvs-per-vg",			required_argument,	0,	5 },
+	{ "lvs",			required_argument,	0,	6 },
+	{ "luks",			no_argument,		0,	7 },
+	{ "seed",			required_argument,	0,	8 },
+	{ "binary",			no_argument,		0,	9 },
+	{ "mockup-filename",		required_argument,	0,	10 },
+	{ "devicegraph-filename",	required_argument,	0,	11 },
+	{ 0, 0, 0, 0 }
+    };
+
+    while (true)
+    {
+	int option_index = 0;
+	int c = getopt_long(argc, argv, "", options, &option_index);
+	if (c == -1)
+	    break;
+
+	if (c == '?')
+	    usage();
+
+	switch (c)
+	{
+	    case 1:
+		parameters.disks = to_number(optarg);
+		break;
+
+	    case 2:
+		parameters.partitions = to_number(optarg);
+		break;
+
+	    case 3:
+		parameters.mds = to_number(optarg);
+		break;
+
+	    case 4:
+		parameters.vgs = to_number(optarg);
+		break;
+
+	    case 5:
+		parameters.pvs_per_vg = to_number(optarg);
+		break;
+
+	    case 6:
+		parameters.lvs = to_number(optarg);
+		break;
+
+	    case 7:
+		parameters.luks = true;
+		break;
+
+	    case 8:
+		parameters.seed = to_number(optarg);
+		break;
+
+	    case 9:
+		parameters.binary = true;
+		break;
+
+	    case 10:
+		parameters.mockup_filename = optarg;
+		break;
+
+	    case 11:
+		parameters.devicegraph_filename = optarg;
+		break;
+
+	    default:
+		usage();
+	}
+    }
+
+    if (optind < argc)
+	usage();
+
+    if (parameters.partitions > 128)
+    {
+	cerr << "At most 128 partitions per disk are supported.\n";
+	usage();
+    }
+
+    if (parameters.mds > 0 && (parameters.disks < 2 ||
+			       2 * parameters.mds > parameters.disks * parameters.partitions))
+    {
+	cerr << "Not enough disks or partitions for the MD RAIDs.\n";
+	usage();
+    }
+
+    try
+    {
+	doit();
+    }
+    catch (const exception& e)
+    {
+	cerr << "exception occured: " << e.what() << '\n';
+	exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -23,6 +23,7 @@ bool save_devicegraph = false;
 bool save_mockup = false;
 bool load_mockup = false;
 bool ignore_probe_errors = false;
+string mockup_filename = "mockup.xml";
 View view = View::ALL;
 string rootprefix;
 
@@ -62,7 +63,7 @@ doit()
 
     Environment environment(true, probe_mode, TargetMode::DIRECT);
     environment.set_rootprefix(rootprefix);
-    environment.set_mockup_filename("mockup.xml");
+    environment.set_mockup_filename(mockup_filename);
 
     MyProbeCallbacks my_probe_callbacks;
 
@@ -102,7 +103,7 @@ void
 usage()
 {
     cerr << "probe [--display-devicegraph] [--save-devicegraph] [--save-mockup] [--load-mockup] "
-	"[--ignore-probe-errors] [--view view] [--rootprefix rootprefix]\n";
+	"[--mockup-filename filename] [--ignore-probe-errors] [--view view] [--rootprefix rootprefix]\n";
     exit(EXIT_FAILURE);
 }
 
@@ -118,6 +119,7 @@ main(int argc, char **argv)
 	{ "ignore-probe-errors",	no_argument,		0,	5 },
 	{ "view",			required_argument,	0,	6 },
 	{ "rootprefix",			required_argument,	0,	7 },
+	{ "mockup-filename",		required_argument,	0,	8 },
 	{ 0, 0, 0, 0 }
     };
 
@@ -171,6 +173,10 @@ main(int argc, char **argv)
 		rootprefix = optarg;
 		break;
 
+	    case 8:
+		mockup_filename = optarg;
+		break;
+
 	    default:
 		usage();
 	}